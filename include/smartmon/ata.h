@@ -43,6 +43,7 @@ namespace smartmon {
 
 // 48-bit commands
 #define ATA_READ_LOG_EXT                0x2F
+#define ATA_READ_VERIFY_SECTORS_EXT     0x42
 #define ATA_WRITE_LOG_EXT               0x3f
 
 // ATA Specification Feature Register Values (SMART Subcommands).
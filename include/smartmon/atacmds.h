@@ -16,6 +16,8 @@
 #include <smartmon/ata.h>
 #include <smartmon/dev_interface.h> // ata_device
 
+#include <deque>
+
 namespace smartmon {
 
 typedef enum {
@@ -141,7 +143,9 @@ enum {
   ATTRFLAG_SSD_ONLY    = 0x10, // DEFAULT setting for SSD only
 };
 
-// Vendor attribute display defs for all attribute ids
+// Vendor attribute display defs for all attribute ids.
+// Only entries which have been set are stored.  Adding an entry does not
+// move existing entries, references to entries stay valid.
 class ata_vendor_attr_defs
 {
 public:
@@ -160,14 +164,33 @@ public:
       { byteorder[0] = 0; }
   };
 
+  // Return entry, add a default entry if not yet set.
   entry & operator[](unsigned char id)
-    { return m_defs[id]; }
-
+    {
+      if (!m_index[id]) {
+        m_entries.push_back(entry());
+        m_index[id] = (unsigned short)m_entries.size();
+      }
+      return m_entries[m_index[id] - 1];
+    }
+
+  // Return entry, a default entry if not set.
   const entry & operator[](unsigned char id) const
-    { return m_defs[id]; }
+    {
+      if (!m_index[id])
+        return default_entry();
+      return m_entries[m_index[id] - 1];
+    }
 
 private:
-  entry m_defs[256];
+  unsigned short m_index[256]{}; // Index+1 into m_entries, 0 if not set
+  std::deque<entry> m_entries; // No reallocation on push_back()
+
+  static const entry & default_entry()
+    {
+      static const entry def;
+      return def;
+    }
 };
 
 
@@ -219,6 +242,15 @@ bool ata_nodata_command(ata_device * device, unsigned char command, int sector_c
 // Issue SET FEATURES command with optional sector count register value
 bool ata_set_features(ata_device * device, unsigned char features, int sector_count = -1);
 
+// Issue READ VERIFY SECTOR(S) EXT for NUM_SECTORS (1-65536) sectors at LBA
+bool ata_read_verify_sectors(ata_device * device, uint64_t lba, unsigned num_sectors);
+
+// Same as above, also request the Error and Status registers.  On failure,
+// OUT.out_regs.error is only valid if OUT.out_regs.status is set and has
+// the ERR bit (0x01) set.
+bool ata_read_verify_sectors(ata_device * device, uint64_t lba, unsigned num_sectors,
+                             ata_cmd_out & out);
+
 /* Read S.M.A.R.T information from drive */
 int ataReadSmartValues(ata_device * device,struct ata_smart_values *);
 int ataReadSmartThresholds(ata_device * device, struct ata_smart_thresholds_pvt *);
@@ -382,14 +414,31 @@ ata_attr_state ata_get_attr_state(const ata_smart_attribute & attr,
 uint64_t ata_get_attr_raw_value(const ata_smart_attribute & attr,
                                 const ata_vendor_attr_defs & defs);
 
-// Format attribute raw value.
-std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
-                                      const ata_vendor_attr_defs & defs);
+// Format attribute raw value into STR, return STR.
+const char * ata_format_attr_raw_value(char * str, int strsize,
+                                       const ata_smart_attribute & attr,
+                                       const ata_vendor_attr_defs & defs);
+
+template <size_t SIZE>
+inline const char * ata_format_attr_raw_value(char (& str)[SIZE],
+                                              const ata_smart_attribute & attr,
+                                              const ata_vendor_attr_defs & defs)
+  { return ata_format_attr_raw_value(str, (int)SIZE, attr, defs); }
 
-// Get attribute name
-std::string ata_get_smart_attr_name(unsigned char id,
-                                    const ata_vendor_attr_defs & defs,
-                                    int rpm = 0);
+// Format attribute raw value (std::string variant).
+inline std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
+                                             const ata_vendor_attr_defs & defs)
+{
+  char str[64];
+  return ata_format_attr_raw_value(str, attr, defs);
+}
+
+// Get attribute name.  The returned string is valid as long as DEFS and
+// the default attribute definitions exist and the name of the entry is
+// not changed.  Adding entries for other ids does not invalidate it.
+const char * ata_get_smart_attr_name(unsigned char id,
+                                     const ata_vendor_attr_defs & defs,
+                                     int rpm = 0);
 
 // Find attribute index for attribute id, -1 if not found.
 int ata_find_attr_index(unsigned char id, const ata_smart_values & smartval);
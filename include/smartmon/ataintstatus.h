@@ -0,0 +1,92 @@
+/*
+ * ataintstatus.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SMARTMON_ATAINTSTATUS_H
+#define SMARTMON_ATAINTSTATUS_H
+
+#include <smartmon/smartmon_defs.h>
+
+#include <stdint.h>
+
+#include <functional>
+
+namespace smartmon {
+
+class ata_device;
+
+/////////////////////////////////////////////////////////////////////////////
+// Current and Saved Device Internal Status logs (ACS-4 9.8, 9.21).
+//
+// These GP logs contain vendor specific diagnostic data of up to 65535
+// pages.  Page 0 is a header which specifies the last page of the data
+// areas 1, 2 and 3.  Reading page 0 of the Current log with bit 0 of the
+// LOG SPECIFIC field set initiates a new capture of the data.
+// The data pages are read with multi-sector READ LOG EXT commands.
+// If a command fails, the number of pages per command is halved and the
+// reduced size is kept for further commands.
+
+/// GP log addresses.
+const unsigned char ata_log_current_int_status = 0x24;
+const unsigned char ata_log_saved_int_status   = 0x25;
+
+/// Decoded header (page 0).
+struct ata_int_status_header
+{
+  unsigned char log_address = 0;
+  uint32_t organization_id = 0;            ///< IEEE OUI
+  uint16_t area_last_page[3] = {};         ///< Last page of data area 1, 2, 3
+  bool saved_data_available = false;       ///< Current log only
+  unsigned char saved_data_generation = 0; ///< Current log only
+  unsigned char reason_id[128] = {};       ///< Vendor specific
+};
+
+class ata_int_status_reader
+{
+public:
+  /// Create reader for an open ATA device.  Transfers are limited to
+  /// MAX_CHUNK (1-65535) pages per command.
+  explicit ata_int_status_reader(ata_device * device, unsigned max_chunk = 128)
+    : m_device(device), m_chunk(max_chunk) { }
+
+  /// Read and decode page 0 of the Saved (SAVED=true) or Current log.
+  /// If INITIATE is set, a new capture of the Current log is initiated.
+  /// PAGE0 receives the raw data.
+  /// Return false on error, see device->get_errmsg().
+  bool read_header(bool saved, bool initiate, ata_int_status_header & header,
+                   unsigned char (& page0)[512]);
+
+  /// Called with each chunk of pages, return false to stop.
+  typedef std::function<bool (unsigned page, const unsigned char * data,
+                              unsigned num_pages)> data_callback;
+
+  /// Read pages 1 to LAST_PAGE of the log specified by HEADER and pass
+  /// them to DATA in ascending order.  At most one chunk is held in memory.
+  /// Return false on device error (see device->get_errmsg()) or if stopped.
+  bool read_data(const ata_int_status_header & header, unsigned last_page,
+                 const data_callback & data);
+
+  /// Current number of pages per command, possibly reduced by read_data().
+  unsigned get_chunk() const
+    { return m_chunk; }
+
+private:
+  ata_int_status_reader(const ata_int_status_reader &) = delete;
+  void operator=(const ata_int_status_reader &) = delete;
+
+  ata_device * m_device;
+  unsigned m_chunk;
+
+  bool read_pages(unsigned char logaddr, unsigned char features, unsigned page,
+                  void * data, unsigned num_pages);
+};
+
+} // namespace smartmon
+
+#endif // SMARTMON_ATAINTSTATUS_H
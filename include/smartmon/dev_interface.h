@@ -177,6 +177,18 @@ public:
   static int get_num_objects()
     { return s_num_objects; }
 
+  ///////////////////////////////////////////////
+  // Command statistics
+
+  /// Get number of commands issued through the ATA, SCSI and NVMe
+  /// command layers of the library since the object was created.
+  uint64_t get_num_commands() const
+    { return m_num_commands; }
+
+  /// Add NUM to number of commands, called by the command layers.
+  void count_commands(unsigned num = 1)
+    { m_num_commands += num; }
+
 // Operations
 public:
   ///////////////////////////////////////////////
@@ -213,6 +225,13 @@ public:
   /// Default implementation returns false.
   virtual bool is_powered_down();
 
+  /// Get number of read and write requests completed by the OS block
+  /// layer.  Does not access the device and can be used without 'open()'.
+  /// A change of the number indicates that the device is active.
+  /// Return false if not supported.
+  /// Default implementation returns false.
+  virtual bool get_block_io_count(uint64_t & count);
+
   ///////////////////////////////////////////////
   // Support for tunnelled devices
 
@@ -237,6 +256,7 @@ private:
   smart_interface * m_intf;
   device_info m_info;
   error_info m_err;
+  uint64_t m_num_commands = 0;
 
   // Pointers for to_ata(), to_scsi(), to_nvme()
   // set by ATA/SCSI/NVMe interface classes.
@@ -612,14 +632,42 @@ public:
 
   bool is_spc4_or_higher() const { return spc4_or_above; }
 
+  /// Read the list of supported commands (REPORT SUPPORTED OPERATION
+  /// CODES).  Returns false on error.
   bool query_cmd_support();
 
   bool checked_cmd_support() const { return rsoc_queried; }
 
+  /// Return support level of command OPCODE with service action SA
+  /// (if SA_VALID) as reported by query_cmd_support().  Returns
+  /// SC_SUPPORT_UNKNOWN if not queried or query failed.  If !SA_VALID,
+  /// any service action of OPCODE is sufficient.  SC_NO_SUPPORT is only
+  /// returned if the 'one command' format of REPORT SUPPORTED OPERATION
+  /// CODES confirmed it, or for service actions missing from a complete
+  /// 'all commands' list.
   enum scsi_cmd_support cmd_support_level(uint8_t opcode, bool sa_valid,
                                           uint16_t sa,
                                           bool for_lsense_spc = false) const;
 
+  /// Return true if query_cmd_support() reported that OPCODE is not
+  /// supported.  Used to skip optional commands which would fail.
+  bool cmd_not_supported(uint8_t opcode) const
+    { return (cmd_support_level(opcode, false, 0) == SC_NO_SUPPORT); }
+
+  /// Get mode page PAGENUM/SUBPAGENUM with page control PC (current,
+  /// changeable or default) from the mode page cache.  The cache is
+  /// filled by one MODE SENSE(10) command for all pages (and subpages
+  /// if supported) per page control value.  The page is copied to PBUF
+  /// with header and block descriptors in the format of a MODE SENSE(6)
+  /// or (10) response (MODESE_LEN).  Returns 0 if ok, SIMPLE_ERR_BAD_FIELD
+  /// if the page is not provided, SIMPLE_ERR_BAD_OPCODE if MODE SENSE(10)
+  /// is not supported or -1 if the cache could not be used.
+  int get_cached_mode_page(int pagenum, int subpagenum, int pc,
+                           int modese_len, uint8_t * pBuf, int bufLen);
+
+  /// Discard all cached mode pages.  Called before MODE SELECT.
+  void clear_mode_page_cache();
+
 protected:
   /// Hide/unhide SCSI interface.
   void hide_scsi(bool hide = true)
@@ -632,11 +680,10 @@ protected:
       spc4_or_above(false),
       rsoc_queried(false),
       rsoc_sup(SC_SUPPORT_UNKNOWN),
-      logsense_sup(SC_SUPPORT_UNKNOWN),
       logsense_spc_sup(SC_SUPPORT_UNKNOWN),
-      rcap16_sup(SC_SUPPORT_UNKNOWN),
-      rdefect10_sup(SC_SUPPORT_UNKNOWN),
-      rdefect12_sup(SC_SUPPORT_UNKNOWN)
+      rsoc_complete(false),
+      opcode_sup{},
+      opcode_unsup{}
     { hide_scsi(false); }
 
 private:
@@ -645,11 +692,20 @@ private:
 
   bool rsoc_queried;
   scsi_cmd_support rsoc_sup;
-  scsi_cmd_support logsense_sup;
   scsi_cmd_support logsense_spc_sup;
-  scsi_cmd_support rcap16_sup;
-  scsi_cmd_support rdefect10_sup;
-  scsi_cmd_support rdefect12_sup;
+  bool rsoc_complete; // 'all commands' list was not truncated or malformed
+  uint32_t opcode_sup[256 / 32]; // Bitmap of supported opcodes
+  uint32_t opcode_unsup[256 / 32]; // Bitmap of opcodes confirmed as not supported
+  std::vector<uint32_t> sa_sup; // Sorted (opcode << 16 | service action)
+
+  // MODE SENSE(10) response for all pages, one per page control value
+  struct mode_page_set {
+    signed char state = 0; // 0: not fetched, 1: fetched, -1: failed
+    bool complete = false; // true if response was not truncated
+    std::vector<uint8_t> resp;
+  };
+  mode_page_set mode_pages[3];
+  bool modese10_unsup = false;
 };
 
 
@@ -703,6 +759,16 @@ struct nvme_cmd_out
      { }
 };
 
+/// NVMe pass through parameters and result of one of multiple
+/// independent commands
+struct nvme_cmd_multi
+{
+  nvme_cmd_in in;  ///< Input parameters
+  nvme_cmd_out out; ///< Output parameters
+  bool ok = false; ///< true if command succeeded
+  smart_device::error_info err; ///< Error info if command failed
+};
+
 /// NVMe device access
 class nvme_device
 : virtual public /*extends*/ smart_device
@@ -712,6 +778,20 @@ public:
   /// Return false on error.
   virtual bool nvme_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out) = 0;
 
+  /// NVMe pass through of NUM independent commands.
+  /// The commands may be submitted concurrently and may complete in any
+  /// order if supported by the implementation.  Default implementation
+  /// runs the commands one after another.
+  /// Return false if any command failed, error info is then set to the
+  /// error of the first failed command.
+  virtual bool nvme_pass_through_multi(nvme_cmd_multi * cmds, unsigned num);
+
+  /// NVMe pass through of an NVM command set I/O command.
+  /// Default implementation fails with ENOSYS because the I/O
+  /// opcodes must never be sent to the admin queue.
+  /// Return false on error.
+  virtual bool nvme_io_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out);
+
   /// Get namespace id.
   unsigned get_nsid() const
     { return m_nsid; }
@@ -907,6 +987,22 @@ private:
 /// List of types for DEVICESCAN
 typedef std::vector<std::string> smart_devtype_list;
 
+/// Device identity as provided by the OS without pass-through commands.
+struct os_dev_identity
+{
+  std::string protocol; ///< "ATA", "SCSI" or "NVMe"
+  std::string vendor;   ///< SCSI vendor, empty for ATA and NVMe
+  std::string model;
+  std::string serial;
+  std::string firmware;
+  std::string wwn;      ///< "naa.HEX", "eui.HEX" or empty
+
+  /// Return id suitable for duplicate detection: WWN if available,
+  /// otherwise "PROTOCOL:MODEL:SERIAL" if both are available,
+  /// otherwise empty string.
+  std::string get_unique_id() const;
+};
+
 
 /////////////////////////////////////////////////////////////////////////////
 // smart_interface
@@ -1033,6 +1129,13 @@ public:
   /// but not with 'sat,'.
   virtual bool is_raid_dev_type(const char * type) const;
 
+  /// Get identity of device 'name' with optional 'type' from OS
+  /// (e.g. Linux sysfs) without opening the device.
+  /// Return false if unsupported or if the information is incomplete.
+  /// Default implementation returns false.
+  virtual bool get_os_dev_identity(const char * name, const char * type,
+    os_dev_identity & id);
+
 protected:
   /// Return standard ATA device.
   virtual ata_device * get_ata_device(const char * name, const char * type) = 0;
@@ -1082,6 +1185,12 @@ protected:
   virtual ata_device * get_intelliprop_device(const char * type, ata_device * atadev);
   //{ implemented in dev_intelliprop.cpp }
 
+  /// Return simulated ATA, SCSI or NVMe device for load testing.
+  /// 'type' is "sim,PROTOCOL[,OPTION=VALUE,...]".
+  /// Return 0 if not enabled by 'configure --enable-sim-devices'.
+  virtual smart_device * get_sim_device(const char * name, const char * type);
+  //{ implemented in dev_sim.cpp }
+
   /// Return JMB93x->ATA filter.
   /// Device 'smartdev' is used for ATA or SCSI R/W access.
   /// Return 0 and delete 'scsidev' on error.
@@ -9,6 +9,7 @@
  */
 
 #ifndef SMARTMON_JSON_H
+#define SMARTMON_JSON_H
 
 #include <smartmon/byteorder.h>
 
@@ -103,11 +104,16 @@ private:
 
   typedef std::vector<node_info> node_path;
 
+  struct node;
+
 public:
+  class cursor;
+
   /// Reference to a JSON element.
   class ref
   {
   public:
+    ref(const ref & src);
     ~ref();
 
     /// Return reference to object element.
@@ -166,11 +172,40 @@ public:
     ref(const ref & base, int index);
     ref(const ref & base, const char * /*dummy*/, const char * key_suffix);
 
-    void operator=(const initlist_value & value)
-      { m_js.set_initlist_value(m_path, value); }
+    void operator=(const initlist_value & value);
+
+    /// Return the path from the root node.
+    node_path get_full_path() const;
+    /// Find or create the node, return nullptr if JSON output is disabled.
+    node * find_or_create_node(node_type type) const;
 
     json & m_js;
+    cursor * m_cursor = nullptr; ///< Base of m_path, nullptr if root node
     node_path m_path;
+    bool m_is_cursor = false;
+  };
+
+  /// Reference to a JSON element which is located only once.
+  /// The element is created on first assignment to one of its childs.
+  /// Further assignments to childs start at this element instead of the
+  /// root node.  Use it for many assignments below the same path.
+  /// References to childs must not be used after the cursor is destroyed.
+  class cursor : public ref
+  {
+  public:
+    explicit cursor(const ref & base);
+    ~cursor();
+
+    using ref::operator=;
+
+  private:
+    friend class ref;
+    cursor(const cursor &) = delete;
+    void operator=(const cursor &) = delete;
+
+    node * get_node(node_type type);
+
+    node * m_node = nullptr;
   };
 
   /// Return reference to element of top level object.
@@ -186,6 +221,7 @@ public:
     { ref(*this) += ilist; }
 
   /// Enable/disable JSON output.
+  /// References created while disabled remain without effect.
   void enable(bool yes = true)
     { m_enabled = yes; }
 
@@ -306,15 +342,8 @@ private:
 
   node m_root_node;
 
-  node * find_or_create_node(const node_path & path, node_type type);
-
-  void set_bool(const node_path & path, bool value);
-  void set_int64(const node_path & path, int64_t value);
-  void set_uint64(const node_path & path, uint64_t value);
-  void set_uint128(const node_path & path, uint64_t value_hi, uint64_t value_lo);
-  void set_cstring(const node_path & path, const char * value);
-  void set_string(const node_path & path, const std::string & value);
-  void set_initlist_value(const node_path & path, const initlist_value & value);
+  static node * find_or_create_node(node * p, const node_path & path, node_type type);
+  static void set_node_type(node * p, node_type type);
 
   static void output_json(output_function & prt, bool pretty, bool sorted, const node * p,
     int level);
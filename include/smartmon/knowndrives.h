@@ -46,6 +46,13 @@ int showallpresets();
 // Returns # matching entries.
 int showmatchingpresets(const char *model, const char *firmware);
 
+// Searches drive database for a drive with the given model and firmware
+// strings, both may be nullptr.  The database version of the entry is
+// returned in dbversion if specified.
+// Returns pointer to database entry or nullptr if none found.
+const drive_settings * lookup_drive(const char * model, const char * firmware,
+  std::string * dbversion = nullptr);
+
 // Searches drive database and sets preset vendor attribute
 // options in defs and firmwarebugs.
 // Values that have already been set will not be changed.
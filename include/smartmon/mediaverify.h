@@ -0,0 +1,115 @@
+/*
+ * mediaverify.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SMARTMON_MEDIAVERIFY_H
+#define SMARTMON_MEDIAVERIFY_H
+
+#include <smartmon/smartmon_defs.h>
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace smartmon {
+
+class smart_device;
+
+/////////////////////////////////////////////////////////////////////////////
+// Host-driven media verification.
+//
+// Reads LBA ranges of the medium without transferring data by issuing
+// ATA READ VERIFY SECTOR(S) EXT, SCSI VERIFY(16) or NVMe Verify commands.
+// The throughput can be limited to reduce the impact on other I/O.
+// Chunks which fail with a medium error or exceed a time limit are
+// reported as failed or slow ranges.
+
+/// Parameters of media_verifier::run().
+struct media_verify_options
+{
+  uint64_t end_lba = ~(uint64_t)0; ///< Last LBA to verify, limited to capacity
+  unsigned chunk_blocks = 0;  ///< Blocks per command, 0 = 1 MiB, max 65536
+  unsigned rate_mbps = 0;     ///< Max throughput (MB/s), 0 = unlimited
+  unsigned slow_msec = 1000;  ///< Report chunks taking at least this time
+  unsigned max_seconds = 0;   ///< Stop after this time, 0 = unlimited
+  unsigned max_ranges = 100;  ///< Max number of ranges kept in result
+};
+
+/// Failed or slow range, adjacent chunks are merged.
+struct media_verify_range
+{
+  uint64_t lba = 0;
+  uint64_t num_blocks = 0;
+  unsigned msec = 0;          ///< Max duration of a single chunk
+  bool failed = false;        ///< Medium error, otherwise slow
+};
+
+/// Result of media_verifier::run().
+struct media_verify_result
+{
+  uint64_t next_lba = 0;        ///< First LBA not verified yet
+  uint64_t blocks_verified = 0; ///< Blocks verified by this run
+  uint64_t usec = 0;            ///< Duration of this run
+  unsigned failed_chunks = 0;   ///< Number of failed chunks (or parts)
+  unsigned slow_chunks = 0;     ///< Number of slow chunks
+  bool complete = false;        ///< end_lba has been reached
+  std::vector<media_verify_range> ranges;
+};
+
+class media_verifier
+{
+public:
+  /// Create verifier for an open ATA, SCSI or NVMe device.
+  explicit media_verifier(smart_device * device)
+    : m_device(device) { }
+
+  /// Read capacity of the device (or NVMe namespace).
+  /// Return false on error, see device->get_errmsg().
+  bool init();
+
+  /// Number of logical blocks.
+  uint64_t get_num_blocks() const
+    { return m_num_blocks; }
+
+  /// Logical block size in bytes.
+  unsigned get_block_size() const
+    { return m_block_size; }
+
+  /// Result of verify_chunk().
+  enum chunk_status { CHUNK_OK, CHUNK_MEDIUM_ERROR, CHUNK_DEVICE_ERROR };
+
+  /// Verify NUM_BLOCKS (1-65536) blocks starting at LBA.
+  chunk_status verify_chunk(uint64_t lba, unsigned num_blocks);
+
+  /// Called after each chunk, return false to stop.
+  typedef std::function<bool (const media_verify_result &)> progress_callback;
+
+  /// Verify from START_LBA up to OPTIONS.end_lba.  A failed chunk is
+  /// verified again in smaller parts to narrow the failed range.
+  /// Return false on device error, see device->get_errmsg().
+  /// RESULT is valid in any case.
+  bool run(uint64_t start_lba, const media_verify_options & options,
+           media_verify_result & result,
+           const progress_callback & progress = progress_callback());
+
+private:
+  media_verifier(const media_verifier &) = delete;
+  void operator=(const media_verifier &) = delete;
+
+  smart_device * m_device;
+  uint64_t m_num_blocks = 0;
+  unsigned m_block_size = 0;
+  unsigned m_nsid = 0;
+};
+
+} // namespace smartmon
+
+#endif // SMARTMON_MEDIAVERIFY_H
@@ -209,6 +209,11 @@ enum nvme_admin_opcode {
 //nvme_admin_security_recv = 0x82,
 };
 
+// NVM command set I/O commands, see nvme_device::nvme_io_pass_through()
+enum nvme_io_opcode {
+  nvme_cmd_verify          = 0x0c, // NVMe 1.4
+};
+
 // Figure 213 of NVM Express(TM) Base Specification, revision 2.0a, July 2021
 struct nvme_self_test_result {
   uint8_t   self_test_status;
@@ -16,9 +16,12 @@
 #include <errno.h>
 #include <stddef.h>
 
+#include <string>
+
 namespace smartmon {
 
 class nvme_device;
+struct nvme_cmd_out;
 
 // Broadcast namespace ID.
 constexpr uint32_t nvme_broadcast_nsid = 0xffffffffU;
@@ -48,9 +51,35 @@ bool nvme_read_smart_log(nvme_device * device, uint32_t nsid,
 bool nvme_read_self_test_log(nvme_device * device, uint32_t nsid,
   nvme_self_test_log & self_test_log);
 
+// Request for nvme_read_log_pages().
+struct nvme_log_page_req
+{
+  uint32_t nsid = 0;     // Namespace ID
+  unsigned char lid = 0; // Log page identifier
+  void * data = nullptr; // Data buffer
+  unsigned size = 0;     // Size of buffer, multiple of 4, at most 4096
+  bool ok = false;       // Set to true on success
+  int err_no = 0;        // Error number and message on failure
+  std::string errmsg;
+};
+
+// Read NUM independent log pages.  The commands are submitted concurrently
+// if supported by the device.  SMART/Health Information and Self-test Log
+// are converted to host byte order like the functions above do.
+// Return false if any request failed.
+bool nvme_read_log_pages(nvme_device * device, nvme_log_page_req * reqs, unsigned num);
+
 // Start Self-test
 bool nvme_self_test(nvme_device * device, uint8_t stc, uint32_t nsid);
 
+// Verify NUM_BLOCKS (1-65536) logical blocks starting at LBA.
+// Requires NVMe I/O pass-through support.
+bool nvme_verify(nvme_device * device, uint32_t nsid, uint64_t lba, unsigned num_blocks);
+
+// Same as above, also return completion status in OUT.
+bool nvme_verify(nvme_device * device, uint32_t nsid, uint64_t lba, unsigned num_blocks,
+                 nvme_cmd_out & out);
+
 // Return true if NVMe status indicates an error.
 constexpr bool nvme_status_is_error(uint16_t status)
   { return !!(status & 0x07ff); }
@@ -75,6 +75,9 @@ namespace smartmon {
 #ifndef REPORT_LUNS
 #define REPORT_LUNS  0xa0
 #endif
+#ifndef VERIFY_16
+#define VERIFY_16  0x8f
+#endif
 #ifndef READ_CAPACITY_10
 #define READ_CAPACITY_10  0x25
 #endif
@@ -169,6 +172,28 @@ struct scsiNonMediumError {
     uint64_t counterPE_H;  /* Positioning errors [Hitachi] */
 };
 
+/* Carrier for Zoned block device statistics log page, indexed by
+ * parameter code */
+struct scsiZBDeviceStats {
+    uint8_t gotPC[12];
+    uint64_t counter[12];
+};
+
+/* Carrier for General statistics and performance log page, indexed by
+ * parameter code 1-4 and value number */
+struct scsiGStatsPerf {
+    uint8_t gotParam[5];        /* parameter present */
+    uint8_t gotPC[5];           /* parameter long enough for all values */
+    uint64_t counter[5][8];
+};
+
+/* Carrier for Solid state media log page */
+struct scsiSSMedia {
+    uint8_t gotParam;
+    uint8_t gotPUEI;
+    uint64_t pcntUsedEndurance; /* Percentage used endurance indicator */
+};
+
 struct scsi_readcap_resp {
     uint64_t num_lblocks;       /* Number of Logical Blocks on device */
     uint32_t lb_size;   /* should be available in all non-error cases */
@@ -475,6 +500,9 @@ int scsiSetPowerCondition(scsi_device * device, int power_cond,
 int scsiSendDiagnostic(scsi_device * device, int functioncode, uint8_t *pBuf,
                        int bufLen);
 
+int scsiVerify16(scsi_device * device, uint64_t lba, uint32_t num_blocks,
+                 uint8_t * sense_key = nullptr);
+
 bool scsi_pass_through_yield_sense(scsi_device * device, scsi_cmnd_io * iop,
                                    struct scsi_sense_disect & sinfo);
 
@@ -0,0 +1,170 @@
+/*
+ * scsilogpage.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SMARTMON_SCSILOGPAGE_H
+#define SMARTMON_SCSILOGPAGE_H
+
+#include <smartmon/smartmon_defs.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smartmon {
+
+/////////////////////////////////////////////////////////////////////////////
+// Table-driven decoding of SCSI log pages.
+//
+// A log page (SPC-5 7.3) consists of a 4 byte header followed by log
+// parameters, each with a 4 byte header (parameter code, control byte,
+// length) and parameter data.  A schema describes the parameters of a
+// page as a table of fields which are decoded into the uint64_t members
+// of a plain struct in one pass.
+
+/// Iterates over the complete log parameters of a LOG SENSE response.
+/// Iteration stops at the end of the page, at the end of the buffer
+/// or at the first truncated parameter.
+class scsi_log_param_iterator
+{
+public:
+  /// RESP_LEN is the number of valid bytes in RESP including the
+  /// 4 byte page header.
+  scsi_log_param_iterator(const uint8_t * resp, int resp_len)
+    : m_next(resp + 4),
+      m_remain(resp_len >= 4 ? (resp[2] << 8) | resp[3] : 0)
+    {
+      // Page length is limited by the buffer
+      if (m_remain > resp_len - 4)
+        m_remain = resp_len - 4;
+    }
+
+  /// Advance to next parameter, return false if none is left.
+  bool next()
+    {
+      // Header of each parameter takes 4 bytes
+      if (m_remain < 4)
+        return false;
+      int pl = m_next[3] + 4;
+      if (m_remain < pl) // Truncated parameter
+        return false;
+      m_param = m_next;
+      m_next += pl;
+      m_remain -= pl;
+      return true;
+    }
+
+  /// Parameter code of current parameter.
+  unsigned code() const
+    { return (m_param[0] << 8) | m_param[1]; }
+
+  /// Control byte (DU, TSD, ETC, TMC, FORMAT AND LINKING).
+  uint8_t control() const
+    { return m_param[2]; }
+
+  /// Parameter data following the 4 byte parameter header.
+  const uint8_t * data() const
+    { return m_param + 4; }
+
+  /// Length of parameter data.
+  int data_len() const
+    { return m_param[3]; }
+
+private:
+  const uint8_t * m_next;
+  const uint8_t * m_param = nullptr;
+  int m_remain;
+};
+
+/// Pseudo parameter code of a field which receives all parameters
+/// not listed in the schema.
+const unsigned scsi_log_other_params = 0x10000;
+
+/// No value or no 'got' flag for this field.
+const uint16_t scsi_log_no_offset = 0xffff;
+
+/// Log parameter to struct member mapping.
+struct scsi_log_field
+{
+  unsigned param_code;  ///< Parameter code or scsi_log_other_params
+  uint8_t offset;       ///< Offset of value in parameter data
+  uint8_t width;        ///< Bytes (1-8), 0 = up to end of parameter, last 8 bytes used
+  uint16_t value_offset; ///< Offset of uint64_t value in struct or scsi_log_no_offset
+  uint16_t got_offset;  ///< Offset of uint8_t flag in struct or scsi_log_no_offset
+  const char * name;    ///< Name for printing, key for JSON
+  const char * unit;    ///< Unit for printing, e.g. "%", or nullptr
+};
+
+/// Log page schema.
+struct scsi_log_schema
+{
+  const char * name;
+  const scsi_log_field * fields; ///< Ordered by parameter code
+  unsigned num_fields;
+  size_t struct_size;   ///< sizeof() result struct
+};
+
+/// Decode log page response into the struct described by SCHEMA.
+/// All members are cleared first.  A field is only set if the parameter
+/// is long enough.  RESP_LEN is the number of valid bytes in RESP.
+/// Return number of fields set, -1 if RESULT_SIZE does not match schema.
+int scsi_decode_log_page(const scsi_log_schema & schema, const uint8_t * resp,
+                         int resp_len, void * result, size_t result_size);
+
+/// Typed wrapper for the above.
+template <class T>
+inline int scsi_decode_log_page(const scsi_log_schema & schema, const uint8_t * resp,
+                                int resp_len, T & result)
+{
+  return scsi_decode_log_page(schema, resp, resp_len, &result, sizeof(T));
+}
+
+/// Value of a field in a decoded struct, 0 if field has no value.
+inline uint64_t scsi_log_field_value(const scsi_log_field & field, const void * result)
+{
+  if (field.value_offset == scsi_log_no_offset)
+    return 0;
+  return *reinterpret_cast<const uint64_t *>(
+    static_cast<const char *>(result) + field.value_offset);
+}
+
+/// True if the 'got' flag of a field in a decoded struct is set.
+/// Fields without flag are always present.
+inline bool scsi_log_field_present(const scsi_log_field & field, const void * result)
+{
+  return (   field.got_offset == scsi_log_no_offset
+          || static_cast<const uint8_t *>(result)[field.got_offset]);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Schemas of supported log pages.
+
+/// Write, read and verify error counter log pages (0x02, 0x03, 0x05),
+/// decoded into struct scsiErrorCounter.
+extern const scsi_log_schema scsi_error_counter_schema;
+
+/// Non-medium error log page (0x06),
+/// decoded into struct scsiNonMediumError.
+extern const scsi_log_schema scsi_non_medium_error_schema;
+
+/// Zoned block device statistics log page (0x14,0x01),
+/// decoded into struct scsiZBDeviceStats.
+extern const scsi_log_schema scsi_zb_device_stats_schema;
+
+/// General statistics and performance log page (0x19),
+/// decoded into struct scsiGStatsPerf.  Fields with unit "interval"
+/// count time intervals (parameter 0x0003).
+extern const scsi_log_schema scsi_gen_stats_perf_schema;
+
+/// Solid state media log page (0x11),
+/// decoded into struct scsiSSMedia.
+extern const scsi_log_schema scsi_ss_media_schema;
+
+} // namespace smartmon
+
+#endif // SMARTMON_SCSILOGPAGE_H
@@ -0,0 +1,80 @@
+/*
+ * selftest.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SMARTMON_SELFTEST_H
+#define SMARTMON_SELFTEST_H
+
+#include <smartmon/smartmon_defs.h>
+
+#include <stdint.h>
+
+namespace smartmon {
+
+class smart_device;
+
+/////////////////////////////////////////////////////////////////////////////
+// Protocol independent device self-tests.
+//
+// Starts background short or extended self-tests on ATA, SCSI or NVMe
+// devices and polls their progress and result.  Used to run self-tests
+// on many devices in parallel.
+
+/// Type of self-test.
+enum self_test_type { SELF_TEST_SHORT, SELF_TEST_EXTENDED };
+
+/// State returned by self_test_runner::poll().
+struct self_test_state
+{
+  bool running = false;     ///< A self-test is in progress
+  int percent_done = -1;    ///< Progress of running test, -1 if unknown
+  int status = -1;          ///< Protocol specific result of last test, -1 if none
+  bool passed = false;      ///< Last test completed without error
+  const char * status_str = "No self-test logged";
+};
+
+class self_test_runner
+{
+public:
+  /// Create runner for an open ATA, SCSI or NVMe device.
+  explicit self_test_runner(smart_device * device)
+    : m_device(device) { }
+
+  /// Check self-test support and read the estimated durations.
+  /// Return false on error, see device->get_errmsg().
+  bool init();
+
+  /// Estimated duration of a test in seconds, 0 if unknown.
+  /// Short tests are specified to complete within 2 minutes.
+  unsigned get_duration_sec(self_test_type type) const
+    { return (type == SELF_TEST_SHORT ? m_short_sec : m_extended_sec); }
+
+  /// Start a test in background mode.
+  /// Return false on error, see device->get_errmsg().
+  bool start(self_test_type type);
+
+  /// Abort running test.
+  bool abort();
+
+  /// Read progress of running test or result of last test.
+  /// Return false on error, see device->get_errmsg().
+  bool poll(self_test_state & state);
+
+private:
+  self_test_runner(const self_test_runner &) = delete;
+  void operator=(const self_test_runner &) = delete;
+
+  smart_device * m_device;
+  unsigned m_short_sec = 0, m_extended_sec = 0;
+  uint32_t m_nsid = 0;
+};
+
+} // namespace smartmon
+
+#endif // SMARTMON_SELFTEST_H
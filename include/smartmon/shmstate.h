@@ -0,0 +1,184 @@
+/*
+ * shmstate.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SMARTMON_SHMSTATE_H
+#define SMARTMON_SHMSTATE_H
+
+#include <smartmon/smartmon_defs.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smartmon {
+
+/////////////////////////////////////////////////////////////////////////////
+// Memory mapped device state snapshot written by 'smartd -S FILE'.
+//
+// The file consists of a header followed by one fixed size entry per
+// device.  All values use the native byte order of the writer.
+// Each entry is protected by a sequence lock: the writer increments
+// 'seq' before and after an update, a reader retries if 'seq' was odd
+// or has changed during its copy.  Readers map the file once and read
+// entries without any system calls.
+
+const char shmstate_magic[8] = { 'S', 'M', 'A', 'R', 'T', 'S', 'H', 'M' };
+const uint32_t shmstate_version = 1;
+
+/// Value of unknown or unsupported counters.
+const uint64_t shmstate_na = ~(uint64_t)0;
+
+// shmstate_header::flags
+enum {
+  SHMSTATE_REPLACED = 0x01, // File was replaced by a new one, reopen
+  SHMSTATE_CLOSED   = 0x02  // Writer has exited, no further updates
+};
+
+struct shmstate_header {
+  char magic[8];            // shmstate_magic
+  uint32_t version;         // shmstate_version
+  uint32_t header_size;     // sizeof(shmstate_header)
+  uint32_t entry_size;      // sizeof(shmstate_entry)
+  uint32_t num_entries;     // Number of entries following the header
+  uint32_t flags;           // SHMSTATE_* flags, updated atomically
+  uint32_t pid;             // Process ID of writer, updated atomically
+  int64_t create_time;      // time_t of file creation
+  uint8_t reserved[24];
+};
+SMARTMON_ASSERT_SIZEOF(shmstate_header, 64);
+
+// shmstate_entry::protocol
+enum {
+  SHMSTATE_ATA = 1, SHMSTATE_SCSI = 2, SHMSTATE_NVME = 3
+};
+
+struct shmstate_entry {
+  uint32_t seq;             // Sequence lock, odd during update
+  uint32_t check_count;     // Number of successful checks
+  int64_t check_time;       // time_t of last successful check, 0 if none
+  uint8_t protocol;         // SHMSTATE_ATA, _SCSI, _NVME
+  int8_t health;            // SMART health: 1=passed, -1=failed, 0=not checked
+  uint8_t temperature;      // Current temperature (Celsius), 0 if unknown
+  uint8_t temperature_min;  // Lifetime min/max temperature tracked by smartd,
+  uint8_t temperature_max;  // 0 if unknown
+  uint8_t percentage_used;  // NVMe: Percentage used, 0xff if unknown
+  uint8_t available_spare;  // NVMe: Available spare, 0xff if unknown
+  uint8_t critical_warning; // NVMe: Critical warning bits
+  uint32_t selftest_errors; // Number of failed self-tests in log
+  uint32_t reserved;
+  // Key counters, shmstate_na if unknown:
+  uint64_t power_on_hours;        // ATA: Attribute 9, NVMe: Power on hours
+  uint64_t reallocated_sectors;   // ATA: Attribute 5
+  uint64_t pending_sectors;       // ATA: Attribute 197
+  uint64_t offline_uncorrectable; // ATA: Attribute 198
+  uint64_t media_errors;          // NVMe: Media errors, SCSI: Total uncorrected errors
+  uint64_t error_log_entries;     // ATA: Error log count, NVMe: Error log entries,
+                                  // SCSI: Non-medium errors
+  char name[64];            // Device name with optional extra info
+  char identity[112];       // Model, S/N, WWN, firmware, capacity
+};
+SMARTMON_ASSERT_SIZEOF(shmstate_entry, 256);
+
+/// Initialize ENTRY with unknown values.
+void shmstate_init_entry(shmstate_entry & entry);
+
+/// Creates and updates a state snapshot file.
+class shmstate_writer
+{
+public:
+  shmstate_writer() = default;
+  /// Unmap the file without marking it as closed.  This allows to
+  /// exit the parent process after fork().
+  ~shmstate_writer();
+
+  /// Create new file PATH with NUM_ENTRIES entries initialized
+  /// from ENTRIES.  An existing file is atomically replaced.
+  /// A previously created file is marked as replaced.
+  /// Return false and set errno on error.
+  bool create(const char * path, unsigned num_entries,
+              const shmstate_entry * entries);
+
+  /// Mark file as closed and unmap it.
+  void close();
+
+  /// Set process ID in header to the current process.
+  /// Must be called by the child process after fork().
+  void set_pid();
+
+  /// Return true if a file is mapped.
+  bool is_open() const
+    { return !!m_header; }
+
+  /// Number of entries.
+  unsigned num_entries() const
+    { return (m_header ? m_num_entries : 0); }
+
+  /// Return current data of entry INDEX.
+  const shmstate_entry & get(unsigned index) const;
+
+  /// Replace entry INDEX with ENTRY (except 'seq') under the sequence lock.
+  void update(unsigned index, const shmstate_entry & entry);
+
+private:
+  shmstate_writer(const shmstate_writer &) = delete;
+  void operator=(const shmstate_writer &) = delete;
+
+  void unmap();
+
+  shmstate_header * m_header = nullptr;
+  size_t m_size = 0;
+  unsigned m_num_entries = 0;
+};
+
+/// Reads a state snapshot file.
+class shmstate_reader
+{
+public:
+  shmstate_reader() = default;
+  ~shmstate_reader();
+
+  /// Map file PATH read-only and check the header.
+  /// Return false and set errno on error.
+  bool open(const char * path);
+
+  /// Unmap the file.
+  void close();
+
+  /// Return true if a file is mapped.
+  bool is_open() const
+    { return !!m_header; }
+
+  /// Number of entries.
+  unsigned num_entries() const
+    { return (m_header ? m_num_entries : 0); }
+
+  /// Return SHMSTATE_* flags of the header.
+  unsigned flags() const;
+
+  /// Return process ID of writer.
+  unsigned pid() const
+    { return (m_header ? m_header->pid : 0); }
+
+  /// Copy a consistent snapshot of entry INDEX to ENTRY.
+  /// Return false if INDEX is out of range or the entry was
+  /// modified during all retries.
+  bool read(unsigned index, shmstate_entry & entry) const;
+
+private:
+  shmstate_reader(const shmstate_reader &) = delete;
+  void operator=(const shmstate_reader &) = delete;
+
+  const shmstate_header * m_header = nullptr;
+  size_t m_size = 0;
+  unsigned m_num_entries = 0;
+};
+
+} // namespace smartmon
+
+#endif // SMARTMON_SHMSTATE_H
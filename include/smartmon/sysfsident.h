@@ -0,0 +1,45 @@
+/*
+ * sysfsident.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SMARTMON_SYSFSIDENT_H
+#define SMARTMON_SYSFSIDENT_H
+
+#include <smartmon/dev_interface.h> // os_dev_identity
+
+#include <string>
+
+namespace smartmon {
+
+/// Reads device identity from Linux sysfs attributes which are
+/// cached by the kernel during device probing.  No device is opened
+/// and no command is issued.
+/// The sysfs root directory is configurable for testing.
+class sysfs_identity_reader
+{
+public:
+  explicit sysfs_identity_reader(const char * root = "/sys")
+    : m_root(root) { }
+
+  /// Read identity of kernel device 'kname' (e.g. "sda", "sg1",
+  /// "nvme0", "nvme0n1").
+  /// Return false if the device is unknown or if model or serial
+  /// number are not available.
+  bool read(const char * kname, os_dev_identity & id) const;
+
+private:
+  std::string m_root;
+
+  bool read_scsi(const std::string & devdir, os_dev_identity & id) const;
+  bool read_nvme(const char * ctrl, os_dev_identity & id) const;
+};
+
+} // namespace smartmon
+
+#endif // SMARTMON_SYSFSIDENT_H
@@ -70,6 +70,11 @@ std::string strprintf(const char * fmt, ...)
   SMARTMON_FORMAT_PRINTF(1, 2);
 std::string vstrprintf(const char * fmt, va_list ap);
 
+// Append (v)snprintf() formatted string to STR, truncate if STRSIZE
+// is too small, return STR
+const char * strcatprintf(char * str, int strsize, const char * fmt, ...)
+  SMARTMON_FORMAT_PRINTF(3, 4);
+
 // Return true if STR starts with PREFIX
 inline bool str_starts_with(const char * str, const char * prefix)
   { return !strncmp(str, prefix, strlen(prefix)); }
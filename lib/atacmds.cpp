@@ -256,10 +256,12 @@ bool parse_attribute_def(const char * opt, ata_vendor_attr_defs & defs,
       return false;
   }
 
+  // Check priority without adding entries
+  const ata_vendor_attr_defs & cdefs = defs;
   if (!id) {
     // "N,format" -> set format for all entries
     for (i = 0; i < MAX_ATTRIBUTE_NUM; i++) {
-      if (defs[i].priority >= priority)
+      if (cdefs[i].priority >= priority)
         continue;
       if (attrname[0])
         defs[i].name = attrname;
@@ -269,7 +271,7 @@ bool parse_attribute_def(const char * opt, ata_vendor_attr_defs & defs,
       snprintf(defs[i].byteorder, sizeof(defs[i].byteorder), "%s", byteorder);
     }
   }
-  else if (defs[id].priority <= priority) {
+  else if (cdefs[id].priority <= priority) {
     // "id,format[,name]"
     if (attrname[0])
       defs[id].name = attrname;
@@ -592,6 +594,7 @@ int smartcommandhandler(ata_device * device, smart_command_set command, int sele
 
     auto start_usec = (ata_debugmode ? get_timer_usec() : -1);
 
+    device->count_commands();
     bool ok = device->ata_pass_through(in, out);
 
     if (start_usec >= 0) {
@@ -742,6 +745,7 @@ void ata_get_size_info(const ata_identify_device * id, ata_size_info & sizes)
 // incorrect.  The size (512) is correct for all SMART structures.
 unsigned char checksum(const void * data)
 {
+  // Loop of constant size is fully vectorized, faster than sum8()
   unsigned char sum = 0;
   for (int i = 0; i < 512; i++)
     sum += ((const unsigned char *)data)[i];
@@ -835,6 +839,36 @@ bool ata_set_features(ata_device * device, unsigned char features,
   return device->ata_pass_through(in);
 }
 
+// Issue READ VERIFY SECTOR(S) EXT for NUM_SECTORS (1-65536) sectors at LBA
+bool ata_read_verify_sectors(ata_device * device, uint64_t lba, unsigned num_sectors)
+{
+  if (!(1 <= num_sectors && num_sectors <= 0x10000 && lba < (1ULL << 48)))
+    return device->set_err(EINVAL);
+  ata_cmd_in in;
+  in.in_regs.command = ATA_READ_VERIFY_SECTORS_EXT;
+  in.in_regs.sector_count_16 = (num_sectors & 0xffff); // 0 = 65536
+  in.in_regs.lba_48 = lba;
+  in.in_regs.device = 0x40; // LBA mode
+
+  return device->ata_pass_through(in);
+}
+
+bool ata_read_verify_sectors(ata_device * device, uint64_t lba, unsigned num_sectors,
+                             ata_cmd_out & out)
+{
+  if (!(1 <= num_sectors && num_sectors <= 0x10000 && lba < (1ULL << 48)))
+    return device->set_err(EINVAL);
+  ata_cmd_in in;
+  in.in_regs.command = ATA_READ_VERIFY_SECTORS_EXT;
+  in.in_regs.sector_count_16 = (num_sectors & 0xffff); // 0 = 65536
+  in.in_regs.lba_48 = lba;
+  in.in_regs.device = 0x40; // LBA mode
+  in.out_needed.error = in.out_needed.status = true;
+
+  device->count_commands();
+  return device->ata_pass_through(in, out);
+}
+
 // Reads current Device Identity info (512 bytes) into buf.  Returns 0
 // if all OK.  Returns -1 if no ATA Device identity can be
 // established.  Returns >0 if Device is ATA Packet Device (not SMART
@@ -1108,6 +1142,7 @@ bool ataWriteLogExt(ata_device * device, unsigned char logaddr,
   in.set_data_out(data, nsectors);
 
   ata_cmd_out out;
+  device->count_commands();
   if (!device->ata_pass_through(in, out)) { // TODO: Debug output
     if (nsectors <= 1) {
       lib_printf("ATA_WRITE_LOG_EXT (addr=0x%02x, page=%u, n=%u) failed: %s\n",
@@ -1918,9 +1953,14 @@ static bool check_temp_range(int t, unsigned char ut1, unsigned char ut2,
 }
 
 // Format attribute raw value.
-std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
-                                      const ata_vendor_attr_defs & defs)
+const char * ata_format_attr_raw_value(char * str, int strsize,
+                                       const ata_smart_attribute & attr,
+                                       const ata_vendor_attr_defs & defs)
 {
+  if (strsize <= 0)
+    return str;
+  str[0] = 0;
+
   // Get 48 bit or 64 bit raw value
   uint64_t rawvalue = ata_get_attr_raw_value(attr, defs);
 
@@ -1948,60 +1988,59 @@ std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
   }
 
   // Print
-  std::string s;
   switch (format) {
   case RAWFMT_RAW8:
-    s = strprintf("%d %d %d %d %d %d",
+    strcatprintf(str, strsize, "%d %d %d %d %d %d",
       raw[5], raw[4], raw[3], raw[2], raw[1], raw[0]);
     break;
 
   case RAWFMT_RAW16:
-    s = strprintf("%u %u %u", word[2], word[1], word[0]);
+    strcatprintf(str, strsize, "%u %u %u", word[2], word[1], word[0]);
     break;
 
   case RAWFMT_RAW48:
   case RAWFMT_RAW56:
   case RAWFMT_RAW64:
-    s = strprintf("%" PRIu64, rawvalue);
+    strcatprintf(str, strsize, "%" PRIu64, rawvalue);
     break;
 
   case RAWFMT_HEX48:
-    s = strprintf("0x%012" PRIx64, rawvalue);
+    strcatprintf(str, strsize, "0x%012" PRIx64, rawvalue);
     break;
 
   case RAWFMT_HEX56:
-    s = strprintf("0x%014" PRIx64, rawvalue);
+    strcatprintf(str, strsize, "0x%014" PRIx64, rawvalue);
     break;
 
   case RAWFMT_HEX64:
-    s = strprintf("0x%016" PRIx64, rawvalue);
+    strcatprintf(str, strsize, "0x%016" PRIx64, rawvalue);
     break;
 
   case RAWFMT_RAW16_OPT_RAW16:
-    s = strprintf("%u", word[0]);
+    strcatprintf(str, strsize, "%u", word[0]);
     if (word[1] || word[2])
-      s += strprintf(" (%u %u)", word[2], word[1]);
+      strcatprintf(str, strsize, " (%u %u)", word[2], word[1]);
     break;
 
   case RAWFMT_RAW16_OPT_AVG16:
-    s = strprintf("%u", word[0]);
+    strcatprintf(str, strsize, "%u", word[0]);
     if (word[1])
-      s += strprintf(" (Average %u)", word[1]);
+      strcatprintf(str, strsize, " (Average %u)", word[1]);
     break;
 
   case RAWFMT_RAW24_OPT_RAW8:
-    s = strprintf("%u", (unsigned)(rawvalue & 0x00ffffffULL));
+    strcatprintf(str, strsize, "%u", (unsigned)(rawvalue & 0x00ffffffULL));
     if (raw[3] || raw[4] || raw[5])
-      s += strprintf(" (%d %d %d)", raw[5], raw[4], raw[3]);
+      strcatprintf(str, strsize, " (%d %d %d)", raw[5], raw[4], raw[3]);
     break;
 
   case RAWFMT_RAW24_DIV_RAW24:
-    s = strprintf("%u/%u",
+    strcatprintf(str, strsize, "%u/%u",
       (unsigned)(rawvalue >> 24), (unsigned)(rawvalue & 0x00ffffffULL));
     break;
 
   case RAWFMT_RAW24_DIV_RAW32:
-    s = strprintf("%u/%u",
+    strcatprintf(str, strsize, "%u/%u",
       (unsigned)(rawvalue >> 32), (unsigned)(rawvalue & 0xffffffffULL));
     break;
 
@@ -2011,9 +2050,9 @@ std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
       int64_t temp = word[0]+(word[1]<<16);
       int64_t tmp1 = temp/60;
       int64_t tmp2 = temp%60;
-      s = strprintf("%" PRIu64 "h+%02" PRIu64 "m", tmp1, tmp2);
+      strcatprintf(str, strsize, "%" PRIu64 "h+%02" PRIu64 "m", tmp1, tmp2);
       if (word[2])
-        s += strprintf(" (%u)", word[2]);
+        strcatprintf(str, strsize, " (%u)", word[2]);
     }
     break;
 
@@ -2023,7 +2062,7 @@ std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
       int64_t hours = rawvalue/3600;
       int64_t minutes = (rawvalue-3600*hours)/60;
       int64_t seconds = rawvalue%60;
-      s = strprintf("%" PRIu64 "h+%02" PRIu64 "m+%02" PRIu64 "s", hours, minutes, seconds);
+      strcatprintf(str, strsize, "%" PRIu64 "h+%02" PRIu64 "m+%02" PRIu64 "s", hours, minutes, seconds);
     }
     break;
 
@@ -2032,7 +2071,7 @@ std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
       // 30-second counter
       int64_t hours = rawvalue/120;
       int64_t minutes = (rawvalue-120*hours)/2;
-      s += strprintf("%" PRIu64 "h+%02" PRIu64 "m", hours, minutes);
+      strcatprintf(str, strsize, "%" PRIu64 "h+%02" PRIu64 "m", hours, minutes);
     }
     break;
 
@@ -2042,7 +2081,7 @@ std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
       unsigned hours = (unsigned)(rawvalue & 0xffffffffULL);
       unsigned milliseconds = (unsigned)(rawvalue >> 32);
       unsigned seconds = milliseconds / 1000;
-      s = strprintf("%uh+%02um+%02u.%03us",
+      strcatprintf(str, strsize, "%uh+%02um+%02u.%03us",
         hours, seconds / 60, seconds % 60, milliseconds % 1000);
     }
     break;
@@ -2096,16 +2135,16 @@ std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
 
       switch (tformat) {
         case 0:
-          s = strprintf("%d", t);
+          strcatprintf(str, strsize, "%d", t);
           break;
         case 1: case 2: case 3:
-          s = strprintf("%d (Min/Max %d/%d)", t, lo, hi);
+          strcatprintf(str, strsize, "%d (Min/Max %d/%d)", t, lo, hi);
           break;
         case 4:
-          s = strprintf("%d (Min/Max %d/%d #%d)", t, lo, hi, word[2]);
+          strcatprintf(str, strsize, "%d (Min/Max %d/%d #%d)", t, lo, hi, word[2]);
           break;
         default:
-          s = strprintf("%d (%d %d %d %d %d)", raw[0], raw[5], raw[4], raw[3], raw[2], raw[1]);
+          strcatprintf(str, strsize, "%d (%d %d %d %d %d)", raw[0], raw[5], raw[4], raw[3], raw[2], raw[1]);
           break;
       }
     }
@@ -2113,23 +2152,23 @@ std::string ata_format_attr_raw_value(const ata_smart_attribute & attr,
 
   case RAWFMT_TEMP10X:
     // ten times temperature in Celsius
-    s = strprintf("%d.%d", word[0]/10, word[0]%10);
+    strcatprintf(str, strsize, "%d.%d", word[0]/10, word[0]%10);
     break;
 
   default:
-    s = "?"; // Should not happen
+    strcatprintf(str, strsize, "?"); // Should not happen
     break;
   }
 
-  return s;
+  return str;
 }
 
 // Get attribute name
-std::string ata_get_smart_attr_name(unsigned char id, const ata_vendor_attr_defs & defs,
-                                    int rpm /* = 0 */)
+const char * ata_get_smart_attr_name(unsigned char id, const ata_vendor_attr_defs & defs,
+                                     int rpm /* = 0 */)
 {
   if (!defs[id].name.empty())
-    return defs[id].name;
+    return defs[id].name.c_str();
   else {
      const ata_vendor_attr_defs::entry & def = get_default_attr_defs()[id];
      if (def.name.empty())
@@ -2139,7 +2178,7 @@ std::string ata_get_smart_attr_name(unsigned char id, const ata_vendor_attr_defs
      else if ((def.flags & ATTRFLAG_SSD_ONLY) && rpm > 1)
        return "Unknown_HDD_Attribute";
      else
-       return def.name;
+       return def.name.c_str();
   }
 }
 
@@ -2325,6 +2364,7 @@ static int ataGetSetSCTFeatureControl(ata_device * device, unsigned short featur
     in.out_needed.sector_count = in.out_needed.lba_low = true;
 
   ata_cmd_out out;
+  device->count_commands();
   if (!device->ata_pass_through(in, out)) {
     lib_printf("Write SCT (%cet) Feature Control Command failed: %s\n",
       (!set ? 'G' : 'S'), device->get_errmsg());
@@ -2467,6 +2507,7 @@ static int ataGetSetSCTErrorRecoveryControltime(ata_device * device, unsigned ty
     in.out_needed.sector_count = in.out_needed.lba_low = true;
 
   ata_cmd_out out;
+  device->count_commands();
   if (!device->ata_pass_through(in, out)) {
     lib_printf("Write SCT (%cet) Error Recovery Control Command failed: %s\n",
       (!set ? 'G' : 'S'), device->get_errmsg());
@@ -0,0 +1,97 @@
+/*
+ * ataintstatus.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <smartmon/ataintstatus.h>
+
+#include <smartmon/atacmds.h>
+#include <smartmon/dev_interface.h>
+#include <smartmon/sg_unaligned.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace smartmon {
+
+// READ LOG EXT without the single sector retries of ataReadLogExt().
+bool ata_int_status_reader::read_pages(unsigned char logaddr, unsigned char features,
+                                       unsigned page, void * data, unsigned num_pages)
+{
+  ata_cmd_in in;
+  in.in_regs.command      = ATA_READ_LOG_EXT;
+  in.in_regs.features     = features; // log specific
+  in.set_data_in_48bit(data, num_pages);
+  in.in_regs.lba_low      = logaddr;
+  in.in_regs.lba_mid_16   = page;
+  return m_device->ata_pass_through(in);
+}
+
+bool ata_int_status_reader::read_header(bool saved, bool initiate,
+  ata_int_status_header & header, unsigned char (& page0)[512])
+{
+  header = ata_int_status_header();
+  unsigned char logaddr = (saved ? ata_log_saved_int_status : ata_log_current_int_status);
+  if (initiate && saved)
+    return m_device->set_err(EINVAL, "Capture can only be initiated for the Current log");
+  if (!read_pages(logaddr, (initiate ? 0x01 : 0x00), 0, page0, 1))
+    return false;
+
+  // Some devices return an empty header if no data is available
+  if (page0[0] != logaddr && !(page0[0] == 0 && !page0[8] && !page0[9]))
+    return m_device->set_err(EIO, "Invalid log address 0x%02x in header", page0[0]);
+  header.log_address = logaddr;
+  header.organization_id = sg_get_unaligned_le32(page0 + 4);
+  for (int i = 0; i < 3; i++)
+    header.area_last_page[i] = sg_get_unaligned_le16(page0 + 8 + 2 * i);
+  if (!(   header.area_last_page[0] <= header.area_last_page[1]
+        && header.area_last_page[1] <= header.area_last_page[2]))
+    return m_device->set_err(EIO, "Invalid data area sizes %u, %u, %u in header",
+                             header.area_last_page[0], header.area_last_page[1],
+                             header.area_last_page[2]);
+  if (!saved) {
+    header.saved_data_available = !!(page0[382] & 0x01);
+    header.saved_data_generation = page0[383];
+  }
+  memcpy(header.reason_id, page0 + 384, sizeof(header.reason_id));
+  return true;
+}
+
+bool ata_int_status_reader::read_data(const ata_int_status_header & header,
+  unsigned last_page, const data_callback & data)
+{
+  if (!(1 <= m_chunk && m_chunk <= 0xffff))
+    return m_device->set_err(EINVAL, "Invalid number of pages per command: %u", m_chunk);
+  if (last_page > 0xffff)
+    return m_device->set_err(EINVAL, "Invalid last page: %u", last_page);
+
+  std::vector<unsigned char> buf;
+  for (unsigned page = 1; page <= last_page; ) {
+    unsigned n = std::min(m_chunk, last_page - page + 1);
+    buf.resize(n * 512);
+    if (!read_pages(header.log_address, 0x00, page, buf.data(), n)) {
+      if (n <= 1)
+        return false;
+      // Multi-sector transfer of this size may not be supported by
+      // device, driver or bridge: retry same page with smaller chunks
+      m_chunk = n / 2;
+      continue;
+    }
+    if (!data(page, buf.data(), n))
+      return m_device->set_err(EINTR, "Capture stopped");
+    page += n;
+  }
+  return true;
+}
+
+} // namespace smartmon
@@ -0,0 +1,254 @@
+/*
+ * bench.h - allocation counters and benchmark runner for microbenchmarks
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Used by lib/bench/smartmon-bench.cpp and src/bench/smartctl-bench.cpp.
+// Must be included by exactly one translation unit of a program because
+// it replaces the global operator new and delete.
+
+#ifndef SMARTMON_BENCH_H
+#define SMARTMON_BENCH_H
+
+#include <smartmon/json.h>
+#include <smartmon/smartmon_defs.h>
+#include <smartmon/utility.h>
+
+#include <inttypes.h>
+#include <stdarg.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Program name for messages and JSON output, set by main().
+static const char * bench_name = "bench";
+
+/////////////////////////////////////////////////////////////////////////////
+// Allocation counters
+
+// Counts all allocations done with operator new, also from libsmartmon.
+// Allocations done with malloc() (e.g. by regcomp()) are not counted.
+static uint64_t alloc_count, alloc_bytes;
+
+#if __GNUC__ >= 11 && !defined(__clang__)
+// Replacement operator delete below calls free()
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void * operator new(std::size_t size)
+{
+  alloc_count++; alloc_bytes += size;
+  void * p = std::malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void * operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void * p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+  std::free(p);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Benchmark runner
+
+namespace {
+
+struct bench_options
+{
+  unsigned min_time_ms = 250; // Minimum time of all repetitions
+  unsigned reps = 5;          // Number of repetitions
+  const char * filter = nullptr; // Run only benchmarks containing this string
+};
+
+struct bench_result
+{
+  std::string name;
+  uint64_t iterations = 0;   // Operations per repetition
+  uint64_t median_ns = 0;    // Median time of repetitions
+  uint64_t min_ns = 0;       // Minimum time of repetitions
+  uint64_t allocs = 0;       // Allocations during one repetition
+  uint64_t alloc_bytes = 0;  // Bytes allocated during one repetition
+  bool noalloc = false;      // Must not allocate
+};
+
+// Prevent the compiler from optimizing out benchmarked calls.
+volatile uint64_t bench_sink;
+
+class bench_runner
+{
+public:
+  explicit bench_runner(const bench_options & opts)
+    : m_opts(opts) { }
+
+  /// Run FUNC repeatedly. FUNC performs OPS operations per call.
+  template <typename F>
+  void run(const char * name, F && func, unsigned ops = 1);
+
+  /// Same as run(), but FUNC must not allocate any memory.
+  template <typename F>
+  void run_noalloc(const char * name, F && func, unsigned ops = 1);
+
+  const std::vector<bench_result> & results() const
+    { return m_results; }
+
+private:
+  bench_options m_opts;
+  std::vector<bench_result> m_results;
+
+  template <typename F>
+  static uint64_t time_calls(F & func, uint64_t calls);
+};
+
+template <typename F>
+uint64_t bench_runner::time_calls(F & func, uint64_t calls)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < calls; i++)
+    func();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+template <typename F>
+void bench_runner::run(const char * name, F && func, unsigned ops)
+{
+  if (m_opts.filter && !std::strstr(name, m_opts.filter))
+    return;
+
+  // Warm-up and calibration: double number of calls until one
+  // repetition takes at least min_time / reps
+  uint64_t target_ns = 1000000ULL * m_opts.min_time_ms / m_opts.reps;
+  uint64_t calls = 1;
+  for (;;) {
+    uint64_t ns = time_calls(func, calls);
+    if (ns >= target_ns || calls >= (1ULL << 40))
+      break;
+    if (ns < target_ns / 16)
+      calls *= 8;
+    else
+      calls *= 2;
+  }
+
+  bench_result res;
+  res.name = name;
+  res.iterations = calls * ops;
+
+  std::vector<uint64_t> times;
+  times.reserve(m_opts.reps);
+  for (unsigned r = 0; r < m_opts.reps; r++) {
+    uint64_t c0 = alloc_count, b0 = alloc_bytes;
+    times.push_back(time_calls(func, calls));
+    res.allocs = alloc_count - c0; res.alloc_bytes = alloc_bytes - b0;
+  }
+  std::sort(times.begin(), times.end());
+  res.median_ns = times[times.size() / 2];
+  res.min_ns = times[0];
+  m_results.push_back(res);
+}
+
+template <typename F>
+void bench_runner::run_noalloc(const char * name, F && func, unsigned ops)
+{
+  std::size_t n = m_results.size();
+  run(name, std::forward<F>(func), ops);
+  if (m_results.size() > n)
+    m_results.back().noalloc = true;
+}
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////
+// Checks
+
+static unsigned check_failures;
+
+SMARTMON_FORMAT_PRINTF(1, 2)
+inline void check_failed(const char * fmt, ...)
+{
+  va_list ap; va_start(ap, fmt);
+  std::fprintf(stderr, "%s: check failed: ", bench_name);
+  std::vfprintf(stderr, fmt, ap);
+  std::fputs("\n", stderr);
+  va_end(ap);
+  check_failures++;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Output
+
+inline void print_results(const std::vector<bench_result> & results)
+{
+  std::printf("%-44s %12s %12s %10s %10s\n",
+    "Benchmark", "Iterations", "ns/op", "allocs/op", "bytes/op");
+  for (const auto & r : results) {
+    double n = (double)r.iterations;
+    std::printf("%-44s %12" PRIu64 " %12.1f %10.2f %10.1f\n", r.name.c_str(),
+      r.iterations, r.median_ns / n, r.allocs / n, r.alloc_bytes / n);
+  }
+}
+
+inline void print_results_json(const std::vector<bench_result> & results,
+                               const bench_options & opts)
+{
+  smartmon::json js; js.enable();
+  std::string version = smartmon::format_version_info(bench_name, 1);
+  if (!version.empty() && version.back() == '\n')
+    version.pop_back();
+  js["smartmontools"]["version"] = version;
+  js["options"]["min_time_ms"] = opts.min_time_ms;
+  js["options"]["repetitions"] = opts.reps;
+  for (unsigned i = 0; i < results.size(); i++) {
+    const bench_result & r = results[i];
+    smartmon::json::ref jref = js["benchmarks"][i];
+    jref["name"] = r.name;
+    jref["iterations"] = r.iterations;
+    jref["median_ns"] = r.median_ns;
+    jref["min_ns"] = r.min_ns;
+    jref["ns_per_op"] = (r.median_ns + r.iterations / 2) / r.iterations;
+    jref["allocs"] = r.allocs;
+    jref["alloc_bytes"] = r.alloc_bytes;
+  }
+  smartmon::json::output_options oo;
+  oo.pretty = true;
+  js.output([](const char * str) { std::fputs(str, stdout); }, nullptr, oo);
+}
+
+// Return 1 if checks failed or a benchmark which must not allocate
+// memory did allocate, 0 otherwise.
+inline int get_exit_status(const std::vector<bench_result> & results)
+{
+  int status = (check_failures ? 1 : 0);
+  for (const auto & r : results) {
+    if (r.noalloc && r.allocs) {
+      std::fprintf(stderr, "%s: %s: %" PRIu64 " unexpected allocations\n",
+        bench_name, r.name.c_str(), r.allocs);
+      status = 1;
+    }
+  }
+  return status;
+}
+
+#endif // SMARTMON_BENCH_H
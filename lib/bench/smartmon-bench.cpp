@@ -0,0 +1,767 @@
+/*
+ * smartmon-bench.cpp - microbenchmarks for libsmartmon hot paths
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Build and run with 'make bench'.
+// All inputs are fixed and built into this program, no devices are accessed.
+// Some functions are also checked against reference implementations.
+// The smartctl output functions are benchmarked by src/bench/smartctl-bench.
+
+#include "config.h"
+
+#include <smartmon/dev_interface.h>
+#include <smartmon/atacmds.h>
+#include <smartmon/farmcmds.h>
+#include <smartmon/json.h>
+#include <smartmon/knowndrives.h>
+#include <smartmon/scsicmds.h>
+#include <smartmon/scsilogpage.h>
+#include <smartmon/sg_unaligned.h>
+#include <smartmon/utility.h>
+#include "checksum.h" // Not part of public API
+#include "bench.h"
+#ifdef WITH_DFA_REGEX
+#include "regex_dfa.h" // Not part of public API
+#endif
+
+#include <errno.h>
+#if defined(WITH_DFA_REGEX) && !defined(WITH_CXX11_REGEX)
+#include <sys/types.h> // for regex.h (according to POSIX)
+#include <regex.h>
+#endif
+
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#ifdef WITH_DFA_REGEX
+#include <regex>
+#endif
+
+using namespace smartmon;
+
+/////////////////////////////////////////////////////////////////////////////
+// Checks
+
+#if defined(WITH_DFA_REGEX) && !defined(WITH_CXX11_REGEX)
+
+// Compare regex_dfa::full_match() with regexec() for patterns of the
+// smartd '-s' directive and patterns whose start state is the dead state.
+static void check_regex_dfa()
+{
+  static const char * const patterns[] = {
+    "S/../.././02", "L/../../6/03", "(S/../.././02|L/../../6/03)",
+    "(L/../../7/(00|12)|S/../.././(02|14))", "n/../.././(01|13)",
+    "O/../.././(00|06|12|18)", "[SL]/../../[1-5]/1[0-9]",
+    "C/../(0[1-9]|1[0-5])/./..", "L/(01|04|07|10)/01/./05",
+    "S/../.././0[0-9]", "[Ssc]/(0[1-6])/.[05]/[^67]/1?[2-4]",
+    "r/../../(1|7)/(0[0-9]|2[0-3])", "(S/../.././02)?",
+    "^S/../.././02$", ".*", "x{2,3}", "a?b+",
+    // Start state is the dead state
+    "$a", "^$x", "a^b", "$.", "(x$)y",
+  };
+
+  // Test strings T/MM/DD/d/HH and some others
+  std::vector<std::string> strs = { "", "a", "x", "xx", "xxx", "ab", "S", "S/" };
+  for (char t : std::string("LSCOncr"))
+    for (int mm : { 1, 6, 12 })
+      for (int dd : { 1, 15, 30 })
+        for (int d = 1; d <= 7; d += 3)
+          for (int hh : { 0, 2, 3, 12, 13, 23 })
+            strs.push_back(strprintf("%c/%02d/%02d/%d/%02d", t, mm, dd, d, hh));
+
+  for (const char * pat : patterns) {
+    regex_dfa dfa;
+    if (!dfa.compile(pat)) {
+      check_failed("regex_dfa: \"%s\": compile failed", pat);
+      continue;
+    }
+    regex_t rex;
+    if (regcomp(&rex, pat, REG_EXTENDED)) {
+      check_failed("regex_dfa: \"%s\": regcomp() failed", pat);
+      continue;
+    }
+    for (const std::string & str : strs) {
+      regmatch_t m;
+      bool expect = (   !regexec(&rex, str.c_str(), 1, &m, 0)
+                     && m.rm_so == 0 && m.rm_eo == (int)str.size());
+      int res = dfa.full_match(str.c_str());
+      if (res != (expect ? 1 : 0))
+        check_failed("regex_dfa: \"%s\": full_match(\"%s\") = %d, regexec() = %d",
+                     pat, str.c_str(), res, (int)expect);
+    }
+    regfree(&rex);
+  }
+}
+
+#endif // WITH_DFA_REGEX && !WITH_CXX11_REGEX
+
+#ifdef WITH_DFA_REGEX
+
+// Same as knowndrives.cpp
+static const drive_settings bench_knowndrives[] = {
+#include "drivedb.h"
+};
+
+const unsigned bench_knowndrives_size =
+  sizeof(bench_knowndrives) / sizeof(bench_knowndrives[0]);
+
+// Return comment of LINE, ignore "//" in string literals.
+static const char * get_line_comment(const std::string & line)
+{
+  bool in_str = false;
+  for (size_t i = 0; i < line.size(); i++) {
+    char c = line[i];
+    if (in_str) {
+      if (c == '\\')
+        i++;
+      else if (c == '"')
+        in_str = false;
+    }
+    else if (c == '"')
+      in_str = true;
+    else if (c == '/' && line[i + 1] == '/')
+      return line.c_str() + i + 2;
+  }
+  return "";
+}
+
+// Read the comments of each entry of drivedb.h file PATH.
+// Return false if the entries differ from the builtin table.
+static bool read_drivedb_comments(const char * path, std::vector<std::string> & comments)
+{
+  std::ifstream f(path);
+  if (!f)
+    return false;
+  std::string line;
+  while (std::getline(f, line)) {
+    if (!line.compare(0, 5, "  { \"")) {
+      // Check model family up to first escape or end of string literal
+      unsigned i = comments.size();
+      size_t e = std::min(line.find('"', 5), line.find('\\', 5));
+      if (!(   i < bench_knowndrives_size && e != std::string::npos
+            && !std::strncmp(line.c_str() + 5, bench_knowndrives[i].modelfamily, e - 5)))
+        return false;
+      comments.push_back("");
+    }
+    if (!comments.empty())
+      (comments.back() += get_line_comment(line)) += ' ';
+  }
+  return (comments.size() == bench_knowndrives_size);
+}
+
+// Add matching and non-matching test strings for MODEL/FIRMWARE examples
+// in COMMENT.
+static void get_drivedb_examples(const std::string & comment,
+                                 std::vector<std::string> & models,
+                                 std::vector<std::string> & firmwares)
+{
+  static const std::regex example_re("([-A-Za-z0-9_. ]*[-A-Za-z0-9_.])/([-A-Za-z0-9_.]+)");
+  for (std::sregex_iterator it(comment.begin(), comment.end(), example_re), end;
+       it != end; ++it) {
+    // "tested with APPLE HDD ST3000DM001/AP15": all word suffixes of model
+    std::string model = (*it)[1];
+    for (size_t i = 0; i != std::string::npos; ) {
+      models.push_back(model.substr(i));
+      i = model.find(' ', i);
+      if (i != std::string::npos)
+        i++;
+    }
+    firmwares.push_back((*it)[2]);
+  }
+
+  for (std::vector<std::string> * strs : { &models, &firmwares }) {
+    unsigned n = strs->size();
+    for (unsigned i = 0; i < n; i++) {
+      std::string s = (*strs)[i];
+      strs->push_back(s + 'X');
+      strs->push_back(s.substr(0, s.size() - 1));
+      strs->push_back(' ' + s);
+    }
+    strs->push_back("");
+    strs->push_back("X");
+  }
+}
+
+// Compare regex_dfa::full_match() with std::regex_match() for all model
+// and firmware patterns of the builtin drive database.  Test strings are
+// the examples found in comments of drivedb.h file DBPATH and variants
+// which usually do not match.
+static void check_regex_dfa_drivedb(const char * dbpath)
+{
+  std::vector<std::string> comments;
+  if (!(dbpath && read_drivedb_comments(dbpath, comments))) {
+    std::printf("regex_dfa: drivedb examples not checked, %s\n",
+                (dbpath ? "-B FILE is not the builtin drivedb.h" : "no -B FILE"));
+    comments.assign(bench_knowndrives_size, std::string());
+  }
+
+  for (unsigned i = 0; i < bench_knowndrives_size; i++) {
+    const drive_settings & dbentry = bench_knowndrives[i];
+    std::vector<std::string> models, firmwares;
+    get_drivedb_examples(comments[i], models, firmwares);
+
+    for (bool firmware : { false, true }) {
+      const char * pat = (firmware ? dbentry.firmwareregexp : dbentry.modelregexp);
+      if (!*pat)
+        continue;
+      regex_dfa dfa;
+      if (!dfa.compile(pat))
+        continue; // Not supported, regex backend is used
+      std::regex rex;
+      try {
+        rex.assign(pat, std::regex_constants::extended);
+      }
+      catch (const std::regex_error & ex) {
+        check_failed("regex_dfa: drivedb entry %u: \"%s\": std::regex: %s", i, pat, ex.what());
+        continue;
+      }
+      for (const std::string & str : (firmware ? firmwares : models)) {
+        bool expect = std::regex_match(str, rex);
+        int res = dfa.full_match(str.c_str());
+        if (res != (expect ? 1 : 0))
+          check_failed("regex_dfa: drivedb entry %u: \"%s\": full_match(\"%s\") = %d, "
+                       "std::regex_match() = %d", i, pat, str.c_str(), res, (int)expect);
+      }
+    }
+  }
+}
+
+#endif // WITH_DFA_REGEX
+
+// Bitwise reference implementations of checksum.cpp functions.
+static uint16_t ref_crc16_t10dif(uint16_t crc, const unsigned char * p, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {
+    crc ^= (uint16_t)(p[i] << 8);
+    for (int b = 0; b < 8; b++)
+      crc = (uint16_t)((crc << 1) ^ (crc & 0x8000 ? 0x8bb7 : 0));
+  }
+  return crc;
+}
+
+static uint32_t ref_crc32_mpeg2(uint32_t crc, const unsigned char * p, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {
+    crc ^= (uint32_t)p[i] << 24;
+    for (int b = 0; b < 8; b++)
+      crc = (crc << 1) ^ (crc & 0x80000000 ? 0x04c11db7 : 0);
+  }
+  return crc;
+}
+
+// Compare checksum.cpp functions and ATA checksum() with the reference
+// implementations for random buffers of all sizes up to 1100 bytes at
+// all alignments.
+static void check_checksums()
+{
+  std::minstd_rand rng(42);
+  static unsigned char buf[1100 + 8];
+  for (auto & b : buf)
+    b = (unsigned char)(rng() >> 8);
+
+  for (unsigned off = 0; off < 8; off++) {
+    for (unsigned size = 0; off + size <= sizeof(buf) && size <= 1100; size++) {
+      const unsigned char * p = buf + off;
+      uint16_t crc16 = (uint16_t)rng();
+      uint32_t crc32 = (uint32_t)rng() << 1;
+
+      uint8_t sum = 0;
+      for (unsigned i = 0; i < size; i++)
+        sum += p[i];
+      if (sum8(p, size) != sum)
+        check_failed("sum8(+%u, %u)", off, size);
+      if (size == 512 && checksum(p) != sum)
+        check_failed("checksum(+%u)", off);
+
+      if (crc16_t10dif(crc16, p, size) != ref_crc16_t10dif(crc16, p, size))
+        check_failed("crc16_t10dif(0x%04x, +%u, %u)", crc16, off, size);
+      if (crc32_mpeg2(crc32, p, size) != ref_crc32_mpeg2(crc32, p, size))
+        check_failed("crc32_mpeg2(0x%08x, +%u, %u)", crc32, off, size);
+
+      if (size % 4)
+        continue;
+      unsigned char be[1100];
+      for (unsigned i = 0; i < size; i += 4) {
+        be[i] = p[i+3]; be[i+1] = p[i+2]; be[i+2] = p[i+1]; be[i+3] = p[i];
+      }
+      if (crc32_mpeg2_le32(crc32, p, size / 4) != ref_crc32_mpeg2(crc32, be, size))
+        check_failed("crc32_mpeg2_le32(0x%08x, +%u, %u)", crc32, off, size / 4);
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Fixed inputs
+
+// Identity strings of some common drives and a drive not in the database.
+static const struct {
+  const char * model, * firmware;
+} test_drives[] = {
+  { "ST4000DM004-2CV104", "0001" },
+  { "WDC WD40EFRX-68N32N0", "82.00A82" },
+  { "Samsung SSD 870 EVO 1TB", "SVT01B6Q" },
+  { "TOSHIBA MG07ACA14TE", "0101" },
+  { "SIMULATED DRIVE NOT IN DATABASE", "1.0" },
+};
+
+// Store ATA IDENTIFY string with byte-swapped words.
+static void set_id_string(uint8_t * dest, const char * src, unsigned size)
+{
+  unsigned len = std::strlen(src);
+  for (unsigned i = 0; i < size; i++)
+    dest[i ^ 1] = (i < len ? src[i] : ' ');
+}
+
+// SMART attribute table of a Seagate HDD: ID, flags, current, worst, raw
+static const struct {
+  uint8_t id;
+  uint16_t flags;
+  uint8_t current, worst;
+  uint64_t raw;
+} test_attrs[] = {
+  {   1, 0x000f,  77,  64, 0x00000000031a6c4eULL },
+  {   3, 0x0003,  97,  96, 0 },
+  {   4, 0x0032, 100, 100, 0x000000000000006bULL },
+  {   5, 0x0033, 100, 100, 0 },
+  {   7, 0x000f,  87,  60, 0x0000000c18e5a7c2ULL },
+  {   9, 0x0032,  69,  69, 0x0000000000006b2dULL },
+  {  10, 0x0013, 100, 100, 0 },
+  {  12, 0x0032, 100, 100, 0x000000000000006bULL },
+  { 183, 0x0032, 100, 100, 0 },
+  { 184, 0x0032, 100, 100, 0 },
+  { 187, 0x0032, 100, 100, 0 },
+  { 188, 0x0032, 100, 100, 0x0000000000000000ULL },
+  { 189, 0x003a, 100, 100, 0 },
+  { 190, 0x0022,  62,  50, 0x0000001d26190026ULL },
+  { 191, 0x0032, 100, 100, 0 },
+  { 192, 0x0032, 100, 100, 0x0000000000000046ULL },
+  { 193, 0x0032,  97,  97, 0x0000000000000db2ULL },
+  { 194, 0x0022,  38,  50, 0x0000001200000026ULL },
+  { 197, 0x0012, 100, 100, 0 },
+  { 198, 0x0010, 100, 100, 0 },
+  { 199, 0x003e, 200, 200, 0 },
+  { 240, 0x0000, 100, 253, 0x58f3000069c9ULL },
+  { 241, 0x0000, 100, 253, 0x0000000b6a3cbd1dULL },
+  { 242, 0x0000, 100, 253, 0x0000001c2f1a5e23ULL },
+};
+
+const unsigned num_test_attrs = sizeof(test_attrs) / sizeof(test_attrs[0]);
+
+static void get_test_attrs(ata_smart_attribute (& attrs)[num_test_attrs])
+{
+  for (unsigned i = 0; i < num_test_attrs; i++) {
+    ata_smart_attribute & a = attrs[i];
+    std::memset(&a, 0, sizeof(a));
+    a.id = test_attrs[i].id;
+    sg_put_unaligned_le16(test_attrs[i].flags, &a.flags);
+    a.current = test_attrs[i].current; a.worst = test_attrs[i].worst;
+    for (int j = 0; j < 6; j++)
+      a.raw[j] = (uint8_t)(test_attrs[i].raw >> (8 * j));
+  }
+}
+
+// SCSI Read Error Counter log page (0x03) with all parameters 0-6
+// and a vendor specific parameter.
+static void get_test_err_counter_page(unsigned char (& page)[256], int & len)
+{
+  std::memset(page, 0, sizeof(page));
+  page[0] = READ_ERROR_COUNTER_LPAGE;
+  static const uint64_t values[] = {
+    0, 0, 0, 3482917, 3482917, 93824992236885ULL, 0, 0x1234
+  };
+  unsigned char * p = page + 4;
+  for (int pc = 0; pc < 8; pc++) {
+    int pcode = (pc < 7 ? pc : 0x8001);
+    sg_put_unaligned_be16(pcode, p);
+    p[2] = 0x02; p[3] = 8;
+    sg_put_unaligned_be64(values[pc], p + 4);
+    p += 12;
+  }
+  len = (int)(p - page);
+  sg_put_unaligned_be16(len - 4, page + 2);
+}
+
+// SCSI Zoned block device statistics log page (0x14,0x01) with
+// parameters 0-11.
+static void get_test_zbd_stats_page(unsigned char (& page)[256], int & len)
+{
+  std::memset(page, 0, sizeof(page));
+  page[0] = DEVICE_STATS_LPAGE | 0x40; page[1] = ZB_DEV_STATS_L_SPAGE;
+  unsigned char * p = page + 4;
+  for (int pc = 0; pc < 12; pc++) {
+    sg_put_unaligned_be16(pc, p);
+    p[2] = 0x03; p[3] = 8;
+    sg_put_unaligned_be32(1000 * pc + 17, p + 8);
+    p += 12;
+  }
+  len = (int)(p - page);
+  sg_put_unaligned_be16(len - 4, page + 2);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// FARM log source
+
+// Returns a fixed FARM log (GP log 0xA6) for READ LOG EXT.
+class farm_test_device
+: public /*implements*/ ata_device
+{
+public:
+  static const unsigned num_sectors = 192;
+
+  explicit farm_test_device(smart_interface * intf);
+
+  virtual bool is_open() const override
+    { return true; }
+
+  virtual bool open() override
+    { return true; }
+
+  virtual bool close() override
+    { return true; }
+
+  virtual bool ata_pass_through(const ata_cmd_in & in, ata_cmd_out & out) override;
+
+private:
+  unsigned char m_log[num_sectors * 512];
+};
+
+farm_test_device::farm_test_device(smart_interface * intf)
+: smart_device(intf, "farm", "ata", "ata")
+{
+  const unsigned page_size = sizeof(m_log) / 6;
+  for (unsigned page = 0; page < 6; page++) {
+    unsigned char * p = m_log + page * page_size;
+    for (unsigned i = 0; i < page_size / 8; i++) {
+      uint64_t val = (page == 0 && i == 0 ? 0x00004641524D4552ULL
+                      : ((uint64_t)page << 32) | (i * 12345));
+      sg_put_unaligned_le64(val | (0xC0ULL << 56), p + i * 8);
+    }
+  }
+}
+
+bool farm_test_device::ata_pass_through(const ata_cmd_in & in, ata_cmd_out & /*out*/)
+{
+  if (!(in.in_regs.command == ATA_READ_LOG_EXT && in.in_regs.lba_low == 0xa6
+        && in.direction == ata_cmd_in::data_in))
+    return set_err(ENOSYS);
+  unsigned offset = in.in_regs.lba_mid_16 * 512;
+  if (offset + in.size > sizeof(m_log))
+    return set_err(EINVAL);
+  std::memcpy(in.buffer, m_log + offset, in.size);
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+static void bench_lookup_drive(bench_runner & runner)
+{
+  for (const auto & d : test_drives) {
+    ata_identify_device id{};
+    set_id_string(id.model, d.model, sizeof(id.model));
+    set_id_string(id.fw_rev, d.firmware, sizeof(id.fw_rev));
+    std::string name = strprintf("lookup_drive/%s", d.model);
+    runner.run(name.c_str(), [&id]() {
+      ata_vendor_attr_defs defs; firmwarebug_defs bugs; std::string dbversion;
+      bench_sink = !!lookup_drive_apply_presets(&id, defs, bugs, dbversion);
+    });
+  }
+}
+
+static void bench_format_attr_raw_value(bench_runner & runner)
+{
+  ata_smart_attribute attrs[num_test_attrs];
+  get_test_attrs(attrs);
+
+  // Use the Seagate presets from the drive database
+  ata_identify_device id{};
+  set_id_string(id.model, test_drives[0].model, sizeof(id.model));
+  set_id_string(id.fw_rev, test_drives[0].firmware, sizeof(id.fw_rev));
+  ata_vendor_attr_defs defs; firmwarebug_defs bugs; std::string dbversion;
+  lookup_drive_apply_presets(&id, defs, bugs, dbversion);
+
+  runner.run("ata_format_attr_raw_value/string", [&attrs, &defs]() {
+    for (const auto & a : attrs)
+      bench_sink = ata_format_attr_raw_value(a, defs).size();
+  }, num_test_attrs);
+
+  runner.run_noalloc("ata_format_attr_raw_value", [&attrs, &defs]() {
+    char rawstr[64];
+    for (const auto & a : attrs)
+      bench_sink = ata_format_attr_raw_value(rawstr, a, defs)[0];
+  }, num_test_attrs);
+}
+
+// Build a JSON tree similar to 'smartctl -j -a' output of an ATA device.
+// REF is json::ref or json::cursor.
+template <class REF>
+static void build_test_json(json & js, const ata_vendor_attr_defs & defs)
+{
+  ata_smart_attribute attrs[num_test_attrs];
+  get_test_attrs(attrs);
+
+  js["json_format_version"][0] = 1;
+  js["json_format_version"][1] = 0;
+  js["device"]["name"] = "/dev/sda";
+  js["device"]["type"] = "sat";
+  js["device"]["protocol"] = "ATA";
+  js["model_family"] = "Seagate BarraCuda 3.5 (SMR)";
+  js["model_name"] = test_drives[0].model;
+  js["serial_number"] = "ZFN0A1B2";
+  js["firmware_version"] = test_drives[0].firmware;
+  js["user_capacity"]["blocks"] = 7814037168ULL;
+  js["user_capacity"]["bytes"] = 4000787030016ULL;
+  js["smart_status"]["passed"] = true;
+
+  REF jref(js["ata_smart_attributes"]);
+  jref["revision"] = 10;
+  for (unsigned i = 0; i < num_test_attrs; i++) {
+    const ata_smart_attribute & a = attrs[i];
+    REF jrefi(jref["table"][i]);
+    jrefi["id"] = a.id;
+    jrefi["name"] = ata_get_smart_attr_name(a.id, defs);
+    jrefi["value"] = a.current;
+    jrefi["worst"] = a.worst;
+    jrefi["thresh"] = 0;
+    jrefi["when_failed"] = "";
+    unsigned flags = sg_get_unaligned_le16(&a.flags);
+    jrefi["flags"]["value"] = flags;
+    jrefi["flags"]["prefailure"] = !!(flags & 0x01);
+    jrefi["flags"]["updated_online"] = !!(flags & 0x02);
+    jrefi["raw"]["value"] = ata_get_attr_raw_value(a, defs);
+    jrefi["raw"]["string"] = ata_format_attr_raw_value(a, defs);
+  }
+  js["power_on_time"]["hours"] = 27437;
+  js["power_cycle_count"] = 107;
+  js["temperature"]["current"] = 38;
+}
+
+static void bench_json(bench_runner & runner)
+{
+  ata_vendor_attr_defs defs;
+  runner.run("json/build", [&defs]() {
+    json js; js.enable();
+    build_test_json<json::ref>(js, defs);
+  });
+  runner.run("json/build_cursor", [&defs]() {
+    json js; js.enable();
+    build_test_json<json::cursor>(js, defs);
+  });
+
+  json js; js.enable();
+  build_test_json<json::ref>(js, defs);
+
+  static const struct {
+    const char * name;
+    bool pretty, sorted;
+    char format;
+  } formats[] = {
+    { "json::output/compact", false, false, 0   },
+    { "json::output/pretty" , true , false, 0   },
+    { "json::output/sorted" , true , true , 0   },
+    { "json::output/yaml"   , true , false, 'y' },
+    { "json::output/flat"   , false, false, 'g' },
+  };
+
+  for (const auto & f : formats) {
+    json::output_options opts;
+    opts.pretty = f.pretty; opts.sorted = f.sorted; opts.format = f.format;
+    runner.run(f.name, [&js, &opts]() {
+      size_t len = 0;
+      js.output([](const char * str, size_t * lenp) { *lenp += std::strlen(str); },
+                &len, opts);
+      bench_sink = len;
+    });
+  }
+}
+
+static void bench_scsi_err_counter(bench_runner & runner)
+{
+  unsigned char page[256]; int len;
+  get_test_err_counter_page(page, len);
+  runner.run_noalloc("scsiDecodeErrCounterPage", [&page, len]() {
+    scsiErrorCounter ec;
+    scsiDecodeErrCounterPage(page, &ec, len);
+    bench_sink = ec.counter[5];
+  });
+  runner.run_noalloc("scsi_log_param_iterator", [&page, len]() {
+    uint64_t sum = 0;
+    scsi_log_param_iterator it(page, len);
+    while (it.next())
+      sum += it.code() + it.data_len();
+    bench_sink = sum;
+  });
+}
+
+static void bench_scsi_zbd_stats(bench_runner & runner)
+{
+  unsigned char page[256]; int len;
+  get_test_zbd_stats_page(page, len);
+  runner.run_noalloc("scsi_decode_log_page/zbd_stats", [&page, len]() {
+    scsiZBDeviceStats zbds;
+    scsi_decode_log_page(scsi_zb_device_stats_schema, page, len, zbds);
+    bench_sink = zbds.counter[11];
+  });
+}
+
+// Checksums of 512-byte sectors, ns/op is per sector.
+static void bench_checksums(bench_runner & runner)
+{
+  const unsigned nsectors = 16;
+  static unsigned char data[nsectors * 512];
+  for (unsigned i = 0; i < sizeof(data); i++)
+    data[i] = (unsigned char)(i * 7 + (i >> 9));
+
+  runner.run_noalloc("checksum/512", []() {
+    unsigned sum = 0;
+    for (unsigned i = 0; i < nsectors; i++)
+      sum += checksum(data + i * 512);
+    bench_sink = sum;
+  }, nsectors);
+  runner.run_noalloc("crc16_t10dif/512", []() {
+    unsigned crc = 0;
+    for (unsigned i = 0; i < nsectors; i++)
+      crc ^= crc16_t10dif(0, data + i * 512, 512);
+    bench_sink = crc;
+  }, nsectors);
+  runner.run_noalloc("crc32_mpeg2_le32/508", []() {
+    uint32_t crc = 0;
+    for (unsigned i = 0; i < nsectors; i++)
+      crc ^= crc32_mpeg2_le32(0x52325032, data + i * 512, 127);
+    bench_sink = crc;
+  }, nsectors);
+}
+
+static void bench_farm(bench_runner & runner)
+{
+  std::unique_ptr<farm_test_device> dev(new farm_test_device(smi()));
+  runner.run("ataReadFarmLog", [&dev]() {
+    ataFarmLog farm;
+    if (!ataReadFarmLog(dev.get(), farm, farm_test_device::num_sectors))
+      throw std::runtime_error(dev->get_errmsg());
+    bench_sink = farm.header.signature;
+  });
+}
+
+// Must be run last because each call appends to the drive database.
+static void bench_read_drive_database(bench_runner & runner, const char * path)
+{
+  std::string name = strprintf("read_drive_database/%s", path);
+  runner.run(name.c_str(), [path]() {
+    if (!read_drive_database(path))
+      throw std::runtime_error(strprintf("%s: read_drive_database() failed", path));
+  });
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+
+static int usage(const char * prog, int status)
+{
+  std::printf("%s\n"
+    "Microbenchmarks for libsmartmon\n\n"
+    "Usage: %s [-B FILE] [-c] [-f FILTER] [-j] [-r REPS] [-t MSEC]\n\n"
+    "    -B FILE    Also benchmark read_drive_database(FILE), check regex_dfa\n"
+    "               with the examples if FILE is the builtin drivedb.h\n"
+    "    -c         Run only the checks, no benchmarks\n"
+    "    -f FILTER  Run only benchmarks with names containing FILTER\n"
+    "    -j         Print results in JSON format\n"
+    "    -r REPS    Number of repetitions [5]\n"
+    "    -t MSEC    Minimum time for all repetitions of a benchmark [250]\n"
+    "    -h         Print this help\n"
+    "    -V         Print version information\n",
+    format_version_info("smartmon-bench").c_str(), prog);
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+  try {
+    bench_name = "smartmon-bench";
+    smart_interface::init();
+
+    bench_options opts;
+    const char * dbpath = nullptr;
+    bool print_json = false, checks_only = false;
+
+    for (int ai = 1; ai < argc; ai++) {
+      const char * arg = argv[ai];
+      const char * val = (ai + 1 < argc ? argv[ai + 1] : nullptr);
+      if (!std::strcmp(arg, "-B") && val) {
+        dbpath = val; ai++;
+      }
+      else if (!std::strcmp(arg, "-c")) {
+        checks_only = true;
+      }
+      else if (!std::strcmp(arg, "-f") && val) {
+        opts.filter = val; ai++;
+      }
+      else if (!std::strcmp(arg, "-j")) {
+        print_json = true;
+      }
+      else if (!std::strcmp(arg, "-r") && val && std::atoi(val) > 0) {
+        opts.reps = std::atoi(val); ai++;
+      }
+      else if (!std::strcmp(arg, "-t") && val && std::atoi(val) > 0) {
+        opts.min_time_ms = std::atoi(val); ai++;
+      }
+      else if (!std::strcmp(arg, "-h")) {
+        return usage(argv[0], 0);
+      }
+      else if (!std::strcmp(arg, "-V")) {
+        std::fputs(format_version_info("smartmon-bench", 3).c_str(), stdout);
+        return 0;
+      }
+      else
+        return usage(argv[0], 1);
+    }
+
+    // Use the default database, the builtin one if not installed
+    if (!init_drive_database(true))
+      return 1;
+
+    // Checks
+#if defined(WITH_DFA_REGEX) && !defined(WITH_CXX11_REGEX)
+    check_regex_dfa();
+#endif
+#ifdef WITH_DFA_REGEX
+    check_regex_dfa_drivedb(dbpath);
+#endif
+    check_checksums();
+    if (checks_only) {
+      if (check_failures)
+        return 1;
+      std::printf("All checks passed\n");
+      return 0;
+    }
+
+    bench_runner runner(opts);
+    bench_lookup_drive(runner);
+    bench_format_attr_raw_value(runner);
+    bench_json(runner);
+    bench_scsi_err_counter(runner);
+    bench_scsi_zbd_stats(runner);
+    bench_checksums(runner);
+    bench_farm(runner);
+    if (dbpath)
+      bench_read_drive_database(runner, dbpath);
+
+    if (print_json)
+      print_results_json(runner.results(), opts);
+    else
+      print_results(runner.results());
+
+    return get_exit_status(runner.results());
+  }
+  catch (const std::exception & ex) {
+    std::fprintf(stderr, "smartmon-bench: %s\n", ex.what());
+    return 1;
+  }
+}
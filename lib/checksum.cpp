@@ -0,0 +1,139 @@
+/*
+ * checksum.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "checksum.h"
+
+#include <smartmon/sg_unaligned.h>
+
+// The CRCs use slicing-by-8 tables which process 8 bytes per step.
+// Hardware CRC instructions (x86 SSE4.2, ARMv8) only support the
+// reflected polynomials 0x1edc6f41 and 0x04c11db7 and could not be used.
+
+namespace smartmon {
+
+uint8_t sum8(const void * data, size_t size)
+{
+  const unsigned char * p = (const unsigned char *)data;
+  uint8_t sum = 0;
+  // Blocks of constant size allow auto-vectorization also with -O2
+  for ( ; size >= 64; size -= 64, p += 64) {
+    for (int i = 0; i < 64; i++)
+      sum += p[i];
+  }
+  for (size_t i = 0; i < size; i++)
+    sum += p[i];
+  return sum;
+}
+
+namespace {
+
+// Slicing-by-8 tables: tab[k][b] is the CRC of byte B followed by K
+// zero bytes.
+template <typename T, unsigned Bits, T Poly>
+struct crc_tables
+{
+  T tab[8][256];
+
+  crc_tables()
+    {
+      const T msb = (T)1 << (Bits - 1);
+      for (unsigned b = 0; b < 256; b++) {
+        T c = (T)(b << (Bits - 8));
+        for (int i = 0; i < 8; i++)
+          c = (T)((c << 1) ^ (c & msb ? Poly : 0));
+        tab[0][b] = c;
+      }
+      for (unsigned k = 1; k < 8; k++) {
+        for (unsigned b = 0; b < 256; b++) {
+          T c = tab[k-1][b];
+          tab[k][b] = (T)((c << 8) ^ tab[0][c >> (Bits - 8)]);
+        }
+      }
+    }
+};
+
+typedef crc_tables<uint16_t, 16, 0x8bb7> crc16_t10dif_tables;
+typedef crc_tables<uint32_t, 32, 0x04c11db7> crc32_mpeg2_tables;
+
+const crc16_t10dif_tables & get_crc16_t10dif_tables()
+{
+  static const crc16_t10dif_tables tables;
+  return tables;
+}
+
+const crc32_mpeg2_tables & get_crc32_mpeg2_tables()
+{
+  static const crc32_mpeg2_tables tables;
+  return tables;
+}
+
+// Process one byte.
+inline uint32_t crc32_byte(const uint32_t (& t0)[256], uint32_t crc, uint8_t b)
+{
+  return (crc << 8) ^ t0[(crc >> 24) ^ b];
+}
+
+// Process 8 bytes given as big endian words W0, W1.
+inline uint32_t crc32_step8(const uint32_t (& t)[8][256], uint32_t crc,
+                            uint32_t w0, uint32_t w1)
+{
+  uint32_t x = crc ^ w0;
+  return   t[7][x >> 24] ^ t[6][(x >> 16) & 0xff]
+         ^ t[5][(x >> 8) & 0xff] ^ t[4][x & 0xff]
+         ^ t[3][w1 >> 24] ^ t[2][(w1 >> 16) & 0xff]
+         ^ t[1][(w1 >> 8) & 0xff] ^ t[0][w1 & 0xff];
+}
+
+} // namespace
+
+uint16_t crc16_t10dif(uint16_t crc, const void * data, size_t size)
+{
+  const uint16_t (& t)[8][256] = get_crc16_t10dif_tables().tab;
+  const unsigned char * p = (const unsigned char *)data;
+
+  for ( ; size >= 8; size -= 8, p += 8) {
+    unsigned x = crc ^ sg_get_unaligned_be16(p);
+    crc =   t[7][x >> 8] ^ t[6][x & 0xff] ^ t[5][p[2]] ^ t[4][p[3]]
+          ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+  }
+  for ( ; size > 0; size--, p++)
+    crc = (uint16_t)((crc << 8) ^ t[0][(crc >> 8) ^ *p]);
+  return crc;
+}
+
+uint32_t crc32_mpeg2(uint32_t crc, const void * data, size_t size)
+{
+  const uint32_t (& t)[8][256] = get_crc32_mpeg2_tables().tab;
+  const unsigned char * p = (const unsigned char *)data;
+
+  for ( ; size >= 8; size -= 8, p += 8)
+    crc = crc32_step8(t, crc, sg_get_unaligned_be32(p), sg_get_unaligned_be32(p + 4));
+  for ( ; size > 0; size--, p++)
+    crc = crc32_byte(t[0], crc, *p);
+  return crc;
+}
+
+uint32_t crc32_mpeg2_le32(uint32_t crc, const void * data, size_t nwords)
+{
+  const uint32_t (& t)[8][256] = get_crc32_mpeg2_tables().tab;
+  const unsigned char * p = (const unsigned char *)data;
+
+  for ( ; nwords >= 2; nwords -= 2, p += 8)
+    crc = crc32_step8(t, crc, sg_get_unaligned_le32(p), sg_get_unaligned_le32(p + 4));
+  if (nwords) {
+    for (int i = 3; i >= 0; i--)
+      crc = crc32_byte(t[0], crc, p[i]);
+  }
+  return crc;
+}
+
+} // namespace smartmon
@@ -0,0 +1,38 @@
+/*
+ * checksum.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace smartmon {
+
+/// Return the 8-bit sum of SIZE bytes.
+/// Used for ATA data structures: sum of all 512 bytes is zero if valid.
+uint8_t sum8(const void * data, size_t size);
+
+/// Continue CRC-16 with polynomial 0x8bb7 (T10-DIF) over SIZE bytes.
+/// MSB first, not reflected, no final XOR.
+uint16_t crc16_t10dif(uint16_t crc, const void * data, size_t size);
+
+/// Continue CRC-32 with polynomial 0x04c11db7 over SIZE bytes.
+/// MSB first, not reflected, no final XOR (CRC-32/MPEG-2 if started
+/// with 0xffffffff).
+uint32_t crc32_mpeg2(uint32_t crc, const void * data, size_t size);
+
+/// Same as crc32_mpeg2() but for NWORDS 32-bit little endian words:
+/// the bytes of each word are processed from the most significant byte.
+uint32_t crc32_mpeg2_le32(uint32_t crc, const void * data, size_t nwords);
+
+} // namespace smartmon
+
+#endif // CHECKSUM_H
@@ -12,6 +12,7 @@
 
 #include <smartmon/atacmds.h> // SMARTMON_ATTR_PACKED, SMARTMON_ASSERT_SIZEOF, ata_debugmode
 #include <smartmon/dev_interface.h>
+#include "checksum.h"
 #include "dev_tunnelled.h"
 #include <errno.h>
 
@@ -80,59 +81,13 @@ SMARTMON_ASSERT_SIZEOF(iprop_internal_log, 512);
  */
 static uint16_t iprop_crc16_1(uint8_t * buffer, uint32_t len, bool check_crc)
 {
-  uint8_t crc[16];
-  uint16_t crc_final = 0;
-  uint8_t crc_msb;
-  uint8_t data_msb;
-  uint32_t total_len;
-
-  // Initialize CRC array
-  for (uint32_t ii = 0; ii < 16; ii++) {
-    crc[ii] = 0;
-    //crc[ii] = (crc_in >> ii) & 1;
-  }
-
-  // If calculating a new CRC, we need to pad the data with extra zeroes
-  total_len = check_crc ? len : len + 2;
-
-  // Loop for each byte, plus extra for the CRC itself
-  for (uint32_t ii = 0; ii < total_len; ii++) {
-    uint8_t data = (ii < len) ? buffer[ii] : 0;
-
-    // Loop for each bit
-    for (uint32_t jj = 0; jj < 8; jj++) {
-      crc_msb = crc[15];
-      data_msb = (data >> (8 - jj - 1)) & 1;
-
-      crc[15] = crc[14] ^ crc_msb;
-      crc[14] = crc[13];
-      crc[13] = crc[12];
-      crc[12] = crc[11];
-      crc[11] = crc[10] ^ crc_msb;
-      crc[10] = crc[9];
-      crc[9] = crc[8] ^ crc_msb;
-      crc[8] = crc[7] ^ crc_msb;
-      crc[7] = crc[6] ^ crc_msb;
-      crc[6] = crc[5];
-      crc[5] = crc[4] ^ crc_msb;
-      crc[4] = crc[3] ^ crc_msb;
-      crc[3] = crc[2];
-      crc[2] = crc[1] ^ crc_msb;
-      crc[1] = crc[0] ^ crc_msb;
-      crc[0] = data_msb ^ crc_msb;
-    }
-  }
-
-  // Convert CRC array to final value
-  for (uint32_t ii = 0; ii < 16; ii++) {
-    if (crc[ii] == 1) {
-      crc_final |= (1 << ii);
-    } else {
-      crc_final &= ~(1 << ii);
-    }
-  }
-
-  return crc_final;
+  // CRC-16 T10-DIF, calculated as if the data is padded with two zero
+  // bytes.  Without padding, the CRC bytes are simply XORed.
+  if (!check_crc)
+    return crc16_t10dif(0, buffer, len);
+  if (len < 2)
+    return (len ? buffer[0] : 0);
+  return crc16_t10dif(0, buffer, len - 2) ^ ((buffer[len - 2] << 8) | buffer[len - 1]);
 }
 
 static void iprop_dump_log_structure(struct iprop_internal_log const * const log)
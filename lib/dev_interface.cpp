@@ -103,6 +103,11 @@ bool smart_device::is_powered_down()
   return false;
 }
 
+bool smart_device::get_block_io_count(uint64_t & /*count*/)
+{
+  return false;
+}
+
 bool smart_device::owns(const smart_device * /*dev*/) const
 {
   return false;
@@ -150,6 +155,7 @@ ata_cmd_out::ata_cmd_out()
 
 bool ata_device::ata_pass_through(const ata_cmd_in & in)
 {
+  count_commands();
   ata_cmd_out dummy;
   return ata_pass_through(in, dummy);
 }
@@ -221,6 +227,7 @@ bool scsi_device::scsi_pass_through_and_check(scsi_cmnd_io * iop,
   iop->timeout = SCSI_TIMEOUT_DEFAULT;
 
   // Run cmd
+  count_commands();
   if (!scsi_pass_through(iop)) {
     if (scsi_debugmode > 0)
       lib_printf("%sscsi_pass_through() failed, errno=%d [%s]\n",
@@ -246,6 +253,30 @@ bool scsi_device::scsi_pass_through_and_check(scsi_cmnd_io * iop,
 /////////////////////////////////////////////////////////////////////////////
 // nvme_device
 
+bool nvme_device::nvme_pass_through_multi(nvme_cmd_multi * cmds, unsigned num)
+{
+  const nvme_cmd_multi * failed = nullptr;
+  for (unsigned i = 0; i < num; i++) {
+    nvme_cmd_multi & cmd = cmds[i];
+    cmd.ok = nvme_pass_through(cmd.in, cmd.out);
+    if (cmd.ok)
+      cmd.err.clear();
+    else {
+      cmd.err = get_err();
+      if (!failed)
+        failed = &cmd;
+    }
+  }
+  if (failed)
+    return set_err(failed->err);
+  return true;
+}
+
+bool nvme_device::nvme_io_pass_through(const nvme_cmd_in & /*in*/, nvme_cmd_out & /*out*/)
+{
+  return set_err(ENOSYS, "NVMe I/O commands are not supported by this device type");
+}
+
 bool nvme_device::set_nvme_err(nvme_cmd_out & out, unsigned status, const char * msg /* = 0 */)
 {
   out.status = status;
@@ -324,6 +355,9 @@ std::string smart_interface::get_valid_dev_types_str()
     "usbjmicron[,p][,x][,N], usbprolific, usbsunplus[/sat], sntasmedia[/sat], "
     "sntjmicron[,NSID][/sat], sntrealtek[/sat], jmb39x[-q[2]],N[,sLBA][,force][+TYPE], "
     "jms56x,N[,sLBA][,force][+TYPE]";
+#ifdef WITH_SIM_DEVICES
+  s += ", sim,PROTOCOL[,OPTION=VALUE...]";
+#endif
   // append custom
   std::string s2 = get_valid_custom_dev_types_str();
   if (!s2.empty()) {
@@ -418,6 +452,22 @@ bool smart_interface::is_raid_dev_type(const char * type) const
 }
 
 
+bool smart_interface::get_os_dev_identity(const char * /*name*/, const char * /*type*/,
+                                          os_dev_identity & /*id*/)
+{
+  return false;
+}
+
+std::string os_dev_identity::get_unique_id() const
+{
+  if (!wwn.empty())
+    return wwn;
+  if (model.empty() || serial.empty())
+    return "";
+  return protocol + ':' + model + ':' + serial;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 // Default device factory
 
@@ -496,6 +546,10 @@ smart_device * smart_interface::get_smart_device(const char * name, const char *
     return get_jmb39x_device(jmbtype.c_str(), basedev.release());
   }
 
+  else if (str_starts_with(type, "sim,")) {
+    return get_sim_device(name, type);
+  }
+
   else if (str_starts_with(type, "intelliprop")) {
     // Split "intelliprop...+base..." -> ("intelliprop...", "base...")
     unsigned itllen = strcspn(type, "+");
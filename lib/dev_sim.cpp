@@ -0,0 +1,1365 @@
+/*
+ * dev_sim.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Simulated ATA, SCSI and NVMe devices for load testing of smartd.
+// Selected with '-d sim,ata|scsi|nvme[,OPTION=VALUE,...]'.
+// Device names are arbitrary and only used to seed the model.
+
+#include "config.h"
+
+#include <smartmon/dev_interface.h>
+#include <smartmon/atacmds.h>
+#include <smartmon/scsicmds.h>
+#include <smartmon/nvmecmds.h>
+#include <smartmon/sg_unaligned.h>
+#include <smartmon/utility.h>
+#include "checksum.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef WITH_SIM_DEVICES
+#include <chrono>
+#include <thread>
+#endif
+
+namespace smartmon {
+
+#ifdef WITH_SIM_DEVICES
+
+namespace sim {
+
+/// Parameters of the simulation model, parsed from '-d sim,...'.
+struct sim_model
+{
+  unsigned seed = 0;        ///< Additional seed for the random generator
+  unsigned latency = 0;     ///< Delay of each command (ms)
+  unsigned errors = 0;      ///< Percentage of commands failing with EIO
+  unsigned timeouts = 0;    ///< Percentage of commands timing out
+  unsigned timeout_ms = 0;  ///< Delay before a timed out command returns (ms)
+  unsigned growth = 0;      ///< Percent chance of a new defect per SMART read
+  unsigned fail_after = 0;  ///< Report failing health after N SMART reads, 0 = never
+  unsigned temp = 35;       ///< Base temperature (Celsius)
+  unsigned bad_lba = 0;     ///< Verify of a range containing this LBA fails, 0 = none
+  unsigned id = 0;          ///< Device identity, 0 = from device name and seed
+  unsigned offline_after = 0; ///< open() fails after N opens, 0 = never
+  unsigned test_sec = 0;    ///< Duration of self-tests (s), 0 = complete immediately
+  unsigned standby = 0;     ///< Period (s) of alternating standby and active phases, 0 = always active
+  unsigned intstatus = 0;   ///< Pages of ATA Device Internal Status logs, 0 = no GP logs
+  unsigned max_xfer = 0;    ///< Max sectors per ATA log command, 0 = unlimited
+};
+
+// Parse ',OPTION=VALUE,...' list, return false on error.
+static bool parse_sim_model(const char * args, sim_model & model)
+{
+  static const struct {
+    const char * name;
+    unsigned sim_model::* value;
+    unsigned max;
+  } options[] = {
+    { "seed"      , &sim_model::seed      , ~0U },
+    { "latency"   , &sim_model::latency   , 60000 },
+    { "errors"    , &sim_model::errors    , 100 },
+    { "timeouts"  , &sim_model::timeouts  , 100 },
+    { "timeout_ms", &sim_model::timeout_ms, 600000 },
+    { "growth"    , &sim_model::growth    , 100 },
+    { "fail_after", &sim_model::fail_after, ~0U },
+    { "temp"      , &sim_model::temp      , 120 },
+    { "bad_lba"   , &sim_model::bad_lba   , ~0U },
+    { "id"        , &sim_model::id        , ~0U },
+    { "offline_after", &sim_model::offline_after, ~0U },
+    { "test_sec"  , &sim_model::test_sec  , 86400 },
+    { "standby"   , &sim_model::standby   , 86400 },
+    { "intstatus" , &sim_model::intstatus , 65535 },
+    { "max_xfer"  , &sim_model::max_xfer  , 65535 },
+  };
+
+  while (*args) {
+    char name[15+1] = ""; unsigned val = 0; int n = -1;
+    if (!(sscanf(args, ",%15[a-z_]=%u%n", name, &val, &n) == 2 && n > 0))
+      return false;
+    unsigned i;
+    for (i = 0; i < sizeof(options)/sizeof(options[0]); i++) {
+      if (!strcmp(name, options[i].name))
+        break;
+    }
+    if (i >= sizeof(options)/sizeof(options[0]) || val > options[i].max)
+      return false;
+    model.*options[i].value = val;
+    args += n;
+  }
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// sim_device_base
+
+/// Common functionality of all simulated devices:
+/// Open state, random generator, latency, error and timeout injection.
+class sim_device_base
+: virtual public /*implements*/ smart_device
+{
+protected:
+  sim_device_base(const sim_model & model);
+
+public:
+  virtual bool is_open() const override
+    { return m_is_open; }
+
+  virtual bool open() override;
+
+  virtual bool close() override;
+
+  virtual bool get_block_io_count(uint64_t & count) override;
+
+protected:
+  /// Return pseudo random number (xorshift32).
+  uint32_t next_random();
+
+  /// Return true with a probability of 'pct' percent.
+  bool chance(unsigned pct)
+    { return (pct && next_random() % 100 < pct); }
+
+  /// Simulate command latency and injected errors.
+  /// Return false and set error info if the command should fail.
+  bool begin_command();
+
+  /// Simulate command latency only.
+  void simulate_latency();
+
+  /// Advance the model by one SMART/health read.
+  void advance();
+
+  /// Return true if health check should report failure.
+  bool is_failing() const
+    { return (m_model.fail_after && m_reads >= m_model.fail_after); }
+
+  /// Return true if a verify of NUM sectors at LBA should fail.
+  bool is_bad_range(uint64_t lba, uint64_t num) const
+    { return (m_model.bad_lba && lba <= m_model.bad_lba && m_model.bad_lba < lba + num); }
+
+  /// Start timer of a self-test which runs for 'test_sec' seconds.
+  void start_test()
+    { m_test_end = get_timer_usec() + m_model.test_sec * 1000000LL; }
+
+  /// Stop timer, a following test completes immediately.
+  void stop_test()
+    { m_test_end = 0; }
+
+  /// Return percentage of the running self-test completed,
+  /// -1 if no test is running.
+  int get_test_progress() const;
+
+  /// Return true if device is in a standby phase of the 'standby' cycle.
+  bool in_standby() const
+    { return (m_model.standby && (time(nullptr) / m_model.standby) % 2 == 0); }
+
+  /// Return current temperature, oscillating by up to 8 degrees.
+  unsigned get_temp() const
+    { unsigned t = m_reads % 16; return m_model.temp + (t < 8 ? t : 16 - t); }
+
+  /// Build serial number from device name and seed.
+  std::string get_serial(const char * prefix) const
+    { return strprintf("%s%08X", prefix, m_id); }
+
+  /// Unique id of simulated device.
+  uint32_t get_id() const
+    { return m_id; }
+
+  /// Parameters of the simulation model.
+  const sim_model & get_model() const
+    { return m_model; }
+
+  uint64_t m_reads = 0;         ///< Number of SMART/health reads
+  uint64_t m_defects = 0;       ///< Grown defects (reallocated sectors)
+  uint64_t m_pending = 0;       ///< Pending sectors
+  uint64_t m_errors = 0;        ///< Errors logged by the device
+  unsigned m_power_cycles = 0;  ///< Number of open() calls
+  bool m_no_latency = false;    ///< Commands run concurrently, latency already simulated
+
+private:
+  sim_model m_model;
+  bool m_is_open = false;
+  uint32_t m_id = 0;
+  uint32_t m_rand = 0;
+  long long m_test_end = 0;
+};
+
+sim_device_base::sim_device_base(const sim_model & model)
+: smart_device(never_called),
+  m_model(model)
+{
+  // FNV-1a hash of device name and seed
+  uint32_t h = 0x811c9dc5;
+  for (const char * p = get_dev_name(); *p; p++)
+    h = (h ^ (unsigned char)*p) * 0x01000193;
+  for (int i = 0; i < 4; i++)
+    h = (h ^ (unsigned char)(model.seed >> (i * 8))) * 0x01000193;
+  // Devices with same 'id' simulate multiple paths to one device
+  m_id = (model.id ? model.id : h);
+  m_rand = (m_id ? m_id : 1);
+}
+
+bool sim_device_base::open()
+{
+  if (m_model.offline_after && m_power_cycles >= m_model.offline_after)
+    return set_err(ENXIO, "Simulated path failure");
+  if (!begin_command())
+    return false;
+  m_is_open = true;
+  m_power_cycles++;
+  return true;
+}
+
+bool sim_device_base::close()
+{
+  m_is_open = false;
+  return true;
+}
+
+bool sim_device_base::get_block_io_count(uint64_t & count)
+{
+  if (!m_model.standby)
+    return false;
+  // Host I/O occurs at the begin of each active phase
+  count = (time(nullptr) / m_model.standby + 1) / 2;
+  return true;
+}
+
+int sim_device_base::get_test_progress() const
+{
+  if (!m_test_end)
+    return -1;
+  long long remain = m_test_end - get_timer_usec();
+  if (remain <= 0)
+    return -1;
+  return 100 - (int)(remain / (m_model.test_sec * 10000LL)) - 1;
+}
+
+uint32_t sim_device_base::next_random()
+{
+  uint32_t x = m_rand;
+  x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+  m_rand = x;
+  return x;
+}
+
+bool sim_device_base::begin_command()
+{
+  if (chance(m_model.timeouts)) {
+    if (m_model.timeout_ms)
+      std::this_thread::sleep_for(std::chrono::milliseconds(m_model.timeout_ms));
+    return set_err(ETIMEDOUT, "Simulated command timeout");
+  }
+  if (!m_no_latency)
+    simulate_latency();
+  if (chance(m_model.errors))
+    return set_err(EIO, "Simulated I/O error");
+  return true;
+}
+
+void sim_device_base::simulate_latency()
+{
+  if (m_model.latency)
+    std::this_thread::sleep_for(std::chrono::milliseconds(m_model.latency));
+}
+
+void sim_device_base::advance()
+{
+  m_reads++;
+  if (chance(m_model.growth)) {
+    // New defect: Either pending or directly reallocated
+    if (next_random() & 1)
+      m_pending++;
+    else
+      m_defects++;
+    m_errors++;
+  }
+  else if (m_pending && chance(50)) {
+    // Pending sector reallocated on rewrite
+    m_pending--;
+    m_defects++;
+  }
+}
+
+// Put ATA string into IDENTIFY data (two chars per word, first in high byte).
+static void put_ata_string(unsigned char * dest, const char * src, unsigned n)
+{
+  unsigned len = strlen(src);
+  for (unsigned i = 0; i < n; i++)
+    dest[i ^ 1] = (i < len ? src[i] : ' ');
+}
+
+// Put SCSI string, padded with spaces.
+static void put_scsi_string(unsigned char * dest, const char * src, unsigned n)
+{
+  unsigned len = strlen(src);
+  for (unsigned i = 0; i < n; i++)
+    dest[i] = (i < len ? src[i] : ' ');
+}
+
+// Set checksum of ATA data structure in last byte.
+static void set_ata_checksum(unsigned char * data)
+{
+  data[511] = -sum8(data, 511);
+}
+
+// Simulated capacity: 4 TB, 512 byte sectors
+const uint64_t sim_num_sectors = 7814037168ULL;
+
+/////////////////////////////////////////////////////////////////////////////
+// sim_ata_device
+
+class sim_ata_device
+: public /*implements*/ ata_device,
+  public /*extends*/ sim_device_base
+{
+public:
+  sim_ata_device(smart_interface * intf, const char * dev_name,
+    const char * req_type, const sim_model & model);
+
+  virtual bool ata_pass_through(const ata_cmd_in & in, ata_cmd_out & out) override;
+
+private:
+  bool smart_command(const ata_cmd_in & in, ata_cmd_out & out);
+  bool read_gp_log(const ata_cmd_in & in);
+
+  void get_identify(unsigned char * data);
+  void get_smart_values(unsigned char * data);
+  void get_smart_thresholds(unsigned char * data);
+  void get_error_log(unsigned char * data);
+  void get_selftest_log(unsigned char * data);
+
+  void add_selftest(unsigned char number, unsigned char status);
+  void update_selftest();
+
+  // Circular self-test log, index of most recent entry + 1, 0 if empty
+  struct selftest_entry {
+    unsigned char number, status;
+    uint16_t hours;
+  };
+  selftest_entry m_selftests[21] = {};
+  unsigned m_selftest_index = 0;
+  unsigned char m_running_test = 0; ///< Self-test in progress, 0 if none
+  unsigned char m_exec_status = 0;  ///< Execution status of last self-test
+  unsigned char m_intstatus_gen = 0; ///< Generation of Current Device Internal Status data
+};
+
+// Simulated attributes: ID, flags, threshold
+static const struct {
+  unsigned char id;
+  unsigned short flags;
+  unsigned char thresh;
+} sim_ata_attrs[] = {
+  {   1, 0x000f,  6 }, // Raw_Read_Error_Rate
+  {   5, 0x0033, 10 }, // Reallocated_Sector_Ct
+  {   9, 0x0032,  0 }, // Power_On_Hours
+  {  12, 0x0032, 20 }, // Power_Cycle_Count
+  { 194, 0x0022,  0 }, // Temperature_Celsius
+  { 197, 0x0012,  0 }, // Current_Pending_Sector
+  { 198, 0x0010,  0 }, // Offline_Uncorrectable
+  { 199, 0x003e,  0 }, // UDMA_CRC_Error_Count
+};
+
+sim_ata_device::sim_ata_device(smart_interface * intf, const char * dev_name,
+    const char * req_type, const sim_model & model)
+: smart_device(intf, dev_name, "sim", req_type),
+  sim_device_base(model)
+{
+  set_info().info_name = strprintf("%s [SIM ATA]", dev_name);
+}
+
+bool sim_ata_device::ata_pass_through(const ata_cmd_in & in, ata_cmd_out & out)
+{
+  if (!ata_cmd_is_supported(in,
+    supports_data_out | supports_output_regs | supports_multi_sector | supports_48bit,
+    "sim"))
+    return false;
+  if (!begin_command())
+    return false;
+
+  unsigned char * data = (unsigned char *)in.buffer;
+  switch (in.in_regs.command) {
+    case ATA_IDENTIFY_DEVICE:
+      if (in.size != 512)
+        break;
+      get_identify(data);
+      return true;
+    case ATA_CHECK_POWER_MODE:
+      out.out_regs.sector_count = (in_standby() ? 0x00 : 0xff); // Standby, active or idle
+      return true;
+    case ATA_SMART_CMD:
+      if (smart_command(in, out))
+        return true;
+      break;
+    case ATA_READ_VERIFY_SECTORS_EXT: {
+      if (!in.in_regs.is_48bit_cmd())
+        break;
+      uint64_t lba = in.in_regs.lba_48;
+      unsigned num = in.in_regs.sector_count_16;
+      if (!num)
+        num = 0x10000;
+      if (lba + num > sim_num_sectors) {
+        out.out_regs.error = 0x10; out.out_regs.status = 0x51; // IDNF
+        return set_err(EIO, "Simulated address not found");
+      }
+      if (is_bad_range(lba, num)) {
+        out.out_regs.error = 0x40; out.out_regs.status = 0x51; // UNC
+        return set_err(EIO, "Simulated uncorrectable error");
+      }
+      return true;
+    }
+    case ATA_READ_LOG_EXT:
+      if (read_gp_log(in))
+        return true;
+      break;
+    default:
+      break;
+  }
+  out.out_regs.error = 0x04; out.out_regs.status = 0x51; // ABRT
+  return set_err(EIO, "Simulated command abort");
+}
+
+// GP Log Directory and Device Internal Status logs (0x24, 0x25) if
+// 'intstatus=N' is specified.  Data areas 1, 2, 3 end at N/4, N/2, N.
+bool sim_ata_device::read_gp_log(const ata_cmd_in & in)
+{
+  unsigned n = get_model().intstatus;
+  unsigned num = in.in_regs.sector_count_16;
+  if (!(n && in.in_regs.is_48bit_cmd() && num && in.size == num * 512))
+    return false;
+  if (get_model().max_xfer && num > get_model().max_xfer)
+    return set_err(EIO, "Simulated transfer size limit");
+  unsigned char * data = (unsigned char *)in.buffer;
+  unsigned char logaddr = in.in_regs.lba_low;
+  unsigned page = in.in_regs.lba_mid_16;
+  switch (logaddr) {
+    case 0x00: // Log directory: version 1, N+1 pages each for 0x24, 0x25
+      if (!(page == 0 && num == 1))
+        return false;
+      memset(data, 0, 512);
+      data[0] = 0x01;
+      for (unsigned a : {0x24, 0x25}) {
+        data[2 * a] = (unsigned char)(n + 1); data[2 * a + 1] = (unsigned char)((n + 1) >> 8);
+      }
+      return true;
+    case 0x24: case 0x25:
+      break;
+    default:
+      return false;
+  }
+  if (page + num > n + 1)
+    return false;
+  if (logaddr == 0x24 && page == 0 && (in.in_regs.features & 0x01))
+    m_intstatus_gen++; // Initiate new capture
+  unsigned char gen = (logaddr == 0x24 ? m_intstatus_gen : 0);
+  for (unsigned i = 0; i < num; i++, page++) {
+    unsigned char * p = data + i * 512;
+    if (page == 0) {
+      memset(p, 0, 512);
+      p[0] = logaddr;
+      sg_put_unaligned_le32(0x00a0b1c2, p + 4); // Organization ID
+      sg_put_unaligned_le16(n / 4, p + 8);
+      sg_put_unaligned_le16(n / 2, p + 10);
+      sg_put_unaligned_le16(n, p + 12);
+      if (logaddr == 0x24) {
+        p[382] = 0x01; // Saved data available
+        p[383] = gen;
+      }
+      snprintf((char *)p + 384, 128, "SIM %s", (logaddr == 0x24 ? "current" : "saved"));
+      continue;
+    }
+    // Pattern identifies log, generation and page
+    for (unsigned j = 0; j < 512; j += 4) {
+      p[j] = logaddr; p[j + 1] = gen;
+      sg_put_unaligned_le16(page, p + j + 2);
+    }
+  }
+  return true;
+}
+
+void sim_ata_device::add_selftest(unsigned char number, unsigned char status)
+{
+  selftest_entry & e = m_selftests[m_selftest_index % 21];
+  e.number = number; e.status = status;
+  e.hours = (uint16_t)(24 * 365 + m_reads);
+  m_selftest_index = m_selftest_index % 21 + 1;
+  m_exec_status = status;
+}
+
+// Log result of running self-test if completed, failing if there are
+// pending sectors.
+void sim_ata_device::update_selftest()
+{
+  if (m_running_test && get_test_progress() < 0) {
+    add_selftest(m_running_test, (m_pending ? 0x70 : 0x00));
+    m_running_test = 0;
+  }
+}
+
+bool sim_ata_device::smart_command(const ata_cmd_in & in, ata_cmd_out & out)
+{
+  unsigned char * data = (unsigned char *)in.buffer;
+  update_selftest();
+  switch (in.in_regs.features) {
+    case ATA_SMART_READ_VALUES:
+      if (in.size != 512)
+        return false;
+      advance();
+      get_smart_values(data);
+      return true;
+    case ATA_SMART_READ_THRESHOLDS:
+      if (in.size != 512)
+        return false;
+      get_smart_thresholds(data);
+      return true;
+    case ATA_SMART_READ_LOG_SECTOR:
+      if (in.size != 512)
+        return false;
+      switch (in.in_regs.lba_low) {
+        case 0x00: // Log directory: version 1, one sector each for 0x01, 0x06
+          memset(data, 0, 512);
+          data[0] = 0x01; data[2 * 0x01] = 1; data[2 * 0x06] = 1;
+          return true;
+        case 0x01: get_error_log(data); return true;
+        case 0x06: get_selftest_log(data); return true;
+      }
+      return false;
+    case ATA_SMART_IMMEDIATE_OFFLINE: {
+      unsigned char test = in.in_regs.lba_low;
+      if (!(test == SHORT_SELF_TEST || test == EXTEND_SELF_TEST
+            || test == OFFLINE_FULL_SCAN || test == ABORT_SELF_TEST))
+        return false;
+      if (test == OFFLINE_FULL_SCAN)
+        return true;
+      // A new test or abort stops the running test
+      if (m_running_test) {
+        add_selftest(m_running_test, 0x10); // Aborted by host
+        m_running_test = 0;
+      }
+      if (test == ABORT_SELF_TEST)
+        return true;
+      m_running_test = test;
+      start_test();
+      update_selftest();
+      return true;
+    }
+    case ATA_SMART_ENABLE:
+    case ATA_SMART_DISABLE:
+    case ATA_SMART_AUTOSAVE:
+    case ATA_SMART_AUTO_OFFLINE:
+      return true;
+    case ATA_SMART_STATUS:
+      if (!is_failing()) {
+        out.out_regs.lba_mid = 0x4f; out.out_regs.lba_high = 0xc2;
+      }
+      else {
+        out.out_regs.lba_mid = 0xf4; out.out_regs.lba_high = 0x2c;
+      }
+      return true;
+  }
+  return false;
+}
+
+void sim_ata_device::get_identify(unsigned char * data)
+{
+  memset(data, 0, 512);
+  uint16_t words[256] = {};
+  words[0] = 0x0040; // Fixed device
+  words[49] = 0x0200; // LBA supported
+  words[60] = 0xffff; words[61] = 0x0fff; // 28-bit LBA capacity
+  words[80] = 0x01f0; // ATA8-ACS .. ACS-3
+  words[82] = 0x0001; // SMART supported
+  words[83] = 0x4400; // 48-bit LBA supported
+  words[84] = 0x4003; // SMART error log and self-test supported
+  words[85] = 0x0001; // SMART enabled
+  words[86] = 0x0400; // 48-bit LBA enabled
+  words[87] = 0x4003;
+  for (int i = 0; i < 4; i++)
+    words[100 + i] = (uint16_t)(sim_num_sectors >> (16 * i));
+  words[217] = 7200; // Rotation rate
+  for (int i = 0; i < 256; i++)
+    sg_put_unaligned_le16(words[i], data + 2 * i);
+
+  put_ata_string(data + 2 * 10, get_serial("SIMA").c_str(), 20);
+  put_ata_string(data + 2 * 23, "SIM1.0", 8);
+  put_ata_string(data + 2 * 27, "SIMULATED ATA DISK", 40);
+
+  data[510] = 0xa5;
+  set_ata_checksum(data);
+}
+
+void sim_ata_device::get_smart_values(unsigned char * data)
+{
+  memset(data, 0, 512);
+  sg_put_unaligned_le16(0x0010, data);
+  uint64_t hours = 24 * 365 + m_reads;
+  for (unsigned i = 0; i < sizeof(sim_ata_attrs)/sizeof(sim_ata_attrs[0]); i++) {
+    unsigned char * a = data + 2 + 12 * i;
+    unsigned char id = sim_ata_attrs[i].id;
+    unsigned cur = 100; uint64_t raw = 0;
+    switch (id) {
+      case   5: raw = m_defects;
+                cur = (is_failing() ? 1 : (m_defects < 90 ? 100 - m_defects : 11)); break;
+      case   9: raw = hours; break;
+      case  12: raw = m_power_cycles; break;
+      case 194: raw = get_temp(); cur = 100 - raw; break;
+      case 197: raw = m_pending; break;
+      case 198: raw = m_pending; break;
+    }
+    a[0] = id;
+    sg_put_unaligned_le16(sim_ata_attrs[i].flags, a + 1);
+    a[3] = a[4] = (unsigned char)cur;
+    for (int j = 0; j < 6; j++)
+      a[5 + j] = (unsigned char)(raw >> (8 * j));
+  }
+  data[362] = 0x82; // Offline data collection completed
+  if (m_running_test) {
+    int remain = (100 - get_test_progress()) / 10;
+    data[363] = 0xf0 | (remain < 9 ? remain : 9);
+  }
+  else
+    data[363] = m_exec_status;
+  sg_put_unaligned_le16(600, data + 364);
+  data[367] = 0x5b; // Offline immediate, self-tests, selective not supported
+  sg_put_unaligned_le16(0x0003, data + 368);
+  data[370] = 0x01; // Error logging supported
+  data[372] = 2; // Short self-test: 2 minutes
+  data[373] = 120; // Extended self-test: 120 minutes
+  set_ata_checksum(data);
+}
+
+void sim_ata_device::get_smart_thresholds(unsigned char * data)
+{
+  memset(data, 0, 512);
+  sg_put_unaligned_le16(0x0010, data);
+  for (unsigned i = 0; i < sizeof(sim_ata_attrs)/sizeof(sim_ata_attrs[0]); i++) {
+    data[2 + 12 * i] = sim_ata_attrs[i].id;
+    data[2 + 12 * i + 1] = sim_ata_attrs[i].thresh;
+  }
+  set_ata_checksum(data);
+}
+
+void sim_ata_device::get_error_log(unsigned char * data)
+{
+  memset(data, 0, 512);
+  data[0] = 0x01; // Revision
+  if (m_errors) {
+    // Fill up to 5 most recent entries with UNC errors
+    unsigned n = (m_errors < 5 ? (unsigned)m_errors : 5);
+    data[1] = (unsigned char)((m_errors - 1) % 5 + 1); // Pointer to most recent
+    for (unsigned i = 0; i < n; i++) {
+      unsigned char * e = data + 2 + 90 * ((m_errors - 1 - i) % 5);
+      unsigned char * err = e + 60;
+      err[1] = 0x40; // Error: UNC
+      err[2] = 1; // Sector count
+      err[6] = 0xe0; // Device
+      err[7] = 0x51; // Status
+      err[27] = 0x01; // State: Active
+      sg_put_unaligned_le16((uint16_t)(24 * 365 + m_reads - i), err + 28);
+      unsigned char * cmd = e + 4 * 12; // Last command
+      cmd[7] = 0x25; // READ DMA EXT
+    }
+  }
+  sg_put_unaligned_le16((uint16_t)m_errors, data + 452);
+  set_ata_checksum(data);
+}
+
+void sim_ata_device::get_selftest_log(unsigned char * data)
+{
+  memset(data, 0, 512);
+  sg_put_unaligned_le16(0x0001, data);
+  for (int i = 0; i < 21; i++) {
+    const selftest_entry & e = m_selftests[i];
+    if (!e.number)
+      continue;
+    unsigned char * d = data + 2 + 24 * i;
+    d[0] = e.number;
+    d[1] = e.status;
+    sg_put_unaligned_le16(e.hours, d + 2);
+  }
+  data[508] = (unsigned char)m_selftest_index;
+  set_ata_checksum(data);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// sim_scsi_device
+
+class sim_scsi_device
+: public /*implements*/ scsi_device,
+  public /*extends*/ sim_device_base
+{
+public:
+  sim_scsi_device(smart_interface * intf, const char * dev_name,
+    const char * req_type, const sim_model & model);
+
+  virtual bool scsi_pass_through(scsi_cmnd_io * iop) override;
+
+private:
+  /// Set CHECK CONDITION status with fixed format sense data.
+  bool check_condition(scsi_cmnd_io * iop, unsigned char sk,
+                       unsigned char asc, unsigned char ascq = 0);
+
+  /// Copy response to data-in buffer.
+  bool respond(scsi_cmnd_io * iop, const unsigned char * resp, unsigned len);
+
+  bool inquiry(scsi_cmnd_io * iop);
+  bool log_sense(scsi_cmnd_io * iop);
+  bool mode_sense(scsi_cmnd_io * iop);
+  bool report_opcodes(scsi_cmnd_io * iop);
+  unsigned get_mode_page(unsigned char page, bool changeable, unsigned char * p);
+
+  void update_selftest();
+
+  // Self-test results, most recent first
+  struct selftest_entry {
+    unsigned char code, result;
+    uint16_t hours;
+  };
+  selftest_entry m_selftests[20] = {};
+  bool m_test_running = false; ///< Background self-test in m_selftests[0]
+};
+
+sim_scsi_device::sim_scsi_device(smart_interface * intf, const char * dev_name,
+    const char * req_type, const sim_model & model)
+: smart_device(intf, dev_name, "sim", req_type),
+  sim_device_base(model)
+{
+  set_info().info_name = strprintf("%s [SIM SCSI]", dev_name);
+}
+
+bool sim_scsi_device::check_condition(scsi_cmnd_io * iop, unsigned char sk,
+                                      unsigned char asc, unsigned char ascq)
+{
+  unsigned char sense[18] = {};
+  sense[0] = 0x70; sense[2] = sk; sense[7] = 10;
+  sense[12] = asc; sense[13] = ascq;
+  iop->scsi_status = SCSI_STATUS_CHECK_CONDITION;
+  unsigned len = (iop->max_sense_len < sizeof(sense) ? iop->max_sense_len : sizeof(sense));
+  if (iop->sensep)
+    memcpy(iop->sensep, sense, len);
+  iop->resp_sense_len = len;
+  return true;
+}
+
+bool sim_scsi_device::respond(scsi_cmnd_io * iop, const unsigned char * resp, unsigned len)
+{
+  if (iop->dxfer_dir != DXFER_FROM_DEVICE)
+    return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+  unsigned n = (len < iop->dxfer_len ? len : iop->dxfer_len);
+  memset(iop->dxferp, 0, iop->dxfer_len);
+  memcpy(iop->dxferp, resp, n);
+  iop->resid = iop->dxfer_len - n;
+  return true;
+}
+
+// Set result of running self-test if completed, failing if there are
+// pending sectors.
+void sim_scsi_device::update_selftest()
+{
+  if (m_test_running && get_test_progress() < 0) {
+    m_selftests[0].result = (m_pending ? 7 : 0);
+    m_test_running = false;
+  }
+}
+
+bool sim_scsi_device::scsi_pass_through(scsi_cmnd_io * iop)
+{
+  if (!begin_command())
+    return false;
+  update_selftest();
+
+  iop->scsi_status = 0;
+  iop->resp_sense_len = 0;
+  iop->resid = 0;
+  const uint8_t * cdb = iop->cmnd;
+  unsigned char resp[32] = {};
+
+  switch (cdb[0]) {
+    case TEST_UNIT_READY:
+      return true;
+    case INQUIRY:
+      return inquiry(iop);
+    case REQUEST_SENSE:
+      resp[0] = 0x70; resp[7] = 10;
+      if (m_test_running) {
+        // Self-test in progress, with progress indication
+        resp[2] = SCSI_SK_NOT_READY; resp[12] = SCSI_ASC_NOT_READY; resp[13] = 0x09;
+        resp[15] = 0x80;
+        sg_put_unaligned_be16((uint16_t)(get_test_progress() * 65536 / 100), resp + 16);
+      }
+      else if (is_failing()) {
+        resp[2] = SCSI_SK_NO_SENSE; resp[12] = SCSI_ASC_IMPENDING_FAILURE;
+      }
+      return respond(iop, resp, 18);
+    case READ_CAPACITY_10:
+      sg_put_unaligned_be32(0xffffffff, resp);
+      sg_put_unaligned_be32(512, resp + 4);
+      return respond(iop, resp, 8);
+    case SERVICE_ACTION_IN_16:
+      if ((cdb[1] & 0x1f) != SAI_READ_CAPACITY_16)
+        break;
+      sg_put_unaligned_be64(sim_num_sectors - 1, resp);
+      sg_put_unaligned_be32(512, resp + 8);
+      return respond(iop, resp, 32);
+    case LOG_SENSE:
+      return log_sense(iop);
+    case MODE_SENSE_6:
+    case MODE_SENSE_10:
+      return mode_sense(iop);
+    case SEND_DIAGNOSTIC: {
+      unsigned char code = cdb[1] >> 5;
+      if (!code && !(cdb[1] & 0x04))
+        return true;
+      // A new test or abort stops the running test
+      if (m_test_running) {
+        m_selftests[0].result = 1; // Aborted by SEND DIAGNOSTIC
+        m_test_running = false;
+      }
+      if (code == SCSI_DIAG_ABORT_SELF_TEST)
+        return true;
+      memmove(m_selftests + 1, m_selftests, sizeof(m_selftests) - sizeof(m_selftests[0]));
+      m_selftests[0].code = (code ? code : 1);
+      m_selftests[0].result = 0xf; // In progress
+      m_selftests[0].hours = (uint16_t)(24 * 365 + m_reads);
+      m_test_running = true;
+      // Foreground and default tests complete immediately
+      if (code == SCSI_DIAG_BG_SHORT_SELF_TEST || code == SCSI_DIAG_BG_EXTENDED_SELF_TEST)
+        start_test();
+      else
+        stop_test();
+      update_selftest();
+      return true;
+    }
+    case VERIFY_16: {
+      if (cdb[1] & 0x06) // BYTCHK not supported
+        return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+      uint64_t lba = sg_get_unaligned_be64(cdb + 2);
+      uint32_t num = sg_get_unaligned_be32(cdb + 10);
+      if (lba + num > sim_num_sectors)
+        return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, 0x21); // LBA out of range
+      if (is_bad_range(lba, num))
+        return check_condition(iop, SCSI_SK_MEDIUM_ERROR, 0x11); // Unrecovered read error
+      return true;
+    }
+    case MAINTENANCE_IN_12:
+      if ((cdb[1] & 0x1f) != MI_REP_SUP_OPCODES)
+        break;
+      return report_opcodes(iop);
+  }
+  return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_UNKNOWN_OPCODE);
+}
+
+bool sim_scsi_device::report_opcodes(scsi_cmnd_io * iop)
+{
+  // Commands supported above, CDB length and service action if any
+  static const struct { unsigned char op, cdb_len; uint16_t sa; } cmds[] = {
+    { TEST_UNIT_READY,       6, 0 },
+    { REQUEST_SENSE,         6, 0 },
+    { INQUIRY,               6, 0 },
+    { MODE_SENSE_6,          6, 0 },
+    { SEND_DIAGNOSTIC,       6, 0 },
+    { READ_CAPACITY_10,     10, 0 },
+    { LOG_SENSE,            10, 0 },
+    { MODE_SENSE_10,        10, 0 },
+    { MAINTENANCE_IN_12,    12, MI_REP_SUP_OPCODES },
+    { VERIFY_16,            16, 0 },
+    { SERVICE_ACTION_IN_16, 16, SAI_READ_CAPACITY_16 },
+  };
+  const uint8_t * cdb = iop->cmnd;
+  unsigned char resp[4 + 8 * 16] = {};
+  unsigned len;
+
+  switch (cdb[2] & 0x07) {
+    case 0: // All commands, descriptors without timeouts
+      if (cdb[2] & 0x80)
+        return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+      len = 4;
+      for (const auto & c : cmds) {
+        unsigned char * p = resp + len;
+        p[0] = c.op;
+        sg_put_unaligned_be16(c.sa, p + 2);
+        p[5] = (c.sa ? 0x01 : 0x00); // SERVACTV
+        sg_put_unaligned_be16(c.cdb_len, p + 6);
+        len += 8;
+      }
+      sg_put_unaligned_be32(len - 4, resp);
+      break;
+    case 1: { // One command without service action
+      unsigned i;
+      for (i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++) {
+        if (cmds[i].op == cdb[3])
+          break;
+      }
+      len = 4;
+      if (i >= sizeof(cmds) / sizeof(cmds[0])) {
+        resp[1] = 0x01; // Not supported
+        break;
+      }
+      if (cmds[i].sa)
+        return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+      resp[1] = 0x03; // Supported
+      sg_put_unaligned_be16(cmds[i].cdb_len, resp + 2);
+      // CDB usage data: opcode and 0xff for all other bytes, except
+      // LOG SENSE subpage code (byte 3) which is not supported
+      memset(resp + 4, 0xff, cmds[i].cdb_len);
+      resp[4] = cmds[i].op;
+      if (cmds[i].op == LOG_SENSE)
+        resp[4 + 3] = 0x00;
+      len += cmds[i].cdb_len;
+      break;
+    }
+    default:
+      return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+  }
+  return respond(iop, resp, len);
+}
+
+bool sim_scsi_device::inquiry(scsi_cmnd_io * iop)
+{
+  const uint8_t * cdb = iop->cmnd;
+  unsigned char resp[64] = {};
+  unsigned len;
+
+  if (!(cdb[1] & 0x01)) {
+    // Standard INQUIRY
+    resp[0] = SCSI_PT_DIRECT_ACCESS;
+    resp[2] = 0x06; // SPC-4
+    resp[3] = 0x02; // Response data format
+    resp[4] = 36 - 5;
+    put_scsi_string(resp + 8, "SIM", 8);
+    put_scsi_string(resp + 16, "SIMULATED SCSI", 16);
+    put_scsi_string(resp + 32, "S100", 4);
+    len = 36;
+  }
+  else switch (cdb[2]) {
+    case SCSI_VPD_SUPPORTED_VPD_PAGES:
+      resp[3] = 3;
+      resp[4] = SCSI_VPD_SUPPORTED_VPD_PAGES;
+      resp[5] = SCSI_VPD_UNIT_SERIAL_NUMBER;
+      resp[6] = SCSI_VPD_DEVICE_IDENTIFICATION;
+      len = 4 + 3;
+      break;
+    case SCSI_VPD_UNIT_SERIAL_NUMBER: {
+      std::string sn = get_serial("SIMS");
+      resp[1] = SCSI_VPD_UNIT_SERIAL_NUMBER;
+      resp[3] = (unsigned char)sn.size();
+      memcpy(resp + 4, sn.c_str(), sn.size());
+      len = 4 + sn.size();
+      break;
+    }
+    case SCSI_VPD_DEVICE_IDENTIFICATION:
+      // One NAA IEEE Registered designator for the logical unit
+      resp[1] = SCSI_VPD_DEVICE_IDENTIFICATION;
+      resp[3] = 12;
+      resp[4] = 0x01; // Binary
+      resp[5] = 0x03; // LU, NAA
+      resp[7] = 8;
+      sg_put_unaligned_be64((0x5ULL << 60) | (0x000000ULL << 36) | get_id(), resp + 8);
+      len = 4 + 12;
+      break;
+    default:
+      return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+  }
+  return respond(iop, resp, len);
+}
+
+bool sim_scsi_device::log_sense(scsi_cmnd_io * iop)
+{
+  const uint8_t * cdb = iop->cmnd;
+  unsigned char page = cdb[2] & 0x3f;
+  if (cdb[3]) // No subpages
+    return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+
+  unsigned char resp[4 + 20 * 20] = {};
+  unsigned char * p = resp + 4;
+  switch (page) {
+    case SUPPORTED_LPAGES: {
+      static const unsigned char pages[] = {
+        SUPPORTED_LPAGES, WRITE_ERROR_COUNTER_LPAGE, READ_ERROR_COUNTER_LPAGE,
+        VERIFY_ERROR_COUNTER_LPAGE, NON_MEDIUM_ERROR_LPAGE, TEMPERATURE_LPAGE,
+        SELFTEST_RESULTS_LPAGE, IE_LPAGE
+      };
+      memcpy(p, pages, sizeof(pages));
+      p += sizeof(pages);
+      break;
+    }
+    case WRITE_ERROR_COUNTER_LPAGE:
+    case READ_ERROR_COUNTER_LPAGE:
+    case VERIFY_ERROR_COUNTER_LPAGE:
+      // Parameters 0x0000-0x0006, 4 byte counters
+      for (unsigned pc = 0; pc <= 6; pc++, p += 8) {
+        uint32_t val = 0;
+        switch (pc) {
+          case 0x0003: val = (uint32_t)(m_reads * 7); break; // ECC fast
+          case 0x0004: val = (uint32_t)m_defects; break;     // Reread/rewrite
+          case 0x0005: val = (uint32_t)(m_reads * 1000); break; // Bytes processed
+          case 0x0006: val = (page == READ_ERROR_COUNTER_LPAGE
+                              ? (uint32_t)m_pending : 0); break; // Uncorrected
+        }
+        sg_put_unaligned_be16(pc, p);
+        p[2] = 0x02; p[3] = 4;
+        sg_put_unaligned_be32(val, p + 4);
+      }
+      if (page == READ_ERROR_COUNTER_LPAGE)
+        advance();
+      break;
+    case NON_MEDIUM_ERROR_LPAGE:
+      p[2] = 0x02; p[3] = 4;
+      sg_put_unaligned_be32((uint32_t)m_errors, p + 4);
+      p += 8;
+      break;
+    case TEMPERATURE_LPAGE:
+      p[2] = 0x03; p[3] = 2; p[5] = (unsigned char)get_temp();
+      p += 6;
+      p[1] = 0x01; p[2] = 0x03; p[3] = 2; p[5] = 70; // Reference temperature
+      p += 6;
+      break;
+    case SELFTEST_RESULTS_LPAGE:
+      for (unsigned i = 0; i < 20; i++, p += 20) {
+        sg_put_unaligned_be16(i + 1, p);
+        p[2] = 0x03; p[3] = 0x10;
+        const selftest_entry & e = m_selftests[i];
+        if (!e.code)
+          continue;
+        p[4] = (e.code << 5) | e.result;
+        p[5] = (unsigned char)(i + 1);
+        sg_put_unaligned_be16(e.hours, p + 6);
+        sg_put_unaligned_be64(~0ULL, p + 8);
+      }
+      break;
+    case IE_LPAGE:
+      p[2] = 0x03; p[3] = 4;
+      p[4] = (is_failing() ? SCSI_ASC_IMPENDING_FAILURE : 0);
+      p[6] = (unsigned char)get_temp(); p[7] = 70;
+      p += 8;
+      break;
+    default:
+      return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+  }
+
+  resp[0] = page;
+  sg_put_unaligned_be16((uint16_t)(p - resp - 4), resp + 2);
+  return respond(iop, resp, p - resp);
+}
+
+unsigned sim_scsi_device::get_mode_page(unsigned char page, bool changeable,
+                                        unsigned char * p)
+{
+  switch (page) {
+    case CACHING_PAGE:
+      p[0] = CACHING_PAGE; p[1] = 0x12;
+      p[2] = (changeable ? 0x05 : 0x04); // WCE
+      return 2 + 0x12;
+    case CONTROL_MODE_PAGE:
+      p[0] = CONTROL_MODE_PAGE; p[1] = 0x0a;
+      p[2] = (changeable ? 0x02 : 0x00); // GLTSD
+      if (!changeable)
+        sg_put_unaligned_be16(2 * 3600, p + 10); // Extended self-test: 2 hours
+      return 2 + 0x0a;
+    case INFORMATIONAL_EXCEPTIONS_CONTROL_PAGE:
+      p[0] = INFORMATIONAL_EXCEPTIONS_CONTROL_PAGE; p[1] = 0x0a;
+      p[2] = (changeable ? 0x1c : 0x10); // EWASC, DEXCPT clear
+      p[3] = (changeable ? 0x0f : 0x06); // MRIE 6
+      return 2 + 0x0a;
+  }
+  return 0;
+}
+
+bool sim_scsi_device::mode_sense(scsi_cmnd_io * iop)
+{
+  const uint8_t * cdb = iop->cmnd;
+  bool ms10 = (cdb[0] == MODE_SENSE_10);
+  unsigned char page = cdb[2] & 0x3f, pc = cdb[2] >> 6;
+  if (cdb[3] && cdb[3] != 0xff)
+    return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+
+  unsigned char resp[8 + 3 * 32] = {};
+  unsigned hdr = (ms10 ? 8 : 4), len = hdr;
+  if (page == ALL_MODE_PAGES) {
+    static const unsigned char pages[] = {
+      CACHING_PAGE, CONTROL_MODE_PAGE, INFORMATIONAL_EXCEPTIONS_CONTROL_PAGE
+    };
+    for (unsigned char pg : pages)
+      len += get_mode_page(pg, (pc == 1), resp + len);
+  }
+  else {
+    unsigned n = get_mode_page(page, (pc == 1), resp + len);
+    if (!n)
+      return check_condition(iop, SCSI_SK_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+    len += n;
+  }
+
+  if (ms10)
+    sg_put_unaligned_be16(len - 2, resp);
+  else
+    resp[0] = len - 1;
+  return respond(iop, resp, len);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// sim_nvme_device
+
+class sim_nvme_device
+: public /*implements*/ nvme_device,
+  public /*extends*/ sim_device_base
+{
+public:
+  sim_nvme_device(smart_interface * intf, const char * dev_name,
+    const char * req_type, const sim_model & model);
+
+  virtual bool nvme_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out) override;
+
+  virtual bool nvme_pass_through_multi(nvme_cmd_multi * cmds, unsigned num) override;
+
+  virtual bool nvme_io_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out) override;
+
+private:
+  bool get_log_page(const nvme_cmd_in & in, nvme_cmd_out & out);
+
+  void add_selftest(unsigned char code, unsigned char result);
+  void update_selftest();
+
+  // Self-test log results, [0] = newest
+  struct selftest_entry {
+    unsigned char code, result;
+    uint64_t hours;
+  };
+  selftest_entry m_selftests[20] = {};
+  unsigned char m_running_test = 0; ///< Self-test code in progress, 0 if none
+};
+
+sim_nvme_device::sim_nvme_device(smart_interface * intf, const char * dev_name,
+    const char * req_type, const sim_model & model)
+: smart_device(intf, dev_name, "sim", req_type),
+  nvme_device(1),
+  sim_device_base(model)
+{
+  set_info().info_name = strprintf("%s [SIM NVMe]", dev_name);
+}
+
+// Simulate concurrent processing of the commands: latency occurs only once.
+bool sim_nvme_device::nvme_pass_through_multi(nvme_cmd_multi * cmds, unsigned num)
+{
+  if (num < 2)
+    return nvme_device::nvme_pass_through_multi(cmds, num);
+  simulate_latency();
+  m_no_latency = true;
+  bool ok = nvme_device::nvme_pass_through_multi(cmds, num);
+  m_no_latency = false;
+  return ok;
+}
+
+void sim_nvme_device::add_selftest(unsigned char code, unsigned char result)
+{
+  memmove(m_selftests + 1, m_selftests, sizeof(m_selftests) - sizeof(m_selftests[0]));
+  m_selftests[0].code = code;
+  m_selftests[0].result = result;
+  m_selftests[0].hours = 24 * 365 + m_reads;
+}
+
+// Log result of running self-test if completed, failing if there are
+// pending sectors.
+void sim_nvme_device::update_selftest()
+{
+  if (m_running_test && get_test_progress() < 0) {
+    add_selftest(m_running_test, (m_pending ? 0x7 : 0x0));
+    m_running_test = 0;
+  }
+}
+
+bool sim_nvme_device::nvme_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out)
+{
+  if (!begin_command())
+    return false;
+  update_selftest();
+
+  unsigned char * data = (unsigned char *)in.buffer;
+  switch (in.opcode) {
+    case nvme_admin_identify:
+      if (in.size < 4096)
+        break;
+      memset(data, 0, in.size);
+      if ((in.cdw10 & 0xff) == 0x01) {
+        // Identify Controller
+        nvme_id_ctrl & id = *reinterpret_cast<nvme_id_ctrl *>(data);
+        std::string sn = get_serial("SIMN");
+        put_scsi_string((unsigned char *)id.sn, sn.c_str(), sizeof(id.sn));
+        put_scsi_string((unsigned char *)id.mn, "SIMULATED NVME", sizeof(id.mn));
+        put_scsi_string((unsigned char *)id.fr, "SIM1.0", sizeof(id.fr));
+        sg_put_unaligned_le32(0x00010400, &id.ver);
+        sg_put_unaligned_le16(0x0010, &id.oacs); // Device self-test
+        id.lpa = 0x04; // Extended data for Get Log Page
+        id.elpe = 63;
+        sg_put_unaligned_le16(273 + 70, &id.wctemp);
+        sg_put_unaligned_le16(273 + 80, &id.cctemp);
+        id.tnvmcap = uint64_to_uile128(sim_num_sectors * 512);
+        sg_put_unaligned_le16(10, &id.edstt);
+        sg_put_unaligned_le32(1, &id.nn);
+        return true;
+      }
+      if ((in.cdw10 & 0xff) == 0x00 && (in.nsid == 1 || in.nsid == nvme_broadcast_nsid)) {
+        // Identify Namespace
+        nvme_id_ns & ns = *reinterpret_cast<nvme_id_ns *>(data);
+        sg_put_unaligned_le64(sim_num_sectors, &ns.nsze);
+        sg_put_unaligned_le64(sim_num_sectors, &ns.ncap);
+        sg_put_unaligned_le64(sim_num_sectors / 2, &ns.nuse);
+        ns.lbaf[0].ds = 9;
+        sg_put_unaligned_be64(((uint64_t)0x5ULL << 60) | get_id(), ns.eui64);
+        return true;
+      }
+      return set_nvme_err(out, 0x0002);
+    case nvme_admin_get_log_page:
+      return get_log_page(in, out);
+    case nvme_admin_dev_self_test: {
+      unsigned char stc = in.cdw10 & 0xf;
+      if (stc == 0xf) {
+        if (m_running_test) {
+          add_selftest(m_running_test, 0x1); // Aborted by command
+          m_running_test = 0;
+        }
+        return true;
+      }
+      if (!(stc == 1 || stc == 2))
+        return set_nvme_err(out, 0x0002);
+      if (m_running_test)
+        return set_nvme_err(out, 0x001d); // Device Self-test in Progress
+      m_running_test = stc;
+      start_test();
+      update_selftest();
+      return true;
+    }
+  }
+  return set_nvme_err(out, 0x0001);
+}
+
+bool sim_nvme_device::nvme_io_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out)
+{
+  if (!begin_command())
+    return false;
+
+  switch (in.opcode) {
+    case nvme_cmd_verify: {
+      if (in.nsid != 1)
+        return set_nvme_err(out, 0x000b); // Invalid Namespace
+      uint64_t lba = ((uint64_t)in.cdw11 << 32) | in.cdw10;
+      unsigned num = (in.cdw12 & 0xffff) + 1;
+      if (lba + num > sim_num_sectors)
+        return set_nvme_err(out, 0x0080); // LBA Out of Range
+      if (is_bad_range(lba, num))
+        return set_nvme_err(out, 0x0281); // Unrecovered Read Error
+      return true;
+    }
+  }
+  return set_nvme_err(out, 0x0001);
+}
+
+bool sim_nvme_device::get_log_page(const nvme_cmd_in & in, nvme_cmd_out & out)
+{
+  unsigned char lid = in.cdw10 & 0xff;
+  unsigned size = ((in.cdw10 >> 16) + 1) * 4;
+  if (size > in.size)
+    return set_nvme_err(out, 0x0002);
+  unsigned char * data = (unsigned char *)in.buffer;
+  memset(data, 0, size);
+
+  switch (lid) {
+    case 0x01: {
+      // Error Information, 64 entries, most recent first
+      if (in.cdw12)
+        return true; // Only first page is filled
+      for (unsigned i = 0; i < size / 64 && i < m_errors; i++) {
+        unsigned char * e = data + 64 * i;
+        sg_put_unaligned_le64(m_errors - i, e);
+        sg_put_unaligned_le16(1, e + 8); // SQID
+        sg_put_unaligned_le16(0x0281 << 1, e + 12); // Unrecovered Read Error
+        sg_put_unaligned_le32(1, e + 24);
+      }
+      return true;
+    }
+    case 0x02: {
+      // SMART/Health Information
+      if (size < sizeof(nvme_smart_log))
+        return set_nvme_err(out, 0x0002);
+      advance();
+      nvme_smart_log & sl = *reinterpret_cast<nvme_smart_log *>(data);
+      unsigned spare = (m_defects < 90 ? 100 - (unsigned)m_defects : 10);
+      sl.critical_warning = (is_failing() ? 0x04 : 0x00) | (spare <= 10 ? 0x01 : 0x00);
+      sl.temperature = uint_to_uile16(273 + get_temp());
+      sl.avail_spare = spare;
+      sl.spare_thresh = 10;
+      sl.percent_used = (unsigned char)(m_reads / 1000 < 255 ? m_reads / 1000 : 255);
+      sl.data_units_read = uint64_to_uile128(m_reads * 1000);
+      sl.data_units_written = uint64_to_uile128(m_reads * 500);
+      sl.host_reads = uint64_to_uile128(m_reads * 20000);
+      sl.host_writes = uint64_to_uile128(m_reads * 10000);
+      sl.power_cycles = uint64_to_uile128(m_power_cycles);
+      sl.power_on_hours = uint64_to_uile128(24 * 365 + m_reads);
+      sl.media_errors = uint64_to_uile128(m_pending + m_defects);
+      sl.num_err_log_entries = uint64_to_uile128(m_errors);
+      return true;
+    }
+    case 0x06: {
+      // Device Self-test
+      if (size < sizeof(nvme_self_test_log))
+        return set_nvme_err(out, 0x0002);
+      nvme_self_test_log & st = *reinterpret_cast<nvme_self_test_log *>(data);
+      if (m_running_test) {
+        st.current_operation = m_running_test;
+        st.current_completion = (unsigned char)get_test_progress();
+      }
+      for (int i = 0; i < 20; i++) {
+        const selftest_entry & e = m_selftests[i];
+        nvme_self_test_result & r = st.results[i];
+        if (!e.code) {
+          r.self_test_status = 0xf; // Unused entry
+          continue;
+        }
+        r.self_test_status = (e.code << 4) | e.result;
+        r.power_on_hours = uint_to_uile64(e.hours);
+        sg_put_unaligned_le32(0xffffffff, &r.nsid);
+      }
+      return true;
+    }
+  }
+  return set_nvme_err(out, 0x0109); // Invalid Log Page
+}
+
+} // namespace sim
+
+smart_device * smart_interface::get_sim_device(const char * name, const char * type)
+{
+  // Parse "sim,PROTOCOL[,OPTION=VALUE,...]"
+  char proto[4+1] = ""; int n = -1;
+  sscanf(type, "sim,%4[a-z]%n", proto, &n);
+  sim::sim_model model;
+  if (!(n > 0 && sim::parse_sim_model(type + n, model)))
+    return set_err_np(EINVAL, "Option '-d sim,PROTOCOL[,OPTION=VALUE,...]' is invalid: '%s'", type);
+
+  if (!strcmp(proto, "ata"))
+    return new sim::sim_ata_device(this, name, type, model);
+  if (!strcmp(proto, "scsi"))
+    return new sim::sim_scsi_device(this, name, type, model);
+  if (!strcmp(proto, "nvme"))
+    return new sim::sim_nvme_device(this, name, type, model);
+  return set_err_np(EINVAL, "Unknown simulated protocol '%s', must be ata, scsi or nvme", proto);
+}
+
+#else // WITH_SIM_DEVICES
+
+smart_device * smart_interface::get_sim_device(const char * /*name*/, const char * /*type*/)
+{
+  return set_err_np(ENOSYS, "Simulated devices are not supported in this version of smartmontools");
+}
+
+#endif // WITH_SIM_DEVICES
+
+} // namespace smartmon
@@ -0,0 +1,125 @@
+/*
+ * smartd-shmstate.cpp - print state snapshot of 'smartd -S FILE'
+ *                       (libsmartmon example program)
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <smartmon/shmstate.h>
+#include <smartmon/utility.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+static int usage(const char * prog, int status)
+{
+  std::printf("%s\n"
+    "Print device state snapshot written by 'smartd -S FILE'\n\n"
+    "Usage: %s [-w SECONDS] FILE\n\n"
+    "    -w SECONDS Repeat output every SECONDS, reopen FILE if replaced\n"
+    "    -h         Print this help\n"
+    "    -V         Print version information\n",
+    smartmon::format_version_info("smartd-shmstate").c_str(), prog);
+    return status;
+}
+
+static const char * format_counter(char (& str)[24], uint64_t val)
+{
+  if (val == smartmon::shmstate_na)
+    return "-";
+  std::snprintf(str, sizeof(str), "%" PRIu64, val);
+  return str;
+}
+
+static void print_entry(const smartmon::shmstate_entry & e)
+{
+  static const char * const protocols[] = { "?", "ATA", "SCSI", "NVMe" };
+  char checked[32] = "never";
+  if (e.check_time) {
+    time_t t = (time_t)e.check_time;
+    struct tm tmbuf;
+    std::strftime(checked, sizeof(checked), "%Y-%m-%d %H:%M:%S",
+                  smartmon::time_to_tm_local(&tmbuf, t));
+  }
+  char temp[16] = "-";
+  if (e.temperature)
+    std::snprintf(temp, sizeof(temp), "%uC", e.temperature);
+
+  char poh[24], realloc[24], pend[24], uncorr[24], media[24], errs[24];
+  std::printf("%s [%s]: %s, checked: %s (%u), health: %s, temp: %s,"
+    " POH: %s, realloc: %s, pending: %s, uncorr: %s, media_err: %s, err_log: %s,"
+    " selftest_err: %u\n",
+    e.name, protocols[e.protocol < 4 ? e.protocol : 0], e.identity,
+    checked, e.check_count,
+    (e.health > 0 ? "PASSED" : e.health < 0 ? "FAILED" : "-"), temp,
+    format_counter(poh, e.power_on_hours), format_counter(realloc, e.reallocated_sectors),
+    format_counter(pend, e.pending_sectors), format_counter(uncorr, e.offline_uncorrectable),
+    format_counter(media, e.media_errors), format_counter(errs, e.error_log_entries),
+    e.selftest_errors);
+}
+
+int main(int argc, char **argv)
+{
+  int interval = 0;
+  int ai;
+  for (ai = 1; ai < argc && argv[ai][0] == '-'; ai++) {
+    if (!std::strcmp(argv[ai], "-w") && ai + 1 < argc) {
+      interval = std::atoi(argv[++ai]);
+      if (interval <= 0)
+        return usage(argv[0], 1);
+    }
+    else if (!std::strcmp(argv[ai], "-h")) {
+      return usage(argv[0], 0);
+    }
+    else if (!std::strcmp(argv[ai], "-V")) {
+      std::fputs(smartmon::format_version_info("smartd-shmstate", 3).c_str(), stdout);
+      return 0;
+    }
+    else {
+      return usage(argv[0], 1);
+    }
+  }
+  if (ai + 1 != argc)
+    return usage(argv[0], 1);
+  const char * path = argv[ai];
+
+  smartmon::shmstate_reader reader;
+  for (;;) {
+    if (!reader.is_open() && !reader.open(path)) {
+      std::fprintf(stderr, "%s: %s\n", path, std::strerror(errno));
+      return 1;
+    }
+
+    unsigned flags = reader.flags();
+    for (unsigned i = 0; i < reader.num_entries(); i++) {
+      smartmon::shmstate_entry e;
+      if (!reader.read(i, e)) {
+        std::fprintf(stderr, "%s: entry %u: busy\n", path, i);
+        continue;
+      }
+      print_entry(e);
+    }
+    if (flags & smartmon::SHMSTATE_CLOSED) {
+      std::printf("smartd (pid %u) has exited\n", reader.pid());
+      return 0;
+    }
+    if (!interval)
+      return 0;
+
+    std::fflush(stdout);
+    std::this_thread::sleep_for(std::chrono::seconds(interval));
+    if (flags & smartmon::SHMSTATE_REPLACED)
+      reader.close();
+    std::printf("\n");
+  }
+}
@@ -77,58 +77,117 @@ json::ref::ref(json & js)
 {
 }
 
+// If JSON output is disabled, the ref constructors below do not record
+// the path, so text-only output does not allocate memory for JSON refs.
+
 json::ref::ref(json & js, const char * keystr)
 : m_js(js)
 {
   jassert(keystr && *keystr);
+  if (!m_js.m_enabled)
+    return;
   m_path.push_back(node_info(keystr));
 }
 
+json::ref::ref(const ref & src)
+: m_js(src.m_js), m_cursor(src.m_cursor), m_path(src.m_path)
+{
+}
+
 json::ref::ref(const ref & base, const char * keystr)
-: m_js(base.m_js), m_path(base.m_path)
+: m_js(base.m_js)
 {
   jassert(keystr && *keystr);
+  if (!m_js.m_enabled)
+    return;
+  if (base.m_is_cursor)
+    m_cursor = static_cast<cursor *>(const_cast<ref *>(&base));
+  else {
+    m_cursor = base.m_cursor;
+    m_path = base.m_path;
+  }
   m_path.push_back(node_info(keystr));
 }
 
 json::ref::ref(const ref & base, int index)
-: m_js(base.m_js), m_path(base.m_path)
+: m_js(base.m_js)
 {
   jassert(0 <= index && index < 10000); // Limit: large arrays not supported
+  if (!m_js.m_enabled)
+    return;
+  if (base.m_is_cursor)
+    m_cursor = static_cast<cursor *>(const_cast<ref *>(&base));
+  else {
+    m_cursor = base.m_cursor;
+    m_path = base.m_path;
+  }
   m_path.push_back(node_info(index));
 }
 
 json::ref::ref(const ref & base, const char * /*dummy*/, const char * key_suffix)
-: m_js(base.m_js), m_path(base.m_path)
+: m_js(base.m_js), m_cursor(base.m_cursor), m_path(base.m_path)
 {
+  if (!m_js.m_enabled)
+    return;
   int n = (int)m_path.size(), i;
   for (i = n; --i >= 0; ) {
-    std::string & base_key = m_path[i].key;
-    if (base_key.empty())
-      continue; // skip array
-    base_key += key_suffix;
-    break;
+    if (!m_path[i].key.empty())
+      break;
+  }
+  if (i < 0 && m_cursor) {
+    // Last key is part of the cursor path, use full path instead
+    m_path = get_full_path();
+    m_cursor = nullptr;
+    for (i = (int)m_path.size(); --i >= 0; ) {
+      if (!m_path[i].key.empty())
+        break;
+    }
   }
   jassert(i >= 0); // Limit: top level element must be an object
+  m_path[i].key += key_suffix;
 }
 
 json::ref::~ref()
 {
 }
 
+json::node_path json::ref::get_full_path() const
+{
+  if (!m_cursor)
+    return m_path;
+  node_path path = m_cursor->get_full_path();
+  path.insert(path.end(), m_path.begin(), m_path.end());
+  return path;
+}
+
+json::node * json::ref::find_or_create_node(node_type type) const
+{
+  if (!m_js.m_enabled)
+    return nullptr;
+  if (!m_cursor)
+    return json::find_or_create_node(&m_js.m_root_node, m_path, type);
+  if (m_path.empty())
+    return m_cursor->get_node(type);
+  node * p = m_cursor->get_node(m_path[0].key.empty() ? nt_array : nt_object);
+  return json::find_or_create_node(p, m_path, type);
+}
+
 void json::ref::operator=(bool value)
 {
-  m_js.set_bool(m_path, value);
+  if (node * p = find_or_create_node(nt_bool))
+    p->intval = (value ? 1 : 0);
 }
 
 void json::ref::operator=(long long value)
 {
-  m_js.set_int64(m_path, (int64_t)value);
+  if (node * p = find_or_create_node(nt_int))
+    p->intval = (uint64_t)(int64_t)value;
 }
 
 void json::ref::operator=(unsigned long long value)
 {
-  m_js.set_uint64(m_path, (uint64_t)value);
+  if (node * p = find_or_create_node(nt_uint))
+    p->intval = (uint64_t)value;
 }
 
 void json::ref::operator=(int value)
@@ -153,20 +212,38 @@ void json::ref::operator=(unsigned long value)
 
 void json::ref::operator=(const char * value)
 {
-  m_js.set_cstring(m_path, value);
+  if (!m_js.m_enabled)
+    return;
+  jassert(value != nullptr); // Limit: nullptr not supported
+  find_or_create_node(nt_string)->strval = value;
 }
 
 void json::ref::operator=(const std::string & value)
 {
-  m_js.set_string(m_path, value);
+  if (node * p = find_or_create_node(nt_string))
+    p->strval = value;
+}
+
+void json::ref::operator=(const initlist_value & val)
+{
+  node * p = find_or_create_node(val.type);
+  if (!p)
+    return;
+  switch (p->type) {
+    case nt_bool: case nt_int: case nt_uint: p->intval = val.intval; break;
+    case nt_string: p->strval = val.strval; break;
+    default: jassert(false);
+  }
 }
 
 void json::ref::set_uint128(uint64_t value_hi, uint64_t value_lo)
 {
   if (!value_hi)
     operator=((unsigned long long)value_lo);
-  else
-    m_js.set_uint128(m_path, value_hi, value_lo);
+  else if (node * p = find_or_create_node(nt_uint128)) {
+    p->intval_hi = value_hi;
+    p->intval = value_lo;
+  }
 }
 
 bool json::ref::set_if_safe_uint64(uint64_t value)
@@ -263,6 +340,25 @@ void json::ref::operator+=(std::initializer_list<initlist_value> ilist)
     operator[](i++) = v;
 }
 
+json::cursor::cursor(const ref & base)
+: ref(base)
+{
+  m_is_cursor = true;
+}
+
+json::cursor::~cursor()
+{
+}
+
+json::node * json::cursor::get_node(node_type type)
+{
+  if (!m_node)
+    m_node = find_or_create_node(type);
+  else
+    set_node_type(m_node, type);
+  return m_node;
+}
+
 json::node::node()
 {
 }
@@ -314,9 +410,8 @@ const json::node * json::node::const_iterator::operator*() const
     return m_node_p->childs[m_child_idx].get();
 }
 
-json::node * json::find_or_create_node(const json::node_path & path, node_type type)
+json::node * json::find_or_create_node(node * p, const node_path & path, node_type type)
 {
-  node * p = &m_root_node;
   for (unsigned i = 0; i < path.size(); i++) {
     const node_info & pi = path[i];
     if (!pi.key.empty()) {
@@ -365,70 +460,18 @@ json::node * json::find_or_create_node(const json::node_path & path, node_type t
     }
   }
 
+  set_node_type(p, type);
+  return p;
+}
+
+void json::set_node_type(node * p, node_type type)
+{
   if (   p->type == nt_unset
       || (   nt_int <= p->type && p->type <= nt_uint128
           && nt_int <=    type &&    type <= nt_uint128))
     p->type = type;
   else
     jassert(p->type == type); // Limit: type change not supported
-  return p;
-}
-
-void json::set_bool(const node_path & path, bool value)
-{
-  if (!m_enabled)
-    return;
-  find_or_create_node(path, nt_bool)->intval = (value ? 1 : 0);
-}
-
-void json::set_int64(const node_path & path, int64_t value)
-{
-  if (!m_enabled)
-    return;
-  find_or_create_node(path, nt_int)->intval = (uint64_t)value;
-}
-
-void json::set_uint64(const node_path & path, uint64_t value)
-{
-  if (!m_enabled)
-    return;
-  find_or_create_node(path, nt_uint)->intval = value;
-}
-
-void json::set_uint128(const node_path & path, uint64_t value_hi, uint64_t value_lo)
-{
-  if (!m_enabled)
-    return;
-  node * p = find_or_create_node(path, nt_uint128);
-  p->intval_hi = value_hi;
-  p->intval = value_lo;
-}
-
-void json::set_cstring(const node_path & path, const char * value)
-{
-  if (!m_enabled)
-    return;
-  jassert(value != nullptr); // Limit: nullptr not supported
-  find_or_create_node(path, nt_string)->strval = value;
-}
-
-void json::set_string(const node_path & path, const std::string & value)
-{
-  if (!m_enabled)
-    return;
-  find_or_create_node(path, nt_string)->strval = value;
-}
-
-void json::set_initlist_value(const node_path & path, const initlist_value & val)
-{
-  if (!m_enabled)
-    return;
-  node * p = find_or_create_node(path, val.type);
-  switch (p->type) {
-    case nt_bool: case nt_int: case nt_uint: p->intval = val.intval; break;
-    case nt_string: p->strval = val.strval; break;
-    default: jassert(false);
-  }
 }
 
 // Default implementations of output_function helpers
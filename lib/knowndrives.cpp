@@ -71,7 +71,14 @@ public:
 
   /// Append builtin table.
   void append(const drive_settings * builtin_tab, unsigned builtin_size)
-    { m_builtin_tab = builtin_tab; m_builtin_size = builtin_size; }
+    {
+      m_builtin_tab = builtin_tab; m_builtin_size = builtin_size;
+      m_regex.clear();
+    }
+
+  /// Match model (or firmware) regular expression of entry I.
+  /// The compiled regular expressions are kept for further lookups.
+  bool match(unsigned i, bool firmware, const char * str);
 
 private:
   const drive_settings * m_builtin_tab;
@@ -79,6 +86,7 @@ private:
 
   std::vector<drive_settings> m_custom_tab;
   std::vector<char *> m_custom_strings;
+  std::vector<regular_expression> m_regex; // [2 * i + firmware]
 
   const char * copy_string(const char * str);
 
@@ -112,6 +120,7 @@ void drive_database::push_back(const drive_settings & src)
   dest.warningmsg     = copy_string(src.warningmsg);
   dest.presets        = copy_string(src.presets);
   m_custom_tab.push_back(dest);
+  m_regex.clear();
 }
 
 const char * drive_database::copy_string(const char * src)
@@ -187,12 +196,17 @@ static bool compile(regular_expression & regex, const char *pattern)
   return true;
 }
 
-// Compile & match a regular expression.
-static bool match(const char * pattern, const char * str)
+// Compile (once) & match a regular expression.
+bool drive_database::match(unsigned i, bool firmware, const char * str)
 {
-  regular_expression regex;
-  if (!compile(regex, pattern))
-    return false;
+  if (m_regex.size() != 2 * size())
+    m_regex.resize(2 * size());
+  regular_expression & regex = m_regex[2 * i + firmware];
+  if (regex.empty()) {
+    const drive_settings & dbentry = operator[](i);
+    if (!compile(regex, (firmware ? dbentry.firmwareregexp : dbentry.modelregexp)))
+      return false;
+  }
   return regex.full_match(str);
 }
 
@@ -200,8 +214,8 @@ static bool match(const char * pattern, const char * str)
 // string.  If either the drive's model or firmware strings are not set by the
 // manufacturer then values of NULL may be used.  Returns the entry of the
 // first match in knowndrives[] or 0 if no match if found.
-static const drive_settings * lookup_drive(const char * model, const char * firmware,
-  std::string * dbversion = nullptr)
+const drive_settings * lookup_drive(const char * model, const char * firmware,
+  std::string * dbversion /* = nullptr */)
 {
   if (!model)
     model = "";
@@ -222,12 +236,12 @@ static const drive_settings * lookup_drive(const char * model, const char * firm
       continue;
 
     // Check whether model matches the regular expression in knowndrives[i].
-    if (!match(knowndrives[i].modelregexp, model))
+    if (!knowndrives.match(i, false, model))
       continue;
 
     // Model matches, now check firmware. "" matches always.
     if (!(  !*knowndrives[i].firmwareregexp
-          || match(knowndrives[i].firmwareregexp, firmware)))
+          || knowndrives.match(i, true, firmware)))
       continue;
 
     // Found
@@ -330,7 +344,7 @@ int lookup_usb_device(int vendor_id, int product_id, int bcd_device,
       continue;
 
     // Check whether USB vendor:product ID matches
-    if (!match(dbentry.modelregexp, usb_id_str))
+    if (!knowndrives.match(i, false, usb_id_str))
       continue;
 
     // Parse '-d type'
@@ -342,7 +356,7 @@ int lookup_usb_device(int vendor_id, int product_id, int bcd_device,
     // If two entries with same vendor:product ID have different
     // types, use bcd_device (if provided by OS) to select entry.
     if (  *dbentry.firmwareregexp && *bcd_dev_str
-        && match(dbentry.firmwareregexp, bcd_dev_str)) {
+        && knowndrives.match(i, true, bcd_dev_str)) {
       // Exact match including bcd_device
       info = d; found = 1;
       break;
@@ -417,15 +431,16 @@ static int showonepreset(const drive_settings * dbentry)
         }
       }
 
+      const ata_vendor_attr_defs & cdefs = defs;
       for (int i = 0; i < MAX_ATTRIBUTE_NUM; i++) {
-        if (defs[i].priority != PRIOR_DEFAULT || !defs[i].name.empty()) {
-          std::string name = ata_get_smart_attr_name(i, defs);
+        if (cdefs[i].priority != PRIOR_DEFAULT || !cdefs[i].name.empty()) {
+          const char * name = ata_get_smart_attr_name(i, defs);
           // Use leading zeros instead of spaces so that everything lines up.
           lib_printf("%-*s %03d %s\n", TABLEPRINTWIDTH, first_preset ? "ATTRIBUTE OPTIONS:" : "",
-               i, name.c_str());
+               i, name);
           // Check max name length suitable for smartctl -A output
           const unsigned maxlen = 23;
-          if (name.size() > maxlen) {
+          if (strlen(name) > maxlen) {
             lib_printf("%*s\n", TABLEPRINTWIDTH+6+maxlen, "Error: Attribute name too long ------^");
             errcnt++;
           }
@@ -519,10 +534,10 @@ int showmatchingpresets(const char *model, const char *firmware)
   const char * firmwaremsg = (firmware ? firmware : "(any)");
 
   for (unsigned i = 0; i < knowndrives.size(); i++) {
-    if (!match(knowndrives[i].modelregexp, model))
+    if (!knowndrives.match(i, false, model))
       continue;
     if (   firmware && *knowndrives[i].firmwareregexp
-        && !match(knowndrives[i].firmwareregexp, firmware))
+        && !knowndrives.match(i, true, firmware))
         continue;
     // Found
     if (++cnt == 1)
@@ -0,0 +1,209 @@
+/*
+ * mediaverify.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <smartmon/mediaverify.h>
+
+#include <smartmon/atacmds.h>
+#include <smartmon/dev_interface.h>
+#include <smartmon/nvmecmds.h>
+#include <smartmon/scsicmds.h>
+#include <smartmon/utility.h>
+
+#include <errno.h>
+
+#include <chrono>
+#include <thread>
+
+namespace smartmon {
+
+bool media_verifier::init()
+{
+  m_num_blocks = 0; m_block_size = 0; m_nsid = 0;
+
+  if (ata_device * atadev = m_device->to_ata()) {
+    ata_identify_device id;
+    if (ata_read_identity(atadev, &id, false) < 0)
+      return false;
+    if (!(id.command_set_2 & 0x0400))
+      return m_device->set_err(ENOSYS, "48-bit LBA feature set not supported");
+    ata_size_info sizes;
+    ata_get_size_info(&id, sizes);
+    m_num_blocks = sizes.sectors;
+    m_block_size = sizes.log_sector_size;
+  }
+  else if (scsi_device * scsidev = m_device->to_scsi()) {
+    scsi_readcap_resp srr;
+    if (!scsiGetSize(scsidev, false, &srr))
+      return m_device->set_err(EIO, "Unable to read capacity");
+    m_num_blocks = srr.num_lblocks;
+    m_block_size = srr.lb_size;
+  }
+  else if (nvme_device * nvmedev = m_device->to_nvme()) {
+    // Broadcast NSID is not allowed for I/O commands
+    m_nsid = nvmedev->get_nsid();
+    if (m_nsid == nvme_broadcast_nsid)
+      m_nsid = 1;
+    nvme_id_ns id_ns;
+    if (!nvme_read_id_ns(nvmedev, m_nsid, id_ns))
+      return false;
+    m_num_blocks = id_ns.nsze;
+    m_block_size = 1U << id_ns.lbaf[id_ns.flbas & 0xf].ds;
+  }
+  else
+    return m_device->set_err(ENOSYS, "Media verification not supported by this device type");
+
+  if (!(m_num_blocks && m_block_size >= 512))
+    return m_device->set_err(EINVAL, "Invalid capacity reported");
+  return true;
+}
+
+media_verifier::chunk_status media_verifier::verify_chunk(uint64_t lba, unsigned num_blocks)
+{
+  if (ata_device * atadev = m_device->to_ata()) {
+    ata_cmd_out out;
+    if (ata_read_verify_sectors(atadev, lba, num_blocks, out))
+      return CHUNK_OK;
+    // Medium error only if the device reported UNC (uncorrectable data)
+    // or IDNF (address not found), not for ABRT or if no registers returned
+    const ata_out_regs & r = out.out_regs;
+    if (r.status.is_set() && (r.status & 0x01) && (r.error & (0x40 | 0x10)))
+      return CHUNK_MEDIUM_ERROR;
+    return CHUNK_DEVICE_ERROR;
+  }
+  if (scsi_device * scsidev = m_device->to_scsi()) {
+    uint8_t sense_key = 0;
+    int err = scsiVerify16(scsidev, lba, num_blocks, &sense_key);
+    if (!err)
+      return CHUNK_OK;
+    // Medium error only for MEDIUM ERROR, not for HARDWARE ERROR
+    if (err == SIMPLE_ERR_MEDIUM_HARDWARE && sense_key == SCSI_SK_MEDIUM_ERROR)
+      return CHUNK_MEDIUM_ERROR;
+    if (err > 0)
+      m_device->set_err(EIO, "VERIFY(16) failed: %s", scsiErrString(err));
+    return CHUNK_DEVICE_ERROR;
+  }
+  if (nvme_device * nvmedev = m_device->to_nvme()) {
+    nvme_cmd_out out;
+    if (nvme_verify(nvmedev, m_nsid, lba, num_blocks, out))
+      return CHUNK_OK;
+    // Medium error only for Status Code Type 2 (Media and Data Integrity
+    // Errors), not for generic or transport errors
+    if (out.status_valid && ((out.status >> 8) & 0x7) == 0x2)
+      return CHUNK_MEDIUM_ERROR;
+    return CHUNK_DEVICE_ERROR;
+  }
+  m_device->set_err(ENOSYS);
+  return CHUNK_DEVICE_ERROR;
+}
+
+// Add range to result, merge with last range if adjacent and of same type.
+static void add_range(media_verify_result & result, unsigned max_ranges,
+  uint64_t lba, uint64_t num_blocks, unsigned msec, bool failed)
+{
+  if (!result.ranges.empty()) {
+    media_verify_range & last = result.ranges.back();
+    if (last.failed == failed && last.lba + last.num_blocks == lba) {
+      last.num_blocks += num_blocks;
+      if (last.msec < msec)
+        last.msec = msec;
+      return;
+    }
+  }
+  if (result.ranges.size() >= max_ranges)
+    return;
+  media_verify_range r;
+  r.lba = lba; r.num_blocks = num_blocks; r.msec = msec; r.failed = failed;
+  result.ranges.push_back(r);
+}
+
+bool media_verifier::run(uint64_t start_lba, const media_verify_options & options,
+                         media_verify_result & result,
+                         const progress_callback & progress /* = progress_callback() */)
+{
+  result = media_verify_result();
+  result.next_lba = start_lba;
+  if (!m_num_blocks)
+    return m_device->set_err(EINVAL, "Verifier not initialized");
+
+  uint64_t end_lba = (options.end_lba < m_num_blocks ? options.end_lba : m_num_blocks - 1);
+  unsigned chunk = options.chunk_blocks;
+  if (!chunk)
+    chunk = (1024 * 1024) / m_block_size;
+  if (chunk > 0x10000)
+    chunk = 0x10000;
+  // Failed chunks are verified again in up to 64 parts
+  unsigned part = (chunk >= 64 ? chunk / 64 : 1);
+
+  long long start_usec = get_timer_usec();
+  bool ok = true;
+  while (result.next_lba <= end_lba) {
+    uint64_t lba = result.next_lba;
+    unsigned num = (end_lba - lba + 1 < chunk ? (unsigned)(end_lba - lba + 1) : chunk);
+
+    long long t1 = get_timer_usec();
+    chunk_status st = verify_chunk(lba, num);
+    unsigned msec = (unsigned)((get_timer_usec() - t1) / 1000);
+    if (st == CHUNK_DEVICE_ERROR) {
+      ok = false;
+      break;
+    }
+
+    if (st == CHUNK_MEDIUM_ERROR) {
+      for (uint64_t plba = lba; plba < lba + num; plba += part) {
+        unsigned pnum = (lba + num - plba < part ? (unsigned)(lba + num - plba) : part);
+        long long t2 = get_timer_usec();
+        st = verify_chunk(plba, pnum);
+        unsigned pmsec = (unsigned)((get_timer_usec() - t2) / 1000);
+        if (st == CHUNK_DEVICE_ERROR) {
+          ok = false;
+          break;
+        }
+        if (st == CHUNK_MEDIUM_ERROR) {
+          result.failed_chunks++;
+          add_range(result, options.max_ranges, plba, pnum, pmsec, true);
+        }
+      }
+      if (!ok)
+        break;
+    }
+    else if (options.slow_msec && msec >= options.slow_msec) {
+      result.slow_chunks++;
+      add_range(result, options.max_ranges, lba, num, msec, false);
+    }
+
+    result.next_lba = lba + num;
+    result.blocks_verified += num;
+
+    long long elapsed = get_timer_usec() - start_usec;
+    if (options.rate_mbps) {
+      // Sleep until the average throughput is at the limit
+      long long target = (long long)(result.blocks_verified * m_block_size / options.rate_mbps);
+      if (target > elapsed) {
+        std::this_thread::sleep_for(std::chrono::microseconds(target - elapsed));
+        elapsed = target;
+      }
+    }
+    result.usec = elapsed;
+    result.complete = (result.next_lba > end_lba);
+
+    if (progress && !progress(result))
+      break;
+    if (options.max_seconds && elapsed >= options.max_seconds * 1000000LL)
+      break;
+  }
+
+  result.usec = get_timer_usec() - start_usec;
+  result.complete = (result.next_lba > end_lba);
+  return ok;
+}
+
+} // namespace smartmon
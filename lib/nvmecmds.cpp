@@ -17,6 +17,7 @@
 #include <smartmon/utility.h>
 
 #include <errno.h>
+#include <vector>
 
 namespace smartmon {
 
@@ -46,29 +47,30 @@ static void debug_hex_dump(const void * data, unsigned size)
     lib_printf(" ...\n");
 }
 
-// Call NVMe pass-through and print debug info if requested.
-static bool nvme_pass_through(nvme_device * device, const nvme_cmd_in & in,
-  nvme_cmd_out & out)
+// Print NVMe pass-through parameters.
+static void print_nvme_call(const nvme_cmd_in & in)
 {
-  if (nvme_debugmode) {
-    lib_printf(" [NVMe call: opcode=0x%02x, size=0x%04x, nsid=0x%08x, cdw10=0x%08x",
-      in.opcode, in.size, in.nsid, in.cdw10);
-    if (in.cdw11 || in.cdw12 || in.cdw13 || in.cdw14 || in.cdw15)
-      lib_printf(",\n  cdw1x=0x%08x, 0x%08x, 0x%08x, 0x%08x, 0x%08x",
-        in.cdw11, in.cdw12, in.cdw13, in.cdw14, in.cdw15);
-    lib_printf("]\n");
-  }
-
-  auto start_usec = (nvme_debugmode ? get_timer_usec() : -1);
-
-  bool ok = device->nvme_pass_through(in, out);
+  lib_printf(" [NVMe call: opcode=0x%02x, size=0x%04x, nsid=0x%08x, cdw10=0x%08x",
+    in.opcode, in.size, in.nsid, in.cdw10);
+  if (in.cdw11 || in.cdw12 || in.cdw13 || in.cdw14 || in.cdw15)
+    lib_printf(",\n  cdw1x=0x%08x, 0x%08x, 0x%08x, 0x%08x, 0x%08x",
+      in.cdw11, in.cdw12, in.cdw13, in.cdw14, in.cdw15);
+  lib_printf("]\n");
+}
 
-  if (start_usec >= 0) {
-    auto duration_usec = get_timer_usec() - start_usec;
-    if (duration_usec > 0)
-      lib_printf(" [Duration: %.6fs]\n", duration_usec / 1000000.0);
-  }
+// Print duration of NVMe pass-through.
+static void print_nvme_duration(int64_t start_usec)
+{
+  auto duration_usec = get_timer_usec() - start_usec;
+  if (duration_usec > 0)
+    lib_printf(" [Duration: %.6fs]\n", duration_usec / 1000000.0);
+}
 
+// Invalidate serial numbers if requested and print NVMe pass-through
+// result if requested.
+static void finish_nvme_call(const nvme_cmd_in & in, const nvme_cmd_out & out,
+  bool ok, const char * errmsg)
+{
   if (dont_print_serial_number && ok && in.opcode == nvme_admin_identify) {
     if (in.cdw10 == 0x01 && in.size >= sizeof(nvme_id_ctrl)) {
       // Identify controller: Invalidate serial number
@@ -88,7 +90,7 @@ static bool nvme_pass_through(nvme_device * device, const nvme_cmd_in & in,
       if (out.status_valid)
         lib_printf("NVMe Status=0x%04x", out.status);
       else
-        lib_printf("%s", device->get_errmsg());
+        lib_printf("%s", errmsg);
     }
     else {
       lib_printf(" [NVMe call succeeded: result=0x%08x", out.result);
@@ -100,7 +102,47 @@ static bool nvme_pass_through(nvme_device * device, const nvme_cmd_in & in,
     }
     lib_printf("]\n");
   }
+}
+
+// Call NVMe pass-through and print debug info if requested.
+static bool nvme_pass_through(nvme_device * device, const nvme_cmd_in & in,
+  nvme_cmd_out & out)
+{
+  if (nvme_debugmode)
+    print_nvme_call(in);
+
+  auto start_usec = (nvme_debugmode ? get_timer_usec() : -1);
+
+  device->count_commands();
+  bool ok = device->nvme_pass_through(in, out);
+
+  if (start_usec >= 0)
+    print_nvme_duration(start_usec);
+
+  finish_nvme_call(in, out, ok, device->get_errmsg());
+  return ok;
+}
+
+// Call NVMe pass-through for multiple independent commands and
+// print debug info if requested.
+static bool nvme_pass_through_multi(nvme_device * device, nvme_cmd_multi * cmds,
+  unsigned num)
+{
+  if (nvme_debugmode) {
+    for (unsigned i = 0; i < num; i++)
+      print_nvme_call(cmds[i].in);
+  }
+
+  auto start_usec = (nvme_debugmode ? get_timer_usec() : -1);
+
+  device->count_commands(num);
+  bool ok = device->nvme_pass_through_multi(cmds, num);
 
+  if (start_usec >= 0)
+    print_nvme_duration(start_usec);
+
+  for (unsigned i = 0; i < num; i++)
+    finish_nvme_call(cmds[i].in, cmds[i].out, cmds[i].ok, cmds[i].err.msg.c_str());
   return ok;
 }
 
@@ -185,22 +227,50 @@ bool nvme_read_id_ns(nvme_device * device, unsigned nsid, nvme_id_ns & id_ns)
   return true;
 }
 
-static bool nvme_read_log_page_1(nvme_device * device, unsigned nsid,
+// Check parameters and prepare Get Log Page command.
+static bool init_log_page_cmd(nvme_device * device, nvme_cmd_in & in, unsigned nsid,
   unsigned char lid, void * data, unsigned size, unsigned offset = 0)
 {
   if (!(4 <= size && size <= 0x1000 && !(size % 4) && !(offset % 4)))
     return device->set_err(EINVAL, "Invalid NVMe log size %u or offset %u", size, offset);
 
   memset(data, 0, size);
-  nvme_cmd_in in;
   in.set_data_in(nvme_admin_get_log_page, data, size);
   in.nsid = nsid;
   in.cdw10 = lid | (((size / 4) - 1) << 16);
   in.cdw12 = offset; // LPOL, NVMe 1.2.1
+  return true;
+}
 
+static bool nvme_read_log_page_1(nvme_device * device, unsigned nsid,
+  unsigned char lid, void * data, unsigned size, unsigned offset = 0)
+{
+  nvme_cmd_in in;
+  if (!init_log_page_cmd(device, in, nsid, lid, data, size, offset))
+    return false;
   return nvme_pass_through(device, in);
 }
 
+// Convert SMART/Health Information log to host byte order.
+static void smart_log_to_host(nvme_smart_log & smart_log)
+{
+  if (isbigendian()) {
+    swapx(&smart_log.warning_temp_time);
+    swapx(&smart_log.critical_comp_time);
+    for (int i = 0; i < 8; i++)
+      swapx(&smart_log.temp_sensor[i]);
+  }
+}
+
+// Convert Self-test Log to host byte order.
+static void self_test_log_to_host(nvme_self_test_log & self_test_log)
+{
+  if (isbigendian()) {
+    for (int i = 0; i < 20; i++)
+      swapx(&self_test_log.results[i].nsid);
+  }
+}
+
 // Read NVMe log page with identifier LID.
 unsigned nvme_read_log_page(nvme_device * device, unsigned nsid, unsigned char lid,
   void * data, unsigned size, bool lpo_sup, unsigned offset /* = 0 */)
@@ -253,13 +323,7 @@ bool nvme_read_smart_log(nvme_device * device, uint32_t nsid, nvme_smart_log & s
   if (!nvme_read_log_page_1(device, nsid, 0x02, &smart_log, sizeof(smart_log)))
     return false;
 
-  if (isbigendian()) {
-    swapx(&smart_log.warning_temp_time);
-    swapx(&smart_log.critical_comp_time);
-    for (int i = 0; i < 8; i++)
-      swapx(&smart_log.temp_sensor[i]);
-  }
-
+  smart_log_to_host(smart_log);
   return true;
 }
 
@@ -270,12 +334,46 @@ bool nvme_read_self_test_log(nvme_device * device, uint32_t nsid,
   if (!nvme_read_log_page_1(device, nsid, 0x06, &self_test_log, sizeof(self_test_log)))
     return false;
 
-  if (isbigendian()) {
-    for (int i = 0; i < 20; i++)
-      swapx(&self_test_log.results[i].nsid);
+  self_test_log_to_host(self_test_log);
+  return true;
+}
+
+// Read multiple independent log pages.
+bool nvme_read_log_pages(nvme_device * device, nvme_log_page_req * reqs, unsigned num)
+{
+  std::vector<nvme_cmd_multi> cmds(num);
+  std::vector<unsigned> index; index.reserve(num);
+  bool all_ok = true;
+  for (unsigned i = 0; i < num; i++) {
+    nvme_log_page_req & req = reqs[i];
+    if (!init_log_page_cmd(device, cmds[index.size()].in, req.nsid, req.lid, req.data, req.size)) {
+      req.ok = false;
+      req.err_no = device->get_errno(); req.errmsg = device->get_errmsg();
+      all_ok = false;
+      continue;
+    }
+    index.push_back(i);
   }
 
-  return true;
+  if (!index.empty() && !nvme_pass_through_multi(device, cmds.data(), index.size()))
+    all_ok = false;
+
+  for (unsigned j = 0; j < index.size(); j++) {
+    const nvme_cmd_multi & cmd = cmds[j];
+    nvme_log_page_req & req = reqs[index[j]];
+    req.ok = cmd.ok;
+    if (!cmd.ok) {
+      req.err_no = cmd.err.no; req.errmsg = cmd.err.msg;
+      continue;
+    }
+    req.err_no = 0; req.errmsg.clear();
+    if (req.lid == 0x02 && req.size == sizeof(nvme_smart_log))
+      smart_log_to_host(*static_cast<nvme_smart_log *>(req.data));
+    else if (req.lid == 0x06 && req.size == sizeof(nvme_self_test_log))
+      self_test_log_to_host(*static_cast<nvme_self_test_log *>(req.data));
+  }
+
+  return all_ok;
 }
 
 // Start Self-test
@@ -288,6 +386,37 @@ bool nvme_self_test(nvme_device * device, uint8_t stc, uint32_t nsid)
   return nvme_pass_through(device, in);
 }
 
+bool nvme_verify(nvme_device * device, uint32_t nsid, uint64_t lba, unsigned num_blocks)
+{
+  nvme_cmd_out out;
+  return nvme_verify(device, nsid, lba, num_blocks, out);
+}
+
+bool nvme_verify(nvme_device * device, uint32_t nsid, uint64_t lba, unsigned num_blocks,
+                 nvme_cmd_out & out)
+{
+  if (!(1 <= num_blocks && num_blocks <= 0x10000))
+    return device->set_err(EINVAL);
+  nvme_cmd_in in;
+  in.opcode = nvme_cmd_verify;
+  in.nsid = nsid;
+  in.cdw10 = (uint32_t)lba;
+  in.cdw11 = (uint32_t)(lba >> 32);
+  in.cdw12 = num_blocks - 1; // 0's based
+
+  if (nvme_debugmode)
+    print_nvme_call(in);
+  auto start_usec = (nvme_debugmode ? get_timer_usec() : -1);
+
+  device->count_commands();
+  bool ok = device->nvme_io_pass_through(in, out);
+
+  if (start_usec >= 0)
+    print_nvme_duration(start_usec);
+  finish_nvme_call(in, out, ok, device->get_errmsg());
+  return ok;
+}
+
 // Return flagged error message for NVMe status SCT/SC fields or nullptr if unknown.
 // If message starts with '-', the status indicates an invalid command (EINVAL).
 static const char * nvme_status_to_flagged_str(uint16_t status)
@@ -80,8 +80,11 @@
 #include <smartmon/dev_interface.h>
 #include "dev_ata_cmd_set.h"
 #include "dev_areca.h"
+#include <smartmon/sysfsident.h>
 
 #include <set>
+#include <system_error>
+#include <thread>
 
 // "include/uapi/linux/nvme_ioctl.h" from Linux kernel sources
 #include "linux_nvme_ioctl.h" // nvme_passthru_cmd, NVME_IOCTL_ADMIN_CMD
@@ -121,6 +124,8 @@ public:
 
   virtual bool is_powered_down() override;
 
+  virtual bool get_block_io_count(uint64_t & count) override;
+
 protected:
   /// Return filedesc for derived classes.
   int get_fd() const
@@ -133,7 +138,10 @@ private:
   int m_fd; ///< filedesc, -1 if not open.
   int m_flags; ///< Flags for ::open()
   int m_retry_flags; ///< Flags to retry ::open(), -1 if no retry
-  bool m_enable_is_powered_down; ///< Enable sysfs runtime power management check
+  bool m_enable_is_powered_down; ///< Enable sysfs runtime power management and I/O statistics
+
+  /// Get basename of resolved device path for sysfs access.
+  bool get_sysfs_dev_base(std::string & dev_base);
 };
 
 linux_smart_device::~linux_smart_device()
@@ -217,20 +225,9 @@ static bool read_sysfs_line(const char * dev_name, const char * sysfs_path,
   return true;
 }
 
-// Query OS if device is powered up or down using sysfs runtime power management.
-// Check /sys/block/sdX/device/power/control for "auto" mode, then
-// check /sys/block/sdX/device/power/runtime_status for "suspend*" status.
-// Fallback includes "hidden" SCSI generic devices.
-// Returns true if the device is suspended, false in any other case.
-bool linux_smart_device::is_powered_down()
+// Resolve symlinks and return basename of device path, e.g. "sda".
+bool linux_smart_device::get_sysfs_dev_base(std::string & dev_base)
 {
-  bool debug = (ata_debugmode || scsi_debugmode || nvme_debugmode);
-
-  // Feature must be explicitly enabled for supported device types
-  if (!m_enable_is_powered_down) {
-    return false;
-  }
-
   // Resolve symlinks to get the actual device path
   unique_malloced_ptr<char[]> resolved_path(realpath(get_dev_name(), nullptr));
   if (!resolved_path) {
@@ -240,21 +237,44 @@ bool linux_smart_device::is_powered_down()
   }
 
   // Extract basename from the resolved path
-  const char * dev_base = strrchr(resolved_path.get(), '/');
-  if (!dev_base) {
+  const char * base = strrchr(resolved_path.get(), '/');
+  if (!base) {
     lib_printf("Device: %s, invalid resolved path (no /): %s\n",
                get_dev_name(), resolved_path.get());
     return false;
   }
-  dev_base++;  // Skip past the '/'
+  base++;  // Skip past the '/'
 
   // Validate device name is a simple basename without path components
-  if (strchr(dev_base, '/')) {
+  if (!*base) {
     lib_printf("Device: %s, invalid device name format after resolution: %s\n",
                get_dev_name(), resolved_path.get());
     return false;
   }
 
+  dev_base = base;
+  return true;
+}
+
+// Query OS if device is powered up or down using sysfs runtime power management.
+// Check /sys/block/sdX/device/power/control for "auto" mode, then
+// check /sys/block/sdX/device/power/runtime_status for "suspend*" status.
+// Fallback includes "hidden" SCSI generic devices.
+// Returns true if the device is suspended, false in any other case.
+bool linux_smart_device::is_powered_down()
+{
+  bool debug = (ata_debugmode || scsi_debugmode || nvme_debugmode);
+
+  // Feature must be explicitly enabled for supported device types
+  if (!m_enable_is_powered_down) {
+    return false;
+  }
+
+  std::string dev_base_str;
+  if (!get_sysfs_dev_base(dev_base_str))
+    return false;
+  const char * dev_base = dev_base_str.c_str();
+
   char sysfs_path[128], buffer[64];
 
   // Try block device path first (handles sd, nvme, etc.)
@@ -305,6 +325,47 @@ bool linux_smart_device::is_powered_down()
   bool result = str_starts_with(buffer, "suspend");
   return result;
 }
+
+// Read number of completed read and write requests from /sys/block/sdX/stat.
+// Fallback includes "hidden" SCSI generic devices with a block device attached.
+bool linux_smart_device::get_block_io_count(uint64_t & count)
+{
+  if (!m_enable_is_powered_down)
+    return false;
+
+  std::string dev_base;
+  if (!get_sysfs_dev_base(dev_base))
+    return false;
+
+  std::string sysfs_path = "/sys/block/" + dev_base + "/stat";
+  if (access(sysfs_path.c_str(), R_OK) != 0) {
+    // /sys/class/scsi_generic/sgN/device/block/sdX/stat
+    std::string block_dir = "/sys/class/scsi_generic/" + dev_base + "/device/block";
+    DIR * dp = opendir(block_dir.c_str());
+    if (!dp)
+      return false;
+    sysfs_path.clear();
+    while (const struct dirent * de = readdir(dp)) {
+      if (de->d_name[0] != '.') {
+        sysfs_path = block_dir + '/' + de->d_name + "/stat";
+        break;
+      }
+    }
+    closedir(dp);
+    if (sysfs_path.empty())
+      return false;
+  }
+
+  // Fields: read I/Os, read merges, read sectors, read ticks, write I/Os, ...
+  char buffer[256];
+  if (!read_sysfs_line(get_dev_name(), sysfs_path.c_str(), buffer, sizeof(buffer)))
+    return false;
+  unsigned long long reads = 0, writes = 0;
+  if (sscanf(buffer, "%llu %*u %*u %*u %llu", &reads, &writes) != 2)
+    return false;
+  count = reads + writes;
+  return true;
+}
 // examples for smartctl
 static const char  smartctl_examples[] =
                   "=================================================== SMARTCTL EXAMPLES =====\n\n"
@@ -2812,6 +2873,14 @@ public:
   virtual bool open() override;
 
   virtual bool nvme_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out) override;
+
+  virtual bool nvme_pass_through_multi(nvme_cmd_multi * cmds, unsigned num) override;
+
+  virtual bool nvme_io_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out) override;
+
+private:
+  bool finish_cmd(int status, int err, const nvme_passthru_cmd & pt, nvme_cmd_out & out,
+                  const char * ioctl_name = "NVME_IOCTL_ADMIN_CMD");
 };
 
 linux_nvme_device::linux_nvme_device(smart_interface * intf, const char * dev_name,
@@ -2837,9 +2906,8 @@ bool linux_nvme_device::open()
   return true;
 }
 
-bool linux_nvme_device::nvme_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out)
+static void init_nvme_passthru(nvme_passthru_cmd & pt, const nvme_cmd_in & in)
 {
-  nvme_passthru_cmd pt;
   memset(&pt, 0, sizeof(pt));
 
   pt.opcode = in.opcode;
@@ -2854,11 +2922,14 @@ bool linux_nvme_device::nvme_pass_through(const nvme_cmd_in & in, nvme_cmd_out &
   pt.cdw15 = in.cdw15;
   // Kernel default for NVMe admin commands is 60 seconds
   // pt.timeout_ms = 60 * 1000;
+}
 
-  int status = ioctl(get_fd(), NVME_IOCTL_ADMIN_CMD, &pt);
-
+// Set result or error info of NVME_IOCTL_ADMIN_CMD or NVME_IOCTL_IO_CMD.
+bool linux_nvme_device::finish_cmd(int status, int err, const nvme_passthru_cmd & pt,
+  nvme_cmd_out & out, const char * ioctl_name /* = "NVME_IOCTL_ADMIN_CMD" */)
+{
   if (status < 0)
-    return set_err(errno, "NVME_IOCTL_ADMIN_CMD: %s", strerror(errno));
+    return set_err(err, "%s: %s", ioctl_name, strerror(err));
 
   if (status > 0)
     return set_nvme_err(out, status);
@@ -2867,6 +2938,80 @@ bool linux_nvme_device::nvme_pass_through(const nvme_cmd_in & in, nvme_cmd_out &
   return true;
 }
 
+bool linux_nvme_device::nvme_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out)
+{
+  nvme_passthru_cmd pt;
+  init_nvme_passthru(pt, in);
+
+  int status = ioctl(get_fd(), NVME_IOCTL_ADMIN_CMD, &pt);
+  return finish_cmd(status, errno, pt, out);
+}
+
+bool linux_nvme_device::nvme_io_pass_through(const nvme_cmd_in & in, nvme_cmd_out & out)
+{
+  nvme_passthru_cmd pt;
+  init_nvme_passthru(pt, in);
+
+  // Submitted to an I/O queue of the namespace
+  int status = ioctl(get_fd(), NVME_IOCTL_IO_CMD, &pt);
+  return finish_cmd(status, errno, pt, out, "NVME_IOCTL_IO_CMD");
+}
+
+// The admin queue accepts multiple outstanding commands.  Each command
+// is issued by a separate thread, the kernel handles the concurrent
+// ioctl() calls.
+bool linux_nvme_device::nvme_pass_through_multi(nvme_cmd_multi * cmds, unsigned num)
+{
+  if (num < 2)
+    return nvme_device::nvme_pass_through_multi(cmds, num);
+
+  struct pt_result {
+    nvme_passthru_cmd pt;
+    int status, err;
+  };
+  std::vector<pt_result> res(num);
+  for (unsigned i = 0; i < num; i++)
+    init_nvme_passthru(res[i].pt, cmds[i].in);
+
+  int fd = get_fd();
+  auto run = [fd, &res](unsigned i) {
+    pt_result & r = res[i];
+    r.status = ioctl(fd, NVME_IOCTL_ADMIN_CMD, &r.pt);
+    r.err = (r.status < 0 ? errno : 0);
+  };
+
+  // Commands without a thread are issued by the current thread
+  std::vector<std::thread> threads;
+  threads.reserve(num - 1);
+  try {
+    for (unsigned i = 1; i < num; i++)
+      threads.emplace_back(run, i);
+  }
+  catch (const std::system_error &) {
+  }
+  run(0);
+  for (unsigned i = 1 + threads.size(); i < num; i++)
+    run(i);
+  for (auto & t : threads)
+    t.join();
+
+  const nvme_cmd_multi * failed = nullptr;
+  for (unsigned i = 0; i < num; i++) {
+    nvme_cmd_multi & cmd = cmds[i];
+    cmd.ok = finish_cmd(res[i].status, res[i].err, res[i].pt, cmd.out);
+    if (cmd.ok)
+      cmd.err.clear();
+    else {
+      cmd.err = get_err();
+      if (!failed)
+        failed = &cmd;
+    }
+  }
+  if (failed)
+    return set_err(failed->err);
+  return true;
+}
+
 
 //////////////////////////////////////////////////////////////////////
 // USB bridge ID detection
@@ -2948,6 +3093,9 @@ public:
   virtual bool scan_smart_devices(smart_device_list & devlist,
     const smart_devtype_list & types, const char * pattern = 0) override;
 
+  virtual bool get_os_dev_identity(const char * name, const char * type,
+    os_dev_identity & id) override;
+
 protected:
   virtual ata_device * get_ata_device(const char * name, const char * type) override;
 
@@ -2993,6 +3141,26 @@ std::string linux_smart_interface::get_app_examples(const char * appname)
   return "";
 }
 
+bool linux_smart_interface::get_os_dev_identity(const char * name, const char * type,
+  os_dev_identity & id)
+{
+  // RAID and other tunnelled types address a different device
+  if (type && *type && !(   !strcmp(type, "ata") || !strcmp(type, "scsi")
+                         || !strcmp(type, "nvme") || !strcmp(type, "sat")
+                         || str_starts_with(type, "sat,")))
+    return false;
+  char * p = realpath(name, (char *)0);
+  if (!p)
+    return false;
+  std::string path = p;
+  free(p);
+  if (!str_starts_with(path, "/dev/"))
+    return false;
+  // Environment variable allows to test with a copy of sysfs
+  const char * root = getenv("SMARTMONTOOLS_SYSFS_ROOT");
+  return sysfs_identity_reader(root && *root ? root : "/sys").read(path.c_str() + 5, id);
+}
+
 void linux_smart_interface::get_dev_list(smart_device_list & devlist,
   const char * pattern, bool by_id, std::set<std::string> & devs_seen,
   const char * type_scsi_sat, const char * type_nvme,
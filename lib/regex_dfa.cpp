@@ -0,0 +1,846 @@
+/*
+ * regex_dfa.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "regex_dfa.h"
+
+#include <string.h>
+
+#include <string>
+
+namespace smartmon {
+
+namespace {
+
+// Limits, more complex patterns are left to the regex backend.
+const unsigned max_positions = 2048;
+const unsigned max_states = 4096;
+const unsigned max_depth = 64;   // Nesting of '(...)'
+const unsigned max_repeat = 255; // RE_DUP_MAX
+const unsigned repeat_inf = ~0U;
+
+// Set of bytes
+struct byte_set
+{
+  uint64_t w[4] = {};
+
+  void set(unsigned c)
+    { w[c >> 6] |= 1ULL << (c & 63); }
+  void set_range(unsigned lo, unsigned hi)
+    { for (unsigned c = lo; c <= hi; c++) set(c); }
+  bool test(unsigned c) const
+    { return !!(w[c >> 6] & (1ULL << (c & 63))); }
+  void invert()
+    { for (uint64_t & x : w) x = ~x; }
+};
+
+// Return index of lowest bit set in X != 0 (de Bruijn sequence).
+static inline unsigned lowest_bit(uint64_t x)
+{
+  static const unsigned char index[64] = {
+     0,  1, 48,  2, 57, 49, 28,  3, 61, 58, 50, 42, 38, 29, 17,  4,
+    62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12,  5,
+    63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+    46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19,  9, 13,  8,  7,  6
+  };
+  return index[((x & (0 - x)) * 0x03f79d71b4cb0a89ULL) >> 58];
+}
+
+// Call FUNC(i * 64 + b) for each bit b set in w[i].
+template <typename F>
+static inline void for_each_bit(const uint64_t * w, unsigned words, F && func)
+{
+  for (unsigned i = 0; i < words; i++) {
+    for (uint64_t x = w[i]; x; x &= x - 1)
+      func(i * 64 + lowest_bit(x));
+  }
+}
+
+// Set of Glushkov positions
+class pos_set
+{
+public:
+  explicit pos_set(unsigned words = 0)
+    : m_w(words) { }
+
+  void set(unsigned p)
+    { m_w[p >> 6] |= 1ULL << (p & 63); }
+  bool test(unsigned p) const
+    { return !!(m_w[p >> 6] & (1ULL << (p & 63))); }
+
+  bool empty() const
+    {
+      for (uint64_t x : m_w)
+        if (x)
+          return false;
+      return true;
+    }
+  bool intersects(const pos_set & x) const
+    {
+      for (unsigned i = 0; i < m_w.size(); i++)
+        if (m_w[i] & x.m_w[i])
+          return true;
+      return false;
+    }
+  void clear()
+    { for (uint64_t & x : m_w) x = 0; }
+
+  void operator|=(const pos_set & x)
+    { x.or_to(m_w.data()); }
+  void operator&=(const pos_set & x)
+    { for (unsigned i = 0; i < m_w.size(); i++) m_w[i] &= x.m_w[i]; }
+
+  /// OR this set into W.
+  void or_to(uint64_t * w) const
+    { for (unsigned i = 0; i < m_w.size(); i++) w[i] |= m_w[i]; }
+
+  /// Call FUNC(p) for each p in (*this & mask).
+  template <typename F>
+  void for_each(const pos_set & mask, F && func) const
+    {
+      pos_set x = *this & mask;
+      for_each_bit(x.data(), x.words(), func);
+    }
+
+  pos_set operator&(const pos_set & x) const
+    {
+      pos_set r(m_w.size());
+      for (unsigned i = 0; i < m_w.size(); i++)
+        r.m_w[i] = m_w[i] & x.m_w[i];
+      return r;
+    }
+
+  const uint64_t * data() const
+    { return m_w.data(); }
+  uint64_t * data()
+    { return m_w.data(); }
+  unsigned words() const
+    { return m_w.size(); }
+
+private:
+  std::vector<uint64_t> m_w;
+};
+
+// Parse tree node
+struct re_node
+{
+  enum type_t {
+    t_empty, t_set, t_bol, t_eol, // Leaves
+    t_cat, t_alt, t_star, t_plus, t_quest
+  } type;
+  int left, right; // Child nodes or -1
+  int set;         // Index of byte_set (t_set)
+};
+
+// Recursive descent parser for POSIX ERE subset.
+// All functions return the new node index or -1 if unsupported.
+class re_parser
+{
+public:
+  explicit re_parser(const char * pattern)
+    : m_p(pattern)
+    { memset(m_char_set, 0xff, sizeof(m_char_set)); }
+
+  int parse();
+
+  std::vector<re_node> nodes;
+  std::vector<byte_set> sets; // Unique byte sets
+  unsigned num_leaves = 0;
+
+private:
+  const char * m_p;
+  int m_char_set[128]; ///< Index of byte set for single characters, -1 if none
+
+  int new_node(re_node::type_t type, int left = -1, int right = -1, int set = -1);
+  int new_set(const byte_set & bs);
+  int new_char(unsigned char c);
+  int clone(int n);
+  int append(int n, int next)
+    { return (n < 0 ? next : next < 0 ? -1 : new_node(re_node::t_cat, n, next)); }
+
+  int parse_alt(unsigned depth);
+  int parse_branch(unsigned depth);
+  int parse_piece(unsigned depth);
+  int parse_atom(unsigned depth);
+  bool parse_bound(unsigned & min, unsigned & max);
+  bool parse_bracket(byte_set & bs);
+  int repeat(int n, unsigned min, unsigned max);
+};
+
+int re_parser::new_node(re_node::type_t type, int left, int right, int set)
+{
+  if (type == re_node::t_set || type == re_node::t_bol || type == re_node::t_eol) {
+    if (++num_leaves >= max_positions)
+      return -1;
+  }
+  re_node n = { type, left, right, set };
+  nodes.push_back(n);
+  return (int)nodes.size() - 1;
+}
+
+int re_parser::new_set(const byte_set & bs)
+{
+  unsigned i;
+  for (i = 0; i < sets.size(); i++) {
+    if (!memcmp(sets[i].w, bs.w, sizeof(bs.w)))
+      break;
+  }
+  if (i == sets.size())
+    sets.push_back(bs);
+  return new_node(re_node::t_set, -1, -1, (int)i);
+}
+
+int re_parser::new_char(unsigned char c)
+{
+  if (m_char_set[c] < 0) {
+    byte_set bs;
+    bs.set(c);
+    m_char_set[c] = sets.size();
+    sets.push_back(bs);
+  }
+  return new_node(re_node::t_set, -1, -1, m_char_set[c]);
+}
+
+int re_parser::clone(int n)
+{
+  re_node x = nodes[n];
+  if (x.left >= 0 && (x.left = clone(x.left)) < 0)
+    return -1;
+  if (x.right >= 0 && (x.right = clone(x.right)) < 0)
+    return -1;
+  return new_node(x.type, x.left, x.right, x.set);
+}
+
+int re_parser::parse()
+{
+  int n = parse_alt(0);
+  if (*m_p)
+    return -1;
+  return n;
+}
+
+int re_parser::parse_alt(unsigned depth)
+{
+  if (depth > max_depth)
+    return -1;
+  int n = parse_branch(depth);
+  while (n >= 0 && *m_p == '|') {
+    m_p++;
+    int r = parse_branch(depth);
+    if (r < 0)
+      return -1;
+    n = new_node(re_node::t_alt, n, r);
+  }
+  return n;
+}
+
+// Empty branches are not supported, see check_regex() in utility.cpp.
+int re_parser::parse_branch(unsigned depth)
+{
+  int n = -1;
+  while (*m_p && *m_p != '|' && *m_p != ')') {
+    int r = parse_piece(depth);
+    if (r < 0)
+      return -1;
+    n = append(n, r);
+    if (n < 0)
+      return -1;
+  }
+  return n;
+}
+
+int re_parser::parse_piece(unsigned depth)
+{
+  bool anchor = (*m_p == '^' || *m_p == '$');
+  int n = parse_atom(depth);
+  for (;;) {
+    char c = *m_p;
+    if (n < 0)
+      return -1;
+    if (!(c == '*' || c == '+' || c == '?' || c == '{'))
+      break;
+    if (anchor) // Repeated anchors are undefined
+      return -1;
+    m_p++;
+    switch (c) {
+      case '*': n = new_node(re_node::t_star, n); break;
+      case '+': n = new_node(re_node::t_plus, n); break;
+      case '?': n = new_node(re_node::t_quest, n); break;
+      default: {
+        unsigned min, max;
+        if (!parse_bound(min, max))
+          return -1;
+        n = repeat(n, min, max);
+      }
+    }
+  }
+  return n;
+}
+
+int re_parser::parse_atom(unsigned depth)
+{
+  unsigned char c = *m_p;
+  byte_set bs;
+  switch (c) {
+    case '(': {
+      m_p++;
+      if (*m_p == ')') // Empty subexpression
+        return -1;
+      int n = parse_alt(depth + 1);
+      if (n < 0 || *m_p != ')')
+        return -1;
+      m_p++;
+      return n;
+    }
+    case '[':
+      m_p++;
+      if (!parse_bracket(bs))
+        return -1;
+      return new_set(bs);
+    case '.':
+      m_p++;
+      bs.set_range(1, 255);
+      return new_set(bs);
+    case '^':
+      m_p++;
+      return new_node(re_node::t_bol);
+    case '$':
+      m_p++;
+      return new_node(re_node::t_eol);
+    case '\\':
+      c = m_p[1];
+      // Backreferences and GNU extensions like "\w" or "\<" are not supported
+      if (!c || (c & 0x80) || ('0' <= c && c <= '9') || ('A' <= c && c <= 'Z')
+          || ('a' <= c && c <= 'z') || strchr("<>`'", c))
+        return -1;
+      m_p += 2;
+      return new_char(c);
+    case '*': case '+': case '?': case '{': case '}': case ')': case '|':
+      return -1;
+    default:
+      if (c & 0x80) // Meaning depends on locale
+        return -1;
+      m_p++;
+      return new_char(c);
+  }
+}
+
+// Parse "{N}", "{N,}" or "{N,M}" after the '{'.
+bool re_parser::parse_bound(unsigned & min, unsigned & max)
+{
+  auto get_num = [this](unsigned & val) -> bool {
+    if (!('0' <= *m_p && *m_p <= '9'))
+      return false;
+    val = 0;
+    while ('0' <= *m_p && *m_p <= '9') {
+      val = val * 10 + (*m_p++ - '0');
+      if (val > max_repeat)
+        return false;
+    }
+    return true;
+  };
+
+  if (!get_num(min))
+    return false;
+  if (*m_p == ',') {
+    m_p++;
+    if (*m_p == '}')
+      max = repeat_inf;
+    else if (!get_num(max) || max < min)
+      return false;
+  }
+  else
+    max = min;
+  return (*m_p++ == '}');
+}
+
+// Add POSIX character class.  ASCII only, non-ASCII input is left
+// to the backend.
+static bool add_char_class(byte_set & bs, const std::string & name)
+{
+  static const struct {
+    const char * name;
+    const char * ranges; // Pairs of first and last character
+  } classes[] = {
+    { "alnum" , "09AZaz" },
+    { "alpha" , "AZaz" },
+    { "blank" , "  \t\t" },
+    { "cntrl" , "\x01\x1f\x7f\x7f" },
+    { "digit" , "09" },
+    { "graph" , "!~" },
+    { "lower" , "az" },
+    { "print" , " ~" },
+    { "punct" , "!/:@[`{~" },
+    { "space" , "  \t\r" },
+    { "upper" , "AZ" },
+    { "xdigit", "09AFaf" },
+  };
+
+  for (const auto & cl : classes) {
+    if (name != cl.name)
+      continue;
+    for (const char * r = cl.ranges; *r; r += 2)
+      bs.set_range((unsigned char)r[0], (unsigned char)r[1]);
+    return true;
+  }
+  return false;
+}
+
+// Parse bracket expression after the '['.
+bool re_parser::parse_bracket(byte_set & bs)
+{
+  bool negate = false;
+  if (*m_p == '^') {
+    negate = true; m_p++;
+  }
+
+  for (bool first = true; ; first = false) {
+    unsigned char c = *m_p;
+    if (!c)
+      return false;
+    if (c == ']' && !first) {
+      m_p++;
+      break;
+    }
+    // '\\' is literal for regex(3) but not for std::regex
+    if (c == '\\' || (c & 0x80))
+      return false;
+
+    if (c == '[' && (m_p[1] == '.' || m_p[1] == '='))
+      return false; // Collating element, equivalence class
+
+    if (c == '[' && m_p[1] == ':') {
+      const char * end = strstr(m_p + 2, ":]");
+      if (!end || !add_char_class(bs, std::string(m_p + 2, end - (m_p + 2))))
+        return false;
+      m_p = end + 2;
+      continue;
+    }
+
+    // Range "X-Y", '-' is literal if first or last
+    if (m_p[1] == '-' && m_p[2] && m_p[2] != ']') {
+      unsigned char hi = m_p[2];
+      if (hi == '\\' || hi == '[' || (hi & 0x80) || hi < c)
+        return false;
+      bs.set_range(c, hi);
+      m_p += 3;
+      continue;
+    }
+
+    bs.set(c);
+    m_p++;
+  }
+
+  if (negate)
+    bs.invert();
+  bs.w[0] &= ~1ULL; // NUL never matches
+  return true;
+}
+
+// Expand "X{MIN,MAX}" to "XXX?X?..." or "XXX+".
+int re_parser::repeat(int n, unsigned min, unsigned max)
+{
+  if (!max)
+    return new_node(re_node::t_empty);
+
+  bool first = true;
+  auto next_copy = [&]() -> int {
+    int c = (first ? n : clone(n));
+    first = false;
+    return c;
+  };
+
+  int res = -1;
+  unsigned fixed = (max == repeat_inf && min > 0 ? min - 1 : min);
+  for (unsigned i = 0; i < fixed; i++) {
+    if ((res = append(res, next_copy())) < 0)
+      return -1;
+  }
+  if (max == repeat_inf) {
+    int c = next_copy();
+    if (c < 0)
+      return -1;
+    res = append(res, new_node(min > 0 ? re_node::t_plus : re_node::t_star, c));
+  }
+  else {
+    for (unsigned i = min; i < max; i++) {
+      int c = next_copy();
+      if (c < 0 || (res = append(res, new_node(re_node::t_quest, c))) < 0)
+        return -1;
+    }
+  }
+  return res;
+}
+
+// Glushkov automaton of a parse tree.
+class glushkov
+{
+public:
+  explicit glushkov(const re_parser & parser)
+    : chars((parser.num_leaves + 1 + 63) / 64), bols(chars), eols(chars),
+      m_parser(parser), m_words(chars.words())
+    { }
+
+  /// Assign positions and compute follow sets, return first set of
+  /// augmented expression "ROOT FINAL".
+  pos_set build(int root);
+
+  /// Add follow sets of anchors which could be passed.
+  pos_set closure(const pos_set & s, bool at_start, bool at_end) const;
+
+  unsigned words() const
+    { return m_words; }
+
+  /// Follow set of position P.
+  const uint64_t * follow(unsigned p) const
+    { return &m_follow[p * m_words]; }
+
+  unsigned final_pos = 0;        ///< Position of final marker
+  std::vector<int> pos_byte_set; ///< Byte set index of each position, -1 for anchors
+  pos_set chars, bols, eols;     ///< Positions of each type
+
+private:
+  const re_parser & m_parser;
+  unsigned m_words;
+  std::vector<uint64_t> m_follow; ///< Follow set of each position
+
+  // Positions of subexpressions are disjoint, so first and last
+  // sets could be kept as lists.
+  typedef std::vector<unsigned> pos_list;
+
+  struct info
+  {
+    bool nullable;
+    pos_list first, last;
+  };
+
+  info analyze(int n);
+  void add_follow(const pos_list & from, const pos_list & to);
+};
+
+void glushkov::add_follow(const pos_list & from, const pos_list & to)
+{
+  for (unsigned p : from) {
+    uint64_t * f = &m_follow[p * m_words];
+    for (unsigned q : to)
+      f[q >> 6] |= 1ULL << (q & 63);
+  }
+}
+
+glushkov::info glushkov::analyze(int n)
+{
+  const re_node & node = m_parser.nodes[n];
+  info r{false, pos_list(), pos_list()};
+  switch (node.type) {
+    case re_node::t_empty:
+      r.nullable = true;
+      break;
+    case re_node::t_set: case re_node::t_bol: case re_node::t_eol: {
+      unsigned p = pos_byte_set.size();
+      pos_byte_set.push_back(node.type == re_node::t_set ? node.set : -1);
+      (node.type == re_node::t_set ? chars : node.type == re_node::t_bol ? bols : eols).set(p);
+      r.first.push_back(p); r.last.push_back(p);
+    } break;
+    case re_node::t_cat: {
+      info a = analyze(node.left), b = analyze(node.right);
+      add_follow(a.last, b.first);
+      r.nullable = a.nullable && b.nullable;
+      r.first.swap(a.first);
+      if (a.nullable)
+        r.first.insert(r.first.end(), b.first.begin(), b.first.end());
+      r.last.swap(b.last);
+      if (b.nullable)
+        r.last.insert(r.last.end(), a.last.begin(), a.last.end());
+    } break;
+    case re_node::t_alt: {
+      info a = analyze(node.left), b = analyze(node.right);
+      r.nullable = a.nullable || b.nullable;
+      r.first.swap(a.first);
+      r.first.insert(r.first.end(), b.first.begin(), b.first.end());
+      r.last.swap(a.last);
+      r.last.insert(r.last.end(), b.last.begin(), b.last.end());
+    } break;
+    case re_node::t_star: case re_node::t_plus: case re_node::t_quest:
+      r = analyze(node.left);
+      if (node.type != re_node::t_quest)
+        add_follow(r.last, r.first);
+      if (node.type != re_node::t_plus)
+        r.nullable = true;
+      break;
+  }
+  return r;
+}
+
+pos_set glushkov::build(int root)
+{
+  m_follow.assign((m_parser.num_leaves + 1) * m_words, 0);
+  info r = analyze(root);
+  final_pos = pos_byte_set.size();
+  pos_byte_set.push_back(-1);
+
+  add_follow(r.last, pos_list(1, final_pos));
+  if (r.nullable)
+    r.first.push_back(final_pos);
+
+  pos_set first(m_words);
+  for (unsigned p : r.first)
+    first.set(p);
+  return first;
+}
+
+pos_set glushkov::closure(const pos_set & s, bool at_start, bool at_end) const
+{
+  pos_set anchors(m_words);
+  if (at_start)
+    anchors |= bols;
+  if (at_end)
+    anchors |= eols;
+
+  pos_set res = s, done(m_words);
+  for (bool changed = true; changed; ) {
+    changed = false;
+    res.for_each(anchors, [&](unsigned p) {
+      if (done.test(p))
+        return;
+      done.set(p);
+      for (unsigned i = 0; i < m_words; i++)
+        res.data()[i] |= follow(p)[i];
+      changed = true;
+    });
+  }
+  return res;
+}
+
+// Set of DFA states.  Each state is stored as a bit vector of
+// positions, lookup is done by open hashing.
+class state_table
+{
+public:
+  explicit state_table(unsigned words)
+    : m_words(words), m_buckets(64) { }
+
+  unsigned size() const
+    { return m_size; }
+
+  const uint64_t * get(unsigned i) const
+    { return &m_data[i * m_words]; }
+
+  /// Return index of state KEY, add it if new.
+  unsigned insert(const uint64_t * key, bool & added);
+
+private:
+  unsigned m_words;
+  unsigned m_size = 0;
+  std::vector<uint64_t> m_data;
+  std::vector<unsigned> m_buckets; // State index + 1, 0 if unused
+
+  uint64_t hash(const uint64_t * key) const
+    {
+      uint64_t h = 0;
+      for (unsigned i = 0; i < m_words; i++) {
+        // MurmurHash3 finalizer, mixes high bits into low bits
+        h ^= key[i] + i;
+        h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+      }
+      return h;
+    }
+};
+
+unsigned state_table::insert(const uint64_t * key, bool & added)
+{
+  unsigned mask = m_buckets.size() - 1;
+  for (unsigned b = hash(key) & mask; ; b = (b + 1) & mask) {
+    unsigned i = m_buckets[b];
+    if (!i)
+      break;
+    if (!memcmp(get(i - 1), key, m_words * sizeof(*key))) {
+      added = false;
+      return i - 1;
+    }
+  }
+
+  unsigned ni = m_size++;
+  m_data.insert(m_data.end(), key, key + m_words);
+  if (2 * m_size > m_buckets.size()) {
+    // Rehash
+    m_buckets.assign(2 * m_buckets.size(), 0);
+    mask = m_buckets.size() - 1;
+    for (unsigned i = 0; i < m_size; i++) {
+      unsigned b = hash(get(i)) & mask;
+      while (m_buckets[b])
+        b = (b + 1) & mask;
+      m_buckets[b] = i + 1;
+    }
+  }
+  else {
+    unsigned b = hash(key) & mask;
+    while (m_buckets[b])
+      b = (b + 1) & mask;
+    m_buckets[b] = ni + 1;
+  }
+  added = true;
+  return ni;
+}
+
+} // namespace
+
+void regex_dfa::clear()
+{
+  m_num_classes = 0;
+  m_trans.clear();
+  m_accept.clear();
+}
+
+bool regex_dfa::compile(const char * pattern)
+{
+  clear();
+
+  re_parser parser(pattern);
+  int root = parser.parse();
+  if (root < 0)
+    return false;
+
+  glushkov g(parser);
+  pos_set first = g.build(root);
+
+  // Partition ASCII characters into classes which cannot be
+  // distinguished by any byte set of the pattern.  Each class is
+  // kept as a 128-bit mask.
+  std::vector<byte_set> classes(1);
+  classes[0].set_range(1, 127);
+  for (const byte_set & bs : parser.sets) {
+    for (unsigned k = 0, n = classes.size(); k < n; k++) {
+      byte_set in, out;
+      bool any_in = false, any_out = false;
+      for (unsigned i = 0; i < 2; i++) {
+        in.w[i] = classes[k].w[i] & bs.w[i];
+        out.w[i] = classes[k].w[i] & ~bs.w[i];
+        any_in |= !!in.w[i]; any_out |= !!out.w[i];
+      }
+      if (any_in && any_out) {
+        classes[k] = in;
+        classes.push_back(out);
+      }
+    }
+  }
+  unsigned ncls = classes.size();
+  unsigned char cls[128] = {};
+  for (unsigned k = 0; k < ncls; k++) {
+    for_each_bit(classes[k].w, 2, [&](unsigned c) { cls[c] = k; });
+  }
+
+  // Classes matched by each byte set
+  std::vector<std::vector<unsigned char>> set_classes(parser.sets.size());
+  for (unsigned i = 0; i < parser.sets.size(); i++) {
+    const byte_set & bs = parser.sets[i];
+    for (unsigned k = 0; k < ncls; k++) {
+      if ((classes[k].w[0] & bs.w[0]) || (classes[k].w[1] & bs.w[1]))
+        set_classes[i].push_back(k);
+    }
+  }
+
+  // Subset construction.  A state is the set of character positions
+  // reached, plus the final position if the state is accepting.
+  // Anchors are resolved by closure() only if '$' could be reached.
+  unsigned words = g.words();
+  pos_set fin(words);
+  fin.set(g.final_pos);
+
+  auto state_key = [&](pos_set & s, bool at_start) -> bool {
+    bool accept;
+    if (at_start || s.intersects(g.eols)) { // Rare
+      accept = g.closure(s, at_start, true).test(g.final_pos);
+      if (at_start)
+        s = g.closure(s, true, false);
+    }
+    else
+      accept = s.test(g.final_pos);
+    s &= g.chars;
+    if (accept)
+      s |= fin;
+    return accept;
+  };
+
+  state_table states(words);
+  m_trans.assign(ncls, 0); // Dead state loops to itself
+  bool added;
+  states.insert(pos_set(words).data(), added); // Dead state
+  m_accept.push_back(false);
+
+  pos_set start = first;
+  m_accept.push_back(state_key(start, true));
+  states.insert(start.data(), added);
+  if (!added) {
+    // Start state is the dead state (e.g. "$a", "^$x"): state 1 is kept
+    // as a non-accepting copy of state 0
+    m_trans.resize(2 * ncls, 0);
+  }
+
+  std::vector<pos_set> next(ncls, pos_set(words));
+  std::vector<bool> touched(ncls);
+  for (unsigned si = 1; si < states.size(); si++) {
+    // States contain only character positions and the final position
+    for_each_bit(states.get(si), words, [&](unsigned p) {
+      if (p == g.final_pos)
+        return;
+      for (unsigned char c : set_classes[g.pos_byte_set[p]]) {
+        if (!touched[c]) {
+          touched[c] = true;
+          next[c].clear();
+        }
+        const uint64_t * f = g.follow(p);
+        uint64_t * nc = next[c].data();
+        for (unsigned i = 0; i < words; i++)
+          nc[i] |= f[i];
+      }
+    });
+
+    for (unsigned c = 0; c < ncls; c++) {
+      if (!touched[c]) { // No position matches
+        m_trans.push_back(0);
+        continue;
+      }
+      touched[c] = false;
+      bool accept = state_key(next[c], false);
+      unsigned ni = states.insert(next[c].data(), added);
+      if (added) {
+        if (ni >= max_states) {
+          clear();
+          return false;
+        }
+        m_accept.push_back(accept);
+      }
+      m_trans.push_back((uint16_t)ni);
+    }
+  }
+
+  for (unsigned c = 0; c < 256; c++)
+    m_classmap[c] = (c < 128 ? cls[c] : 0);
+  m_num_classes = ncls;
+  return true;
+}
+
+int regex_dfa::full_match(const char * str) const
+{
+  unsigned s = 1;
+  for (const unsigned char * p = (const unsigned char *)str; *p; p++) {
+    if (*p & 0x80)
+      return -1;
+    s = m_trans[s * m_num_classes + m_classmap[*p]];
+    if (!s)
+      return 0;
+  }
+  return (m_accept[s] ? 1 : 0);
+}
+
+} // namespace smartmon
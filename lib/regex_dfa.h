@@ -0,0 +1,59 @@
+/*
+ * regex_dfa.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef REGEX_DFA_H
+#define REGEX_DFA_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace smartmon {
+
+/////////////////////////////////////////////////////////////////////////////
+// regex_dfa
+
+/// DFA based full match for the subset of POSIX extended regular
+/// expressions used by smartmontools: alternation, grouping, bracket
+/// expressions, '.', anchors and '*', '+', '?', '{n,m}' repetition.
+/// Backreferences, GNU extensions, collating elements and equivalence
+/// classes are not supported.
+/// Matching is done in linear time without any memory allocation.
+
+class regex_dfa
+{
+public:
+  /// Compile pattern to DFA.  Return false if the pattern is not
+  /// supported or the DFA would be too large.  The pattern must have
+  /// been checked by the regex(3) or std::regex backend before.
+  bool compile(const char * pattern);
+
+  /// Return true if not compiled.
+  bool empty() const
+    { return m_trans.empty(); }
+
+  /// Remove compiled DFA.
+  void clear();
+
+  /// Match the full string.  Return 1 on match, 0 on mismatch and
+  /// -1 if the string contains non-ASCII characters whose meaning
+  /// depends on the locale.  Must not be called if empty().
+  int full_match(const char * str) const;
+
+private:
+  unsigned char m_classmap[256] = {}; ///< Byte -> character class
+  unsigned m_num_classes = 0;         ///< Number of character classes
+  std::vector<uint16_t> m_trans;      ///< Transitions [state * m_num_classes + class]
+  std::vector<bool> m_accept;         ///< Accepting states
+  // State 0 is the dead state, state 1 is the start state
+};
+
+} // namespace smartmon
+
+#endif // REGEX_DFA_H
@@ -124,6 +124,8 @@ public:
 
   virtual bool is_powered_down() override;
 
+  virtual bool get_block_io_count(uint64_t & count) override;
+
   virtual smart_device * autodetect_open() override;
 
   virtual bool ata_pass_through(const ata_cmd_in & in, ata_cmd_out & out) override;
@@ -180,6 +182,15 @@ bool sat_device::is_powered_down()
   return scsidev->is_powered_down();
 }
 
+// Get I/O statistics of the underlying SCSI device
+bool sat_device::get_block_io_count(uint64_t & count)
+{
+  scsi_device * scsidev = get_tunnel_dev();
+  if (!scsidev)
+    return false;
+  return scsidev->get_block_io_count(count);
+}
+
 
 // cdb[0]: ATA PASS THROUGH (16) SCSI command opcode byte (0x85)
 // cdb[1]: multiple_count, protocol + extend
@@ -446,6 +457,12 @@ bool sat_device::ata_pass_through(const ata_cmd_in & in, ata_cmd_out & out)
             }
             if (t_dir && (t_length > 0) && (in.direction == ata_cmd_in::data_in))
                 memset(in.buffer, 0, in.size);
+            // Return ATA Error and Status registers of the failed command
+            // (e.g. to distinguish UNC from ABRT)
+            if (ck_cond && ardp && ard_len > 13) {
+                out.out_regs.error  = ardp[ 3];
+                out.out_regs.status = ardp[13];
+            }
             return set_err(EIO, "scsi error %s", scsiErrString(status));
         }
     }
@@ -24,14 +24,17 @@
  * product manuals.
  */
 
+#include "config.h"
+
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 #include <ctype.h>
 
-#include "config.h"
+#include <algorithm> // std::sort(), std::binary_search(), std::min()
 
 #include <smartmon/scsicmds.h>
+#include <smartmon/scsilogpage.h>
 #include <smartmon/dev_interface.h>
 #include <smartmon/utility.h>
 #include <smartmon/sg_unaligned.h>
@@ -51,6 +54,8 @@ supported_vpd_pages * supported_vpd_pages_p = nullptr;
 #define RSOC_ALL_CMDS_CTDP_1 20
 #define RSOC_1_CMD_CTDP_0 36
 
+#define MODE_PAGES_RESP_SZ 4096
+
 // Check if LOG SENSE cdb supports changing the Subpage Code field
 static scsi_cmd_support
 chk_lsense_spc(scsi_device * device)
@@ -76,6 +81,35 @@ chk_lsense_spc(scsi_device * device)
     return rp[7] ? SC_SUPPORT : SC_NO_SUPPORT; /* 4 + ls_cdb_byte3 */
 }
 
+// Optional commands which are skipped if not supported, see
+// cmd_not_supported() callers.
+static const uint8_t rsoc_checked_opcodes[] = {
+    LOG_SENSE, LOG_SELECT, MODE_SENSE_6, MODE_SENSE_10, MODE_SELECT_6,
+    MODE_SELECT_10, START_STOP_UNIT, SEND_DIAGNOSTIC, VERIFY_16,
+    READ_DEFECT_10, READ_DEFECT_12,
+};
+
+// Check with 'one command' format whether OPCODE is not supported.
+// Lists returned by the 'all commands' format are not always complete.
+// Returns 1 if not supported, 0 if supported or unknown, -1 on error.
+static int
+rsoc_confirm_no_support(scsi_device * device, uint8_t opcode)
+{
+    int r_len = 0;
+    uint8_t rsp[4] = {};
+
+    int err = scsiRSOCcmd(device, false /* rctd */, 1 /* '1 cmd' format */,
+                          opcode, 0, rsp, sizeof(rsp), r_len);
+    if (err || r_len < 2) {
+        if (scsi_debugmode)
+            lib_printf("%s(0x%02x) Failed [%s]\n", __func__, opcode,
+                       (err ? scsiErrString(err) : "response too short"));
+        return -1;
+    }
+    /* SUPPORT field: 001b = not supported */
+    return (0x1 == (rsp[1] & 0x7) ? 1 : 0);
+}
+
 bool
 scsi_device::query_cmd_support()
 {
@@ -107,59 +141,79 @@ scsi_device::query_cmd_support()
     }
     rsoc_sup = SC_SUPPORT;
     cd_len = sg_get_unaligned_be32(rp + 0);
+    rsoc_complete = true;
     if (cd_len > max_bytes_of_cmds) {
         if (scsi_debugmode)
             lib_printf("%s: truncate %d byte response to %d bytes\n", __func__,
                        cd_len, max_bytes_of_cmds);
         cd_len = max_bytes_of_cmds;
+        rsoc_complete = false;
+    }
+    if (cd_len > r_len - 4) {
+        if (scsi_debugmode)
+            lib_printf("%s: %d byte response is shorter than %d bytes\n", __func__,
+                       r_len - 4, cd_len);
+        cd_len = r_len - 4;
+        rsoc_complete = false;
     }
-    last_rp = rp + cd_len;
-    logsense_sup = SC_NO_SUPPORT;
+    last_rp = rp + 4 + cd_len;
     logsense_spc_sup = SC_NO_SUPPORT;
-    rdefect10_sup = SC_NO_SUPPORT;
-    rdefect12_sup = SC_NO_SUPPORT;
-    rcap16_sup = SC_NO_SUPPORT;
+    memset(opcode_sup, 0, sizeof(opcode_sup));
+    memset(opcode_unsup, 0, sizeof(opcode_unsup));
+    sa_sup.clear();
 
-    for (k = 0, cmdp = rp + 4; cmdp < last_rp; ++k, cmdp += bump) {
+    for (k = 0, cmdp = rp + 4; cmdp + RSOC_ALL_CMDS_CTDP_0 <= last_rp;
+         ++k, cmdp += bump) {
         bool sa_valid = !! (0x1 & cmdp[5]);
         bool ctdp = !! (0x2 & cmdp[5]);
         uint8_t opcode = cmdp[0];
-        uint16_t sa;
 
         bump = ctdp ? RSOC_ALL_CMDS_CTDP_1 : RSOC_ALL_CMDS_CTDP_0;
-        sa = sa_valid ? sg_get_unaligned_be16(cmdp + 2) : 0;
-
-        switch (opcode) {
-        case LOG_SENSE:
-            logsense_sup = SC_SUPPORT;
-            logsense_spc_sup = chk_lsense_spc(this);
-            break;
-        case READ_DEFECT_10:
-            rdefect10_sup = SC_SUPPORT;
-            break;
-        case READ_DEFECT_12:
-            rdefect12_sup = SC_SUPPORT;
-            break;
-        case SERVICE_ACTION_IN_16:
-            if (sa_valid && (SAI_READ_CAPACITY_16 == sa))
-                rcap16_sup = SC_SUPPORT;
-            break;
-        default:
-            break;
-        }
+        opcode_sup[opcode >> 5] |= 1U << (opcode & 0x1f);
+        if (sa_valid)
+            sa_sup.push_back(((uint32_t)opcode << 16) |
+                             sg_get_unaligned_be16(cmdp + 2));
+    }
+    if (cmdp != last_rp) // Partial descriptor
+        rsoc_complete = false;
+    std::sort(sa_sup.begin(), sa_sup.end());
+
+    /* Commands missing from the list are only considered as not supported
+     * if confirmed by the 'one command' format */
+    for (uint8_t op : rsoc_checked_opcodes) {
+        if (opcode_sup[op >> 5] & (1U << (op & 0x1f)))
+            continue;
+        int r = rsoc_confirm_no_support(this, op);
+        if (r < 0)
+            break; // 'one command' format not supported
+        if (r > 0)
+            opcode_unsup[op >> 5] |= 1U << (op & 0x1f);
     }
+
+    /* Only the CDB usage data of LOG SENSE is needed, this requires
+     * a separate command */
+    if (SC_SUPPORT == cmd_support_level(LOG_SENSE, false, 0))
+        logsense_spc_sup = chk_lsense_spc(this);
+
     if (scsi_debugmode > 3) {
-        lib_printf("%s: decoded %d supported commands\n", __func__, k);
-        lib_printf("  LOG SENSE %ssupported\n",
-             (SC_SUPPORT == logsense_sup) ? "" : "not ");
+        lib_printf("%s: decoded %d supported commands%s\n", __func__, k,
+                   (rsoc_complete ? "" : " (incomplete list)"));
+        for (int op = 0; op < 256; op++) {
+            if (!(opcode_sup[op >> 5] & (1U << (op & 0x1f))))
+                continue;
+            lib_printf("  0x%02x", op);
+            for (uint32_t x : sa_sup) {
+                if ((int)(x >> 16) == op)
+                    lib_printf(" sa=0x%x", x & 0xffff);
+            }
+            lib_printf("\n");
+        }
+        for (int op = 0; op < 256; op++) {
+            if (opcode_unsup[op >> 5] & (1U << (op & 0x1f)))
+                lib_printf("  0x%02x not supported\n", op);
+        }
         lib_printf("  LOG SENSE subpage code %ssupported\n",
              (SC_SUPPORT == logsense_spc_sup) ? "" : "not ");
-        lib_printf("  READ DEFECT 10 %ssupported\n",
-             (SC_SUPPORT == rdefect10_sup) ? "" : "not ");
-        lib_printf("  READ DEFECT 12 %ssupported\n",
-             (SC_SUPPORT == rdefect12_sup) ? "" : "not ");
-        lib_printf("  READ CAPACITY 16 %ssupported\n",
-             (SC_SUPPORT == rcap16_sup) ? "" : "not ");
     }
 
 fini:
@@ -167,35 +221,135 @@ fini:
     return res;
 }
 
-/* May track more in the future */
 enum scsi_cmd_support
 scsi_device::cmd_support_level(uint8_t opcode, bool sa_valid,
                                uint16_t sa, bool for_lsense_spc) const
 {
-    enum scsi_cmd_support scs = SC_SUPPORT_UNKNOWN;
+    /* checking if LOG SENSE _subpages_ supported */
+    if ((LOG_SENSE == opcode) && for_lsense_spc)
+        return logsense_spc_sup;
+    /* RSOC itself is known after first query */
+    if ((MAINTENANCE_IN_12 == opcode) && sa_valid &&
+        (MI_REP_SUP_OPCODES == sa))
+        return rsoc_sup;
+    if (SC_SUPPORT != rsoc_sup)
+        return SC_SUPPORT_UNKNOWN;
+
+    if (!(opcode_sup[opcode >> 5] & (1U << (opcode & 0x1f))))
+        return ((opcode_unsup[opcode >> 5] & (1U << (opcode & 0x1f))) ?
+                SC_NO_SUPPORT : SC_SUPPORT_UNKNOWN);
+    if (!sa_valid)
+        return SC_SUPPORT;
+    if (std::binary_search(sa_sup.begin(), sa_sup.end(),
+                           ((uint32_t)opcode << 16) | sa))
+        return SC_SUPPORT;
+    return (rsoc_complete ? SC_NO_SUPPORT : SC_SUPPORT_UNKNOWN);
+}
 
-    switch (opcode) {
-    case LOG_SENSE:     /* checking if LOG SENSE _subpages_ supported */
-        scs = for_lsense_spc ? logsense_spc_sup : logsense_sup;
-        break;
-    case READ_DEFECT_10:
-        scs = rdefect10_sup;
-        break;
-    case READ_DEFECT_12:
-        scs = rdefect12_sup;
-        break;
-    case SERVICE_ACTION_IN_16:
-        if (sa_valid && (SAI_READ_CAPACITY_16 == sa))
-            scs = rcap16_sup;
-        break;
-    case MAINTENANCE_IN_12:
-        if (sa_valid && (MI_REP_SUP_OPCODES == sa))
-            scs = rsoc_sup;
-        break;
-    default:
-        break;
+int
+scsi_device::get_cached_mode_page(int pagenum, int subpagenum, int pc,
+                                  int modese_len, uint8_t *pBuf, int bufLen)
+{
+    if ((pc < 0) || (pc >= MPAGE_CONTROL_SAVED) || (bufLen < 0))
+        return -1;
+    if (modese10_unsup)
+        return SIMPLE_ERR_BAD_OPCODE;
+    mode_page_set & mps = mode_pages[pc];
+
+    if (0 == mps.state) {
+        /* Single MODE SENSE(10) for all pages and subpages, retry without
+         * subpages if not supported */
+        mps.resp.assign(MODE_PAGES_RESP_SZ, 0);
+        int err = scsiModeSense10(this, ALL_MODE_PAGES, 0xff, pc,
+                                  mps.resp.data(), MODE_PAGES_RESP_SZ);
+        if (SIMPLE_ERR_BAD_FIELD == err)
+            err = scsiModeSense10(this, ALL_MODE_PAGES, 0, pc,
+                                  mps.resp.data(), MODE_PAGES_RESP_SZ);
+        int resp_len = sg_get_unaligned_be16(mps.resp.data()) + 2;
+        if (err || (resp_len < 8)) {
+            mps.resp.clear();
+            mps.resp.shrink_to_fit();
+            if (SIMPLE_ERR_BAD_OPCODE == err) {
+                modese10_unsup = true;
+                return err;
+            }
+            if (err && (SIMPLE_ERR_BAD_FIELD != err))
+                return -1; /* Possibly transient error, retry next time */
+            mps.state = -1;
+            return -1;
+        }
+        mps.complete = (resp_len <= MODE_PAGES_RESP_SZ);
+        if (!mps.complete)
+            resp_len = MODE_PAGES_RESP_SZ;
+        mps.resp.resize(resp_len);
+        mps.resp.shrink_to_fit();
+        mps.state = 1;
+    }
+    if (mps.state < 0)
+        return -1;
+
+    const uint8_t * rp = mps.resp.data();
+    int resp_len = (int)mps.resp.size();
+    int bd_len = sg_get_unaligned_be16(rp + 6);
+    int pg_off, pg_len = 0;
+    bool found = false;
+    for (pg_off = 8 + bd_len; pg_off + 2 <= resp_len; pg_off += pg_len) {
+        bool spf = !! (rp[pg_off] & 0x40);
+        if (spf && (pg_off + 4 > resp_len))
+            break;
+        pg_len = (spf ? 4 + sg_get_unaligned_be16(rp + pg_off + 2)
+                      : 2 + rp[pg_off + 1]);
+        if (((rp[pg_off] & 0x3f) == pagenum) &&
+            ((spf ? rp[pg_off + 1] : 0) == subpagenum)) {
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+        return (mps.complete ? SIMPLE_ERR_BAD_FIELD : -1);
+    if (pg_off + pg_len > resp_len)
+        return -1; /* Truncated */
+
+    uint8_t hdr[8] = {};
+    int hdr_len;
+    if (10 == modese_len) {
+        hdr_len = 8;
+        memcpy(hdr, rp, 8);
+        sg_put_unaligned_be16(hdr_len + bd_len + pg_len - 2, hdr + 0);
+    } else {
+        hdr_len = 4;
+        if ((rp[4] & 0x01) || (hdr_len + bd_len + pg_len > 256))
+            return -1; /* Does not fit into MODE SENSE(6) response */
+        hdr[0] = hdr_len + bd_len + pg_len - 1;
+        hdr[1] = rp[2]; /* Medium type */
+        hdr[2] = rp[3]; /* Device specific parameter */
+        hdr[3] = bd_len;
+    }
+
+    /* Copy header, block descriptors and page, truncate to bufLen */
+    const struct { const uint8_t * p; int n; } parts[3] = {
+        { hdr, hdr_len }, { rp + 8, bd_len }, { rp + pg_off, pg_len }
+    };
+    int k = 0;
+    for (const auto & pt : parts) {
+        int n = std::min(pt.n, bufLen - k);
+        if (n > 0) {
+            memcpy(pBuf + k, pt.p, n);
+            k += n;
+        }
+    }
+    return 0;
+}
+
+void
+scsi_device::clear_mode_page_cache()
+{
+    for (mode_page_set & mps : mode_pages) {
+        mps.state = 0;
+        mps.complete = false;
+        mps.resp.clear();
+        mps.resp.shrink_to_fit();
     }
-    return scs;
 }
 
 supported_vpd_pages::supported_vpd_pages(scsi_device * device) : num_valid(0)
@@ -492,6 +646,7 @@ static struct scsi_opcode_name opcode_name_arr[] = {
     {MODE_SELECT_10, false, 0, "mode select(10)"},        /* 0x55 */
     {MODE_SENSE_10, false, 0, "mode sense(10)"},          /* 0x5a */
     {SAT_ATA_PASSTHROUGH_16, false, 0, "ata pass-through(16)"}, /* 0x85 */
+    {VERIFY_16, false, 0, "verify(16)"},                  /* 0x8f */
     {SERVICE_ACTION_IN_16, true, SAI_READ_CAPACITY_16, "read capacity(16)"},
                                                           /* 0x9e,0x10 */
     {SERVICE_ACTION_IN_16, true, SAI_GET_PHY_ELEM_STATUS,
@@ -898,6 +1053,9 @@ scsiLogSense(scsi_device * device, int pagenum, int subpagenum, uint8_t *pBuf,
     uint8_t cdb[10] = {};
     uint8_t sense[32];
 
+    if (device->cmd_not_supported(LOG_SENSE))
+        return SIMPLE_ERR_BAD_OPCODE;
+
     if (known_resp_len > bufLen)
         return -EIO;
     if (known_resp_len > 0)
@@ -986,6 +1144,9 @@ scsiLogSelect(scsi_device * device, int pcr, int sp, int pc, int pagenum,
     uint8_t cdb[10] = {};
     uint8_t sense[32];
 
+    if (device->cmd_not_supported(LOG_SELECT))
+        return SIMPLE_ERR_BAD_OPCODE;
+
     io_hdr.dxfer_dir = DXFER_TO_DEVICE;
     io_hdr.dxfer_len = bufLen;
     io_hdr.dxferp = pBuf;
@@ -1008,7 +1169,9 @@ scsiLogSelect(scsi_device * device, int pcr, int sp, int pc, int pagenum,
 /* Send MODE SENSE (6 byte) command. Returns 0 if ok, 1 if NOT READY,
  * 2 if command not supported (then MODE SENSE(10) should be supported),
  * 3 if field in command not supported or returns negated errno.
- * SPC-3 sections 6.9 and 7.4 (rev 22a) [mode subpage==0] */
+ * SPC-3 sections 6.9 and 7.4 (rev 22a) [mode subpage==0]
+ * A single page is taken from the mode page cache if possible, see
+ * scsi_device::get_cached_mode_page(). */
 int
 scsiModeSense(scsi_device * device, int pagenum, int subpagenum, int pc,
               uint8_t *pBuf, int bufLen)
@@ -1018,6 +1181,19 @@ scsiModeSense(scsi_device * device, int pagenum, int subpagenum, int pc,
     uint8_t cdb[6] = {};
     uint8_t sense[32];
 
+    if (device->cmd_not_supported(MODE_SENSE_6))
+        return SIMPLE_ERR_BAD_OPCODE;
+    /* Use the mode page cache only if both commands are known to be
+     * supported, a MODE SENSE(10) probe may upset older devices */
+    if ((ALL_MODE_PAGES != pagenum) &&
+        (SC_SUPPORT == device->cmd_support_level(MODE_SENSE_6, false, 0)) &&
+        (SC_SUPPORT == device->cmd_support_level(MODE_SENSE_10, false, 0))) {
+        int res = device->get_cached_mode_page(pagenum, subpagenum, pc, 6,
+                                               pBuf, bufLen);
+        if ((0 == res) || (SIMPLE_ERR_BAD_FIELD == res))
+            return res;
+    }
+
     if ((bufLen < 0) || (bufLen > 255))
         return -EINVAL;
     io_hdr.dxfer_dir = DXFER_FROM_DEVICE;
@@ -1064,6 +1240,10 @@ scsiModeSelect(scsi_device * device, int sp, uint8_t *pBuf, int bufLen)
     uint8_t sense[32];
     int pg_offset, pg_len, hdr_plus_1_pg;
 
+    if (device->cmd_not_supported(MODE_SELECT_6))
+        return SIMPLE_ERR_BAD_OPCODE;
+    device->clear_mode_page_cache();
+
     pg_offset = 4 + pBuf[3];
     if (pg_offset + 2 >= bufLen)
         return -EINVAL;
@@ -1093,7 +1273,9 @@ scsiModeSelect(scsi_device * device, int sp, uint8_t *pBuf, int bufLen)
 /* MODE SENSE (10 byte). Returns 0 if ok, 1 if NOT READY, 2 if command
  * not supported (then MODE SENSE(6) might be supported), 3 if field in
  * command not supported or returns negated errno.
- * SPC-3 sections 6.10 and 7.4 (rev 22a) [mode subpage==0] */
+ * SPC-3 sections 6.10 and 7.4 (rev 22a) [mode subpage==0]
+ * A single page is taken from the mode page cache if possible, see
+ * scsi_device::get_cached_mode_page(). */
 int
 scsiModeSense10(scsi_device * device, int pagenum, int subpagenum, int pc,
                 uint8_t *pBuf, int bufLen)
@@ -1103,6 +1285,15 @@ scsiModeSense10(scsi_device * device, int pagenum, int subpagenum, int pc,
     uint8_t cdb[10] = {};
     uint8_t sense[32];
 
+    if (device->cmd_not_supported(MODE_SENSE_10))
+        return SIMPLE_ERR_BAD_OPCODE;
+    if (ALL_MODE_PAGES != pagenum) {
+        int res = device->get_cached_mode_page(pagenum, subpagenum, pc, 10,
+                                               pBuf, bufLen);
+        if (res >= 0)
+            return res;
+    }
+
     io_hdr.dxfer_dir = DXFER_FROM_DEVICE;
     io_hdr.dxfer_len = bufLen;
     io_hdr.dxferp = pBuf;
@@ -1147,6 +1338,10 @@ scsiModeSelect10(scsi_device * device, int sp, uint8_t *pBuf, int bufLen)
     uint8_t sense[32];
     int pg_offset, pg_len, hdr_plus_1_pg;
 
+    if (device->cmd_not_supported(MODE_SELECT_10))
+        return SIMPLE_ERR_BAD_OPCODE;
+    device->clear_mode_page_cache();
+
     pg_offset = 8 + sg_get_unaligned_be16(pBuf + 6);
     if (pg_offset + 2 >= bufLen)
         return -EINVAL;
@@ -1385,6 +1580,9 @@ scsiSetPowerCondition(scsi_device * device, int power_cond, int pcond_modifier)
     uint8_t cdb[6] = {};
     uint8_t sense[32];
 
+    if (device->cmd_not_supported(START_STOP_UNIT))
+        return SIMPLE_ERR_BAD_OPCODE;
+
     io_hdr.dxfer_dir = DXFER_NONE;
     cdb[0] = START_STOP_UNIT;
     /* IMMED bit (cdb[1] = 0x1) not set, therefore will wait */
@@ -1417,6 +1615,9 @@ scsiSendDiagnostic(scsi_device * device, int functioncode, uint8_t *pBuf,
     uint8_t cdb[6] = {};
     uint8_t sense[32];
 
+    if (device->cmd_not_supported(SEND_DIAGNOSTIC))
+        return SIMPLE_ERR_BAD_OPCODE;
+
     io_hdr.dxfer_dir = bufLen ? DXFER_TO_DEVICE: DXFER_NONE;
     io_hdr.dxfer_len = bufLen;
     io_hdr.dxferp = pBuf;
@@ -1440,6 +1641,44 @@ scsiSendDiagnostic(scsi_device * device, int functioncode, uint8_t *pBuf,
     return scsiSimpleSenseFilter(&sinfo);
 }
 
+/* VERIFY(16) command with BYTCHK=0, medium is read but no data is
+ * transferred. Returns 0 if ok, 1 if NOT READY, 2 if command not supported,
+ * 9 if medium or hardware error or returns negated errno. If sense_key
+ * is not NULL, the sense key is returned there (0 if none).
+ * SBC-3 section 5.34 (rev 36) */
+int
+scsiVerify16(scsi_device * device, uint64_t lba, uint32_t num_blocks,
+             uint8_t * sense_key)
+{
+    struct scsi_cmnd_io io_hdr = {};
+    struct scsi_sense_disect sinfo;
+    uint8_t cdb[16] = {};
+    uint8_t sense[32];
+
+    if (device->cmd_not_supported(VERIFY_16))
+        return SIMPLE_ERR_BAD_OPCODE;
+
+    io_hdr.dxfer_dir = DXFER_NONE;
+    io_hdr.dxfer_len = 0;
+    io_hdr.dxferp = nullptr;
+    cdb[0] = VERIFY_16;
+    sg_put_unaligned_be64(lba, cdb + 2);
+    sg_put_unaligned_be32(num_blocks, cdb + 10);
+    io_hdr.cmnd = cdb;
+    io_hdr.cmnd_len = sizeof(cdb);
+    io_hdr.sensep = sense;
+    io_hdr.max_sense_len = sizeof(sense);
+    io_hdr.timeout = SCSI_TIMEOUT_DEFAULT;
+
+    if (sense_key)
+        *sense_key = 0;
+    if (! scsi_pass_through_yield_sense(device, &io_hdr, sinfo))
+      return -device->get_errno();
+    if (sense_key)
+        *sense_key = sinfo.sense_key;
+    return scsiSimpleSenseFilter(&sinfo);
+}
+
 /* TEST UNIT READY command. SPC-3 section 6.33 (rev 22a) */
 static int
 _testunitready(scsi_device * device, struct scsi_sense_disect * sinfop)
@@ -1497,6 +1736,9 @@ scsiReadDefect10(scsi_device * device, int req_plist, int req_glist,
     uint8_t cdb[10] = {};
     uint8_t sense[32];
 
+    if (device->cmd_not_supported(READ_DEFECT_10))
+        return SIMPLE_ERR_BAD_OPCODE;
+
     io_hdr.dxfer_dir = DXFER_FROM_DEVICE;
     io_hdr.dxfer_len = bufLen;
     io_hdr.dxferp = pBuf;
@@ -1531,6 +1773,9 @@ scsiReadDefect12(scsi_device * device, int req_plist, int req_glist,
     uint8_t cdb[12] = {};
     uint8_t sense[32];
 
+    if (device->cmd_not_supported(READ_DEFECT_12))
+        return SIMPLE_ERR_BAD_OPCODE;
+
     io_hdr.dxfer_dir = DXFER_FROM_DEVICE;
     io_hdr.dxfer_len = bufLen;
     io_hdr.dxferp = pBuf;
@@ -1584,6 +1829,7 @@ scsi_pass_through_yield_sense(scsi_device * device, scsi_cmnd_io * iop,
             dStrHexFp(iop->dxferp, iop->dxfer_len, -1, nullptr);
     }
 
+    device->count_commands();
     if (! device->scsi_pass_through(iop))
         return false; // this will be missing device, timeout, etc
 
@@ -1615,6 +1861,7 @@ scsi_pass_through_yield_sense(scsi_device * device, scsi_cmnd_io * iop,
         if (scsi_debugmode > 0)
             lib_printf("%s Unit Attention %d: asc/ascq=0x%x,0x%x, retrying\n",
                        __func__, k + 1, sinfo.asc, sinfo.ascq);
+        device->count_commands();
         if (! device->scsi_pass_through(iop))
             return false;
         scsi_do_sense_disect(iop, &sinfo);
@@ -2629,45 +2876,8 @@ void
 scsiDecodeErrCounterPage(unsigned char * resp, struct scsiErrorCounter *ecp,
                          int allocLen)
 {
-    memset(ecp, 0, sizeof(*ecp));
-    int num = sg_get_unaligned_be16(resp + 2);
-    unsigned char * ucp = &resp[0] + 4;
-
     /* allocLen is length of whole log page including 4 byte log page header */
-    num = num < allocLen - 4 ? num : allocLen - 4;
-    while (num >= 4) {  /* header of each parameter takes 4 bytes */
-        int pc = sg_get_unaligned_be16(ucp + 0);
-        int pl = ucp[3] + 4;
-        uint64_t * ullp;
-
-        if (num < pl)  /* remaining length less than a complete parameter */
-            break;
-        switch (pc) {
-        case 0:
-        case 1:
-        case 2:
-        case 3:
-        case 4:
-        case 5:
-        case 6:
-            ecp->gotPC[pc] = 1;
-            ullp = &ecp->counter[pc];
-        break;
-        default:
-            ecp->gotExtraPC = 1;
-            ullp = &ecp->counter[7];
-            break;
-        }
-        int k = pl - 4;
-        unsigned char * xp = ucp + 4;
-        if (k > (int)sizeof(*ullp)) {
-            xp += (k - sizeof(*ullp));
-            k = sizeof(*ullp);
-        }
-        *ullp = sg_get_unaligned_be(k, xp);
-        num -= pl;
-        ucp += pl;
-    }
+    scsi_decode_log_page(scsi_error_counter_schema, resp, allocLen, *ecp);
 }
 
 void
@@ -2675,59 +2885,7 @@ scsiDecodeNonMediumErrPage(unsigned char *resp,
                            struct scsiNonMediumError *nmep,
                            int allocLen)
 {
-    memset(nmep, 0, sizeof(*nmep));
-    int num = sg_get_unaligned_be16(resp + 2);
-    unsigned char * ucp = &resp[0] + 4;
-    static int szof = sizeof(nmep->counterPC0);
-
-    /* allocLen is length of whole log page including 4 byte log page header */
-    num = num < allocLen - 4 ? num : allocLen - 4;
-    while (num >= 4) {  /* header of each parameter takes 4 bytes */
-        int pc = sg_get_unaligned_be16(ucp + 0);
-        int pl = ucp[3] + 4;
-        int k;
-        unsigned char * xp;
-
-        if (num < pl)  /* remaining length less than a complete parameter */
-            break;
-        switch (pc) {
-        case 0:
-            nmep->gotPC0 = 1;
-            k = pl - 4;
-            xp = ucp + 4;
-            if (k > szof) {
-                xp += (k - szof);
-                k = szof;
-            }
-            nmep->counterPC0 = sg_get_unaligned_be(k, xp + 0);
-            break;
-        case 0x8009:
-            nmep->gotTFE_H = 1;
-            k = pl - 4;
-            xp = ucp + 4;
-            if (k > szof) {
-                xp += (k - szof);
-                k = szof;
-            }
-            nmep->counterTFE_H = sg_get_unaligned_be(k, xp + 0);
-            break;
-        case 0x8015:
-            nmep->gotPE_H = 1;
-            k = pl - 4;
-            xp = ucp + 4;
-            if (k > szof) {
-                xp += (k - szof);
-                k = szof;
-            }
-            nmep->counterPE_H = sg_get_unaligned_be(k, xp + 0);
-            break;
-        default:
-            nmep->gotExtraPC = 1;
-            break;
-        }
-        num -= pl;
-        ucp += pl;
-    }
+    scsi_decode_log_page(scsi_non_medium_error_schema, resp, allocLen, *nmep);
 }
 
 /* Counts number of failed self-tests. Also encodes the poweron_hour
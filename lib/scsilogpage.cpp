@@ -0,0 +1,227 @@
+/*
+ * scsilogpage.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <smartmon/scsilogpage.h>
+
+#include <smartmon/scsicmds.h>
+#include <smartmon/sg_unaligned.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace smartmon {
+
+static inline bool param_code_less(const scsi_log_field & f, unsigned code)
+{
+  return (f.param_code < code);
+}
+
+// Decode all fields starting at FIELD which match CODE.
+// Return pointer to first field not matching.
+static inline const scsi_log_field * decode_fields(const scsi_log_field * field,
+  const scsi_log_field * end, unsigned code, const scsi_log_param_iterator & it,
+  char * result, int & cnt)
+{
+  for ( ; field < end && field->param_code == code; field++) {
+    const uint8_t * xp = it.data() + field->offset;
+    int k = it.data_len() - field->offset;
+    if (!field->width) {
+      // Variable length counter, use least significant 8 bytes
+      if (k < 0)
+        continue;
+      if (k > 8) {
+        xp += k - 8;
+        k = 8;
+      }
+    }
+    else {
+      if (k < field->width)
+        continue;
+      k = field->width;
+    }
+    if (field->value_offset != scsi_log_no_offset) {
+      uint64_t val = (k == 8 ? sg_get_unaligned_be64(xp) :
+                      k == 4 ? sg_get_unaligned_be32(xp) :
+                               sg_get_unaligned_be(k, xp)  );
+      memcpy(result + field->value_offset, &val, sizeof(val));
+    }
+    if (field->got_offset != scsi_log_no_offset)
+      result[field->got_offset] = 1;
+    cnt++;
+  }
+  return field;
+}
+
+int scsi_decode_log_page(const scsi_log_schema & schema, const uint8_t * resp,
+                         int resp_len, void * result, size_t result_size)
+{
+  if (result_size != schema.struct_size)
+    return -1;
+  memset(result, 0, result_size);
+
+  const scsi_log_field * begin = schema.fields, * end = begin + schema.num_fields;
+  // Fields for other parameters are at the end of the table
+  const scsi_log_field * other = std::lower_bound(begin, end, scsi_log_other_params,
+                                                  param_code_less);
+  char * res = static_cast<char *>(result);
+  int cnt = 0;
+  // Parameters are usually returned in ascending order, so the field
+  // following the last match is tried first.
+  const scsi_log_field * hint = begin;
+  scsi_log_param_iterator it(resp, resp_len);
+  while (it.next()) {
+    unsigned code = it.code();
+    const scsi_log_field * f = hint;
+    if (!(f < other && f->param_code == code))
+      f = std::lower_bound(begin, other, code, param_code_less);
+    if (f < other && f->param_code == code)
+      hint = decode_fields(f, other, code, it, res, cnt);
+    else
+      decode_fields(other, end, scsi_log_other_params, it, res, cnt);
+  }
+  return cnt;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Schemas
+
+#define LOG_FIELD(code, offset, width, type, value, got, name, unit) \
+  { code, offset, width, offsetof(type, value), offsetof(type, got), name, unit }
+
+#define LOG_VALUE(code, offset, width, type, value, name, unit) \
+  { code, offset, width, offsetof(type, value), scsi_log_no_offset, name, unit }
+
+#define LOG_FLAG(code, type, got, name) \
+  { code, 0, 0, scsi_log_no_offset, offsetof(type, got), name, nullptr }
+
+#define LOG_SCHEMA(name, fields, type) \
+  { name, fields, sizeof(fields) / sizeof(fields[0]), sizeof(type) }
+
+// SPC-5 7.3.8, 7.3.23, 7.3.24
+static const scsi_log_field error_counter_fields[] = {
+  LOG_FIELD(0x0000, 0, 0, scsiErrorCounter, counter[0], gotPC[0],
+            "Errors corrected without substantial delay", nullptr),
+  LOG_FIELD(0x0001, 0, 0, scsiErrorCounter, counter[1], gotPC[1],
+            "Errors corrected with possible delays", nullptr),
+  LOG_FIELD(0x0002, 0, 0, scsiErrorCounter, counter[2], gotPC[2],
+            "Total rewrites or rereads", nullptr),
+  LOG_FIELD(0x0003, 0, 0, scsiErrorCounter, counter[3], gotPC[3],
+            "Total errors corrected", nullptr),
+  LOG_FIELD(0x0004, 0, 0, scsiErrorCounter, counter[4], gotPC[4],
+            "Total times correction algorithm processed", nullptr),
+  LOG_FIELD(0x0005, 0, 0, scsiErrorCounter, counter[5], gotPC[5],
+            "Total bytes processed", nullptr),
+  LOG_FIELD(0x0006, 0, 0, scsiErrorCounter, counter[6], gotPC[6],
+            "Total uncorrected errors", nullptr),
+  LOG_FIELD(scsi_log_other_params, 0, 0, scsiErrorCounter, counter[7], gotExtraPC,
+            "Vendor specific", nullptr),
+};
+
+const scsi_log_schema scsi_error_counter_schema =
+  LOG_SCHEMA("Error counter", error_counter_fields, scsiErrorCounter);
+
+// SPC-5 7.3.14
+static const scsi_log_field non_medium_error_fields[] = {
+  LOG_FIELD(0x0000, 0, 0, scsiNonMediumError, counterPC0, gotPC0,
+            "Non-medium error count", nullptr),
+  LOG_FIELD(0x8009, 0, 0, scsiNonMediumError, counterTFE_H, gotTFE_H,
+            "Track following errors", nullptr), // Hitachi
+  LOG_FIELD(0x8015, 0, 0, scsiNonMediumError, counterPE_H, gotPE_H,
+            "Positioning errors", nullptr), // Hitachi
+  LOG_FLAG(scsi_log_other_params, scsiNonMediumError, gotExtraPC,
+           "Vendor specific"),
+};
+
+const scsi_log_schema scsi_non_medium_error_schema =
+  LOG_SCHEMA("Non-medium error", non_medium_error_fields, scsiNonMediumError);
+
+// ZBC-2 5.5.2, 4 byte counters follow 4 reserved bytes.
+// Shorter parameters (e.g. DC HC650) are ignored.
+#define ZBD_FIELD(code, name) \
+  LOG_FIELD(code, 4, 4, scsiZBDeviceStats, counter[code], gotPC[code], name, nullptr)
+
+static const scsi_log_field zb_device_stats_fields[] = {
+  ZBD_FIELD(0x0, "Maximum open zones"),
+  ZBD_FIELD(0x1, "Maximum explicitly open zones"),
+  ZBD_FIELD(0x2, "Maximum implicitly open zones"),
+  ZBD_FIELD(0x3, "Minimum empty zones"),
+  ZBD_FIELD(0x4, "Maximum nonseq zones"),
+  ZBD_FIELD(0x5, "Zones emptied"),
+  ZBD_FIELD(0x6, "Suboptimal write commands"),
+  ZBD_FIELD(0x7, "Commands exceeding optinmal limit"), // sic, JSON key
+  ZBD_FIELD(0x8, "Failed explicit opens"),
+  ZBD_FIELD(0x9, "Read rule violations"),
+  ZBD_FIELD(0xa, "Write rule violations"),
+  ZBD_FIELD(0xb, "Maximum implicitly open sequential or before required zones"),
+};
+
+#undef ZBD_FIELD
+
+const scsi_log_schema scsi_zb_device_stats_schema =
+  LOG_SCHEMA("Zoned block device statistics", zb_device_stats_fields, scsiZBDeviceStats);
+
+// SBC-4 6.4.7, 8 byte values.  The 'got' flag of a parameter is set by
+// its last value, so it is only set if the parameter is complete.
+#define GSP_VALUE(code, i, name, unit) \
+  LOG_VALUE(code, 8 * i, 8, scsiGStatsPerf, counter[code][i], name, unit)
+#define GSP_LAST(code, i, name, unit) \
+  LOG_FIELD(code, 8 * i, 8, scsiGStatsPerf, counter[code][i], gotPC[code], name, unit)
+#define GSP_PARAM(code, name) \
+  LOG_FLAG(code, scsiGStatsPerf, gotParam[code], name)
+
+static const scsi_log_field gen_stats_perf_fields[] = {
+  GSP_PARAM(0x0001, "General access statistics and performance"),
+  GSP_VALUE(0x0001, 0, "Number of read commands", nullptr),
+  GSP_VALUE(0x0001, 1, "Number of write commands", nullptr),
+  GSP_VALUE(0x0001, 2, "number of logical blocks received", nullptr),
+  GSP_VALUE(0x0001, 3, "number of logical blocks transmitted", nullptr),
+  GSP_VALUE(0x0001, 4, "read command processing intervals", "interval"),
+  GSP_VALUE(0x0001, 5, "write command processing intervals", "interval"),
+  GSP_VALUE(0x0001, 6, "weighted number of read commands plus write commands", nullptr),
+  GSP_LAST (0x0001, 7, "weighted read command processing plus write command processing",
+            "interval"),
+  GSP_PARAM(0x0002, "Idle time"),
+  GSP_LAST (0x0002, 0, "Idle time intervals", "interval"),
+  // Time interval, 4 byte exponent and integer
+  GSP_PARAM(0x0003, "Time interval"),
+  LOG_VALUE(0x0003, 0, 4, scsiGStatsPerf, counter[3][0], "Exponent", nullptr),
+  LOG_FIELD(0x0003, 4, 4, scsiGStatsPerf, counter[3][1], gotPC[3], "Integer", nullptr),
+  GSP_PARAM(0x0004, "Force Unit Access statistics and performance"),
+  GSP_VALUE(0x0004, 0, "Number of read FUA commands", nullptr),
+  GSP_VALUE(0x0004, 1, "Number of write FUA commands", nullptr),
+  GSP_VALUE(0x0004, 2, "Number of read FUA_NV commands", nullptr),
+  GSP_VALUE(0x0004, 3, "Number of write FUA_NV commands", nullptr),
+  GSP_VALUE(0x0004, 4, "Number of read FUA intervals", "interval"),
+  GSP_VALUE(0x0004, 5, "Number of write FUA intervals", "interval"),
+  GSP_VALUE(0x0004, 6, "Number of read FUA_NV intervals", "interval"),
+  GSP_LAST (0x0004, 7, "Number of write FUA_NV intervals", "interval"),
+};
+
+#undef GSP_VALUE
+#undef GSP_LAST
+#undef GSP_PARAM
+
+const scsi_log_schema scsi_gen_stats_perf_schema =
+  LOG_SCHEMA("General statistics and performance", gen_stats_perf_fields, scsiGStatsPerf);
+
+// SBC-4 6.4.11
+static const scsi_log_field ss_media_fields[] = {
+  LOG_FLAG(0x0001, scsiSSMedia, gotParam, "Percentage used endurance indicator"),
+  LOG_FIELD(0x0001, 3, 1, scsiSSMedia, pcntUsedEndurance, gotPUEI,
+            "Percentage used endurance indicator", "%"),
+};
+
+const scsi_log_schema scsi_ss_media_schema =
+  LOG_SCHEMA("Solid state media", ss_media_fields, scsiSSMedia);
+
+} // namespace smartmon
@@ -0,0 +1,219 @@
+/*
+ * selftest.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <smartmon/selftest.h>
+
+#include <smartmon/atacmds.h>
+#include <smartmon/dev_interface.h>
+#include <smartmon/nvmecmds.h>
+#include <smartmon/scsicmds.h>
+#include <smartmon/sg_unaligned.h>
+
+#include <errno.h>
+
+namespace smartmon {
+
+// Short self-tests should complete within 2 minutes (ACS-3, SPC-5, NVMe 2.0)
+const unsigned short_test_sec = 2 * 60;
+
+static const char * ata_status_str(unsigned status)
+{
+  switch (status) {
+    case 0x0: return "Completed without error";
+    case 0x1: return "Aborted by host";
+    case 0x2: return "Interrupted (host reset)";
+    case 0x3: return "Fatal or unknown error";
+    case 0x4: return "Completed: unknown failure";
+    case 0x5: return "Completed: electrical failure";
+    case 0x6: return "Completed: servo/seek failure";
+    case 0x7: return "Completed: read failure";
+    case 0x8: return "Completed: handling damage??";
+    case 0xf: return "Self-test routine in progress";
+    default:  return "Unknown status";
+  }
+}
+
+static const char * scsi_status_str(unsigned status)
+{
+  switch (status) {
+    case 0x0: return "Completed";
+    case 0x1: return "Aborted (by user command)";
+    case 0x2: return "Aborted (device reset ?)";
+    case 0x3: return "Unknown error, incomplete";
+    case 0x4: return "Completed, segment failed";
+    case 0x5: return "Failed in first segment";
+    case 0x6: return "Failed in second segment";
+    case 0x7: return "Failed in segment";
+    case 0xf: return "Self test in progress";
+    default:  return "Reserved";
+  }
+}
+
+static const char * nvme_status_str(unsigned status)
+{
+  switch (status) {
+    case 0x0: return "Completed without error";
+    case 0x1: return "Aborted: Self-test command";
+    case 0x2: return "Aborted: Controller Reset";
+    case 0x3: return "Aborted: Namespace removed";
+    case 0x4: return "Aborted: Format NVM command";
+    case 0x5: return "Fatal or unknown test error";
+    case 0x6: return "Completed: unknown failed segment";
+    case 0x7: return "Completed: failed segments";
+    case 0x8: return "Aborted: unknown reason";
+    case 0x9: return "Aborted: sanitize operation";
+    default:  return "Unknown result";
+  }
+}
+
+bool self_test_runner::init()
+{
+  m_short_sec = m_extended_sec = 0;
+
+  if (ata_device * atadev = m_device->to_ata()) {
+    ata_smart_values sv;
+    if (ataReadSmartValues(atadev, &sv))
+      return false;
+    if (!isSupportSelfTest(&sv))
+      return m_device->set_err(ENOSYS, "Self-tests not supported");
+    m_short_sec = TestTime(&sv, SHORT_SELF_TEST) * 60;
+    m_extended_sec = TestTime(&sv, EXTEND_SELF_TEST) * 60;
+  }
+  else if (scsi_device * scsidev = m_device->to_scsi()) {
+    // Self-test log page is mandatory if self-tests are supported
+    self_test_state state;
+    if (!poll(state))
+      return false;
+    int sec = 0;
+    if (!scsiFetchExtendedSelfTestTime(scsidev, &sec, 0))
+      m_extended_sec = sec;
+    m_short_sec = short_test_sec;
+  }
+  else if (nvme_device * nvmedev = m_device->to_nvme()) {
+    nvme_id_ctrl id_ctrl;
+    if (!nvme_read_id_ctrl(nvmedev, id_ctrl))
+      return false;
+    if (!(id_ctrl.oacs & 0x0010))
+      return m_device->set_err(ENOSYS, "Self-tests not supported");
+    m_extended_sec = id_ctrl.edstt * 60;
+    m_short_sec = short_test_sec;
+    m_nsid = nvmedev->get_nsid();
+  }
+  else
+    return m_device->set_err(ENOSYS, "Self-tests not supported by this device type");
+  return true;
+}
+
+bool self_test_runner::start(self_test_type type)
+{
+  bool is_short = (type == SELF_TEST_SHORT);
+  if (ata_device * atadev = m_device->to_ata()) {
+    if (smartcommandhandler(atadev, IMMEDIATE_OFFLINE,
+                            (is_short ? SHORT_SELF_TEST : EXTEND_SELF_TEST), nullptr))
+      return false;
+    return true;
+  }
+  if (scsi_device * scsidev = m_device->to_scsi()) {
+    int err = scsiSendDiagnostic(scsidev, (is_short ? SCSI_DIAG_BG_SHORT_SELF_TEST
+                                                    : SCSI_DIAG_BG_EXTENDED_SELF_TEST),
+                                 nullptr, 0);
+    if (err)
+      return m_device->set_err(EIO, "SEND DIAGNOSTIC failed: %s", scsiErrString(err));
+    return true;
+  }
+  if (nvme_device * nvmedev = m_device->to_nvme())
+    return nvme_self_test(nvmedev, (is_short ? 0x1 : 0x2), m_nsid);
+  return m_device->set_err(ENOSYS);
+}
+
+bool self_test_runner::abort()
+{
+  if (ata_device * atadev = m_device->to_ata())
+    return !smartcommandhandler(atadev, IMMEDIATE_OFFLINE, ABORT_SELF_TEST, nullptr);
+  if (scsi_device * scsidev = m_device->to_scsi()) {
+    int err = scsiSendDiagnostic(scsidev, SCSI_DIAG_ABORT_SELF_TEST, nullptr, 0);
+    if (err)
+      return m_device->set_err(EIO, "SEND DIAGNOSTIC failed: %s", scsiErrString(err));
+    return true;
+  }
+  if (nvme_device * nvmedev = m_device->to_nvme())
+    return nvme_self_test(nvmedev, 0xf, m_nsid);
+  return m_device->set_err(ENOSYS);
+}
+
+bool self_test_runner::poll(self_test_state & state)
+{
+  state = self_test_state();
+
+  if (ata_device * atadev = m_device->to_ata()) {
+    // Execution status reflects the running or last test
+    ata_smart_values sv;
+    if (ataReadSmartValues(atadev, &sv))
+      return false;
+    unsigned status = sv.self_test_exec_status >> 4;
+    state.running = (status == 0xf);
+    if (state.running)
+      state.percent_done = 100 - 10 * (sv.self_test_exec_status & 0xf);
+    state.status = status;
+    state.passed = (status == 0x0);
+    state.status_str = ata_status_str(status);
+  }
+  else if (scsi_device * scsidev = m_device->to_scsi()) {
+    // Most recent entry of Self-test results log page
+    unsigned char resp[LOG_RESP_SELF_TEST_LEN];
+    int err = scsiLogSense(scsidev, SELFTEST_RESULTS_LPAGE, 0, resp,
+                           LOG_RESP_SELF_TEST_LEN, 0);
+    if (err)
+      return m_device->set_err(EIO, "Read Self-test log failed: %s", scsiErrString(err));
+    if ((resp[0] & 0x3f) != SELFTEST_RESULTS_LPAGE
+        || sg_get_unaligned_be16(resp + 2) != 0x190)
+      return m_device->set_err(EIO, "Self-test log page is invalid");
+    const unsigned char * ucp = resp + 4;
+    // Empty entry, see scsiCountFailedSelfTests()
+    if (!ucp[4] && !sg_get_unaligned_be16(ucp + 6))
+      return true;
+    unsigned status = ucp[4] & 0xf;
+    state.running = (status == 0xf);
+    if (state.running) {
+      // Progress indication of REQUEST SENSE data is optional
+      scsi_sense_disect sinfo;
+      if (!scsiRequestSense(scsidev, &sinfo) && sinfo.progress >= 0)
+        state.percent_done = sinfo.progress * 100 / 65536;
+    }
+    state.status = status;
+    state.passed = (status == 0x0);
+    state.status_str = scsi_status_str(status);
+  }
+  else if (nvme_device * nvmedev = m_device->to_nvme()) {
+    nvme_self_test_log log;
+    if (!nvme_read_self_test_log(nvmedev, nvme_broadcast_nsid, log))
+      return false;
+    if (log.current_operation & 0xf) {
+      state.running = true;
+      state.percent_done = log.current_completion & 0x7f;
+      state.status = 0xf;
+      state.status_str = "Self-test in progress";
+      return true;
+    }
+    unsigned status = log.results[0].self_test_status & 0xf;
+    if (status == 0xf) // Unused entry
+      return true;
+    state.status = status;
+    state.passed = (status == 0x0);
+    state.status_str = nvme_status_str(status);
+  }
+  else
+    return m_device->set_err(ENOSYS);
+  return true;
+}
+
+} // namespace smartmon
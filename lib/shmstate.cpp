@@ -0,0 +1,303 @@
+/*
+ * shmstate.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <smartmon/shmstate.h>
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <string>
+
+// The sequence lock and the payload are accessed through 32-bit atomics
+// placed in the shared mapping.  This requires address-free (lock-free)
+// atomics of the same size as the plain integer.
+SMARTMON_STATIC_ASSERT(ATOMIC_INT_LOCK_FREE == 2);
+SMARTMON_STATIC_ASSERT(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+namespace smartmon {
+
+const unsigned entry_words = sizeof(shmstate_entry) / sizeof(uint32_t);
+
+static inline std::atomic<uint32_t> & atomic_ref(uint32_t & v)
+{
+  return reinterpret_cast<std::atomic<uint32_t> &>(v);
+}
+
+static inline const std::atomic<uint32_t> & atomic_ref(const uint32_t & v)
+{
+  return reinterpret_cast<const std::atomic<uint32_t> &>(v);
+}
+
+static inline shmstate_entry * get_entry(shmstate_header * hdr, unsigned index)
+{
+  return reinterpret_cast<shmstate_entry *>(
+    reinterpret_cast<char *>(hdr) + hdr->header_size + index * hdr->entry_size);
+}
+
+static inline const shmstate_entry * get_entry(const shmstate_header * hdr, unsigned index)
+{
+  return reinterpret_cast<const shmstate_entry *>(
+    reinterpret_cast<const char *>(hdr) + hdr->header_size + index * hdr->entry_size);
+}
+
+void shmstate_init_entry(shmstate_entry & entry)
+{
+  memset(&entry, 0, sizeof(entry));
+  entry.percentage_used = entry.available_spare = 0xff;
+  entry.power_on_hours = entry.reallocated_sectors = entry.pending_sectors
+    = entry.offline_uncorrectable = entry.media_errors = entry.error_log_entries
+    = shmstate_na;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// shmstate_writer
+
+shmstate_writer::~shmstate_writer()
+{
+  unmap();
+}
+
+#ifndef _WIN32
+
+bool shmstate_writer::create(const char * path, unsigned num_entries,
+                             const shmstate_entry * entries)
+{
+  size_t size = sizeof(shmstate_header) + num_entries * sizeof(shmstate_entry);
+  std::string tmppath = path; tmppath += '~';
+
+  int fd = ::open(tmppath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+  void * p = MAP_FAILED;
+  if (!ftruncate(fd, (off_t)size))
+    p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int err = errno;
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    unlink(tmppath.c_str());
+    errno = err;
+    return false;
+  }
+
+  shmstate_header * hdr = static_cast<shmstate_header *>(p);
+  memcpy(hdr->magic, shmstate_magic, sizeof(hdr->magic));
+  hdr->version = shmstate_version;
+  hdr->header_size = sizeof(shmstate_header);
+  hdr->entry_size = sizeof(shmstate_entry);
+  hdr->num_entries = num_entries;
+  hdr->pid = (uint32_t)getpid();
+  hdr->create_time = time(nullptr);
+  for (unsigned i = 0; i < num_entries; i++) {
+    shmstate_entry * e = get_entry(hdr, i);
+    memcpy(e, entries + i, sizeof(*e));
+    e->seq = 0;
+  }
+
+  if (rename(tmppath.c_str(), path)) {
+    err = errno;
+    munmap(p, size);
+    unlink(tmppath.c_str());
+    errno = err;
+    return false;
+  }
+
+  // Tell readers of the previous file to reopen
+  if (m_header) {
+    atomic_ref(m_header->flags).fetch_or(SHMSTATE_REPLACED, std::memory_order_release);
+    unmap();
+  }
+  m_header = hdr; m_size = size;
+  m_num_entries = num_entries;
+  return true;
+}
+
+void shmstate_writer::close()
+{
+  if (!m_header)
+    return;
+  atomic_ref(m_header->flags).fetch_or(SHMSTATE_CLOSED, std::memory_order_release);
+  unmap();
+}
+
+void shmstate_writer::set_pid()
+{
+  if (!m_header)
+    return;
+  atomic_ref(m_header->pid).store((uint32_t)getpid(), std::memory_order_release);
+}
+
+void shmstate_writer::unmap()
+{
+  if (!m_header)
+    return;
+  munmap(m_header, m_size);
+  m_header = nullptr; m_size = 0;
+  m_num_entries = 0;
+}
+
+#else // _WIN32
+
+bool shmstate_writer::create(const char * /*path*/, unsigned /*num_entries*/,
+                             const shmstate_entry * /*entries*/)
+{
+  errno = ENOSYS;
+  return false;
+}
+
+void shmstate_writer::close()
+{
+}
+
+void shmstate_writer::set_pid()
+{
+}
+
+void shmstate_writer::unmap()
+{
+}
+
+#endif // _WIN32
+
+const shmstate_entry & shmstate_writer::get(unsigned index) const
+{
+  // Only modified by this writer, no lock required
+  return *get_entry(m_header, index);
+}
+
+void shmstate_writer::update(unsigned index, const shmstate_entry & entry)
+{
+  if (!(m_header && index < m_num_entries))
+    return;
+  uint32_t * dest = reinterpret_cast<uint32_t *>(get_entry(m_header, index));
+  const uint32_t * src = reinterpret_cast<const uint32_t *>(&entry);
+
+  std::atomic<uint32_t> & seq = atomic_ref(dest[0]);
+  uint32_t s = seq.load(std::memory_order_relaxed);
+  seq.store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (unsigned i = 1; i < entry_words; i++)
+    atomic_ref(dest[i]).store(src[i], std::memory_order_relaxed);
+  seq.store(s + 2, std::memory_order_release);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// shmstate_reader
+
+shmstate_reader::~shmstate_reader()
+{
+  close();
+}
+
+#ifndef _WIN32
+
+bool shmstate_reader::open(const char * path)
+{
+  close();
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  void * p = MAP_FAILED;
+  if (!fstat(fd, &st)) {
+    if ((size_t)st.st_size >= sizeof(shmstate_header))
+      p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    else
+      errno = EINVAL;
+  }
+  int err = errno;
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    errno = err;
+    return false;
+  }
+
+  const shmstate_header * hdr = static_cast<const shmstate_header *>(p);
+  size_t size = (size_t)st.st_size;
+  if (!(   !memcmp(hdr->magic, shmstate_magic, sizeof(hdr->magic))
+        && hdr->version == shmstate_version
+        && hdr->header_size == sizeof(shmstate_header)
+        && hdr->entry_size == sizeof(shmstate_entry)
+        && hdr->num_entries <= (size - sizeof(shmstate_header)) / sizeof(shmstate_entry))) {
+    munmap(p, size);
+    errno = EINVAL;
+    return false;
+  }
+
+  m_header = hdr; m_size = size;
+  m_num_entries = hdr->num_entries;
+  return true;
+}
+
+void shmstate_reader::close()
+{
+  if (!m_header)
+    return;
+  munmap(const_cast<shmstate_header *>(m_header), m_size);
+  m_header = nullptr; m_size = 0;
+  m_num_entries = 0;
+}
+
+#else // _WIN32
+
+bool shmstate_reader::open(const char * /*path*/)
+{
+  errno = ENOSYS;
+  return false;
+}
+
+void shmstate_reader::close()
+{
+}
+
+#endif // _WIN32
+
+unsigned shmstate_reader::flags() const
+{
+  if (!m_header)
+    return 0;
+  return atomic_ref(m_header->flags).load(std::memory_order_acquire);
+}
+
+bool shmstate_reader::read(unsigned index, shmstate_entry & entry) const
+{
+  if (!(m_header && index < m_num_entries))
+    return false;
+  const uint32_t * src = reinterpret_cast<const uint32_t *>(get_entry(m_header, index));
+  uint32_t * dest = reinterpret_cast<uint32_t *>(&entry);
+  const std::atomic<uint32_t> & seq = atomic_ref(src[0]);
+
+  // The writer holds the lock only for a few hundred nanoseconds
+  for (int retry = 0; retry < 1000; retry++) {
+    uint32_t s1 = seq.load(std::memory_order_acquire);
+    if (s1 & 1)
+      continue;
+    for (unsigned i = 1; i < entry_words; i++)
+      dest[i] = atomic_ref(src[i]).load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq.load(std::memory_order_relaxed) == s1) {
+      dest[0] = s1;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace smartmon
@@ -0,0 +1,144 @@
+/*
+ * sysfsident.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <smartmon/sysfsident.h>
+
+#include <smartmon/atacmds.h> // ata_format_id_string()
+#include <smartmon/utility.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace smartmon {
+
+// Remove leading and trailing white space.
+static std::string trim_str(const char * str, int len)
+{
+  int i = 0;
+  while (i < len && (str[i] == ' ' || str[i] == '\t' || str[i] == '\n' || !str[i]))
+    i++;
+  while (len > i && (str[len-1] == ' ' || str[len-1] == '\t' || str[len-1] == '\n'
+                     || !str[len-1]))
+    len--;
+  return std::string(str + i, len - i);
+}
+
+// Read binary sysfs attribute, return number of bytes read or -1.
+static int read_attr_bin(const std::string & path, unsigned char * buf, int size)
+{
+  stdio_file f(path.c_str(), "rb");
+  if (!f)
+    return -1;
+  return (int)fread(buf, 1, size, f);
+}
+
+// Read first line of text sysfs attribute with leading and trailing
+// white space removed, return false if missing or empty.
+static bool read_attr_str(const std::string & path, std::string & str)
+{
+  char buf[256];
+  stdio_file f(path.c_str(), "r");
+  if (!(f && fgets(buf, sizeof(buf), f)))
+    return false;
+  str = trim_str(buf, strlen(buf));
+  return !str.empty();
+}
+
+// Accept only globally unique designators.
+static bool read_attr_wwid(const std::string & path, std::string & wwn)
+{
+  std::string s;
+  if (!read_attr_str(path, s))
+    return false;
+  if (!(str_starts_with(s, "naa.") || str_starts_with(s, "eui.")))
+    return false;
+  wwn = s;
+  return true;
+}
+
+bool sysfs_identity_reader::read_scsi(const std::string & devdir, os_dev_identity & id) const
+{
+  if (!read_attr_str(devdir + "vendor", id.vendor))
+    return false;
+
+  unsigned char vpd[60 + 512];
+  if (id.vendor == "ATA") {
+    // SAT-4 12.4.2: ATA Information VPD page contains IDENTIFY DEVICE data
+    // at offset 60.  The INQUIRY model and serial may be truncated.
+    if (read_attr_bin(devdir + "vpd_pg89", vpd, sizeof(vpd)) < (int)sizeof(vpd)
+        || vpd[1] != 0x89 || vpd[56] != 0xec)
+      return false;
+    const unsigned char * idb = vpd + 60;
+    char buf[64];
+    ata_format_id_string(buf, idb + 2*10, 20); id.serial = buf;
+    ata_format_id_string(buf, idb + 2*23, 8);  id.firmware = buf;
+    ata_format_id_string(buf, idb + 2*27, 40); id.model = buf;
+    id.protocol = "ATA";
+    id.vendor.clear();
+
+    // Words 108-111 contain the WWN if word 87 is valid and bit 8 is set
+    unsigned w87 = idb[2*87] | (idb[2*87+1] << 8);
+    if ((w87 & 0xc100) == 0x4100) {
+      char wwn[4 + 16 + 1];
+      snprintf(wwn, sizeof(wwn), "naa.%02x%02x%02x%02x%02x%02x%02x%02x",
+               idb[2*108+1], idb[2*108], idb[2*109+1], idb[2*109],
+               idb[2*110+1], idb[2*110], idb[2*111+1], idb[2*111]);
+      id.wwn = wwn;
+    }
+  }
+  else {
+    id.protocol = "SCSI";
+    read_attr_str(devdir + "model", id.model);
+    read_attr_str(devdir + "rev", id.firmware);
+    // SPC-5 7.7.21: Unit Serial Number VPD page
+    int n = read_attr_bin(devdir + "vpd_pg80", vpd, 4 + 252);
+    if (n > 4 && vpd[1] == 0x80) {
+      int len = (vpd[3] < n - 4 ? vpd[3] : n - 4);
+      id.serial = trim_str((const char *)vpd + 4, len);
+    }
+    read_attr_wwid(devdir + "wwid", id.wwn);
+  }
+
+  return !(id.model.empty() || id.serial.empty());
+}
+
+bool sysfs_identity_reader::read_nvme(const char * ctrl, os_dev_identity & id) const
+{
+  // Namespaces share the identity of the controller, like the duplicate
+  // detection of smartd which ignores the namespace id.
+  std::string dir = m_root + "/class/nvme/" + ctrl + '/';
+  if (!(   read_attr_str(dir + "model", id.model)
+        && read_attr_str(dir + "serial", id.serial)))
+    return false;
+  read_attr_str(dir + "firmware_rev", id.firmware);
+  id.protocol = "NVMe";
+  return true;
+}
+
+bool sysfs_identity_reader::read(const char * kname, os_dev_identity & id) const
+{
+  id = os_dev_identity();
+  unsigned u; int n1 = -1, n2 = -1;
+  if (sscanf(kname, "sd%*[a-z]%n", &n1) == 0 && n1 > 0 && !kname[n1])
+    return read_scsi(m_root + "/block/" + kname + "/device/", id);
+  if (sscanf(kname, "sg%u%n", &u, &n1) == 1 && n1 > 0 && !kname[n1])
+    return read_scsi(m_root + "/class/scsi_generic/" + kname + "/device/", id);
+  if (sscanf(kname, "nvme%u%n", &u, &n1) == 1 && n1 > 0) {
+    std::string ctrl(kname, n1);
+    if (   !kname[n1]
+        || (sscanf(kname + n1, "n%u%n", &u, &n2) == 1 && n2 > 0 && !kname[n1 + n2]))
+      return read_nvme(ctrl.c_str(), id);
+  }
+  return false;
+}
+
+} // namespace smartmon
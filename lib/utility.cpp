@@ -38,6 +38,11 @@
 #include <sys/types.h> // for regex.h (according to POSIX)
 #include <regex.h>
 #endif
+#ifdef WITH_DFA_REGEX
+#include "regex_dfa.h"
+#include <atomic>
+#include <mutex>
+#endif
 
 #include <smartmon/utility.h>
 
@@ -551,6 +556,8 @@ static const char * check_regex(const char * pattern)
 }
 
 // Wrapper class for POSIX regex(3) or std::regex
+// Optionally uses regex_dfa for repeated full_match() calls.
+// The DFA is built on demand, const member functions are thread safe.
 
 #ifdef WITH_CXX11_REGEX
 using regex_type = std::regex;
@@ -558,26 +565,46 @@ using regex_type = std::regex;
 using regex_type = regex_t;
 #endif
 
+namespace {
+
+struct regex_impl
+{
+  regex_type rex{};
+#ifdef WITH_DFA_REGEX
+  regex_dfa dfa;
+  // 0: unused, 1: used once, 2: DFA built on second full_match()
+  std::atomic<unsigned> dfa_state{0};
+  std::mutex dfa_mutex;
+#endif
+};
+
+} // namespace
+
+static inline regex_impl & get_impl(void * m_regex_p)
+{
+  return *reinterpret_cast<regex_impl *>(m_regex_p);
+}
+
 static inline regex_type & get_regex(void * m_regex_p)
 {
-  return *reinterpret_cast<regex_type *>(m_regex_p);
+  return get_impl(m_regex_p).rex;
 }
 
 regular_expression::regular_expression()
-: m_regex_p(new regex_type{})
+: m_regex_p(new regex_impl)
 {
 }
 
 regular_expression::~regular_expression()
 {
   free_regex();
-  delete &get_regex(m_regex_p);
+  delete &get_impl(m_regex_p);
 }
 
 regular_expression::regular_expression(const regular_expression & x)
 : m_pattern(x.m_pattern),
   m_errmsg(x.m_errmsg),
-  m_regex_p(new regex_type)
+  m_regex_p(new regex_impl)
 {
   copy_regex(x);
 }
@@ -593,7 +620,7 @@ regular_expression & regular_expression::operator=(const regular_expression & x)
 
 regular_expression::regular_expression(const char * pattern)
 : m_pattern(pattern),
-  m_regex_p(new regex_type)
+  m_regex_p(new regex_impl)
 {
   if (!compile())
     throw std::runtime_error(strprintf(
@@ -646,6 +673,28 @@ bool regular_expression::compile()
 
 bool regular_expression::full_match(const char * str) const
 {
+#ifdef WITH_DFA_REGEX
+  // Build DFA if the pattern is used again, one-time matches are left
+  // to regex_type.  DFA stays empty if the pattern is not supported.
+  regex_impl & impl = get_impl(m_regex_p);
+  unsigned state = impl.dfa_state.load(std::memory_order_acquire);
+  if (state == 0 && impl.dfa_state.compare_exchange_strong(state, 1))
+    state = 1; // First use
+  else if (state == 1) {
+    std::lock_guard<std::mutex> lock(impl.dfa_mutex);
+    if (impl.dfa_state.load(std::memory_order_relaxed) != 2) {
+      impl.dfa.compile(m_pattern.c_str());
+      impl.dfa_state.store(2, std::memory_order_release);
+    }
+    state = 2;
+  }
+  if (state == 2 && !impl.dfa.empty()) {
+    int res = impl.dfa.full_match(str);
+    if (res >= 0)
+      return !!res;
+  }
+#endif
+
   regex_type & rex = get_regex(m_regex_p);
 #ifdef WITH_CXX11_REGEX
   return std::regex_match(str, rex);
@@ -702,10 +751,21 @@ void regular_expression::copy_regex(const regular_expression & x)
         m_pattern.c_str(), m_errmsg.c_str()));
   }
 #endif
+#ifdef WITH_DFA_REGEX
+  regex_impl & impl = get_impl(m_regex_p), & x_impl = get_impl(x.m_regex_p);
+  unsigned x_state = x_impl.dfa_state.load(std::memory_order_acquire);
+  if (x_state == 2)
+    impl.dfa = x_impl.dfa;
+  impl.dfa_state.store(x_state, std::memory_order_relaxed);
+#endif
 }
 
 void regular_expression::free_regex()
 {
+#ifdef WITH_DFA_REGEX
+  get_impl(m_regex_p).dfa.clear();
+  get_impl(m_regex_p).dfa_state.store(0, std::memory_order_relaxed);
+#endif
 #ifndef WITH_CXX11_REGEX
   regex_type & rex = get_regex(m_regex_p);
   if (nonempty(&rex, sizeof(rex)))
@@ -894,6 +954,17 @@ std::string strprintf(const char * fmt, ...)
   return str;
 }
 
+const char * strcatprintf(char * str, int strsize, const char * fmt, ...)
+{
+  int len = (int)strlen(str);
+  if (len < strsize - 1) {
+    va_list ap; va_start(ap, fmt);
+    vsnprintf(str + len, strsize - len, fmt, ap);
+    va_end(ap);
+  }
+  return str;
+}
+
 #if defined(HAVE___INT128)
 // Compiler supports '__int128'.
 
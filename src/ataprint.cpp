@@ -49,7 +49,7 @@ static bool is_permissive()
 }
 
 /* For the given Command Register (CR) and Features Register (FR), attempts
- * to construct a string that describes the contents of the Status
+ * to construct a string in STR that describes the contents of the Status
  * Register (ST) and Error Register (ER).  If the meanings of the flags of
  * the error register are not known for the given command then it returns an
  * empty string.
@@ -61,7 +61,8 @@ static bool is_permissive()
  * should probably be redesigned.
  */
 
-static std::string format_st_er_desc(
+static const char * format_st_er_desc(
+  char * str, int strsize,
   unsigned char CR, unsigned char FR,
   unsigned char ST, unsigned char ER,
   unsigned short SC,
@@ -99,7 +100,7 @@ static std::string format_st_er_desc(
   for (i = 0; i < 8; i++)
     error_flag[i] = NULL;
 
-  std::string str;
+  str[0] = 0;
 
   switch (CR) {
   case 0x10:  // RECALIBRATE
@@ -316,19 +317,19 @@ static std::string format_st_er_desc(
   /* We ignore any status flags other than Device Fault and Error */
 
   if (uses_device_fault && (ST & (1 << 5))) {
-    str = "Device Fault";
+    strcatprintf(str, strsize, "Device Fault");
     if (ST & 1)  // Error flag
-      str += "; ";
+      strcatprintf(str, strsize, "; ");
   }
   if (ST & 1) {  // Error flag
     int count = 0;
 
-    str += "Error: ";
+    strcatprintf(str, strsize, "Error: ");
     for (i = 7; i >= 0; i--)
       if ((ER & (1 << i)) && (error_flag[i])) {
         if (count++ > 0)
-           str += ", ";
-        str += error_flag[i];
+           strcatprintf(str, strsize, ", ");
+        strcatprintf(str, strsize, "%s", error_flag[i]);
       }
   }
 
@@ -337,7 +338,7 @@ static std::string format_st_er_desc(
   if (print_lba) {
     // print number of sectors, if known, and append to print string
     if (print_sector)
-      str += strprintf(" %d sectors", print_sector);
+      strcatprintf(str, strsize, " %d sectors", print_sector);
 
     if (lba28_regs) {
       unsigned lba;
@@ -352,7 +353,7 @@ static std::string format_st_er_desc(
       lba <<= 8;
       // bits 0-7:   SN
       lba  |= lba28_regs->sector_number;
-      str += strprintf(" at LBA = 0x%08x = %u", lba, lba);
+      strcatprintf(str, strsize, " at LBA = 0x%08x = %u", lba, lba);
     }
     else if (lba48_regs) {
       // This assumes that upper LBA registers are 0 for 28-bit commands
@@ -370,17 +371,18 @@ static std::string format_st_er_desc(
       lba48  |= lba48_regs->lba_mid_register;
       lba48 <<= 8;
       lba48  |= lba48_regs->lba_low_register;
-      str += strprintf(" at LBA = 0x%08" PRIx64 " = %" PRIu64, lba48, lba48);
+      strcatprintf(str, strsize, " at LBA = 0x%08" PRIx64 " = %" PRIu64, lba48, lba48);
     }
   }
 
   return str;
 }
 
-static inline std::string format_st_er_desc(
-  const ata_smart_errorlog_struct * data)
+template <size_t SIZE>
+static inline const char * format_st_er_desc(
+  char (& str)[SIZE], const ata_smart_errorlog_struct * data)
 {
-  return format_st_er_desc(
+  return format_st_er_desc(str, (int)SIZE,
     data->commands[4].commandreg,
     data->commands[4].featuresreg,
     data->error_struct.status,
@@ -389,10 +391,11 @@ static inline std::string format_st_er_desc(
     &data->error_struct, (const ata_smart_exterrlog_error *)0);
 }
 
-static inline std::string format_st_er_desc(
-  const ata_smart_exterrlog_error_log * data)
+template <size_t SIZE>
+static inline const char * format_st_er_desc(
+  char (& str)[SIZE], const ata_smart_exterrlog_error_log * data)
 {
-  return format_st_er_desc(
+  return format_st_er_desc(str, (int)SIZE,
     data->commands[4].command_register,
     data->commands[4].features_register,
     data->error.status_register,
@@ -605,7 +608,7 @@ static void jset_sata_speed(const char * key, int value, int speed, const char *
 {
   if (speed <= 0)
     return;
-  json::ref jref = jglb["interface_speed"][key];
+  json::cursor jref(jglb["interface_speed"][key]);
   jref["sata_value"] = value;
   if (str)
     jref["string"] = str;
@@ -863,7 +866,7 @@ static const char *OfflineDataCollectionStatus(unsigned char status_byte)
 //  prints verbose value Off-line data collection status byte
 static void PrintSmartOfflineStatus(const ata_smart_values * data)
 {
-  json::ref jref = jglb["ata_smart_data"]["offline_data_collection"]["status"];
+  json::cursor jref(jglb["ata_smart_data"]["offline_data_collection"]["status"]);
 
   jout("Offline data collection status:  (0x%02x)\t",
        (int)data->offline_data_collection_status);
@@ -956,7 +959,7 @@ static void PrintSmartSelfExecStatus(const ata_smart_values * data,
       break;
   }
 
-  json::ref jref = jglb["ata_smart_data"]["self_test"]["status"];
+  json::cursor jref(jglb["ata_smart_data"]["self_test"]["status"]);
 
   jref["value"] = status;
   const char * msg;
@@ -998,7 +1001,7 @@ static void PrintSmartTotalTimeCompleteOffline (const ata_smart_values * data)
 
 static void PrintSmartOfflineCollectCap(const ata_smart_values *data)
 {
-  json::ref jref = jglb["ata_smart_data"]["capabilities"];
+  json::cursor jref(jglb["ata_smart_data"]["capabilities"]);
 
   jout("Offline data collection\n");
   jout("capabilities: \t\t\t (0x%02x) ",
@@ -1048,7 +1051,7 @@ static void PrintSmartOfflineCollectCap(const ata_smart_values *data)
 
 static void PrintSmartCapability(const ata_smart_values *data)
 {
-  json::ref jref = jglb["ata_smart_data"]["capabilities"];
+  json::cursor jref(jglb["ata_smart_data"]["capabilities"]);
 
   jout("SMART capabilities:            ");
   jout("(0x%04x)\t", (int)data->smart_capability);
@@ -1217,13 +1220,22 @@ static void set_json_globals_from_smart_attrib(int id, const char * name,
   }
 }
 
+// Format normalized value, worst or threshold, "---" if not valid.
+static void format_attr_byte(char (& str)[8], bool hex, bool valid, int value)
+{
+  if (valid)
+    snprintf(str, sizeof(str), (!hex ? "%.3d" : "0x%02x"), value);
+  else
+    snprintf(str, sizeof(str), "%s", (!hex ? "---" : "----"));
+}
+
 // onlyfailed=0 : print all attribute values
 // onlyfailed=1:  just ones that are currently failed and have prefailure bit set
 // onlyfailed=2:  ones that are failed, or have failed with or without prefailure bit set
-static void PrintSmartAttribWithThres(const ata_smart_values * data,
-                                      const ata_smart_thresholds_pvt * thresholds,
-                                      const ata_vendor_attr_defs & defs, int rpm,
-                                      int onlyfailed, unsigned char format)
+void PrintSmartAttribWithThres(const ata_smart_values * data,
+                               const ata_smart_thresholds_pvt * thresholds,
+                               const ata_vendor_attr_defs & defs, int rpm,
+                               int onlyfailed, unsigned char format)
 {
   bool brief  = !!(format & ata_print_options::FMT_BRIEF);
   bool hexid  = !!(format & ata_print_options::FMT_HEX_ID);
@@ -1266,28 +1278,18 @@ static void PrintSmartAttribWithThres(const ata_smart_values * data,
     }
 
     // Format value, worst, threshold
-    std::string valstr, worstr, threstr;
-    if (state > ATTRSTATE_NO_NORMVAL)
-      valstr = (!hexval ? strprintf("%.3d",   attr.current)
-                        : strprintf("0x%02x", attr.current));
-    else
-      valstr = (!hexval ? "---" : "----");
-    if (!(defs[attr.id].flags & ATTRFLAG_NO_WORSTVAL))
-      worstr = (!hexval ? strprintf("%.3d",   attr.worst)
-                        : strprintf("0x%02x", attr.worst));
-    else
-      worstr = (!hexval ? "---" : "----");
-    if (state > ATTRSTATE_NO_THRESHOLD)
-      threstr = (!hexval ? strprintf("%.3d",   threshold)
-                         : strprintf("0x%02x", threshold));
-    else
-      threstr = (!hexval ? "---" : "----");
+    char valstr[8], worstr[8], threstr[8];
+    format_attr_byte(valstr, hexval, state > ATTRSTATE_NO_NORMVAL, attr.current);
+    format_attr_byte(worstr, hexval, !(defs[attr.id].flags & ATTRFLAG_NO_WORSTVAL),
+                     attr.worst);
+    format_attr_byte(threstr, hexval, state > ATTRSTATE_NO_THRESHOLD, threshold);
 
     // Print line for each valid attribute
-    std::string idstr = (!hexid ? strprintf("%3d",    attr.id)
-                                : strprintf("0x%02x", attr.id));
-    std::string attrname = ata_get_smart_attr_name(attr.id, defs, rpm);
-    std::string rawstr = ata_format_attr_raw_value(attr, defs);
+    char idstr[8];
+    snprintf(idstr, sizeof(idstr), (!hexid ? "%3d" : "0x%02x"), attr.id);
+    const char * attrname = ata_get_smart_attr_name(attr.id, defs, rpm);
+    char rawstr[64];
+    ata_format_attr_raw_value(rawstr, attr, defs);
 
     char flagstr[] = {
       (ATTRIBUTE_FLAGS_PREFAILURE(flags)     ? 'P' : '-'),
@@ -1302,27 +1304,27 @@ static void PrintSmartAttribWithThres(const ata_smart_values * data,
 
     if (!brief)
       jout("%s %-24s0x%04x   %-4s  %-4s  %-4s   %-10s%-9s%-12s%s\n",
-           idstr.c_str(), attrname.c_str(), flags,
-           valstr.c_str(), worstr.c_str(), threstr.c_str(),
+           idstr, attrname, flags,
+           valstr, worstr, threstr,
            (ATTRIBUTE_FLAGS_PREFAILURE(flags) ? "Pre-fail" : "Old_age"),
            (ATTRIBUTE_FLAGS_ONLINE(flags)     ? "Always"   : "Offline"),
            (state == ATTRSTATE_FAILED_NOW  ? "FAILING_NOW" :
             state == ATTRSTATE_FAILED_PAST ? "In_the_past"
                                            : "    -"        ) ,
-            rawstr.c_str());
+            rawstr);
     else
       jout("%s %-24s%s  %-4s  %-4s  %-4s   %-5s%s\n",
-           idstr.c_str(), attrname.c_str(), flagstr,
-           valstr.c_str(), worstr.c_str(), threstr.c_str(),
+           idstr, attrname, flagstr,
+           valstr, worstr, threstr,
            (state == ATTRSTATE_FAILED_NOW  ? "NOW"  :
             state == ATTRSTATE_FAILED_PAST ? "Past"
                                            : "-"     ),
-            rawstr.c_str());
+            rawstr);
 
     if (!jglb.is_enabled())
       continue;
 
-    json::ref jref = jglb["ata_smart_attributes"]["table"][ji++];
+    json::cursor jref(jglb["ata_smart_attributes"]["table"][ji++]);
     jref["id"] = attr.id;
     jref["name"] = attrname;
     if (state > ATTRSTATE_NO_NORMVAL)
@@ -1336,7 +1338,7 @@ static void PrintSmartAttribWithThres(const ata_smart_values * data,
                                                             : ""     );
     }
 
-    json::ref jreff = jref["flags"];
+    json::cursor jreff(jref["flags"]);
     jreff["value"] = flags;
     jreff["string"] = flagstr;
     jreff["prefailure"]     = !!ATTRIBUTE_FLAGS_PREFAILURE(flags);
@@ -1352,7 +1354,7 @@ static void PrintSmartAttribWithThres(const ata_smart_values * data,
     jref["raw"]["value"] = rawval;
     jref["raw"]["string"] = rawstr;
 
-    set_json_globals_from_smart_attrib(attr.id, attrname.c_str(), defs,
+    set_json_globals_from_smart_attrib(attr.id, attrname, defs,
       attr.current, threshold, rawval);
   }
 
@@ -1385,7 +1387,7 @@ static void ataPrintSCTCapability(const ata_identify_device *drive)
   unsigned short sctcaps = drive->words088_255[206-88];
   if (!(sctcaps & 0x01))
     return;
-  json::ref jref = jglb["ata_sct_capabilities"];
+  json::cursor jref(jglb["ata_sct_capabilities"]);
   jout("SCT capabilities: \t       (0x%04x)\tSCT Status supported.\n", sctcaps);
   jref["value"] = sctcaps;
   if (sctcaps & 0x08)
@@ -1570,7 +1572,7 @@ const ata_smart_log_directory * fake_logdir(ata_smart_log_directory * logdir,
 static void PrintLogDirectories(const ata_smart_log_directory * gplogdir,
                                 const ata_smart_log_directory * smartlogdir)
 {
-  json::ref jref = jglb["ata_log_directory"];
+  json::cursor jref(jglb["ata_log_directory"]);
   if (gplogdir) {
     jout("General Purpose Log Directory Version %u\n", gplogdir->logversion);
     jref["gp_dir_version"] = gplogdir->logversion;
@@ -1635,7 +1637,7 @@ static void PrintLogDirectories(const ata_smart_log_directory * gplogdir,
     }
 
     for (;;) {
-      json::ref jrefi = jref["table"][ji++];
+      json::cursor jrefi(jref["table"][ji++]);
       jrefi["address"] = i;
       jrefi["name"] = name;
       if (rw[0] == 'R' && rw[1] && rw[2]) {
@@ -1961,7 +1963,7 @@ static void print_device_statistics_page(const json::ref & jref, const unsigned
     if (!jglb.is_enabled())
       continue;
 
-    json::ref jrefi = jref["table"][ji++];
+    json::cursor jrefi(jref["table"][ji++]);
     jrefi["offset"] = offset;
     jrefi["name"] = valname;
     jrefi["size"] = abs(size);
@@ -1973,7 +1975,7 @@ static void print_device_statistics_page(const json::ref & jref, const unsigned
       jrefi["string"] = infostr;
     }
 
-    json::ref jreff = jrefi["flags"];
+    json::cursor jreff(jrefi["flags"]);
     jreff["value"] = flags;
     jreff["string"] = flagstr;
     jreff["valid"] = valid;
@@ -2037,7 +2039,7 @@ static bool print_device_statistics(ata_device * device, unsigned nsectors,
       ssd_page = false;
   }
 
-  json::ref jref = jglb["ata_device_statistics"];
+  json::cursor jref(jglb["ata_device_statistics"]);
 
   // Print list of supported pages if requested
   if (print_page_0) {
@@ -2118,7 +2120,7 @@ static bool print_pending_defects_log(ata_device * device, unsigned nsectors,
 
   jout("Pending Defects log (GP Log 0x0c)\n");
   unsigned nentries = sg_get_unaligned_le32(page_buf);
-  json::ref jref = jglb["ata_pending_defects_log"];
+  json::cursor jref(jglb["ata_pending_defects_log"]);
   jref["size"] = nsectors * 32 - 1;
   jref["count"] = nentries;
   if (!nentries) {
@@ -2153,7 +2155,7 @@ static bool print_pending_defects_log(ata_device * device, unsigned nsectors,
     uint64_t lba = sg_get_unaligned_le64(entry + 8);
     jout("%5u %18" PRIu64 " %8s\n", i, lba, hourstr);
 
-    json::ref jrefi = jref["table"][i];
+    json::cursor jrefi(jref["table"][i]);
     jrefi["lba"].set_unsafe_uint64(lba);
     if (hours != 0xffffffffU)
       jrefi["power_on_hours"] = hours;
@@ -2229,7 +2231,7 @@ static void PrintSataPhyEventCounters(const unsigned char * data, bool reset)
     jout("0x%04x  %u %12" PRIu64 "%c %s\n", id, size, val,
       (val == max_val ? '+' : ' '), name);
 
-    json::ref jref = jglb["sata_phy_event_counters"]["table"][ji++];
+    json::cursor jref(jglb["sata_phy_event_counters"]["table"][ji++]);
     jref["id"] = id;
     jref["name"] = name;
     jref["size"] = size;
@@ -2243,7 +2245,7 @@ static void PrintSataPhyEventCounters(const unsigned char * data, bool reset)
 }
 
 // Format milliseconds from error log entry as "DAYS+H:M:S.MSEC"
-static std::string format_milliseconds(unsigned msec)
+static const char * format_milliseconds(char (& str)[32], unsigned msec)
 {
   unsigned days  = msec  / 86400000U;
   msec          -= days  * 86400000U;
@@ -2254,10 +2256,10 @@ static std::string format_milliseconds(unsigned msec)
   unsigned sec   = msec  / 1000U;
   msec          -= sec   * 1000U;
 
-  std::string str;
+  int n = 0;
   if (days)
-    str = strprintf("%2ud+", days);
-  str += strprintf("%02u:%02u:%02u.%03u", hours, min, sec, msec);
+    n = snprintf(str, sizeof(str), "%2ud+", days);
+  snprintf(str + n, sizeof(str) - n, "%02u:%02u:%02u.%03u", hours, min, sec, msec);
   return str;
 }
 
@@ -2278,10 +2280,10 @@ static const char * get_error_log_state_desc(unsigned state)
 }
 
 // returns number of errors
-static int PrintSmartErrorlog(const ata_smart_errorlog *data,
-                              firmwarebug_defs firmwarebugs)
+int PrintSmartErrorlog(const ata_smart_errorlog *data,
+                       firmwarebug_defs firmwarebugs)
 {
-  json::ref jref = jglb["ata_smart_error_log"]["summary"];
+  json::cursor jref(jglb["ata_smart_error_log"]["summary"]);
   jout("SMART Error Log Version: %d\n", (int)data->revnumber);
   jref["revision"] = data->revnumber;
 
@@ -2352,7 +2354,7 @@ static int PrintSmartErrorlog(const ata_smart_errorlog *data,
              (int)(data->ata_error_count+k-4), (int)summary->timestamp, days, (int)(summary->timestamp-24*days));
       print_off();
 
-      json::ref jrefi = jref["table"][ji++];
+      json::cursor jrefi(jref["table"][ji++]);
       jrefi["error_number"] = data->ata_error_count + k - 4;
       jrefi["lifetime_hours"] = summary->timestamp;
 
@@ -2370,7 +2372,7 @@ static int PrintSmartErrorlog(const ata_smart_errorlog *data,
            (int)summary->drive_head);
 
       {
-        json::ref jrefir = jrefi["completion_registers"];
+        json::cursor jrefir(jrefi["completion_registers"]);
         jrefir["error"] = summary->error_register;
         jrefir["status"] = summary->status;
         jrefir["count"] = summary->sector_count;
@@ -2382,9 +2384,10 @@ static int PrintSmartErrorlog(const ata_smart_errorlog *data,
 
       // Add a description of the contents of the status and error registers
       // if possible
-      std::string st_er_desc = format_st_er_desc(elog);
-      if (!st_er_desc.empty()) {
-        jout("  %s", st_er_desc.c_str());
+      char st_er_desc[256];
+      format_st_er_desc(st_er_desc, elog);
+      if (st_er_desc[0]) {
+        jout("  %s", st_er_desc);
         jrefi["error_description"] = st_er_desc;
       }
       jout("\n\n");
@@ -2398,6 +2401,7 @@ static int PrintSmartErrorlog(const ata_smart_errorlog *data,
         if (nonempty(thiscommand, sizeof(*thiscommand))) {
           const char * atacmd = look_up_ata_command(thiscommand->commandreg, thiscommand->featuresreg);
           uint32_t timestamp = uile32_to_uint(thiscommand->timestamp);
+          char msecstr[32];
           jout("  %02x %02x %02x %02x %02x %02x %02x %02x  %16s  %s\n",
                (int)thiscommand->commandreg,
                (int)thiscommand->featuresreg,
@@ -2407,11 +2411,11 @@ static int PrintSmartErrorlog(const ata_smart_errorlog *data,
                (int)thiscommand->cylinder_high,
                (int)thiscommand->drive_head,
                (int)thiscommand->devicecontrolreg,
-               format_milliseconds(timestamp).c_str(),
+               format_milliseconds(msecstr, timestamp),
                atacmd);
 
-          json::ref jrefic = jrefi["previous_commands"][jj++];
-          json::ref jreficr = jrefic["registers"];
+          json::cursor jrefic(jrefi["previous_commands"][jj++]);
+          json::cursor jreficr(jrefic["registers"]);
           jreficr["command"] = thiscommand->commandreg;
           jreficr["features"] = thiscommand->featuresreg,
           jreficr["count"] = thiscommand->sector_count;
@@ -2440,7 +2444,7 @@ static int PrintSmartExtErrorLog(ata_device * device,
                                  const ata_smart_exterrlog * log,
                                  unsigned nsectors, unsigned max_errors)
 {
-  json::ref jref = jglb["ata_smart_error_log"]["extended"];
+  json::cursor jref(jglb["ata_smart_error_log"]["extended"]);
   jout("SMART Extended Comprehensive Error Log Version: %u (%u sectors)\n",
        log->version, nsectors);
   jref["revision"] = log->version;
@@ -2530,7 +2534,7 @@ static int PrintSmartExtErrorLog(ata_device * device,
 
     const ata_smart_exterrlog_error_log & entry = log_p->error_logs[erridx % 4];
 
-    json::ref jrefi = jref["table"][i];
+    json::cursor jrefi(jref["table"][i]);
     jrefi["error_number"] = errnum;
     jrefi["log_index"] = erridx;
 
@@ -2572,7 +2576,7 @@ static int PrintSmartExtErrorLog(ata_device * device,
          err.device_control_register);
 
     {
-      json::ref jrefir = jrefi["completion_registers"];
+      json::cursor jrefir(jrefi["completion_registers"]);
       jrefir["error"] = err.error_register;
       jrefir["status"] = err.status_register,
       jrefir["count"] = (err.count_register_hi << 8) | err.count_register;
@@ -2588,9 +2592,10 @@ static int PrintSmartExtErrorLog(ata_device * device,
 
     // Add a description of the contents of the status and error registers
     // if possible
-    std::string st_er_desc = format_st_er_desc(&entry);
-    if (!st_er_desc.empty()) {
-      jout("  %s", st_er_desc.c_str());
+    char st_er_desc[256];
+    format_st_er_desc(st_er_desc, &entry);
+    if (st_er_desc[0]) {
+      jout("  %s", st_er_desc);
       jrefi["error_description"] = st_er_desc;
     }
     jout("\n\n");
@@ -2609,6 +2614,7 @@ static int PrintSmartExtErrorLog(ata_device * device,
       // Print registers, timestamp and ATA command name
       const char * atacmd = look_up_ata_command(cmd.command_register, cmd.features_register);
       uint32_t timestamp = uile32_to_uint(cmd.timestamp);
+      char msecstr[32];
       jout("  %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %16s  %s\n",
            cmd.command_register,
            cmd.features_register_hi,
@@ -2623,11 +2629,11 @@ static int PrintSmartExtErrorLog(ata_device * device,
            cmd.lba_low_register,
            cmd.device_register,
            cmd.device_control_register,
-           format_milliseconds(timestamp).c_str(),
+           format_milliseconds(msecstr, timestamp),
            atacmd);
 
-      json::ref jrefic = jrefi["previous_commands"][cji++];
-      json::ref jreficr = jrefic["registers"];
+      json::cursor jrefic(jrefi["previous_commands"][cji++]);
+      json::cursor jreficr(jrefic["registers"]);
       jreficr["command"] = cmd.command_register;
       jreficr["features"] = (cmd.features_register_hi << 8) | cmd.features_register;
       jreficr["count"] = (cmd.count_register_hi << 8) | cmd.count_register;
@@ -2755,7 +2761,7 @@ static int ataPrintSmartSelfTestEntry(const json::ref & jref,
 static int ataPrintSmartSelfTestlog(const ata_smart_selftestlog * log, bool allentries,
                                     firmwarebug_defs firmwarebugs)
 {
-  json::ref jref = jglb["ata_smart_self_test_log"]["standard"];
+  json::cursor jref(jglb["ata_smart_self_test_log"]["standard"]);
 
   if (allentries)
     jout("SMART Self-test log structure revision number %d\n", log->revnumber);
@@ -2824,7 +2830,7 @@ static int ataPrintSmartSelfTestlog(const ata_smart_selftestlog * log, bool alle
 static int PrintSmartExtSelfTestLog(const ata_smart_extselftestlog * log,
                                     unsigned nsectors, unsigned max_entries)
 {
-  json::ref jref = jglb["ata_smart_self_test_log"]["extended"];
+  json::cursor jref(jglb["ata_smart_self_test_log"]["extended"]);
 
   jout("SMART Extended Self-test Log Version: %u (%u sectors)\n",
        log->version, nsectors);
@@ -2907,7 +2913,7 @@ static int PrintSmartExtSelfTestLog(const ata_smart_extselftestlog * log,
 
 static void ataPrintSelectiveSelfTestLog(const ata_selective_self_test_log * log, const ata_smart_values * sv)
 {
-  json::ref jref = jglb["ata_smart_selective_self_test_log"];
+  json::cursor jref(jglb["ata_smart_selective_self_test_log"]);
 
   // print data structure revision number
   jout("SMART Selective self-test log data structure revision number %d\n", log->logversion);
@@ -2987,7 +2993,7 @@ static void ataPrintSelectiveSelfTestLog(const ata_selective_self_test_log * log
       jout("    %d  %*" PRIu64 "  %*" PRIu64 "  Not_testing\n",
            i + 1, field1, start, field2, end);
 
-    json::ref jrefi = jref["table"][i];
+    json::cursor jrefi(jref["table"][i]);
     jrefi["lba_min"] = start;
     jrefi["lba_max"] = end;
     jrefi["status"]["value"] = sv->self_test_exec_status;
@@ -3005,7 +3011,7 @@ static void ataPrintSelectiveSelfTestLog(const ata_selective_self_test_log * log
     const char * ost = OfflineDataCollectionStatus(sv->offline_data_collection_status);
     jout("%5d  %*" PRIu64 "  %*" PRIu64 "  Read_scanning %s\n",
          log->currentspan, field1, current, field2, currentend, ost);
-    json::ref jrefc = jref["current_read_scan"];
+    json::cursor jrefc(jref["current_read_scan"]);
     jrefc["lba_min"] = current;
     jrefc["lba_max"] = currentend;
     jrefc["status"]["value"] = sv->offline_data_collection_status;
@@ -3024,7 +3030,7 @@ static void ataPrintSelectiveSelfTestLog(const ata_selective_self_test_log * log
   */
   
   jout("Selective self-test flags (0x%x):\n", (unsigned)log->flags);
-  json::ref jreff = jref["flags"];
+  json::cursor jreff(jref["flags"]);
   jreff["value"] = log->flags;
   jreff["remainder_scan_enabled"] = !!(log->flags & SELECTIVE_FLAG_DOSCAN);
   if (log->flags & SELECTIVE_FLAG_DOSCAN) {
@@ -3102,7 +3108,7 @@ static const char * sct_device_state_msg(unsigned char state)
 // Print SCT Status
 static int ataPrintSCTStatus(const ata_sct_status_response * sts)
 {
-  json::ref jref = jglb["ata_sct_status"];
+  json::cursor jref(jglb["ata_sct_status"]);
 
   jout("SCT Status Version:                  %u\n", sts->format_version);
   jref["format_version"] = sts->format_version;
@@ -3189,7 +3195,7 @@ static int ataPrintSCTStatus(const ata_sct_status_response * sts)
 // Print SCT Temperature History Table
 static int ataPrintSCTTempHist(const ata_sct_temperature_history_table * tmh)
 {
-  json::ref jref = jglb["ata_sct_temperature_history"];
+  json::cursor jref(jglb["ata_sct_temperature_history"]);
 
   char buf1[20], buf2[20], buf3[64];
   jout("SCT Temperature History Version:     %u%s\n", tmh->format_version,
@@ -3262,7 +3268,7 @@ static int ataPrintSCTTempHist(const ata_sct_temperature_history_table * tmh)
 static void ataPrintSCTErrorRecoveryControl(bool set, unsigned short read_timer, unsigned short write_timer, bool power_on, bool mfg_default = false)
 {
   const char* power_on_str = (power_on ? "Power-on " : "");
-  json::ref jref = jglb["ata_sct_erc"];
+  json::cursor jref(jglb["ata_sct_erc"]);
   jout("SCT Error Recovery Control%s:%s\n", (set ? " set to" : ""), (mfg_default ? " default values." : ""));
 
   if (!mfg_default) {
@@ -3307,7 +3313,7 @@ static void print_aam_level(const char * msg, int level, int recommended = -1)
   else
     jout("%s%d (%s)\n", msg, level, s);
 
-  json::ref jref = jglb["ata_aam"];
+  json::cursor jref(jglb["ata_aam"]);
   jref["enabled"] = true;
   jref["level"] = level;
   jref["string"] = s;
@@ -3334,7 +3340,7 @@ static void print_apm_level(const char * msg, int level)
 
   jout("%s%d (%s)\n", msg, level, s);
 
-  json::ref jref = jglb["ata_apm"];
+  json::cursor jref(jglb["ata_apm"]);
   jref["enabled"] = true;
   jref["level"] = level;
   jref["string"] = s;
@@ -3393,7 +3399,7 @@ static void print_ata_security_status(const char * msg, unsigned short state, un
 
   jout("%s%s%s%s%s%s\n", msg, s1, s2, s3, s4, s5);
 
-  json::ref jref = jglb["ata_security"];
+  json::cursor jref(jglb["ata_security"]);
   jref["state"] = state;
   jref["string"] = strprintf("%s%s%s%s", s1, s2, s3, s4);
   jref["enabled"] = enabled;
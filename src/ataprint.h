@@ -13,6 +13,8 @@
 #ifndef ATAPRINT_H_
 #define ATAPRINT_H_
 
+#include <smartmon/atacmds.h>
+
 #include <vector>
 
 // Request to dump a GP or SMART log
@@ -108,4 +110,17 @@ struct ata_print_options
 
 int ataPrintMain(smartmon::ata_device * device, const ata_print_options & options);
 
+// Print SMART attribute table ('-A'), also used by src/bench/smartctl-bench.
+// onlyfailed: 0: all, 1: failed prefailure, 2: failed now or in the past.
+// format: ata_print_options::FMT_*.
+void PrintSmartAttribWithThres(const smartmon::ata_smart_values * data,
+                               const smartmon::ata_smart_thresholds_pvt * thresholds,
+                               const smartmon::ata_vendor_attr_defs & defs, int rpm,
+                               int onlyfailed, unsigned char format);
+
+// Print SMART Error Log ('-l error'), also used by src/bench/smartctl-bench.
+// Returns number of errors.
+int PrintSmartErrorlog(const smartmon::ata_smart_errorlog * data,
+                       smartmon::firmwarebug_defs firmwarebugs);
+
 #endif
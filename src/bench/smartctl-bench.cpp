@@ -0,0 +1,331 @@
+/*
+ * smartctl-bench.cpp - microbenchmarks for smartctl output functions
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+// Build and run with 'make bench'.
+// Runs the ATA attribute table and error log printers of ataprint.cpp
+// with fixed log buffers.  The text output must not allocate memory.
+
+#include "config.h"
+
+#include <smartmon/atacmds.h>
+#include <smartmon/dev_interface.h>
+#include <smartmon/knowndrives.h>
+#include <smartmon/sg_unaligned.h>
+#include <smartmon/utility.h>
+#include "ataprint.h"
+#include "smartctl.h"
+#include "bench.h"
+
+using namespace smartmon;
+
+/////////////////////////////////////////////////////////////////////////////
+// Replacements for smartctl.cpp
+
+bool printing_is_switchable = false;
+bool printing_is_off = false;
+bool failuretest_conservative = false;
+
+json jglb;
+
+// Total length of output, printed text is discarded.
+static uint64_t output_bytes;
+
+SMARTMON_DIAGNOSTIC_FORMAT_NONLITERAL_IGNORE
+
+SMARTMON_FORMAT_PRINTF(1, 0)
+static void vbench_out(const char * fmt, va_list ap)
+{
+  if (printing_is_off)
+    return;
+  static char buf[1024];
+  int n = std::vsnprintf(buf, sizeof(buf), fmt, ap);
+  if (n > 0)
+    output_bytes += n;
+}
+
+SMARTMON_DIAGNOSTIC_FORMAT_NONLITERAL_RESTORE
+
+void pout(const char * fmt, ...)
+{
+  va_list ap; va_start(ap, fmt);
+  vbench_out(fmt, ap);
+  va_end(ap);
+}
+
+void jout(const char * fmt, ...)
+{
+  va_list ap; va_start(ap, fmt);
+  vbench_out(fmt, ap);
+  va_end(ap);
+}
+
+void jinf(const char * fmt, ...)
+{
+  va_list ap; va_start(ap, fmt);
+  vbench_out(fmt, ap);
+  va_end(ap);
+}
+
+void jwrn(const char * fmt, ...)
+{
+  va_list ap; va_start(ap, fmt);
+  vbench_out(fmt, ap);
+  va_end(ap);
+}
+
+void jerr(const char * fmt, ...)
+{
+  va_list ap; va_start(ap, fmt);
+  vbench_out(fmt, ap);
+  va_end(ap);
+}
+
+void jout_startup_datetime(const char * prefix)
+{
+  jout("%s(startup date not available)\n", prefix);
+}
+
+void failuretest(failure_type /*type*/, int returnvalue)
+{
+  throw std::runtime_error(strprintf("failuretest(%d) called", returnvalue));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Fixed inputs
+
+// Store ATA IDENTIFY string with byte-swapped words.
+static void set_id_string(uint8_t * dest, const char * src, unsigned size)
+{
+  unsigned len = std::strlen(src);
+  for (unsigned i = 0; i < size; i++)
+    dest[i ^ 1] = (i < len ? src[i] : ' ');
+}
+
+// SMART attribute table of a Seagate HDD:
+// ID, flags, current, worst, threshold, raw
+static const struct {
+  uint8_t id;
+  uint16_t flags;
+  uint8_t current, worst, threshold;
+  uint64_t raw;
+} test_attrs[] = {
+  {   1, 0x000f,  77,  64,   6, 0x00000000031a6c4eULL },
+  {   3, 0x0003,  97,  96,   0, 0 },
+  {   4, 0x0032, 100, 100,  20, 0x000000000000006bULL },
+  {   5, 0x0033, 100, 100,  10, 0 },
+  {   7, 0x000f,  87,  60,  45, 0x0000000c18e5a7c2ULL },
+  {   9, 0x0032,  69,  69,   0, 0x0000000000006b2dULL },
+  {  10, 0x0013, 100, 100,  97, 0 },
+  {  12, 0x0032, 100, 100,  20, 0x000000000000006bULL },
+  { 183, 0x0032, 100, 100,   0, 0 },
+  { 184, 0x0032, 100, 100,  99, 0 },
+  { 187, 0x0032, 100, 100,   0, 0 },
+  { 188, 0x0032, 100, 100,   0, 0x0000000000000000ULL },
+  { 189, 0x003a, 100, 100,   0, 0 },
+  { 190, 0x0022,  62,  50,  40, 0x0000001d26190026ULL },
+  { 191, 0x0032, 100, 100,   0, 0 },
+  { 192, 0x0032, 100, 100,   0, 0x0000000000000046ULL },
+  { 193, 0x0032,  97,  97,   0, 0x0000000000000db2ULL },
+  { 194, 0x0022,  38,  50,   0, 0x0000001200000026ULL },
+  { 197, 0x0012, 100, 100,   0, 0 },
+  { 198, 0x0010, 100, 100,   0, 0 },
+  { 199, 0x003e, 200, 200,   0, 0 },
+  { 240, 0x0000, 100, 253,   0, 0x58f3000069c9ULL },
+  { 241, 0x0000, 100, 253,   0, 0x0000000b6a3cbd1dULL },
+  { 242, 0x0000, 100, 253,   0, 0x0000001c2f1a5e23ULL },
+};
+
+static void get_test_smart_values(ata_smart_values & values,
+                                  ata_smart_thresholds_pvt & thresholds)
+{
+  std::memset(&values, 0, sizeof(values));
+  std::memset(&thresholds, 0, sizeof(thresholds));
+  values.revnumber = thresholds.revnumber = 10;
+  unsigned i = 0;
+  for (const auto & t : test_attrs) {
+    ata_smart_attribute & a = values.vendor_attributes[i];
+    a.id = t.id;
+    sg_put_unaligned_le16(t.flags, &a.flags);
+    a.current = t.current; a.worst = t.worst;
+    for (int j = 0; j < 6; j++)
+      a.raw[j] = (uint8_t)(t.raw >> (8 * j));
+    thresholds.thres_entries[i].id = t.id;
+    thresholds.thres_entries[i].threshold = t.threshold;
+    i++;
+  }
+}
+
+// SMART Error Log with 5 entries of failed READ DMA EXT commands (UNC)
+// preceded by 5 commands each.
+static void get_test_errorlog(ata_smart_errorlog & log)
+{
+  std::memset(&log, 0, sizeof(log));
+  log.revnumber = 1;
+  log.error_log_pointer = 3;
+  log.ata_error_count = 1233;
+  static const uint8_t cmds[5] = { 0x60, 0xef, 0x25, 0xb0, 0x25 };
+  for (int i = 0; i < 5; i++) {
+    ata_smart_errorlog_struct & e = log.errorlog_struct[i];
+    uint32_t lba = 0x0123456 + i * 0x1000;
+    for (int j = 0; j < 5; j++) {
+      ata_smart_errorlog_command_struct & c = e.commands[j];
+      c.commandreg = cmds[j];
+      c.featuresreg = (cmds[j] == 0xb0 ? 0xd5 : 0x00);
+      c.sector_count = 8;
+      c.sector_number = (uint8_t)lba;
+      c.cylinder_low = (uint8_t)(lba >> 8);
+      c.cylinder_high = (uint8_t)(lba >> 16);
+      c.drive_head = 0xe0;
+      c.devicecontrolreg = 0x08;
+      sg_put_unaligned_le32(86400000U * i + 3600000U * j + 12345, &c.timestamp);
+    }
+    ata_smart_errorlog_error_struct & r = e.error_struct;
+    r.error_register = 0x40; r.status = 0x51;
+    r.sector_count = 8;
+    r.sector_number = (uint8_t)lba;
+    r.cylinder_low = (uint8_t)(lba >> 8);
+    r.cylinder_high = (uint8_t)(lba >> 16);
+    r.drive_head = 0xe0;
+    r.state = 0x03;
+    r.timestamp = (uint16_t)(27437 - 24 * i);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+
+static void bench_attrib_table(bench_runner & runner)
+{
+  static ata_smart_values values;
+  static ata_smart_thresholds_pvt thresholds;
+  get_test_smart_values(values, thresholds);
+
+  // Use the Seagate presets from the drive database
+  ata_identify_device id{};
+  set_id_string(id.model, "ST4000DM004-2CV104", sizeof(id.model));
+  set_id_string(id.fw_rev, "0001", sizeof(id.fw_rev));
+  ata_vendor_attr_defs defs; firmwarebug_defs bugs; std::string dbversion;
+  lookup_drive_apply_presets(&id, defs, bugs, dbversion);
+
+  static const struct {
+    const char * name;
+    unsigned char format;
+  } formats[] = {
+    { "PrintSmartAttribWithThres", 0 },
+    { "PrintSmartAttribWithThres/brief", ata_print_options::FMT_BRIEF },
+    { "PrintSmartAttribWithThres/hex",
+      ata_print_options::FMT_HEX_ID | ata_print_options::FMT_HEX_VAL },
+  };
+  for (const auto & f : formats) {
+    unsigned char format = f.format;
+    runner.run_noalloc(f.name, [&defs, format]() {
+      PrintSmartAttribWithThres(&values, &thresholds, defs, 7200, 0, format);
+      bench_sink = output_bytes;
+    });
+  }
+
+  // Same with JSON output for comparison
+  jglb.enable();
+  runner.run("PrintSmartAttribWithThres/json", [&defs]() {
+    PrintSmartAttribWithThres(&values, &thresholds, defs, 7200, 0, 0);
+    bench_sink = output_bytes;
+  });
+  jglb.enable(false);
+}
+
+static void bench_errorlog(bench_runner & runner)
+{
+  static ata_smart_errorlog log;
+  get_test_errorlog(log);
+
+  runner.run_noalloc("PrintSmartErrorlog", []() {
+    bench_sink = PrintSmartErrorlog(&log, firmwarebug_defs());
+  });
+
+  jglb.enable();
+  runner.run("PrintSmartErrorlog/json", []() {
+    bench_sink = PrintSmartErrorlog(&log, firmwarebug_defs());
+  });
+  jglb.enable(false);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Main
+
+static int usage(const char * prog, int status)
+{
+  std::printf("%s\n"
+    "Microbenchmarks for smartctl output functions\n\n"
+    "Usage: %s [-f FILTER] [-j] [-r REPS] [-t MSEC]\n\n"
+    "    -f FILTER  Run only benchmarks with names containing FILTER\n"
+    "    -j         Print results in JSON format\n"
+    "    -r REPS    Number of repetitions [5]\n"
+    "    -t MSEC    Minimum time for all repetitions of a benchmark [250]\n"
+    "    -h         Print this help\n"
+    "    -V         Print version information\n",
+    format_version_info(bench_name).c_str(), prog);
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+  try {
+    bench_name = "smartctl-bench";
+    smart_interface::init();
+
+    bench_options opts;
+    bool print_json = false;
+
+    for (int ai = 1; ai < argc; ai++) {
+      const char * arg = argv[ai];
+      const char * val = (ai + 1 < argc ? argv[ai + 1] : nullptr);
+      if (!std::strcmp(arg, "-f") && val) {
+        opts.filter = val; ai++;
+      }
+      else if (!std::strcmp(arg, "-j")) {
+        print_json = true;
+      }
+      else if (!std::strcmp(arg, "-r") && val && std::atoi(val) > 0) {
+        opts.reps = std::atoi(val); ai++;
+      }
+      else if (!std::strcmp(arg, "-t") && val && std::atoi(val) > 0) {
+        opts.min_time_ms = std::atoi(val); ai++;
+      }
+      else if (!std::strcmp(arg, "-h")) {
+        return usage(argv[0], 0);
+      }
+      else if (!std::strcmp(arg, "-V")) {
+        std::fputs(format_version_info(bench_name, 3).c_str(), stdout);
+        return 0;
+      }
+      else
+        return usage(argv[0], 1);
+    }
+
+    // Use the default database, the builtin one if not installed
+    if (!init_drive_database(true))
+      return 1;
+
+    bench_runner runner(opts);
+    bench_attrib_table(runner);
+    bench_errorlog(runner);
+
+    if (print_json)
+      print_results_json(runner.results(), opts);
+    else
+      print_results(runner.results());
+
+    return get_exit_status(runner.results());
+  }
+  catch (const std::exception & ex) {
+    std::fprintf(stderr, "%s: %s\n", bench_name, ex.what());
+    return 1;
+  }
+}
@@ -0,0 +1,364 @@
+/*
+ * event_loop.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "event_loop.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <utility>
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_SIGNALFD_H) && defined(HAVE_SYS_TIMERFD_H)
+#define USE_EPOLL 1
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#endif
+
+// Signals blocked by any event loop, see unblocked_signals
+static sigset_t s_blocked_sigs;
+static bool s_blocked_any /* = false */;
+
+event_loop::~event_loop()
+{
+  close();
+}
+
+event_loop::unblocked_signals::unblocked_signals()
+{
+  if (!s_blocked_any)
+    return;
+  m_restore = !sigprocmask(SIG_UNBLOCK, &s_blocked_sigs, &m_saved);
+}
+
+event_loop::unblocked_signals::~unblocked_signals()
+{
+  if (m_restore)
+    sigprocmask(SIG_SETMASK, &m_saved, nullptr);
+}
+
+#ifdef USE_EPOLL
+
+bool event_loop::open()
+{
+  if (m_epfd >= 0)
+    return true;
+  m_epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (m_epfd < 0)
+    return false;
+
+  // Timer for wait_until(), notices changes of the system clock
+  m_wakeupfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  epoll_event ev{}; ev.events = EPOLLIN; ev.data.fd = m_wakeupfd;
+  if (m_wakeupfd < 0 || epoll_ctl(m_epfd, EPOLL_CTL_ADD, m_wakeupfd, &ev)) {
+    int err = errno;
+    close();
+    errno = err;
+    return false;
+  }
+  sigemptyset(&m_sigmask);
+  return true;
+}
+
+void event_loop::close()
+{
+  if (m_epfd < 0)
+    return;
+  if (m_sigfd >= 0) {
+    sigprocmask(SIG_UNBLOCK, &m_sigmask, nullptr);
+    ::close(m_sigfd); m_sigfd = -1;
+    m_sig_handlers.clear();
+  }
+  for (const auto & src : m_sources) {
+    if (src.second.type != SRC_FD)
+      ::close(src.first);
+  }
+  m_sources.clear();
+  if (m_wakeupfd >= 0) {
+    ::close(m_wakeupfd); m_wakeupfd = -1;
+  }
+  ::close(m_epfd); m_epfd = -1;
+}
+
+bool event_loop::add_signal(int sig, signal_handler handler)
+{
+  if (m_epfd < 0) {
+    errno = EBADF;
+    return false;
+  }
+  sigset_t mask = m_sigmask;
+  if (sigaddset(&mask, sig))
+    return false;
+  int fd = signalfd(m_sigfd, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (fd < 0)
+    return false;
+  if (m_sigfd < 0) {
+    epoll_event ev{}; ev.events = EPOLLIN; ev.data.fd = fd;
+    if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev)) {
+      int err = errno;
+      ::close(fd);
+      errno = err;
+      return false;
+    }
+    m_sigfd = fd;
+  }
+
+  // Pending signals are now delivered to signalfd
+  sigset_t one;
+  sigemptyset(&one); sigaddset(&one, sig);
+  sigprocmask(SIG_BLOCK, &one, nullptr);
+  if (!s_blocked_any) {
+    sigemptyset(&s_blocked_sigs);
+    s_blocked_any = true;
+  }
+  sigaddset(&s_blocked_sigs, sig);
+
+  m_sigmask = mask;
+  m_sig_handlers[sig] = handler;
+  return true;
+}
+
+bool event_loop::add_source(int fd, source_type type, callback && cb)
+{
+  epoll_event ev{}; ev.events = EPOLLIN; ev.data.fd = fd;
+  if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fd, &ev))
+    return false;
+  source & src = m_sources[fd];
+  src.type = type; src.cb = std::move(cb);
+  return true;
+}
+
+void event_loop::remove_source(int fd)
+{
+  auto it = m_sources.find(fd);
+  if (it == m_sources.end())
+    return;
+  epoll_ctl(m_epfd, EPOLL_CTL_DEL, fd, nullptr);
+  if (it->second.type != SRC_FD)
+    ::close(fd);
+  m_sources.erase(it);
+}
+
+bool event_loop::add_fd(int fd, callback cb)
+{
+  if (m_epfd < 0) {
+    errno = EBADF;
+    return false;
+  }
+  return add_source(fd, SRC_FD, std::move(cb));
+}
+
+bool event_loop::remove_fd(int fd)
+{
+  auto it = m_sources.find(fd);
+  if (!(it != m_sources.end() && it->second.type == SRC_FD)) {
+    errno = ENOENT;
+    return false;
+  }
+  remove_source(fd);
+  return true;
+}
+
+bool event_loop::add_child(pid_t pid, callback cb)
+{
+  if (m_epfd < 0) {
+    errno = EBADF;
+    return false;
+  }
+#ifdef SYS_pidfd_open
+  int fd = (int)syscall(SYS_pidfd_open, pid, 0);
+  if (fd < 0)
+    return false;
+  if (!add_source(fd, SRC_CHILD, std::move(cb))) {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    return false;
+  }
+  return true;
+#else
+  (void)pid; (void)cb;
+  errno = ENOSYS;
+  return false;
+#endif
+}
+
+int event_loop::add_timer(unsigned msecs, callback cb)
+{
+  if (m_epfd < 0) {
+    errno = EBADF;
+    return -1;
+  }
+  int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  itimerspec its{};
+  its.it_value.tv_sec = msecs / 1000;
+  its.it_value.tv_nsec = (msecs % 1000) * 1000000L;
+  if (!msecs)
+    its.it_value.tv_nsec = 1; // zero would disarm
+  if (timerfd_settime(fd, 0, &its, nullptr) || !add_source(fd, SRC_TIMER, std::move(cb))) {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    return -1;
+  }
+  return fd;
+}
+
+bool event_loop::remove_timer(int id)
+{
+  auto it = m_sources.find(id);
+  if (!(it != m_sources.end() && it->second.type == SRC_TIMER)) {
+    errno = ENOENT;
+    return false;
+  }
+  remove_source(id);
+  return true;
+}
+
+void event_loop::handle_signals()
+{
+  signalfd_siginfo si;
+  while (read(m_sigfd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+    auto it = m_sig_handlers.find((int)si.ssi_signo);
+    if (it != m_sig_handlers.end())
+      it->second((int)si.ssi_signo);
+  }
+}
+
+void event_loop::handle(int fd)
+{
+  auto it = m_sources.find(fd);
+  if (it == m_sources.end())
+    return; // removed by previous callback
+  if (it->second.type == SRC_FD) {
+    // Copy, callback may remove itself
+    callback cb = it->second.cb;
+    cb();
+    return;
+  }
+
+  // One-shot sources are removed before the callback is called
+  callback cb = std::move(it->second.cb);
+  remove_source(fd);
+  cb();
+}
+
+int event_loop::run_once(int timeout_msecs)
+{
+  if (m_epfd < 0) {
+    errno = EBADF;
+    return -1;
+  }
+  epoll_event events[16];
+  int n = epoll_wait(m_epfd, events, sizeof(events) / sizeof(events[0]), timeout_msecs);
+  if (n < 0)
+    return (errno == EINTR ? 0 : -1);
+
+  int cnt = 0;
+  for (int i = 0; i < n; i++) {
+    int fd = events[i].data.fd;
+    if (fd == m_wakeupfd) {
+      // Expired or canceled due to clock change
+      uint64_t ticks;
+      if (read(m_wakeupfd, &ticks, sizeof(ticks)) < 0 && errno != ECANCELED)
+        continue;
+    }
+    else if (fd == m_sigfd)
+      handle_signals();
+    else
+      handle(fd);
+    cnt++;
+  }
+  return cnt;
+}
+
+void event_loop::wait_until(time_t wakeuptime)
+{
+  if (wakeuptime <= time(nullptr))
+    return;
+  itimerspec its{};
+  its.it_value.tv_sec = wakeuptime;
+  if (timerfd_settime(m_wakeupfd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &its, nullptr)) {
+    // Should not happen, wait with relative timeout
+    time_t secs = wakeuptime - time(nullptr);
+    run_once((int)(secs < 3600 ? (secs > 0 ? secs : 0) : 3600) * 1000);
+    return;
+  }
+  run_once(-1);
+}
+
+#else // USE_EPOLL
+
+bool event_loop::open()
+{
+  errno = ENOSYS;
+  return false;
+}
+
+void event_loop::close()
+{
+}
+
+bool event_loop::add_signal(int /*sig*/, signal_handler /*handler*/)
+{
+  errno = ENOSYS;
+  return false;
+}
+
+bool event_loop::add_fd(int /*fd*/, callback /*cb*/)
+{
+  errno = ENOSYS;
+  return false;
+}
+
+bool event_loop::remove_fd(int /*fd*/)
+{
+  errno = ENOSYS;
+  return false;
+}
+
+bool event_loop::add_child(pid_t /*pid*/, callback /*cb*/)
+{
+  errno = ENOSYS;
+  return false;
+}
+
+int event_loop::add_timer(unsigned /*msecs*/, callback /*cb*/)
+{
+  errno = ENOSYS;
+  return -1;
+}
+
+bool event_loop::remove_timer(int /*id*/)
+{
+  errno = ENOSYS;
+  return false;
+}
+
+void event_loop::wait_until(time_t wakeuptime)
+{
+  time_t timenow = time(nullptr);
+  if (timenow < wakeuptime)
+    sleep((unsigned)(wakeuptime - timenow));
+}
+
+int event_loop::run_once(int /*timeout_msecs*/)
+{
+  errno = ENOSYS;
+  return -1;
+}
+
+#endif // USE_EPOLL
@@ -0,0 +1,115 @@
+/*
+ * event_loop.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <signal.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <functional>
+#include <map>
+
+// Event loop for smartd based on epoll(7), signalfd(2), timerfd_create(2)
+// and pidfd_open(2).  Signals, file descriptors, child processes and timers
+// are handled by a single blocking epoll_wait() call.
+// If unsupported (non-Linux or old kernel), open() fails and the caller
+// should fall back to sleep(3) and asynchronous signal handlers.
+class event_loop
+{
+public:
+  typedef std::function<void ()> callback;
+  typedef void (*signal_handler)(int);
+
+  event_loop() = default;
+  ~event_loop();
+
+  /// Create the epoll instance.  Return false and set errno on error.
+  bool open();
+
+  /// Close all file descriptors and unblock all signals.
+  void close();
+
+  /// Return true if open() succeeded.
+  bool is_open() const
+    { return (m_epfd >= 0); }
+
+  /// Block signal SIG and call HANDLER(SIG) from wait_until() or
+  /// run_once() if the signal arrives.  The asynchronous signal handler
+  /// should also be set to HANDLER because it is called if the signal
+  /// arrives while unblocked (see 'unblocked_signals' below).
+  bool add_signal(int sig, signal_handler handler);
+
+  /// Call CB if FD becomes readable.  FD is not closed by this class.
+  bool add_fd(int fd, callback cb);
+
+  /// Remove FD added by add_fd().
+  bool remove_fd(int fd);
+
+  /// Call CB once if child process PID has terminated.  The child is not
+  /// reaped, CB should call waitpid().  Requires Linux 5.3.
+  bool add_child(pid_t pid, callback cb);
+
+  /// Call CB once after MSECS milliseconds.  Return timer id or -1 on error.
+  int add_timer(unsigned msecs, callback cb);
+
+  /// Remove pending timer ID.
+  bool remove_timer(int id);
+
+  /// Wait until system clock reaches WAKEUPTIME or until at least one
+  /// other event has been handled.  Return early also if the system
+  /// clock has been set.
+  void wait_until(time_t wakeuptime);
+
+  /// Wait at most TIMEOUT_MSECS (-1: infinite) and handle events.
+  /// Return number of events handled or -1 on error.
+  int run_once(int timeout_msecs);
+
+  /// Unblock signals of all event loops while in scope, for example
+  /// to let child processes inherit the original signal mask.
+  class unblocked_signals
+  {
+  public:
+    unblocked_signals();
+    ~unblocked_signals();
+
+  private:
+    unblocked_signals(const unblocked_signals &) = delete;
+    void operator=(const unblocked_signals &) = delete;
+
+    sigset_t m_saved;
+    bool m_restore = false;
+  };
+
+private:
+  event_loop(const event_loop &) = delete;
+  void operator=(const event_loop &) = delete;
+
+  enum source_type { SRC_FD, SRC_CHILD, SRC_TIMER };
+  struct source {
+    source_type type;
+    callback cb;
+  };
+
+  bool add_source(int fd, source_type type, callback && cb);
+  void remove_source(int fd);
+  void handle_signals();
+  void handle(int fd);
+
+  int m_epfd = -1;
+  int m_sigfd = -1;
+  int m_wakeupfd = -1;
+  sigset_t m_sigmask;
+  std::map<int, signal_handler> m_sig_handlers;
+  std::map<int, source> m_sources;
+};
+
+#endif // EVENT_LOOP_H
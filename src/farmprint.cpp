@@ -345,10 +345,10 @@ void ataPrintFarmLog(const ataFarmLog& farmLog) {
   farm_print_by_head_to_text("Number of Reallocation Candidate Sectors by Head", farmLog.reliability.reallocationCandidates, farmLog.driveInformation.heads);
 
   // Print JSON if --json or -j is specified
-  json::ref jref = jglb["seagate_farm_log"];
+  json::cursor jref(jglb["seagate_farm_log"]);
 
   // Page 0: Log Header
-  json::ref jref0 = jref["page_0_log_header"];
+  json::cursor jref0(jref["page_0_log_header"]);
   jref0["farm_log_version"][0] = farmLog.header.majorRev;
   jref0["farm_log_version"][1] = farmLog.header.minorRev;
   jref0["pages_supported"] = farmLog.header.pagesSupported;
@@ -359,7 +359,7 @@ void ataPrintFarmLog(const ataFarmLog& farmLog) {
   jref0["reason_for_frame_capture"] = farmLog.header.frameCapture;
 
   // Page 1: Drive Information
-  json::ref jref1 = jref["page_1_drive_information"];
+  json::cursor jref1(jref["page_1_drive_information"]);
   if (!dont_print_serial_number) {
     jref1["serial_number"] = serialNumber;
     jref1["world_wide_name"] = worldWideName;
@@ -388,7 +388,7 @@ void ataPrintFarmLog(const ataFarmLog& farmLog) {
   jref1["depopulation_head_mask"] = farmLog.driveInformation.depopulationHeadMask;
 
   // Page 2: Workload Statistics
-  json::ref jref2 = jref["page_2_workload_statistics"];
+  json::cursor jref2(jref["page_2_workload_statistics"]);
   jref2["total_read_commands"] = farmLog.workload.totalReadCommands;
   jref2["total_write_commands"] = farmLog.workload.totalWriteCommands;
   jref2["total_random_reads"] = farmLog.workload.totalRandomReads;
@@ -409,7 +409,7 @@ void ataPrintFarmLog(const ataFarmLog& farmLog) {
   jref2["write_commands_by_radius_75_100"] = farmLog.workload.writeCommandsByRadius4;
 
   // Page 3: Error Statistics
-  json::ref jref3 = jref["page_3_error_statistics"];
+  json::cursor jref3(jref["page_3_error_statistics"]);
   jref3["number_of_unrecoverable_read_errors"] = farmLog.error.totalUnrecoverableReadErrors;
   jref3["number_of_unrecoverable_write_errors"] = farmLog.error.totalUnrecoverableWriteErrors;
   jref3["number_of_reallocated_sectors"] = farmLog.error.totalReallocations;
@@ -435,7 +435,7 @@ void ataPrintFarmLog(const ataFarmLog& farmLog) {
   for (uint8_t i = flash_led_size; i > 0; i--) {
     index = (i - farmLog.error.indexFlashLED + flash_led_size) % flash_led_size;
     snprintf(buffer, sizeof(buffer), "flash_led_event_%i", index);
-    json::ref jref3a = jref3[buffer];
+    json::cursor jref3a(jref3[buffer]);
     jref3a["timestamp_of_event"] = farmLog.error.universalTimestampFlashLED[index];
     jref3a["event_information"] = farmLog.error.flashLEDArray[index];
     jref3a["power_cycle_event"] = farmLog.error.powerCycleFlashLED[index];
@@ -444,13 +444,13 @@ void ataPrintFarmLog(const ataFarmLog& farmLog) {
   // Page 3 by-head parameters
   for (uint8_t hd = 0; hd < (uint8_t)farmLog.driveInformation.heads; hd++) {
     snprintf(buffer, sizeof(buffer), "cum_lifetime_unrecoverable_by_head_%i", hd);
-    json::ref jref3_hd = jref3[buffer];
+    json::cursor jref3_hd(jref3[buffer]);
     jref3_hd["cum_lifetime_unrecoverable_read_repeating"] = farmLog.error.cumulativeUnrecoverableReadRepeating[hd];
     jref3_hd["cum_lifetime_unrecoverable_read_unique"] = farmLog.error.cumulativeUnrecoverableReadUnique[hd];
   }
 
   // Page 4: Environment Statistics
-  json::ref jref4 = jref["page_4_environment_statistics"];
+  json::cursor jref4(jref["page_4_environment_statistics"]);
   jref4["curent_temp"] = farmLog.environment.curentTemp;
   jref4["highest_temp"] = farmLog.environment.highestTemp;
   jref4["lowest_temp"] = farmLog.environment.lowestTemp;
@@ -480,7 +480,7 @@ void ataPrintFarmLog(const ataFarmLog& farmLog) {
   jref4["maximum_5v_power"] = farmLog.environment.powerMax5v;
 
   // Page 5: Reliability Statistics
-  json::ref jref5 = jref["page_5_reliability_statistics"];
+  json::cursor jref5(jref["page_5_reliability_statistics"]);
   jref5["attr_error_rate_raw"] = farmLog.reliability.attrErrorRateRaw;
   jref5["error_rate_normalized"] = farmLog.reliability.attrErrorRateNormal;
   jref5["error_rate_worst"] = farmLog.reliability.attrErrorRateWorst;
@@ -715,10 +715,10 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   }
 
   // Print JSON if --json or -j is specified
-  json::ref jref = jglb["seagate_farm_log"];
+  json::cursor jref(jglb["seagate_farm_log"]);
 
   // Parameter 0: Log Header
-  json::ref jref0 = jref["log_header"];
+  json::cursor jref0(jref["log_header"]);
   jref0["farm_log_version"] = farmLog.header.minorRev;
   jref0["pages_supported"] = farmLog.header.parametersSupported;
   jref0["log_size"] = farmLog.header.logSize;
@@ -726,7 +726,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   jref0["reason_for_frame_capture"] = farmLog.header.frameCapture;
 
   // Parameter 1: Drive Information
-  json::ref jref1 = jref["drive_information"];
+  json::cursor jref1(jref["drive_information"]);
   if (!dont_print_serial_number) {
     jref1["serial_number"] = serialNumber;
     jref1["world_wide_name"] = worldWideName;
@@ -746,7 +746,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   jref1["date_of_assembled"] = dateOfAssembly;
 
   // Parameter 2: Workload Statistics
-  json::ref jref2 = jref["workload_statistics"];
+  json::cursor jref2(jref["workload_statistics"]);
   jref2["total_number_of_read_commands"] = farmLog.workload.totalReadCommands;
   jref2["total_number_of_write_commands"] = farmLog.workload.totalWriteCommands;
   jref2["total_number_of_random_read_cmds"] = farmLog.workload.totalRandomReads;
@@ -764,7 +764,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   jref2["number_of_write_commands_from_50_to_100_percent_of_lba_space"] = farmLog.workload.writeCommandsByRadius4;
 
   // Parameter 3: Error Statistics
-  json::ref jref3 = jref["error_statistics"];
+  json::cursor jref3(jref["error_statistics"]);
   jref3["unrecoverable_read_errors"] = farmLog.error.totalUnrecoverableReadErrors;
   jref3["unrecoverable_write_errors"] = farmLog.error.totalUnrecoverableWriteErrors;
   jref3["number_of_mechanical_start_failures"] = farmLog.error.totalMechanicalStartRetries;
@@ -779,7 +779,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   jref3["phy_reset_problem_port_b"] = farmLog.error.phyResetProblemB;
 
   // Parameter 4: Environment Statistics
-  json::ref jref4 = jref["environment_statistics"];
+  json::cursor jref4(jref["environment_statistics"]);
   jref4["current_temperature_(celsius)"] = farmLog.environment.curentTemp;
   jref4["highest_temperature"] = farmLog.environment.highestTemp;
   jref4["lowest_temperature"] = farmLog.environment.lowestTemp;
@@ -795,13 +795,13 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   jref4["5v_power_maximum"] = farmLog.environment.powerMax5v;
 
   // Parameter 5: Reliability Statistics
-  json::ref jref5 = jref["reliability_statistics"];
+  json::cursor jref5(jref["reliability_statistics"]);
 //jref5["number_of_raw_operations"] = farmLog.reliability.xxxxxx;
 //jref5["cumulative_lifetime_ecc_due_to_erc"] = farmLog.reliability.xxxxxx;
   jref5["helium_pressure_threshold_tripped"] = farmLog.reliability.heliumPresureTrip;
 
   // Parameter 6: Drive Information Continued
-  json::ref jref6 = jref["drive_information_continued"];
+  json::cursor jref6(jref["drive_information_continued"]);
   jref6["depopulation_head_mask"] = farmLog.driveInformation2.depopulationHeadMask;
   jref6["product_id"] = productID;
   jref6["drive_recording_type"] = recordingType;
@@ -812,7 +812,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   jref6["last_servo_spin_up_time_(sec)"] = farmLog.driveInformation2.lastServoSpinUpTime;
 
   // Parameter 7: Environment Information Continued
-  json::ref jref7 = jref["environment_information_continued"];
+  json::cursor jref7(jref["environment_information_continued"]);
   jref7["current_12_volts"] = farmLog.environment2.current12v;
   jref7["minimum_12_volts"] = farmLog.environment2.min12v;
   jref7["maximum_12_volts"] = farmLog.environment2.max12v;
@@ -822,7 +822,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
 
   // "By Head" Parameters
   char buffer[128]; // Generic character buffer
-  json::ref jrefh = jref["head_information"];
+  json::cursor jrefh(jref["head_information"]);
   farm_print_by_head_to_json(jrefh, buffer, "mr_head_resistance", (int64_t*)farmLog.mrHeadResistance.headValue, farmLog.driveInformation.heads);
   farm_print_by_head_to_json(jrefh, buffer, "number_of_reallocated_sectors", (int64_t*)farmLog.totalReallocations.headValue, farmLog.driveInformation.heads);
   farm_print_by_head_to_json(jrefh, buffer, "number_of_reallocation_candidate_sectors", (int64_t*)farmLog.totalReallocationCanidates.headValue, farmLog.driveInformation.heads);
@@ -834,7 +834,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   // "By Actuator" Parameters
   for (unsigned i = 0; i < sizeof(actrefs) / sizeof(actrefs[0]); i++) {
     snprintf(buffer, sizeof(buffer), "actuator_information_%" PRIx64, actrefs[i].actuatorID);
-    json::ref jrefa = jref[buffer];
+    json::cursor jrefa(jref[buffer]);
     jrefa["head_load_events"] = actrefs[i].headLoadEvents;
     jrefa["timestamp_of_last_idd_test"] = actrefs[i].timelastIDDTest;
     jrefa["sub-command_of_last_idd_test"] = actrefs[i].subcommandlastIDDTest;
@@ -855,7 +855,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   // "By Actuator" Flash LED Information
   for (unsigned i = 0; i < sizeof(fledrefs) / sizeof(fledrefs[0]); i++) {
     snprintf(buffer, sizeof(buffer), "actuator_flash_led_information_%" PRIx64, fledrefs[i].actuatorID);
-    json::ref jrefa = jref[buffer];
+    json::cursor jrefa(jref[buffer]);
     jrefa["total_flash_led_events"] = fledrefs[i].totalFlashLED;
     jrefa["index_of_last_flash_led"] = fledrefs[i].indexFlashLED;
 
@@ -872,7 +872,7 @@ void scsiPrintFarmLog(const scsiFarmLog& farmLog) {
   // "By Actuator" Reallocation Information
   for (unsigned i = 0; i < sizeof(ararefs) / sizeof(ararefs[0]); i++) {
     snprintf(buffer, sizeof(buffer), "actuator_reallocation_information_%" PRIx64, ararefs[i].actuatorID);
-    json::ref jrefa = jref[buffer];
+    json::cursor jrefa(jref[buffer]);
     jrefa["number_of_reallocated_sectors"] = ararefs[i].totalReallocations;
     jrefa["number_of_reallocated_candidate_sectors"] = ararefs[i].totalReallocationCanidates;
   }
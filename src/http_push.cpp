@@ -0,0 +1,581 @@
+/*
+ * http_push.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "http_push.h"
+
+#include <smartmon/utility.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace smartmon;
+
+#ifndef MSG_NOSIGNAL // e.g. macOS, see SO_NOSIGPIPE below
+#define MSG_NOSIGNAL 0
+#endif
+
+const char * parse_http_push_arg(const char * arg, http_push_options & options)
+{
+  const char * comma = strchr(arg, ',');
+  options.url.assign(arg, (comma ? comma - arg : strlen(arg)));
+  if (strncmp(options.url.c_str(), "http://", 7)) {
+    if (!strncmp(options.url.c_str(), "https://", 8))
+      return "HTTPS is not supported, use a local TLS proxy";
+    return "URL must start with 'http://'";
+  }
+
+  for (arg = comma; arg && *arg; ) {
+    if (!strncmp(arg, ",spool=", 7)) {
+      // DIR may contain commas, must be last
+      options.spool_dir = arg + 7;
+      if (options.spool_dir.empty())
+        return "Missing spool directory";
+      break;
+    }
+    if (!strcmp(arg, ",gzip") || !strncmp(arg, ",gzip,", 6)) {
+#ifdef HAVE_LIBZ
+      options.gzip = true;
+      arg += 5;
+      continue;
+#else
+      return "gzip compression is not supported by this build";
+#endif
+    }
+    char name[8+1] = ""; unsigned v = 0; int n = -1;
+    if (!(sscanf(arg, ",%8[a-z]=%u%n", name, &v, &n) == 2 && n > 0))
+      return "Syntax error in options";
+    if (!strcmp(name, "queue") && 1 <= v && v <= 100000)
+      options.max_queue = v;
+    else if (!strcmp(name, "retry") && 1 <= v && v <= 86400)
+      options.retry_sec = v;
+    else if (!strcmp(name, "maxretry") && 1 <= v && v <= 86400)
+      options.max_retry_sec = v;
+    else if (!strcmp(name, "timeout") && 1 <= v && v <= 300)
+      options.timeout_sec = v;
+    else
+      return "Unknown option or value out of range";
+    arg += n;
+  }
+  if (options.max_retry_sec < options.retry_sec)
+    options.max_retry_sec = options.retry_sec;
+  return nullptr;
+}
+
+#ifdef HAVE_LIBZ
+
+// Compress DATA into gzip format.
+static bool gzip_compress(const std::string & data, std::string & out)
+{
+  z_stream zs{};
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16 /* gzip */,
+                   8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+  out.resize(deflateBound(&zs, data.size()));
+  zs.next_in = (Bytef *)data.data();
+  zs.avail_in = data.size();
+  zs.next_out = (Bytef *)&out[0];
+  zs.avail_out = out.size();
+  int rc = deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return (rc == Z_STREAM_END);
+}
+
+#endif // HAVE_LIBZ
+
+static bool read_file(const char * path, std::string & data)
+{
+  stdio_file f(path, "rb");
+  if (!f)
+    return false;
+  data.clear();
+  char buf[8192];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.append(buf, n);
+  return !ferror(f);
+}
+
+// Write file atomically.
+static bool write_file(const char * path, const std::string & data)
+{
+  std::string tmppath = path; tmppath += '~';
+  stdio_file f(tmppath.c_str(), "wb");
+  if (!f)
+    return false;
+  if (!(fwrite(data.data(), 1, data.size(), f) == data.size() && f.close())) {
+    unlink(tmppath.c_str());
+    return false;
+  }
+  if (rename(tmppath.c_str(), path)) {
+    unlink(tmppath.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Spool file names sort in the order of creation
+static const char spool_prefix[] = "smartd-push-";
+static const char spool_suffix[] = ".ndjson";
+
+static bool is_spool_file(const char * name, bool & gzip)
+{
+  size_t len = strlen(name), pl = sizeof(spool_prefix) - 1, sl = sizeof(spool_suffix) - 1;
+  if (!(len > pl && !strncmp(name, spool_prefix, pl)))
+    return false;
+  if (len > pl + sl + 3 && !strcmp(name + len - 3, ".gz")) {
+    gzip = true;
+    len -= 3;
+  }
+  else
+    gzip = false;
+  return (len > pl + sl && !strncmp(name + len - sl, spool_suffix, sl));
+}
+
+bool http_pusher::open(const http_push_options & options, log_func logfn, std::string & errmsg)
+{
+  m_options = options;
+  m_log = logfn;
+
+  // Split URL: http://HOST[:PORT][/PATH], HOST may be [IPv6]
+  const char * p = options.url.c_str() + 7;
+  size_t hl;
+  if (*p == '[') {
+    const char * e = strchr(p, ']');
+    if (!e) {
+      errmsg = "Missing ']' in URL";
+      return false;
+    }
+    m_host.assign(p + 1, e - p - 1);
+    hl = e - p + 1;
+  }
+  else {
+    hl = strcspn(p, ":/");
+    m_host.assign(p, hl);
+  }
+  if (m_host.empty()) {
+    errmsg = "Missing host name in URL";
+    return false;
+  }
+  p += hl;
+  m_port = "80";
+  if (*p == ':') {
+    size_t pl = strspn(++p, "0123456789");
+    if (!pl || !(p[pl] == '/' || !p[pl])) {
+      m_host.clear();
+      errmsg = "Invalid port in URL";
+      return false;
+    }
+    m_port.assign(p, pl);
+    p += pl;
+  }
+  m_path = (*p ? p : "/");
+
+  char hostname[256] = "";
+  if (gethostname(hostname, sizeof(hostname) - 1))
+    strcpy(hostname, "unknown");
+  m_hostname = hostname;
+
+  // Load batches left from previous run
+  if (!options.spool_dir.empty()) {
+    DIR * dir = opendir(options.spool_dir.c_str());
+    if (!dir) {
+      m_host.clear();
+      errmsg = strprintf("%s: %s", options.spool_dir.c_str(), strerror(errno));
+      return false;
+    }
+    std::vector<std::string> names;
+    while (const dirent * de = readdir(dir)) {
+      bool gz;
+      if (is_spool_file(de->d_name, gz))
+        names.push_back(de->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (const auto & name : names) {
+      batch b;
+      b.path = options.spool_dir + '/' + name;
+      is_spool_file(name.c_str(), b.gzip);
+      m_queue.push_back(b);
+    }
+    while (m_queue.size() > options.max_queue)
+      drop_oldest();
+    if (!m_queue.empty()) {
+      log(LOG_INFO, "%u batch(es) found in spool directory %s",
+          (unsigned)m_queue.size(), options.spool_dir.c_str());
+      m_next_try = time(nullptr);
+    }
+  }
+
+  // Randomize retries of many hosts
+  m_rng.seed((unsigned)time(nullptr) ^ (unsigned)getpid());
+
+  // Host name is resolved by first post(), not here: smartd may fork()
+  // after open() and the lookup may leave a thread in the resolver
+  m_addr.set(m_host.c_str(), m_port.c_str());
+  return true;
+}
+
+void http_pusher::log(int priority, const char * fmt, ...)
+{
+  if (!m_log)
+    return;
+  va_list ap;
+  va_start(ap, fmt);
+  std::string msg = vstrprintf(fmt, ap);
+  va_end(ap);
+  m_log(priority, msg);
+}
+
+void http_pusher::drop_oldest()
+{
+  const batch & b = m_queue.front();
+  if (!b.path.empty())
+    unlink(b.path.c_str());
+  m_queue.pop_front();
+  log(LOG_INFO, "Push queue full, oldest batch dropped");
+}
+
+void http_pusher::push(std::string && body, time_t now, bool send)
+{
+  batch b;
+#ifdef HAVE_LIBZ
+  if (m_options.gzip) {
+    if (gzip_compress(body, b.body))
+      b.gzip = true;
+    else
+      b.body = std::move(body);
+  }
+  else
+#endif
+    b.body = std::move(body);
+  m_queue.push_back(std::move(b));
+  while (m_queue.size() > m_options.max_queue)
+    drop_oldest();
+
+  if (!send) {
+    // Send on next retry()
+    if (!m_next_try)
+      m_next_try = now;
+  }
+  else if (!m_next_try || m_next_try <= now)
+    flush(now);
+  spool();
+}
+
+void http_pusher::retry(time_t now)
+{
+  if (!m_queue.empty() && m_next_try <= now)
+    flush(now);
+}
+
+// Send queued batches in order, stop at first failure.
+void http_pusher::flush(time_t now)
+{
+  while (!m_queue.empty()) {
+    batch & b = m_queue.front();
+    std::string data;
+    if (!b.path.empty() && !read_file(b.path.c_str(), data)) {
+      log(LOG_INFO, "%s: %s, batch dropped", b.path.c_str(), strerror(errno));
+      unlink(b.path.c_str());
+      m_queue.pop_front();
+      continue;
+    }
+
+    int status = 0; std::string errmsg;
+    bool ok = post((b.path.empty() ? b.body : data), b.gzip, status, errmsg);
+    if (ok && 200 <= status && status <= 299) {
+      if (m_failures)
+        log(LOG_INFO, "Push to %s worked again after %u failure(s)",
+            m_options.url.c_str(), m_failures);
+      m_failures = 0; m_delay = 0; m_next_try = 0;
+      if (!b.path.empty())
+        unlink(b.path.c_str());
+      m_queue.pop_front();
+      continue;
+    }
+    if (ok && 400 <= status && status <= 499 && status != 408 && status != 429) {
+      // Request is not acceptable, retry would fail again
+      log(LOG_CRIT, "Push to %s rejected with HTTP status %d, batch dropped",
+          m_options.url.c_str(), status);
+      if (!b.path.empty())
+        unlink(b.path.c_str());
+      m_queue.pop_front();
+      continue;
+    }
+    if (ok)
+      errmsg = strprintf("HTTP status %d", status);
+
+    // Exponential backoff with random jitter of up to 50%
+    m_delay = (!m_delay ? m_options.retry_sec
+               : std::min(2 * m_delay, m_options.max_retry_sec));
+    unsigned delay = m_delay - (unsigned)(m_rng() % (m_delay / 2 + 1));
+    m_next_try = now + delay;
+    if (!m_failures++)
+      log(LOG_CRIT, "Push to %s failed: %s", m_options.url.c_str(), errmsg.c_str());
+    log(LOG_INFO, "Push to %s: %u batch(es) queued, next try in %u seconds",
+        m_options.url.c_str(), (unsigned)m_queue.size(), delay);
+    return;
+  }
+}
+
+// Save batches not yet spooled.
+void http_pusher::spool()
+{
+  if (m_options.spool_dir.empty())
+    return;
+  for (auto & b : m_queue) {
+    if (!b.path.empty())
+      continue;
+    std::string path = strprintf("%s/%s%010lld-%06u%s%s", m_options.spool_dir.c_str(),
+      spool_prefix, (long long)time(nullptr), m_spool_seq++ % 1000000, spool_suffix,
+      (b.gzip ? ".gz" : ""));
+    if (!write_file(path.c_str(), b.body)) {
+      log(LOG_INFO, "%s: %s", path.c_str(), strerror(errno));
+      continue;
+    }
+    b.path = path;
+    b.body.clear(); b.body.shrink_to_fit();
+  }
+}
+
+bool send_all(int fd, const char * data, size_t size)
+{
+  while (size > 0) {
+    ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += n; size -= n;
+  }
+  return true;
+}
+
+// Connect with timeout.
+static int connect_to(const sockaddr * addr, socklen_t addrlen, int family,
+                      int socktype, int protocol, unsigned timeout_sec)
+{
+  int fd = socket(family, socktype, protocol);
+  if (fd < 0)
+    return -1;
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  int flags = fcntl(fd, F_GETFL);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  if (::connect(fd, addr, addrlen)) {
+    if (errno != EINPROGRESS) {
+      int err = errno; close(fd); errno = err;
+      return -1;
+    }
+    pollfd pfd{}; pfd.fd = fd; pfd.events = POLLOUT;
+    int rc = poll(&pfd, 1, timeout_sec * 1000);
+    int err = 0; socklen_t len = sizeof(err);
+    if (rc <= 0)
+      err = (rc ? errno : ETIMEDOUT);
+    else if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len))
+      err = errno;
+    if (err) {
+      close(fd); errno = err;
+      return -1;
+    }
+  }
+  fcntl(fd, F_SETFL, flags);
+
+  timeval tv{}; tv.tv_sec = timeout_sec;
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+  return fd;
+}
+
+void socket_address::set(const char * host, const char * port)
+{
+  m_host = host;
+  m_unix = !port;
+  m_port = (port ? port : "");
+  m_addrs.clear();
+}
+
+// Result of getaddrinfo(), shared with the lookup thread.  The thread
+// is detached on timeout and the last owner frees the result.
+struct addrinfo_result
+{
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done = false;
+  int rc = 0;
+  addrinfo * res = nullptr;
+
+  ~addrinfo_result()
+    { if (res) freeaddrinfo(res); }
+};
+
+bool socket_address::resolve(unsigned timeout_sec, std::string & errmsg)
+{
+  if (!m_addrs.empty())
+    return true;
+
+  if (m_unix) {
+    sockaddr_un sa{};
+    if (m_host.size() >= sizeof(sa.sun_path)) {
+      errmsg = strprintf("%s: %s", m_host.c_str(), strerror(ENAMETOOLONG));
+      return false;
+    }
+    sa.sun_family = AF_UNIX;
+    strcpy(sa.sun_path, m_host.c_str());
+    entry e{};
+    memcpy(&e.addr, &sa, sizeof(sa)); e.addrlen = sizeof(sa);
+    e.family = AF_UNIX; e.socktype = SOCK_STREAM;
+    m_addrs.push_back(e);
+    return true;
+  }
+
+  // getaddrinfo() has no timeout, run it in a separate thread
+  auto result = std::make_shared<addrinfo_result>();
+  try {
+    std::thread([result](std::string host, std::string port) {
+      addrinfo hints{}; hints.ai_family = AF_UNSPEC; hints.ai_socktype = SOCK_STREAM;
+      addrinfo * res = nullptr;
+      int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+      std::lock_guard<std::mutex> lock(result->mutex);
+      result->rc = rc; result->res = res;
+      result->done = true;
+      result->cond.notify_one();
+    }, m_host, m_port).detach();
+  }
+  catch (const std::system_error & ex) {
+    errmsg = strprintf("%s: %s", m_host.c_str(), ex.what());
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(result->mutex);
+  if (!result->cond.wait_for(lock, std::chrono::seconds(timeout_sec),
+                             [&result]() { return result->done; })) {
+    errmsg = strprintf("%s: Name lookup timed out", m_host.c_str());
+    return false;
+  }
+  if (result->rc) {
+    errmsg = strprintf("%s: %s", m_host.c_str(), gai_strerror(result->rc));
+    return false;
+  }
+  for (const addrinfo * ai = result->res; ai; ai = ai->ai_next) {
+    if (ai->ai_addrlen > sizeof(sockaddr_storage))
+      continue;
+    entry e{};
+    memcpy(&e.addr, ai->ai_addr, ai->ai_addrlen); e.addrlen = ai->ai_addrlen;
+    e.family = ai->ai_family; e.socktype = ai->ai_socktype; e.protocol = ai->ai_protocol;
+    m_addrs.push_back(e);
+  }
+  if (m_addrs.empty()) {
+    errmsg = strprintf("%s: No usable address", m_host.c_str());
+    return false;
+  }
+  return true;
+}
+
+int socket_address::connect(unsigned timeout_sec, std::string & errmsg)
+{
+  if (!resolve(timeout_sec, errmsg))
+    return -1;
+  int fd = -1, err = 0;
+  for (const entry & e : m_addrs) {
+    fd = connect_to((const sockaddr *)&e.addr, e.addrlen, e.family,
+                    e.socktype, e.protocol, timeout_sec);
+    if (fd >= 0)
+      return fd;
+    err = errno;
+  }
+  // Address may have changed, resolve again on next attempt
+  if (!m_unix)
+    invalidate();
+  errmsg = strprintf("connect(): %s", strerror(err));
+  return -1;
+}
+
+bool http_pusher::post(const std::string & body, bool gzip, int & status, std::string & errmsg)
+{
+  int fd = m_addr.connect(m_options.timeout_sec, errmsg);
+  if (fd < 0)
+    return false;
+  int err = 0;
+
+  bool v6 = !!strchr(m_host.c_str(), ':');
+  std::string hdr = strprintf(
+    "POST %s HTTP/1.1\r\n"
+    "Host: %s%s%s%s%s\r\n"
+    "User-Agent: smartd/" PACKAGE_VERSION "\r\n"
+    "Content-Type: application/x-ndjson\r\n"
+    "%s"
+    "Content-Length: %u\r\n"
+    "X-Smartd-Host: %s\r\n"
+    "Connection: close\r\n"
+    "\r\n",
+    m_path.c_str(), (v6 ? "[" : ""), m_host.c_str(), (v6 ? "]" : ""),
+    (m_port != "80" ? ":" : ""), (m_port != "80" ? m_port.c_str() : ""),
+    (gzip ? "Content-Encoding: gzip\r\n" : ""), (unsigned)body.size(),
+    m_hostname.c_str());
+
+  if (!(send_all(fd, hdr.data(), hdr.size()) && send_all(fd, body.data(), body.size()))) {
+    errmsg = strprintf("send(): %s", strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  // Only the status line is evaluated
+  char buf[256]; size_t len = 0;
+  while (len < sizeof(buf) - 1 && !memchr(buf, '\n', len)) {
+    ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      if (n < 0)
+        err = errno;
+      break;
+    }
+    len += n;
+  }
+  close(fd);
+  buf[len] = 0;
+  if (!(sscanf(buf, "HTTP/1.%*d %d", &status) == 1 && 100 <= status && status <= 599)) {
+    errmsg = (err ? strprintf("recv(): %s", strerror(err)) : "Invalid HTTP response");
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,139 @@
+/*
+ * http_push.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef HTTP_PUSH_H
+#define HTTP_PUSH_H
+
+#include <smartmon/smartmon_defs.h>
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include <deque>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Socket helpers, also used by smtp_client.cpp.
+
+// Address of a TCP or Unix domain socket.  The host name is resolved
+// on first use and cached.  It is resolved again after a failed connect.
+class socket_address
+{
+public:
+  /// Set HOST and PORT, or Unix domain socket HOST if PORT is nullptr.
+  void set(const char * host, const char * port);
+
+  /// Resolve host name unless cached.  Name lookup does not wait longer
+  /// than the timeout.  Return false and set ERRMSG on error.
+  bool resolve(unsigned timeout_sec, std::string & errmsg);
+
+  /// Connect to the first reachable address.  Return socket with send and
+  /// receive timeouts set, or -1 and set ERRMSG on error.
+  int connect(unsigned timeout_sec, std::string & errmsg);
+
+  /// Discard cached addresses.
+  void invalidate()
+    { m_addrs.clear(); }
+
+private:
+  std::string m_host, m_port;
+  bool m_unix = false;
+
+  struct entry {
+    sockaddr_storage addr;
+    socklen_t addrlen;
+    int family, socktype, protocol;
+  };
+  std::vector<entry> m_addrs;
+};
+
+/// Send all DATA, return false and set errno on error.
+bool send_all(int fd, const char * data, size_t size);
+
+// Options of smartd '--push'
+struct http_push_options
+{
+  std::string url;                        // http://HOST[:PORT][/PATH]
+  std::string spool_dir;                  // Directory for batches not yet sent, empty if none
+  unsigned max_queue = 100;               // Number of queued batches, oldest are dropped
+  unsigned retry_sec = 60;                // First retry delay, doubled after each failure
+  unsigned max_retry_sec = 3600;          // Limit of retry delay
+  unsigned timeout_sec = 10;              // Timeout of connect, send and receive
+  bool gzip = false;                      // Compress batches
+};
+
+// Parse argument of '--push=URL[,OPTION=VALUE,...]'.
+// Return nullptr on success, error message otherwise.
+const char * parse_http_push_arg(const char * arg, http_push_options & options);
+
+// Sends batches of device snapshots to a collector via HTTP POST.
+// Batches which could not be sent are queued in memory or spooled to disk
+// and are retried with exponential backoff.  Requests are sent synchronously
+// and are limited by the timeout.  HTTPS is not supported.
+class http_pusher
+{
+public:
+  // Log callback, PRIORITY is LOG_INFO or LOG_CRIT.
+  typedef std::function<void (int priority, const std::string & msg)> log_func;
+
+  /// Parse URL and load batches from spool directory.
+  /// Return false and set ERRMSG on error.
+  bool open(const http_push_options & options, log_func logfn, std::string & errmsg);
+
+  /// Return true if open() succeeded.
+  bool is_open() const
+    { return !m_host.empty(); }
+
+  /// Queue BODY (NDJSON) and send all queued batches unless a retry
+  /// is pending.  If SEND is false, only queue and let next retry() send.
+  void push(std::string && body, time_t now, bool send = true);
+
+  /// Send queued batches if the retry time is reached.
+  void retry(time_t now);
+
+  /// Time of next retry, 0 if nothing is queued.
+  time_t get_retry_time() const
+    { return (!m_queue.empty() ? m_next_try : 0); }
+
+  /// Number of batches not yet sent.
+  unsigned get_queue_size() const
+    { return m_queue.size(); }
+
+private:
+  http_push_options m_options;
+  log_func m_log;
+  std::string m_host, m_port, m_path, m_hostname;
+  socket_address m_addr;
+
+  struct batch {
+    std::string body;                     // Batch data, empty if spooled
+    std::string path;                     // Spool file, empty if none
+    bool gzip = false;
+  };
+  std::deque<batch> m_queue;
+  unsigned m_spool_seq = 0;
+
+  time_t m_next_try = 0;                  // Time of next retry, 0 = none
+  unsigned m_delay = 0;                   // Current retry delay
+  unsigned m_failures = 0;                // Number of failures in a row
+  std::minstd_rand m_rng;                 // Retry jitter
+
+  void flush(time_t now);
+  void spool();
+  void drop_oldest();
+  bool post(const std::string & body, bool gzip, int & status, std::string & errmsg);
+  void log(int priority, const char * fmt, ...)
+    SMARTMON_FORMAT_PRINTF(3, 4);
+};
+
+#endif // HTTP_PUSH_H
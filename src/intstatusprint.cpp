@@ -0,0 +1,199 @@
+/*
+ * intstatusprint.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "intstatusprint.h"
+
+#include <smartmon/ataintstatus.h>
+#include <smartmon/atacmds.h>
+#include <smartmon/utility.h>
+#include "smartctl.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+using namespace smartmon;
+
+// Interval of progress output
+const unsigned progress_interval_sec = 10;
+
+bool parse_int_status_arg(const char * arg, int_status_print_options & options)
+{
+  if (!strncmp(arg, "current", 7)) {
+    options.saved = false;
+    arg += 7;
+  }
+  else if (!strncmp(arg, "saved", 5)) {
+    options.saved = true;
+    arg += 5;
+  }
+  else
+    return false;
+
+  options.file.clear();
+  while (*arg) {
+    if (!strncmp(arg, ",file=", 6)) {
+      // FILE may contain commas, must be last
+      options.file = arg + 6;
+      break;
+    }
+    if (!strcmp(arg, ",initiate") || !strncmp(arg, ",initiate,", 10)) {
+      options.initiate = true;
+      arg += 9;
+      continue;
+    }
+    char name[8+1] = ""; unsigned v = 0; int n = -1;
+    if (!(sscanf(arg, ",%8[a-z]=%u%n", name, &v, &n) == 2 && n > 0))
+      return false;
+    if (!strcmp(name, "area") && 1 <= v && v <= 3)
+      options.area = v;
+    else if (!strcmp(name, "chunk") && 1 <= v && v <= 8192)
+      options.chunk = v;
+    else
+      return false;
+    arg += n;
+  }
+  if (options.file.empty() || (options.saved && options.initiate))
+    return false;
+  options.enabled = true;
+  return true;
+}
+
+int intStatusPrintMain(ata_device * device, const int_status_print_options & options)
+{
+  unsigned char logaddr = (options.saved ? ata_log_saved_int_status
+                                         : ata_log_current_int_status);
+  const char * logname = (options.saved ? "Saved" : "Current");
+
+  // Check GP Log Directory for log size
+  ata_smart_log_directory logdir;
+  if (ataReadLogDirectory(device, &logdir, true)) {
+    jerr("%s: Read GP Log Directory failed\n", device->get_info_name());
+    return FAILSMART;
+  }
+  unsigned num_pages = logdir.entry[logaddr-1].numsectors
+                     | (logdir.entry[logaddr-1].reserved << 8);
+  if (!num_pages) {
+    jerr("%s: %s Device Internal Status log (GP Log 0x%02x) not supported\n",
+         device->get_info_name(), logname, logaddr);
+    return FAILSMART;
+  }
+
+  ata_int_status_reader reader(device, options.chunk);
+  ata_int_status_header header;
+  unsigned char page0[512];
+  if (!reader.read_header(options.saved, options.initiate, header, page0)) {
+    jerr("%s: Read %s Device Internal Status log failed: %s\n", device->get_info_name(),
+         logname, device->get_errmsg());
+    return FAILSMART;
+  }
+
+  unsigned last_page = header.area_last_page[options.area - 1];
+  bool truncated = false;
+  if (last_page >= num_pages) {
+    // Do not read beyond the size from the directory
+    last_page = num_pages - 1;
+    truncated = true;
+  }
+
+  json::cursor jref(jglb["ata_internal_status"]);
+  jref["log_address"] = logaddr;
+  jref["saved"] = options.saved;
+  jref["initiated"] = options.initiate;
+  jref["organization_id"] = header.organization_id;
+  for (int i = 0; i < 3; i++)
+    jref["data_area_last_page"][i] = header.area_last_page[i];
+  if (!options.saved) {
+    jref["saved_data_available"] = header.saved_data_available;
+    jref["saved_data_generation"] = header.saved_data_generation;
+  }
+  jref["file"] = options.file;
+
+  jout("%s Device Internal Status log (GP Log 0x%02x)%s\n", logname, logaddr,
+       (options.initiate ? ", new capture initiated" : ""));
+  jout("Organization ID:     0x%06x\n", header.organization_id);
+  for (int i = 0; i < 3; i++)
+    jout("Data Area %d:         last page %u\n", i + 1, header.area_last_page[i]);
+  if (!options.saved)
+    jout("Saved Data:          %savailable, generation %u\n",
+         (header.saved_data_available ? "" : "not "), header.saved_data_generation);
+  if (truncated)
+    pout("Warning: Data Area %u exceeds log size of %u pages, truncated\n",
+         options.area, num_pages);
+
+  // Data is written while reading, at most one chunk is held in memory
+  stdio_file f(options.file.c_str(), "wb");
+  if (!f) {
+    jerr("%s: %s\n", options.file.c_str(), strerror(errno));
+    return FAILCMD;
+  }
+  bool write_failed = false; int err = 0;
+  if (fwrite(page0, 1, sizeof(page0), f) != sizeof(page0)) {
+    write_failed = true; err = errno;
+  }
+
+  jout("Writing %u page(s) to %s\n", last_page + 1, options.file.c_str());
+
+  auto start = std::chrono::steady_clock::now();
+  auto last_progress = start;
+  auto elapsed_usec = [&](std::chrono::steady_clock::time_point t) -> uint64_t {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - start).count();
+  };
+  unsigned pages_read = 1;
+
+  bool ok = !write_failed && reader.read_data(header, last_page,
+    [&](unsigned page, const unsigned char * data, unsigned n) -> bool {
+      if (fwrite(data, 512, n, f) != n) {
+        write_failed = true; err = errno;
+        return false;
+      }
+      pages_read = page + n;
+      auto now = std::chrono::steady_clock::now();
+      if (now - last_progress < std::chrono::seconds(progress_interval_sec))
+        return true;
+      last_progress = now;
+      uint64_t usec = elapsed_usec(now);
+      jout("%5.1f%% done, page %u of %u, %.1f MB/s\n", 100.0 * pages_read / (last_page + 1),
+           pages_read, last_page + 1, (usec ? (pages_read - 1) * 512.0 / usec : 0.0));
+      return true;
+    });
+
+  if (!f.close() && !write_failed) {
+    write_failed = true; err = errno;
+  }
+
+  uint64_t usec = elapsed_usec(std::chrono::steady_clock::now());
+  uint64_t bytes = (uint64_t)pages_read * 512;
+  char bytes_str[64];
+  jout("Captured %u page(s) (%s bytes) in %.1f seconds (%.1f MB/s), %u page(s) per command\n",
+       pages_read, format_with_thousands_sep(bytes_str, sizeof(bytes_str), bytes),
+       usec / 1000000.0, (usec ? (pages_read - 1) * 512.0 / usec : 0.0), reader.get_chunk());
+  jref["pages"] = pages_read;
+  jref["bytes"] = bytes;
+  jref["pages_per_command"] = reader.get_chunk();
+  jref["elapsed_msec"] = usec / 1000;
+  jref["completed"] = (ok && !write_failed);
+
+  if (write_failed) {
+    jerr("%s: %s\n", options.file.c_str(), strerror(err));
+    return FAILCMD;
+  }
+  if (!ok) {
+    jerr("%s: Read %s Device Internal Status log failed at page %u: %s\n",
+         device->get_info_name(), logname, pages_read, device->get_errmsg());
+    jref["error"] = device->get_errmsg();
+    return FAILSMART;
+  }
+  return 0;
+}
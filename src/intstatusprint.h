@@ -0,0 +1,37 @@
+/*
+ * intstatusprint.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef INTSTATUSPRINT_H
+#define INTSTATUSPRINT_H
+
+#include <smartmon/dev_interface.h>
+
+#include <string>
+
+// options for intStatusPrintMain
+struct int_status_print_options
+{
+  bool enabled = false;   // --internal-status was specified
+  bool saved = false;     // Saved instead of Current log
+  bool initiate = false;  // Initiate new capture of Current log
+  unsigned area = 3;      // Last data area to read
+  unsigned chunk = 128;   // Max pages per command
+  std::string file;       // Output file
+};
+
+// Parse argument of '--internal-status=current|saved[,OPTION...],file=FILE'.
+// Return false on error.
+bool parse_int_status_arg(const char * arg, int_status_print_options & options);
+
+// Capture the Current or Saved Device Internal Status log of an open
+// ATA device into a file.
+int intStatusPrintMain(smartmon::ata_device * device, const int_status_print_options & options);
+
+#endif // INTSTATUSPRINT_H
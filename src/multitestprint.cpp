@@ -0,0 +1,344 @@
+/*
+ * multitestprint.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "multitestprint.h"
+
+#include <smartmon/utility.h>
+#include "smartctl.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace smartmon;
+
+// Polls are done at least this often to report progress
+const unsigned max_poll_sec = 600;
+
+bool parse_multi_test_arg(const char * arg, multi_test_options & options)
+{
+  if (!strncmp(arg, "short", 5)) {
+    options.type = SELF_TEST_SHORT;
+    arg += 5;
+  }
+  else if (!strncmp(arg, "long", 4)) {
+    options.type = SELF_TEST_EXTENDED;
+    arg += 4;
+  }
+  else
+    return false;
+
+  while (*arg) {
+    char name[8+1] = ""; unsigned v = 0; int n = -1;
+    if (!(sscanf(arg, ",%8[a-z]=%u%n", name, &v, &n) == 2 && n > 0))
+      return false;
+    if (!strcmp(name, "max"))
+      options.max_parallel = v;
+    else if (!strcmp(name, "poll") && 1 <= v && v <= 86400)
+      options.poll_sec = v;
+    else if (!strcmp(name, "time"))
+      options.max_seconds = v;
+    else
+      return false;
+    arg += n;
+  }
+  options.enabled = true;
+  return true;
+}
+
+namespace {
+
+enum test_phase { PHASE_WAITING, PHASE_RUNNING, PHASE_DONE };
+
+// Test state of one device
+struct test_entry
+{
+  smart_device_auto_ptr dev;
+  std::unique_ptr<self_test_runner> runner;
+  test_phase phase = PHASE_WAITING;
+  unsigned est_sec = 0;           // Estimated duration, 0 if unknown
+  long long start_usec = 0, end_usec = 0, next_poll_usec = 0;
+  unsigned polls = 0;
+  int percent_done = -1;          // Last reported progress
+  self_test_state state;          // Result if completed
+  std::string errmsg;             // Open or command error
+  bool open_failed = false;
+  bool aborted = false;           // Aborted due to timeout
+};
+
+} // namespace
+
+static const char * get_protocol(const smart_device * dev)
+{
+  return (dev->is_ata() ? "ATA" : dev->is_scsi() ? "SCSI" : dev->is_nvme() ? "NVMe" : "?");
+}
+
+// Print line of progress stream.
+static void print_progress(const test_entry & e, const char * fmt, ...)
+  SMARTMON_FORMAT_PRINTF(2, 3);
+
+static void print_progress(const test_entry & e, const char * fmt, ...)
+{
+  if (jglb.is_enabled())
+    return;
+  char timestr[16];
+  struct tm tmbuf;
+  time_t now = time(nullptr);
+  strftime(timestr, sizeof(timestr), "%H:%M:%S", time_to_tm_local(&tmbuf, now));
+  va_list ap; va_start(ap, fmt);
+  std::string msg = vstrprintf(fmt, ap);
+  va_end(ap);
+  pout("%s %-24s %s\n", timestr, e.dev->get_info_name(), msg.c_str());
+}
+
+// Return time until next poll.  The remaining time is estimated from
+// the progress if available, otherwise from the estimated duration.
+// The interval is halved as the end approaches.
+static long long get_poll_delay_usec(const test_entry & e, long long now_usec,
+                                     unsigned poll_sec)
+{
+  long long elapsed = now_usec - e.start_usec;
+  long long remain = 0;
+  if (e.percent_done > 0)
+    remain = elapsed * (100 - e.percent_done) / e.percent_done;
+  else if (e.est_sec)
+    remain = e.est_sec * 1000000LL - elapsed;
+  long long delay = remain / 2;
+  long long min_delay = poll_sec * 1000000LL;
+  long long max_delay = (poll_sec > max_poll_sec ? poll_sec : max_poll_sec) * 1000000LL;
+  return (delay < min_delay ? min_delay : delay > max_delay ? max_delay : delay);
+}
+
+static void finish_test(test_entry & e, const char * errmsg = nullptr)
+{
+  if (errmsg) {
+    e.errmsg = errmsg;
+    print_progress(e, "%s", errmsg);
+  }
+  e.end_usec = get_timer_usec();
+  e.phase = PHASE_DONE;
+  if (e.dev->is_open())
+    e.dev->close();
+}
+
+static void start_test(test_entry & e, const multi_test_options & options)
+{
+  e.dev.replace(e.dev->autodetect_open());
+  if (!e.dev->is_open()) {
+    e.open_failed = true;
+    finish_test(e, strprintf("Open failed: %s", e.dev->get_errmsg()).c_str());
+    return;
+  }
+
+  e.runner.reset(new self_test_runner(e.dev.get()));
+  if (!e.runner->init()) {
+    finish_test(e, e.dev->get_errmsg());
+    return;
+  }
+  // Do not abort a test started by someone else
+  self_test_state st;
+  if (!e.runner->poll(st)) {
+    finish_test(e, e.dev->get_errmsg());
+    return;
+  }
+  if (st.running) {
+    finish_test(e, "Self-test already in progress, skipped");
+    return;
+  }
+  if (!e.runner->start(options.type)) {
+    finish_test(e, strprintf("Start of self-test failed: %s", e.dev->get_errmsg()).c_str());
+    return;
+  }
+
+  e.est_sec = e.runner->get_duration_sec(options.type);
+  e.start_usec = get_timer_usec();
+  e.next_poll_usec = e.start_usec + get_poll_delay_usec(e, e.start_usec, options.poll_sec);
+  e.phase = PHASE_RUNNING;
+  if (e.est_sec)
+    print_progress(e, "%s self-test started, estimated %u min",
+                   (options.type == SELF_TEST_SHORT ? "Short" : "Extended"),
+                   (e.est_sec + 59) / 60);
+  else
+    print_progress(e, "%s self-test started",
+                   (options.type == SELF_TEST_SHORT ? "Short" : "Extended"));
+}
+
+static void poll_test(test_entry & e, const multi_test_options & options)
+{
+  e.polls++;
+  self_test_state st;
+  if (!e.runner->poll(st)) {
+    finish_test(e, strprintf("Poll failed: %s", e.dev->get_errmsg()).c_str());
+    return;
+  }
+  long long now_usec = get_timer_usec();
+  if (st.running) {
+    if (st.percent_done >= 0 && st.percent_done != e.percent_done) {
+      e.percent_done = st.percent_done;
+      print_progress(e, "%d%% done", st.percent_done);
+    }
+    e.next_poll_usec = now_usec + get_poll_delay_usec(e, now_usec, options.poll_sec);
+    return;
+  }
+  e.state = st;
+  finish_test(e);
+  print_progress(e, "%s after %lld min", st.status_str,
+                 (e.end_usec - e.start_usec + 30000000LL) / 60000000LL);
+}
+
+// Abort test which is still running at timeout.
+static void abort_test(test_entry & e)
+{
+  e.end_usec = get_timer_usec();
+  if (!e.runner->abort()) {
+    print_progress(e, "Abort of self-test failed: %s", e.dev->get_errmsg());
+    return;
+  }
+  e.aborted = true;
+  print_progress(e, "Self-test aborted after %lld min (timeout)",
+                 (e.end_usec - e.start_usec + 30000000LL) / 60000000LL);
+}
+
+int multiTestMain(smart_device_list & devlist, const multi_test_options & options)
+{
+  std::vector< std::unique_ptr<test_entry> > entries;
+  for (unsigned i = 0; i < devlist.size(); i++) {
+    test_entry * e = new test_entry;
+    entries.emplace_back(e);
+    e->dev.replace(devlist.release(i));
+  }
+
+  const char * type_str = (options.type == SELF_TEST_SHORT ? "short" : "extended");
+  unsigned num = entries.size();
+  unsigned max = (options.max_parallel && options.max_parallel < num ? options.max_parallel : num);
+  jout("Running %s self-test on %u device%s, %u at a time\n\n", type_str, num,
+       (num == 1 ? "" : "s"), max);
+
+  long long start_usec = get_timer_usec();
+  long long deadline_usec = (options.max_seconds ? start_usec + options.max_seconds * 1000000LL : 0);
+  unsigned next = 0, running = 0;
+  for (;;) {
+    // Start further tests up to the limit
+    while (next < num && running < max) {
+      test_entry & e = *entries[next++];
+      start_test(e, options);
+      if (e.phase == PHASE_RUNNING)
+        running++;
+    }
+    if (!running)
+      break;
+
+    // Sleep until the next poll is due
+    long long wake_usec = 0;
+    for (const auto & e : entries) {
+      if (e->phase == PHASE_RUNNING && (!wake_usec || e->next_poll_usec < wake_usec))
+        wake_usec = e->next_poll_usec;
+    }
+    bool timeout = (deadline_usec && wake_usec >= deadline_usec);
+    if (timeout)
+      wake_usec = deadline_usec;
+    long long wait_usec = wake_usec - get_timer_usec();
+    if (wait_usec > 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(wait_usec));
+    if (timeout) {
+      for (const auto & e : entries) {
+        if (e->phase == PHASE_RUNNING)
+          abort_test(*e);
+      }
+      break;
+    }
+
+    long long now_usec = get_timer_usec();
+    for (const auto & e : entries) {
+      if (!(e->phase == PHASE_RUNNING && e->next_poll_usec <= now_usec))
+        continue;
+      poll_test(*e, options);
+      if (e->phase == PHASE_DONE)
+        running--;
+    }
+  }
+
+  // Summary
+  unsigned passed = 0, failed = 0, errors = 0, unfinished = 0;
+  int retval = 0;
+  jout("\n%-24s %-5s %9s %9s  %s\n", "Device", "Proto", "Est.(min)", "Time(min)", "Result");
+  json::ref jref = jglb["multi_self_test"];
+  jref["type"] = type_str;
+  jref["max_parallel"] = max;
+  for (unsigned i = 0; i < num; i++) {
+    test_entry & e = *entries[i];
+    const char * result;
+    long long usec = 0;
+    json::ref jrefd = jref["devices"][(int)i];
+    jrefd["name"] = e.dev->get_dev_name();
+    jrefd["info_name"] = e.dev->get_info_name();
+    jrefd["type"] = e.dev->get_dev_type();
+    jrefd["protocol"] = get_protocol(e.dev.get());
+    if (e.phase == PHASE_WAITING) {
+      result = "Not started (timeout)";
+      unfinished++;
+    }
+    else if (e.phase == PHASE_RUNNING) {
+      result = (e.aborted ? "Aborted (timeout)" : "Still running (timeout)");
+      usec = e.end_usec - e.start_usec;
+      jrefd[(e.aborted ? "aborted" : "running")] = true;
+      if (e.percent_done >= 0)
+        jrefd["percent_done"] = e.percent_done;
+      unfinished++;
+    }
+    else if (!e.errmsg.empty()) {
+      result = e.errmsg.c_str();
+      if (e.start_usec)
+        usec = e.end_usec - e.start_usec;
+      jrefd["error"] = e.errmsg;
+      retval |= (e.open_failed ? FAILDEV : FAILSMART);
+      errors++;
+    }
+    else {
+      result = e.state.status_str;
+      usec = e.end_usec - e.start_usec;
+      json::ref jrefs = jrefd["status"];
+      jrefs["value"] = e.state.status;
+      jrefs["string"] = e.state.status_str;
+      jrefs["passed"] = e.state.passed;
+      if (e.state.passed)
+        passed++;
+      else {
+        retval |= FAILLOG;
+        failed++;
+      }
+    }
+    if (e.est_sec)
+      jrefd["estimated_seconds"] = e.est_sec;
+    if (usec)
+      jrefd["elapsed_seconds"] = usec / 1000000;
+    if (e.polls)
+      jrefd["polls"] = e.polls;
+
+    jout("%-24s %-5s %9s %9s  %s\n", e.dev->get_info_name(), get_protocol(e.dev.get()),
+         (e.est_sec ? strprintf("%u", (e.est_sec + 59) / 60).c_str() : "-"),
+         (usec ? strprintf("%.1f", usec / 60000000.0).c_str() : "-"), result);
+  }
+  jout("\n%u passed, %u failed, %u errors, %u not finished\n", passed, failed, errors, unfinished);
+  jref["passed_count"] = passed;
+  jref["failed_count"] = failed;
+  jref["error_count"] = errors;
+  jref["unfinished_count"] = unfinished;
+  return retval;
+}
@@ -0,0 +1,35 @@
+/*
+ * multitestprint.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef MULTITESTPRINT_H
+#define MULTITESTPRINT_H
+
+#include <smartmon/dev_interface.h>
+#include <smartmon/selftest.h>
+
+// options for multiTestMain
+struct multi_test_options
+{
+  bool enabled = false; // --multi-test was specified
+  smartmon::self_test_type type = smartmon::SELF_TEST_SHORT;
+  unsigned max_parallel = 0; // Max number of tests running at a time, 0 = all
+  unsigned poll_sec = 60; // Min interval between polls of a device
+  unsigned max_seconds = 0; // Stop waiting after this time, 0 = unlimited
+};
+
+// Parse argument of '--multi-test=TEST[,OPTION=VALUE,...]'.
+// Return false on error.
+bool parse_multi_test_arg(const char * arg, multi_test_options & options);
+
+// Run self-tests on all (unopened) devices of DEVLIST, print progress
+// and a summary.
+int multiTestMain(smartmon::smart_device_list & devlist, const multi_test_options & options);
+
+#endif // MULTITESTPRINT_H
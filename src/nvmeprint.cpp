@@ -146,7 +146,7 @@ static void print_drive_info(const nvme_id_ctrl & id_ctrl, const nvme_id_ns & id
     const char * align = &("  "[nsid < 10 ? 0 : (nsid < 100 ? 1 : 2)]);
     int fmt_lba_bits = id_ns.lbaf[id_ns.flbas & 0xf].ds;
 
-    json::ref jrns = jglb["nvme_namespaces"][0]; // Same as in print_drive_capabilities()
+    json::cursor jrns(jglb["nvme_namespaces"][0]); // Same as in print_drive_capabilities()
     jrns["id"] = nsid;
 
     // Size and Capacity are equal if thin provisioning is not supported
@@ -360,7 +360,7 @@ static void print_drive_capabilities(const nvme_id_ctrl & id_ctrl, const nvme_id
          ((id_ns.nsfeat & ~0x1f) ? " *Other*" : ""));
   }
 
-  json::ref jrns = jglb["nvme_namespaces"][0]; // Same as in print_drive_info()
+  json::cursor jrns(jglb["nvme_namespaces"][0]); // Same as in print_drive_info()
   if (nsid) {
     jrns["id"] = nsid;
     jrns["features"] += {
@@ -390,7 +390,7 @@ static void print_drive_capabilities(const nvme_id_ctrl & id_ctrl, const nvme_id
          ps.write_lat & 0x1f, ps.write_tput & 0x1f,
          ps.entry_lat, ps.exit_lat);
 
-    json::ref jrefi = jglb["nvme_power_states"][i];
+    json::cursor jrefi(jglb["nvme_power_states"][i]);
     jrefi += {
       { "non_operational_state", !!(ps.flags & 0x02) },
       { "relative_read_latency", ps.read_lat & 0x1f },
@@ -433,7 +433,7 @@ static void print_critical_warning(unsigned char w)
        (!w ? "PASSED" : "FAILED!"));
   jglb["smart_status"]["passed"] = !w;
 
-  json::ref jref = jglb["smart_status"]["nvme"];
+  json::cursor jref(jglb["smart_status"]["nvme"]);
   jref["value"] = w;
 
   if (w) {
@@ -466,7 +466,7 @@ static void print_critical_warning(unsigned char w)
 static void print_smart_log(const nvme_smart_log & smart_log,
   const nvme_id_ctrl & id_ctrl, unsigned nsid, bool show_all)
 {
-  json::ref jref = jglb["nvme_smart_health_information_log"];
+  json::cursor jref(jglb["nvme_smart_health_information_log"]);
   char buf[64];
   jout("SMART/Health Information (NVMe Log 0x02, NSID 0x%x)\n", nsid);
   jref["nsid"] = (nsid != nvme_broadcast_nsid ? (int64_t)nsid : -1);
@@ -570,7 +570,7 @@ static void print_error_log(const nvme_error_log_page * error_log,
 {
   // Figure 93 of NVM Express Base Specification Revision 1.3d, March 20, 2019
   // Figure 197 of NVM Express Base Specification Revision 1.4c, March 9, 2021
-  json::ref jref = jglb["nvme_error_information_log"];
+  json::cursor jref(jglb["nvme_error_information_log"]);
   jout("Error Information (NVMe Log 0x01, %u of %u entries)\n",
        read_entries, max_entries);
 
@@ -607,7 +607,7 @@ static void print_error_log(const nvme_error_log_page * error_log,
       unused = 0;
     }
 
-    json::ref jrefi = jref["table"][i];
+    json::cursor jrefi(jref["table"][i]);
     jrefi["error_count"] = e.error_count;
     const char * msg = "-"; char msgbuf[64]{};
     char sq[16] = "-", cm[16] = "-", st[16] = "-", pe[16] = "-";
@@ -666,7 +666,7 @@ static void print_self_test_log(const nvme_self_test_log & self_test_log, unsign
 {
   // Figure 99 of NVM Express Base Specification Revision 1.3d, March 20, 2019
   // Figure 203 of NVM Express Base Specification Revision 1.4c, March 9, 2021
-  json::ref jref = jglb["nvme_self_test_log"];
+  json::cursor jref(jglb["nvme_self_test_log"]);
   jout("Self-test Log (NVMe Log 0x06, NSID 0x%x)\n", nsid);
   jref["nsid"] = (nsid != nvme_broadcast_nsid ? (int64_t)nsid : -1);
 
@@ -699,7 +699,7 @@ static void print_self_test_log(const nvme_self_test_log & self_test_log, unsign
     if (!op || res == 0xf)
       continue; // unused entry
 
-    json::ref jrefi = jref["table"][i];
+    json::cursor jrefi(jref["table"][i]);
     const char * t; char buf2[32];
     switch (op) {
       case 0x1: t = "Short"; break;
@@ -21,6 +21,7 @@
 #include <errno.h>
 
 #include <smartmon/scsicmds.h>
+#include <smartmon/scsilogpage.h>
 #include <smartmon/atacmds.h> // dont_print_serial_number
 #include <smartmon/dev_interface.h>
 #include "scsiprint.h"
@@ -457,7 +458,7 @@ scsiPrintActiveTapeAlerts(scsi_device * device, int peripheral_type,
     }
     pagelength = sg_get_unaligned_be16(gBuf + 2);
 
-    json::ref jref = jglb[tapealert_s]["status"];
+    json::cursor jref(jglb[tapealert_s]["status"]);
     for (s=severities, j = 0; *s; s++) {
         for (i = 4, m = 0; i < pagelength; i += 5, ++m) {
             parametercode = sg_get_unaligned_be16(gBuf + i);
@@ -641,7 +642,7 @@ scsiPrintPendingDefectsLPage(scsi_device * device)
             lba = sg_get_unaligned_be64(bp + 8);
             jout("  %4d:  0x%-16" PRIx64 ",  %5u\n", pc, lba, poh);
             {
-                json::ref jref = jglb[jname]["table"][pc];
+                json::cursor jref(jglb[jname]["table"][pc]);
 
                 jref["lba"] = lba;
                 jref["accum_power_on_hours"] = poh;
@@ -969,7 +970,7 @@ scsiPrintErrorCounterLog(scsi_device * device)
         pout("           fast | delayed   rewrites  corrected  "
              "invocations   [10^9 bytes]  errors\n");
 
-        json::ref jref = jglb["scsi_error_counter_log"];
+        json::cursor jref(jglb["scsi_error_counter_log"]);
         for (int k = 0; k < 3; ++k) {
             if (! found[k])
                 continue;
@@ -1533,19 +1534,14 @@ scsiPrintGStatsPerf(scsi_device * device)
     int retval = 0;
     int64_t timeUnitInNS;
     uint64_t ull;
-    const char * ccp;
     uint8_t * ucp;
-    // const char * q;
-    json::ref jref = jglb["scsi_general_statistics_and_performance_log"];
-    json::ref jref1 = jref["general_access"];
-    json::ref jref2 = jref["idle_time"];
-    json::ref jref3 = jref["time_interval"];
-    json::ref jref4 = jref["fua_stats"];
-    static const char * p1name = "General access statistics and performance";
-    static const char * p2name = "Idle time";
-    static const char * p3name = "Time interval";
-    static const char * p4name = "Force Unit Access statistics and "
-                                 "performance";
+    json::cursor jref(jglb["scsi_general_statistics_and_performance_log"]);
+    json::cursor jref1(jref["general_access"]);
+    json::cursor jref2(jref["idle_time"]);
+    json::cursor jref3(jref["time_interval"]);
+    json::cursor jref4(jref["fua_stats"]);
+    // Indexed by parameter code
+    json::cursor * const jrefs[] = { nullptr, &jref1, &jref2, &jref3, &jref4 };
 
     jout("\n%s %s:\n", gsap_s, lp_s);
     if ((err = scsiLogSense(device, GEN_STATS_PERF_LPAGE, 0, gBuf,
@@ -1585,140 +1581,37 @@ scsiPrintGStatsPerf(scsi_device * device)
         timeUnitInNS = 0;
     }
 
-    while (num > 3) {
-        int pc = sg_get_unaligned_be16(ucp + 0);
-        // pcb = ucp[2];
-        int pl = ucp[3] + 4;
-
-        switch (pc) {
-        case 1: /* General access statistics and performance log parameter */
-            if (pl < 0x40 + 4) {
-                print_on();
-                pout("%s %s log parameter too short (pl=%d)\n", gsap_s,
-                     p1name, pl);
-                print_off();
-                return FAILSMART;
-            }
-            jout("  %s:\n", p1name);
-            ccp =  "Number of read commands";
-            ull = sg_get_unaligned_be64(ucp + 4);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref1[ccp] = ull;
-            ccp =  "Number of write commands";
-            ull = sg_get_unaligned_be64(ucp + 12);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref1[ccp] = ull;
-            ccp =  "number of logical blocks received";
-            ull = sg_get_unaligned_be64(ucp + 20);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref1[ccp] = ull;
-            ccp =  "number of logical blocks transmitted";
-            ull = sg_get_unaligned_be64(ucp + 28);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref1[ccp] = ull;
-            ccp = "read command processing intervals";
-            ull = sg_get_unaligned_be64(ucp + 36);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            scsiPrintTimeUnitInNano(6, ull, timeUnitInNS);
-            jref1[ccp] = ull;
-            ccp = "write command processing intervals";
-            ull = sg_get_unaligned_be64(ucp + 44);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            scsiPrintTimeUnitInNano(6, ull, timeUnitInNS);
-            jref1[ccp] = ull;
-            ccp = "weighted number of read commands plus write commands";
-            ull = sg_get_unaligned_be64(ucp + 52);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref1[ccp] = ull;
-            ccp = "weighted read command processing plus write command "
-                  "processing";
-            ull = sg_get_unaligned_be64(ucp + 60);
-            scsiPrintTimeUnitInNano(6, ull, timeUnitInNS);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref1[ccp] = ull;
-            break;
-        case 2:     /* Idle time log parameter */
-            if (pl < 0x8 + 4) {
-                print_on();
-                pout("%s %s log parameter too short (pl=%d)\n", gsap_s,
-                     p2name, pl);
-                print_off();
-                return FAILSMART;
-            }
-            jout("  %s:\n", p2name);
-            ccp = "Idle time intervals";
-            ull = sg_get_unaligned_be64(ucp + 4);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            scsiPrintTimeUnitInNano(6, ull, timeUnitInNS);
-            jref2[ccp] = ull;
-            break;
-        case 3:    /* Time interval log parameter (shared with other lpages */
-            /* only produce JSON for this parameter */
-            if (pl < 0x8 + 4) {
+    const scsi_log_schema & schema = scsi_gen_stats_perf_schema;
+    scsiGStatsPerf gsp;
+    scsi_decode_log_page(schema, gBuf, LOG_RESP_LONG_LEN, gsp);
+    for (unsigned i = 0; i < schema.num_fields; i++) {
+        const scsi_log_field & f = schema.fields[i];
+        unsigned pc = f.param_code;
+        /* Time interval log parameter (shared with other lpages) */
+        /* only produce JSON for this parameter */
+        bool json_only = (pc == 3);
+        if (f.value_offset == scsi_log_no_offset) {
+            /* Parameter present, f.name is name of parameter */
+            if (gsp.gotParam[pc] && !gsp.gotPC[pc]) {
                 print_on();
-                pout("%s %s log parameter too short (pl=%d)\n", gsap_s,
-                     p3name, pl);
+                pout("%s %s log parameter too short\n", gsap_s, f.name);
                 print_off();
                 return FAILSMART;
             }
-            ccp = "Exponent";
-            ull = sg_get_unaligned_be32(ucp + 4);
-            jref3[ccp] = ull;
-            ccp = "Integer";
-            ull = sg_get_unaligned_be32(ucp + 8);
-            jref3[ccp] = ull;
-            break;
-        case 4:     /* FUA statistics and performance log parameter */
-            if (pl < 0x40 + 4) {
-                print_on();
-                pout("%s %s log parameter too short (pl=%d)\n", gsap_s,
-                     p4name, pl);
-                print_off();
-                return FAILSMART;
-            }
-            jout("  %s:\n", p4name);
-            ccp = "Number of read FUA commands";
-            ull = sg_get_unaligned_be64(ucp + 4);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref4[ccp] = ull;
-            ccp = "Number of write FUA commands";
-            ull = sg_get_unaligned_be64(ucp + 12);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref4[ccp] = ull;
-            ccp = "Number of read FUA_NV commands";
-            ull = sg_get_unaligned_be64(ucp + 20);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref4[ccp] = ull;
-            ccp = "Number of write FUA_NV commands";
-            ull = sg_get_unaligned_be64(ucp + 28);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref4[ccp] = ull;
-            ccp = "Number of read FUA intervals";
-            ull = sg_get_unaligned_be64(ucp + 36);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            scsiPrintTimeUnitInNano(6, ull, timeUnitInNS);
-            jref4[ccp] = ull;
-            ccp = "Number of write FUA intervals";
-            ull = sg_get_unaligned_be64(ucp + 44);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            jref4[ccp] = ull;
-            ccp = "Number of read FUA_NV intervals";
-            ull = sg_get_unaligned_be64(ucp + 52);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            scsiPrintTimeUnitInNano(6, ull, timeUnitInNS);
-            jref4[ccp] = ull;
-            ccp = "Number of write FUA_NV intervals";
-            ull = sg_get_unaligned_be64(ucp + 60);
-            jout("    %s: %" PRIu64 "\n", ccp, ull);
-            scsiPrintTimeUnitInNano(6, ull, timeUnitInNS);
-            jref4[ccp] = ull;
-            break;
-        default:        /* ignore other parameter codes */
-            break;
+            if (gsp.gotPC[pc] && !json_only)
+                jout("  %s:\n", f.name);
+            continue;
         }
-        num -= pl;
-        ucp += pl;
-    }           /* end of long for loop */
+        if (!gsp.gotPC[pc])
+            continue;
+        ull = scsi_log_field_value(f, &gsp);
+        if (!json_only) {
+            jout("    %s: %" PRIu64 "\n", f.name, ull);
+            if (f.unit) /* "interval" */
+                scsiPrintTimeUnitInNano(6, ull, timeUnitInNS);
+        }
+        (*jrefs[pc])[f.name] = ull;
+    }
     return retval;
 }
 
@@ -1730,10 +1623,8 @@ scsiPrintGStatsPerf(scsi_device * device)
 static int
 scsiPrintSSMedia(scsi_device * device)
 {
-    int num, err, truncated;
+    int num, err;
     int retval = 0;
-    uint8_t * ucp;
-    const char * q;
 
     if ((err = scsiLogSense(device, SS_MEDIA_LPAGE, 0, gBuf,
                             LOG_RESP_LONG_LEN, 0))) {
@@ -1756,33 +1647,22 @@ scsiPrintSSMedia(scsi_device * device)
         print_off();
         return FAILSMART;
     }
-    truncated = (num > LOG_RESP_LONG_LEN) ? num : 0;
-    if (truncated)
-        num = LOG_RESP_LONG_LEN;
-    ucp = gBuf + 4;
-    num -= 4;
-    while (num > 3) {
-        int pc = sg_get_unaligned_be16(ucp + 0);
-        // pcb = ucp[2];
-        int pl = ucp[3] + 4;
-        switch (pc) {
-        case 1:
-            if (pl < 8) {
-                print_on();
-                pout("%s Percentage used endurance indicator parameter "
-                     "too short (pl=%d)\n", ssm_s, pl);
-                print_off();
-                return FAILSMART;
-            }
-            q = "Percentage used endurance indicator";
-            jout("%s: %d%%\n", q, ucp[7]);
-            jglb[std::string("scsi_") + json::str2key(q)] = ucp[7];
-            jglb["endurance_used"]["current_percent"] = ucp[7];
-        default:        /* ignore other parameter codes */
-            break;
-        }
-        num -= pl;
-        ucp += pl;
+    const scsi_log_schema & schema = scsi_ss_media_schema;
+    scsiSSMedia ssm;
+    scsi_decode_log_page(schema, gBuf, LOG_RESP_LONG_LEN, ssm);
+    if (ssm.gotParam && !ssm.gotPUEI) {
+        print_on();
+        pout("%s Percentage used endurance indicator parameter "
+             "too short\n", ssm_s);
+        print_off();
+        return FAILSMART;
+    }
+    if (ssm.gotPUEI) {
+        const char * q = "Percentage used endurance indicator";
+        unsigned pcnt = (unsigned)ssm.pcntUsedEndurance;
+        jout("%s: %u%%\n", q, pcnt);
+        jglb[std::string("scsi_") + json::str2key(q)] = pcnt;
+        jglb["endurance_used"]["current_percent"] = pcnt;
     }
     return retval;
 }
@@ -1790,11 +1670,9 @@ scsiPrintSSMedia(scsi_device * device)
 static int
 scsiPrintZBDeviceStats(scsi_device * device)
 {
-    int num, err, truncated;
+    int num, err;
     int retval = 0;
     uint32_t u;
-    uint8_t * ucp;
-    const char * q;
     static const char * jname = "scsi_zoned_block_device_statistics";
 
     jout("\n%s %s:\n", zbds_s, lp_s);
@@ -1820,97 +1698,16 @@ scsiPrintZBDeviceStats(scsi_device * device)
         print_off();
         return FAILSMART;
     }
-    truncated = (num > LOG_RESP_LONG_LEN) ? num : 0;
-    if (truncated)
-        num = LOG_RESP_LONG_LEN;
-    ucp = gBuf + 4;
-    num -= 4;
-    while (num > 3) {
-        int pc = sg_get_unaligned_be16(ucp + 0);
-        // pcb = ucp[2];
-        int pl = ucp[3] + 4;
-
-        if (pl < 12)
-            goto skip;  /* DC HC650 has non-compliant 4 byte parameters */
-        switch (pc) {
-        case 0:
-            q = "Maximum open zones";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 1:
-            q = "Maximum explicitly open zones";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 2:
-            q = "Maximum implicitly open zones";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 3:
-            q = "Minimum empty zones";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 4:
-            q = "Maximum nonseq zones";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 5:
-            q = "Zones emptied";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 6:
-            q = "Suboptimal write commands";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 7:
-            q = "Commands exceeding optinmal limit";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 8:
-            q = "Failed explicit opens";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 9:
-            q = "Read rule violations";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 0xa:
-            q = "Write rule violations";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        case 0xb:
-            q = "Maximum implicitly open sequential or before required zones";
-            u = sg_get_unaligned_be32(ucp + 8);
-            jout("    %s: %u\n", q, u);
-            jglb[jname][json::str2key(q)] = u;
-            break;
-        default:        /* ignore other parameter codes */
-            break;
-        }
-skip:
-        num -= pl;
-        ucp += pl;
+    const scsi_log_schema & schema = scsi_zb_device_stats_schema;
+    scsiZBDeviceStats zbds;
+    scsi_decode_log_page(schema, gBuf, LOG_RESP_LONG_LEN, zbds);
+    for (unsigned i = 0; i < schema.num_fields; i++) {
+        const scsi_log_field & f = schema.fields[i];
+        if (!scsi_log_field_present(f, &zbds))
+            continue;
+        u = (uint32_t)scsi_log_field_value(f, &zbds);
+        jout("    %s: %u\n", f.name, u);
+        jglb[jname][json::str2key(f.name)] = u;
     }
     return retval;
 }
@@ -2554,7 +2351,7 @@ show_sas_port_param(int port_num, unsigned char * ucp, int param_len)
         char yn[32];
 
         snprintf(yn, sizeof(yn), "phy_%d", k);
-        json::ref jref = jglb[pn][yn];
+        json::cursor jref(jglb[pn][yn]);
         jout("  phy identifier = %d\n", vcp[1]);
         jref["identifier"] = vcp[1];
         spld_len = vcp[3];
@@ -2921,6 +2718,14 @@ scsiGetDriveInfo(scsi_device * device, uint8_t * peripheral_type,
              "Try an additional '-d ata' or '-d sat' argument.\n");
         return 2;
     }
+
+    /* Before first MODE SENSE, enables the mode page cache */
+    if (device->is_spc4_or_higher() && (! device->checked_cmd_support())) {
+        if (! device->query_cmd_support()) {
+            if (scsi_debugmode)
+                pout("%s: query_cmd_support() failed\n", __func__);
+        }
+    }
     if (! all)
         return 0;
 
@@ -3606,14 +3411,6 @@ scsiPrintMain(scsi_device * device, const scsi_print_options & options)
                (SCSI_PT_HOST_MANAGED == peripheral_type));
     is_tape = ((SCSI_PT_SEQUENTIAL_ACCESS == peripheral_type) ||
                (SCSI_PT_MEDIUM_CHANGER == peripheral_type));
-    bool ge_spc4 = device->is_spc4_or_higher();
-    if (ge_spc4 && (! device->checked_cmd_support())) {
-        if (! device->query_cmd_support()) {
-            if (scsi_debugmode)
-                pout("%s: query_cmd_support() failed\n", __func__);
-        }
-    }
-
     short int wce = -1, rcd = -1;
     // Print read look-ahead status for disks
     if (options.get_rcd || options.get_wce) {
@@ -38,6 +38,10 @@
 #include <smartmon/scsicmds.h>
 #include "scsiprint.h"
 #include "nvmeprint.h"
+#include "intstatusprint.h"
+#include "multitestprint.h"
+#include "verifyprint.h"
+#include "watchprint.h"
 #include "smartctl.h"
 #include <smartmon/utility.h>
 #include <smartmon/version.h>
@@ -56,6 +60,11 @@ static bool print_as_json_output = false;
 static bool print_as_json_impl = false;
 static bool print_as_json_unimpl = false;
 
+// Control JSON output to file (--json-file)
+static std::string print_as_json_file;
+static json::output_options print_as_json_file_options;
+static stdio_file print_as_json_file_fp;
+
 static void printslogan()
 {
   jout("%s\n", format_version_info("smartctl").c_str());
@@ -80,7 +89,7 @@ static void js_initialize(int argc, char **argv, bool verbose)
   jglb["json_format_version"][1] = 0;
 
   // Smartctl version info
-  json::ref jref = jglb["smartctl"];
+  json::cursor jref(jglb["smartctl"]);
   int ver[3] = { 0, 0, 0 };
   sscanf(PACKAGE_VERSION, "%d.%d.%d", ver, ver+1, ver+2);
   jref["version"][0] = ver[0];
@@ -137,6 +146,12 @@ static void Usage()
 "         Show all SMART information for device\n\n"
 "  -x, --xall\n"
 "         Show all information for device\n\n"
+"  --watch=SECONDS[,COUNT]\n"
+"         Print changes of attributes and counters every SECONDS\n\n"
+"  --verify=RANGE[,chunk=N][,rate=MBPS][,slow=MSEC][,time=SEC][,state=FILE]\n"
+"         Verify medium without data transfer, RANGE: all, N-M, N+SIZE\n\n"
+"  --internal-status=current|saved[,initiate][,area=N][,chunk=N],file=FILE\n"
+"         Save Device Internal Status log to FILE                     (ATA)\n\n"
 "  --scan\n"
 "         Scan for devices\n\n"
 "  --scan-open\n"
@@ -146,6 +161,8 @@ static void Usage()
 "================================== SMARTCTL RUN-TIME BEHAVIOR OPTIONS =====\n\n"
 "  -j, --json[=cgiosuvy]\n"
 "         Print output in JSON or YAML format\n\n"
+"  --json-file=FILE[,cgsvy]\n"
+"         Print output as usual and also save JSON or YAML to FILE\n\n"
 "  -q TYPE, --quietmode=TYPE                                           (ATA)\n"
 "         Set smartctl quiet mode to one of: errorsonly, silent, noserial\n\n"
 "  -d TYPE, --device=TYPE\n"
@@ -221,6 +238,8 @@ static void Usage()
 "        Do test in captive mode (along with -t)\n\n"
 "  -X, --abort\n"
 "        Abort any non-captive test on device\n\n"
+"  --multi-test=TEST[,max=N][,poll=SEC][,time=SEC] [DEVICE ...]\n"
+"        Run test on all DEVICEs or scan results, TEST: short, long\n\n"
 );
   std::string examples = smi()->get_app_examples("smartctl");
   if (!examples.empty())
@@ -228,7 +247,8 @@ static void Usage()
 }
 
 // Values for  --long only options, see parse_options()
-enum { opt_identify = 1000, opt_scan, opt_scan_open, opt_set, opt_smart };
+enum { opt_identify = 1000, opt_scan, opt_scan_open, opt_set, opt_smart, opt_watch,
+       opt_verify, opt_multi_test, opt_int_status, opt_json_file };
 
 /* Returns a string containing a formatted list of the valid arguments
    to the option opt or empty on failure. Note 'v' case different */
@@ -283,6 +303,17 @@ static std::string getvalidarglist(int opt)
     return "c, g, i, o, s, u, v, y";
   case opt_identify:
     return "n, wn, w, v, wv, wb";
+  case opt_watch:
+    return "SECONDS[,COUNT]";
+  case opt_verify:
+    return "all, N-M, N+SIZE, followed by [,chunk=N][,rate=MBPS][,slow=MSEC]"
+           "[,time=SEC][,state=FILE]";
+  case opt_multi_test:
+    return "short, long, followed by [,max=N][,poll=SEC][,time=SEC]";
+  case opt_int_status:
+    return "current, saved, followed by [,initiate][,area=N][,chunk=N],file=FILE";
+  case opt_json_file:
+    return "FILE, optionally followed by ,[cgsvy]";
   case 'v':
   default:
     return "";
@@ -316,12 +347,16 @@ enum checksum_err_mode_t {
 static checksum_err_mode_t checksum_err_mode = CHECKSUM_ERR_WARN;
 
 static void scan_devices(const smart_devtype_list & types, bool with_open, char ** argv);
+static int multi_test_devices(const multi_test_options & options,
+                              const smart_devtype_list & types, char ** argv);
 
 
 /*      Takes command options and sets features to be run */    
 static int parse_options(int argc, char** argv, const char * & type,
   ata_print_options & ataopts, scsi_print_options & scsiopts,
-  nvme_print_options & nvmeopts, bool & print_type_only)
+  nvme_print_options & nvmeopts, watch_print_options & watchopts,
+  verify_print_options & verifyopts, int_status_print_options & intstatusopts,
+  bool & print_type_only)
 {
   // Please update getvalidarglist() if you edit shortopts
   const char *shortopts = "h?Vq:d:T:b:r:s:o:S:HcAl:iaxv:P:t:CXF:n:B:f:g:j";
@@ -358,8 +393,13 @@ static int parse_options(int argc, char** argv, const char * & type,
     { "format",          required_argument, 0, 'f' },
     { "get",             required_argument, 0, 'g' },
     { "json",            optional_argument, 0, 'j' },
+    { "json-file",       required_argument, 0, opt_json_file },
     { "identify",        optional_argument, 0, opt_identify },
     { "set",             required_argument, 0, opt_set },
+    { "watch",           required_argument, 0, opt_watch },
+    { "verify",          required_argument, 0, opt_verify },
+    { "multi-test",      required_argument, 0, opt_multi_test },
+    { "internal-status", required_argument, 0, opt_int_status },
     { "scan",            no_argument,       0, opt_scan      },
     { "scan-open",       no_argument,       0, opt_scan_open },
     { 0,                 0,                 0, 0   }
@@ -373,6 +413,7 @@ static int parse_options(int argc, char** argv, const char * & type,
   bool use_default_db = true; // set false on '-B FILE'
   bool output_format_set = false; // set true on '-f FORMAT'
   int scan = 0; // set by --scan, --scan-open
+  multi_test_options multitestopts; // set by --multi-test
   bool badarg = false, captive = false;
   int testcnt = 0; // number of self-tests requested
 
@@ -723,6 +764,35 @@ static int parse_options(int argc, char** argv, const char * & type,
       }
       break;
 
+    case opt_watch:
+      {
+        unsigned interval = 0, count = 0;
+        int n1 = -1, n2 = -1, len = strlen(optarg);
+        sscanf(optarg, "%u%n,%u%n", &interval, &n1, &count, &n2);
+        if (!((n1 == len || (n2 == len && count > 0)) && 0 < interval && interval <= 86400))
+          badarg = true;
+        else {
+          watchopts.interval = interval;
+          watchopts.count = count;
+        }
+      }
+      break;
+
+    case opt_verify:
+      if (!parse_verify_arg(optarg, verifyopts))
+        badarg = true;
+      break;
+
+    case opt_multi_test:
+      if (!parse_multi_test_arg(optarg, multitestopts))
+        badarg = true;
+      break;
+
+    case opt_int_status:
+      if (!parse_int_status_arg(optarg, intstatusopts))
+        badarg = true;
+      break;
+
     case 'a':
       ataopts.a_option = true;
       ataopts.drive_info           = scsiopts.drive_info          = nvmeopts.drive_info          = true;
@@ -1173,6 +1243,35 @@ static int parse_options(int argc, char** argv, const char * & type,
       }
       break;
 
+    case opt_json_file:
+      {
+        print_as_json_file_options.pretty = true;
+        print_as_json_file_options.sorted = false;
+        print_as_json_file_options.format = 0;
+        bool json_verbose = false;
+        // Flags follow the last ',' if valid, use "FILE," if FILE ends with such a suffix
+        const char * comma = strrchr(optarg, ',');
+        if (comma && !comma[strspn(comma + 1, "cgsvy") + 1]) {
+          for (int i = 1; comma[i]; i++) {
+            switch (comma[i]) {
+              case 'c': print_as_json_file_options.pretty = false; break;
+              case 'g': print_as_json_file_options.format = 'g'; break;
+              case 's': print_as_json_file_options.sorted = true; break;
+              case 'v': json_verbose = true; break;
+              case 'y': print_as_json_file_options.format = 'y'; break;
+            }
+          }
+          print_as_json_file.assign(optarg, comma - optarg);
+        }
+        else
+          print_as_json_file = optarg;
+        if (print_as_json_file.empty())
+          badarg = true;
+        else
+          js_initialize(argc, argv, json_verbose);
+      }
+      break;
+
     case '?':
     default:
       printing_is_off = false;
@@ -1221,6 +1320,11 @@ static int parse_options(int argc, char** argv, const char * & type,
       jerr("=======> INVALID ARGUMENT TO -%s: %s\n",
         (optchar == opt_identify ? "-identify" :
          optchar == opt_set ? "-set" :
+         optchar == opt_watch ? "-watch" :
+         optchar == opt_verify ? "-verify" :
+         optchar == opt_multi_test ? "-multi-test" :
+         optchar == opt_int_status ? "-internal-status" :
+         optchar == opt_json_file ? "-json-file" :
          optchar == opt_smart ? "-smart" :
          optchar == 'j' ? "-json" : optstr), optarg);
       printvalidarglistmessage(optchar);
@@ -1231,6 +1335,22 @@ static int parse_options(int argc, char** argv, const char * & type,
     }
   }
 
+  // --json-file collects the JSON tree while the text output is printed
+  if (!print_as_json_file.empty()) {
+    if (print_as_json || watchopts.interval || verifyopts.enabled || multitestopts.enabled) {
+      printslogan();
+      jerr("\nERROR: --json-file cannot be used with -j, --watch, --verify or --multi-test.\n");
+      UsageSummary();
+      return FAILCMD;
+    }
+    // Open now to fail before any device access
+    if (!print_as_json_file_fp.open(print_as_json_file.c_str(), "w")) {
+      printslogan();
+      jerr("%s: %s\n", print_as_json_file.c_str(), strerror(errno));
+      return FAILCMD;
+    }
+  }
+
   // Special handling of --scan, --scanopen
   if (scan) {
     // Read or init drive database to allow USB ID check.
@@ -1240,6 +1360,13 @@ static int parse_options(int argc, char** argv, const char * & type,
     return 0;
   }
 
+  // Special handling of --multi-test
+  if (multitestopts.enabled) {
+    if (!init_drive_database(use_default_db))
+      return FAILCMD;
+    return multi_test_devices(multitestopts, scan_types, argv + optind);
+  }
+
   // At this point we have processed all command-line options.  If the
   // print output is switchable, then start with the print output
   // turned off
@@ -1278,6 +1405,28 @@ static int parse_options(int argc, char** argv, const char * & type,
     return FAILCMD;
   }
 
+  if (watchopts.interval && verifyopts.enabled) {
+    printing_is_off = false;
+    printslogan();
+    jerr("\nERROR: --watch and --verify cannot be used together.\n");
+    UsageSummary();
+    return FAILCMD;
+  }
+
+  if (intstatusopts.enabled && (watchopts.interval || verifyopts.enabled)) {
+    printing_is_off = false;
+    printslogan();
+    jerr("\nERROR: --internal-status cannot be used with --watch or --verify.\n");
+    UsageSummary();
+    return FAILCMD;
+  }
+
+  // --watch prints one JSON object per line (NDJSON)
+  if (watchopts.interval && print_as_json) {
+    print_as_json_options.pretty = false;
+    print_as_json_options.format = 0;
+  }
+
   // If captive option was used, change test type if appropriate.
   if (captive)
     switch (ataopts.smart_selftest_type) {
@@ -1338,10 +1487,14 @@ static void vjpout(bool is_js_impl, const char * msg_severity,
 {
   if (!print_as_json) {
     // Print out directly
-    vprintf(fmt, ap);
+    va_list aq;
+    va_copy(aq, ap);
+    vprintf(fmt, aq);
+    va_end(aq);
     fflush(stdout);
   }
-  else {
+  // --json-file: Also collect messages in JSON output
+  if (print_as_json || (msg_severity && print_as_json_file_fp)) {
     // Add lines to JSON output
     static char buf[1024];
     static char * bufnext = buf;
@@ -1368,7 +1521,7 @@ static void vjpout(bool is_js_impl, const char * msg_severity,
       if (msg_severity) {
         // Collect non-empty messages in array
         static int errindex = 0;
-        json::ref jref = jglb["smartctl"]["messages"][errindex++];
+        json::cursor jref(jglb["smartctl"]["messages"][errindex++]);
         jref["string"] = p;
         jref["severity"] = msg_severity;
       }
@@ -1376,8 +1529,10 @@ static void vjpout(bool is_js_impl, const char * msg_severity,
       if (   ( is_js_impl && print_as_json_impl  )
           || (!is_js_impl && print_as_json_unimpl)) {
         // Add (un)implemented non-empty lines to global object
-        jglb[strprintf("smartctl_%04d_%c", lineno,
-                     (is_js_impl ? 'i' : 'u')).c_str()] = p;
+        char key[32];
+        snprintf(key, sizeof(key), "smartctl_%04d_%c", lineno,
+                 (is_js_impl ? 'i' : 'u'));
+        jglb[key] = p;
       }
     }
   }
@@ -1555,6 +1710,29 @@ static void js_device_info(const json::ref & jref, const smart_device * dev)
   jref["protocol"] = get_protocol_info(dev);
 }
 
+// Add JSON device identity provided by the OS (e.g. Linux sysfs)
+static void js_os_identity(const json::ref & jref, const smart_device * dev)
+{
+  os_dev_identity id;
+  if (!smi()->get_os_dev_identity(dev->get_dev_name(), dev->get_req_type(), id))
+    return;
+  json::ref jrefi = jref["os_identity"];
+  jrefi["protocol"] = id.protocol;
+  if (!id.vendor.empty())
+    jrefi["vendor"] = id.vendor;
+  jrefi["model_name"] = id.model;
+  jrefi["serial_number"] = id.serial;
+  if (!id.firmware.empty())
+    jrefi["firmware_version"] = id.firmware;
+  if (!id.wwn.empty())
+    jrefi["wwid"] = id.wwn;
+  if (id.protocol == "ATA") {
+    const drive_settings * dbentry = lookup_drive(id.model.c_str(), id.firmware.c_str());
+    if (dbentry && *dbentry->modelfamily)
+      jrefi["model_family"] = dbentry->modelfamily;
+  }
+}
+
 // Device scan
 // smartctl [-d type] --scan[-open] -- [PATTERN] [smartd directive ...]
 void scan_devices(const smart_devtype_list & types, bool with_open, char ** argv)
@@ -1578,7 +1756,7 @@ void scan_devices(const smart_devtype_list & types, bool with_open, char ** argv
 
   for (unsigned i = 0; i < devlist.size(); i++) {
     smart_device_auto_ptr dev( devlist.release(i) );
-    json::ref jref = jglb["devices"][i];
+    json::cursor jref(jglb["devices"][i]);
 
     if (with_open) {
       printing_is_off = dont_print;
@@ -1587,6 +1765,8 @@ void scan_devices(const smart_devtype_list & types, bool with_open, char ** argv
     }
 
     js_device_info(jref, dev.get());
+    if (jglb.is_enabled())
+      js_os_identity(jref, dev.get());
 
     if (with_open && !dev->is_open()) {
       jout("# %s -d %s # %s, %s device open failed: %s\n", dev->get_dev_name(),
@@ -1610,6 +1790,45 @@ void scan_devices(const smart_devtype_list & types, bool with_open, char ** argv
   }
 }
 
+// Self-tests on multiple devices
+// smartctl [-d type] --multi-test=TEST[,...] [DEVICE ...]
+// Devices are scanned if none are specified.
+int multi_test_devices(const multi_test_options & options,
+                       const smart_devtype_list & types, char ** argv)
+{
+  smart_device_list devlist;
+  if (!argv[0]) {
+    bool dont_print = !(ata_debugmode || scsi_debugmode || nvme_debugmode);
+    printing_is_off = dont_print;
+    bool ok = smi()->scan_smart_devices(devlist, types);
+    printing_is_off = false;
+    if (!ok) {
+      jerr("scan_smart_devices: %s\n", smi()->get_errmsg());
+      return FAILCMD;
+    }
+  }
+  else {
+    if (types.size() > 1) {
+      jerr("ERROR: multiple -d TYPE options are only allowed without DEVICE\n");
+      return FAILCMD;
+    }
+    const char * type = (!types.empty() ? types[0].c_str() : nullptr);
+    for (int i = 0; argv[i]; i++) {
+      smart_device * dev = smi()->get_smart_device(argv[i], type);
+      if (!dev) {
+        jerr("%s: %s\n", argv[i], smi()->get_errmsg());
+        return FAILCMD;
+      }
+      devlist.push_back(dev);
+    }
+  }
+  if (!devlist.size()) {
+    jerr("No devices found\n");
+    return FAILDEV;
+  }
+  return multiTestMain(devlist, options);
+}
+
 // Main program without exception handling
 static int main_worker(int argc, char **argv)
 {
@@ -1630,9 +1849,13 @@ static int main_worker(int argc, char **argv)
   ata_print_options ataopts;
   scsi_print_options scsiopts;
   nvme_print_options nvmeopts;
+  watch_print_options watchopts;
+  verify_print_options verifyopts;
+  int_status_print_options intstatusopts;
   bool print_type_only = false;
   {
-    int status = parse_options(argc, argv, type, ataopts, scsiopts, nvmeopts, print_type_only);
+    int status = parse_options(argc, argv, type, ataopts, scsiopts, nvmeopts, watchopts,
+                               verifyopts, intstatusopts, print_type_only);
     if (status >= 0)
       return status;
   }
@@ -1708,6 +1931,22 @@ static int main_worker(int argc, char **argv)
   if (print_type_only)
     jout("%s: Device of type '%s' [%s] opened\n",
          dev->get_info_name(), dev->get_dev_type(), get_protocol_info(dev.get()));
+  else if (watchopts.interval) {
+    watchopts.fix_swapped_id = ataopts.fix_swapped_id;
+    watchopts.ignore_presets = ataopts.ignore_presets;
+    watchopts.attribute_defs = ataopts.attribute_defs;
+    retval = watchPrintMain(dev.get(), watchopts);
+  }
+  else if (verifyopts.enabled)
+    retval = verifyPrintMain(dev.get(), verifyopts);
+  else if (intstatusopts.enabled) {
+    if (dev->is_ata())
+      retval = intStatusPrintMain(dev->to_ata(), intstatusopts);
+    else {
+      jerr("%s: --internal-status is only supported for ATA devices\n", dev->get_info_name());
+      retval = FAILCMD;
+    }
+  }
   else if (dev->is_ata())
     retval = ataPrintMain(dev->to_ata(), ataopts);
   else if (dev->is_scsi())
@@ -1742,7 +1981,17 @@ int main(int argc, char **argv)
     if (jglb.has_uint128_output())
       jglb["smartctl"]["uint128_precision_bits"] = uint128_to_str_precision_bits();
     jglb["smartctl"]["exit_status"] = status;
-    jglb.output([](const char * str){ fputs(str, stdout); }, nullptr, print_as_json_options);
+    if (print_as_json_file.empty())
+      jglb.output([](const char * str){ fputs(str, stdout); }, nullptr, print_as_json_options);
+    else if (print_as_json_file_fp) {
+      // Text output was printed to stdout, save JSON to file
+      jglb.output([](const char * str, FILE * f){ fputs(str, f); },
+                  (FILE *)print_as_json_file_fp, print_as_json_file_options);
+      if (!print_as_json_file_fp.close()) {
+        printf("Smartctl: %s: write failed\n", print_as_json_file.c_str());
+        status |= FAILCMD;
+      }
+    }
   }
   catch (const std::bad_alloc & /*ex*/) {
     // Memory allocation failed (also thrown by std::operator new)
@@ -0,0 +1,121 @@
+#!/bin/sh
+#
+# smartd-sim-bench.sh - measure smartd check cycle costs with simulated devices
+#
+# Home page of code is: https://www.smartmontools.org
+#
+# Copyright (C) 2026 Christian Franke
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+
+# Requires a smartd build with 'configure --enable-sim-devices'.
+# Runs 'smartd -q onecheck' with N simulated devices (ATA, SCSI and NVMe
+# in turn) and prints wall clock time, CPU time and maximum RSS per run
+# and per device.
+
+set -e
+
+myname=$0
+
+usage()
+{
+  echo "Usage: $myname [-d DIRECTIVES] [-m MODEL] [-s] [-S SMARTD] [N ...]"
+  echo
+  echo "  -d DIRECTIVES  smartd.conf directives for each device [-a]"
+  echo "  -m MODEL       Additional model options, e.g. 'latency=2,growth=5'"
+  echo "  -s             Also write state, attribute log and JSON state files"
+  echo "  -S SMARTD      smartd executable [./smartd]"
+  echo "  N ...          Numbers of devices [10 100 1000 10000]"
+  exit 1
+}
+
+directives="-a"
+model=
+states=false
+smartd="./smartd"
+
+while true; do case $1 in
+  -d) shift; test -n "$1" || usage; directives=$1 ;;
+  -m) shift; test -n "$1" || usage; model=",$1" ;;
+  -s) states=true ;;
+  -S) shift; test -n "$1" || usage; smartd=$1 ;;
+  -*) usage ;;
+  *) break ;;
+esac; shift; done
+
+test $# -ne 0 || set -- 10 100 1000 10000
+
+if ! "$smartd" -V >/dev/null 2>&1; then
+  echo "$myname: $smartd: not found" >&2
+  exit 1
+fi
+
+# GNU time provides CPU times and max RSS
+timecmd=
+if /usr/bin/time -f '%e' true >/dev/null 2>&1; then
+  timecmd="/usr/bin/time"
+fi
+
+tmpdir=$(mktemp -d "${TMPDIR:-/tmp}/smartd-sim-bench.XXXXXX")
+trap 'rm -rf "$tmpdir"' 0
+
+printf '%8s %10s %10s %10s %10s %12s %12s\n' \
+  "Devices" "Wall[s]" "User[s]" "Sys[s]" "MaxRSS[KiB]" "Wall/dev[ms]" "RSS/dev[KiB]"
+
+for n in "$@"; do
+  case $n in
+    *[!0-9]*|'') usage ;;
+  esac
+
+  conf="$tmpdir/smartd.conf"
+  i=0
+  : > "$conf"
+  while [ $i -lt "$n" ]; do
+    case $((i % 3)) in
+      0) proto=ata ;;
+      1) proto=scsi ;;
+      *) proto=nvme ;;
+    esac
+    echo "sim$i -d sim,$proto,seed=$i$model $directives" >> "$conf"
+    i=$((i + 1))
+  done
+
+  opts=
+  if $states; then
+    rm -rf "$tmpdir/s" && mkdir "$tmpdir/s"
+    opts="-s $tmpdir/s/state. -A $tmpdir/s/attrlog. -j $tmpdir/s/json."
+  fi
+
+  log="$tmpdir/smartd.log"
+  if [ -n "$timecmd" ]; then
+    # shellcheck disable=SC2086
+    $timecmd -o "$tmpdir/time" -f '%e %U %S %M' \
+      "$smartd" -q onecheck -c "$conf" $opts > "$log" 2>&1 || rc=$?
+    read -r wall user sys rss < "$tmpdir/time"
+  else
+    # Use nanoseconds if supported by date
+    start=$(date +%s%N)
+    # shellcheck disable=SC2086
+    "$smartd" -q onecheck -c "$conf" $opts > "$log" 2>&1 || rc=$?
+    end=$(date +%s%N)
+    case $start in
+      *N) wall=$(( ${end%N} - ${start%N} )) ;;
+      *)  wall=$(awk -v s="$start" -v e="$end" 'BEGIN { printf "%.2f", (e - s) / 1e9 }') ;;
+    esac
+    user=-; sys=-; rss=-
+  fi
+
+  if [ "${rc:-0}" -ne 0 ]; then
+    echo "$myname: smartd exited with status $rc, see below:" >&2
+    tail -20 "$log" >&2
+    exit 1
+  fi
+
+  perdev=$(awk -v w="$wall" -v n="$n" 'BEGIN { printf "%.3f", w * 1000 / n }')
+  rssdev=-
+  if [ "$rss" != "-" ]; then
+    rssdev=$(awk -v r="$rss" -v n="$n" 'BEGIN { printf "%.1f", r / n }')
+  fi
+  printf '%8s %10s %10s %10s %10s %12s %12s\n' "$n" "$wall" "$user" "$sys" "$rss" "$perdev" "$rssdev"
+done
@@ -26,12 +26,19 @@
 #include <errno.h>
 #include <time.h>
 #include <limits.h>
+#include <math.h>   // sqrt()
 #include <getopt.h>
 
 #include <algorithm> // std::replace()
+#include <atomic>
 #include <map>
+#include <memory> // std::unique_ptr
+#include <new> // placement new
 #include <stdexcept>
 #include <string>
+#include <mutex>
+#include <thread>
+#include <type_traits> // std::aligned_storage
 #include <vector>
 
 // conditionally included files
@@ -71,14 +78,19 @@ typedef int pid_t;
 #include <smartmon/atacmds.h>
 #include <smartmon/dev_interface.h>
 #include <smartmon/knowndrives.h>
+#include <smartmon/mediaverify.h>
 #include <smartmon/scsicmds.h>
 #include <smartmon/nvmecmds.h>
+#include <smartmon/shmstate.h>
 #include <smartmon/json.h>
 #include <smartmon/utility.h>
 #include <smartmon/sg_unaligned.h>
 
 #ifdef HAVE_POSIX_API
+#include "event_loop.h"
+#include "http_push.h"
 #include "popen_as_ugid.h"
+#include "smtp_client.h"
 #endif
 
 #ifdef _WIN32
@@ -141,6 +153,12 @@ static constexpr int default_checktime = 1800;
 static int checktime = default_checktime;
 static int checktime_min = 0; // Minimum individual check time, 0 if none
 
+// command-line: '--io-budget' limits of commands per second, 0 if none
+static double io_budget_rate = 0;       // All devices
+static double io_budget_ctrl_rate = 0;  // Devices of one controller
+// command-line: '--io-budget' limit of devices busy at the same time, 0 if none
+static unsigned io_budget_max_busy = 0;
+
 // command-line: name of PID file (empty for no pid file)
 static std::string pid_file;
 
@@ -165,6 +183,26 @@ static std::string json_state_path_prefix
 #endif
                                         ;
 
+// command-line: path of memory mapped state snapshot file, empty if none.
+static std::string shm_state_path;
+
+// Memory mapped state snapshot of all devices.
+static shmstate_writer shm_state;
+
+#ifdef HAVE_POSIX_API
+// command-line: '--push' options, empty URL if none.
+static http_push_options push_options;
+
+// Sends JSON state of all devices to a collector.
+static http_pusher pusher;
+
+// command-line: '--smtp' options, empty relay if none.
+static smtp_options smtp_relay_options;
+
+// Sends warning emails to a mail relay instead of running the warning script.
+static smtp_client smtp_relay;
+#endif
+
 // configuration file name
 static const char * configfile;
 // configuration file "name" if read from stdin
@@ -217,6 +255,11 @@ static volatile int caughtsigHUP=0;
 // set to signal value if we catch INT, QUIT, or TERM
 static volatile int caughtsigEXIT=0;
 
+#ifdef HAVE_POSIX_API
+// Event loop which receives the above signals if supported
+static event_loop evloop;
+#endif
+
 // This function prints either to stdout or to the syslog as needed.
 static void PrintOut(int priority, const char *fmt, ...)
   SMARTMON_FORMAT_PRINTF(2, 3);
@@ -368,6 +411,18 @@ private:
   unsigned char m_flags[256]{};
 };
 
+// Configuration of '-Y' attribute trend monitoring for one attribute.
+struct attribute_trend_config
+{
+  unsigned char id{};                     // Attribute ID
+  bool as_crit{};                         // Report as LOG_CRIT and send mail ('!')
+  unsigned alpha{10};                     // Weight of new sample in EWMA (percent)
+  double max_rate{};                      // Report if average rate exceeds this (per day), 0 = off
+  double cusum_k{0.5};                    // CUSUM allowance (standard deviations)
+  double cusum_h{5};                      // CUSUM decision limit (standard deviations), 0 = off
+  unsigned window{7};                     // Window of rolling min/max (days)
+};
+
 
 /// Configuration data for a device. Read from smartd.conf.
 /// Supports copy & assignment and is compatible with STL containers.
@@ -407,13 +462,18 @@ struct dev_config
   bool ignorepresets{};                   // Ignore database of -v options
   bool showpresets{};                     // Show database entry for this device
   bool removable{};                       // Device may disappear (not be present)
+  char multipath{};                       // Group paths with same identity: 1=failover, 2=roundrobin
   char powermode{};                       // skip check, if disk in idle or standby mode
   bool powerquiet{};                      // skip powermode 'skipping checks' message
+  bool powerwake{};                       // check skipped disk as soon as it becomes active
   int powerskipmax{};                     // how many times can be check skipped
   unsigned char tempdiff{};               // Track Temperature changes >= this limit
   unsigned char tempinfo{}, tempcrit{};   // Track Temperatures >= these limits as LOG_INFO, LOG_CRIT+mail
   regular_expression test_regex;          // Regex for scheduled testing
   unsigned test_offset_factor{};          // Factor for staggering of scheduled tests
+  unsigned verify_rate{};                 // Media verification rate (MB/s), 0 if disabled
+  unsigned verify_slice{};                // Media verification time per check cycle (seconds)
+  unsigned verify_chunk{};                // Blocks per verify command, 0 = default
 
   // Configuration of email warning messages
   std::string emailcmdline;               // script to execute, empty if no messages
@@ -441,6 +501,7 @@ struct dev_config
   bool curr_pending_set{},  offl_pending_set{};  // True if '-C', '-U' set in smartd.conf
 
   attribute_flags monitor_attr_flags;     // MONITOR_* flags for each attribute
+  std::vector<attribute_trend_config> attr_trends; // '-Y' directives
 
   ata_vendor_attr_defs attribute_defs;    // -v options
 
@@ -449,7 +510,7 @@ struct dev_config
 };
 
 // Number of allowed mail message types
-static const int SMARTD_NMAIL = 13;
+static const int SMARTD_NMAIL = 15;
 // Type for '-M test' mails (state not persistent)
 static const int MAILTYPE_TEST = 0;
 // TODO: Add const or enum for all mail types.
@@ -460,6 +521,120 @@ struct mailinfo {
   time_t lastsent{};    // time last email was sent, as defined by time(2)
 };
 
+/// Pool for protocol specific state data.
+/// Objects of the same type are allocated in chunks,
+/// freed objects are kept for reuse after reload.
+template <class T>
+class dev_state_pool
+{
+public:
+  static T * alloc()
+    {
+      dev_state_pool & p = get();
+      if (!p.m_free) {
+        slot * c = new slot[chunk_size];
+        p.m_chunks.push_back(std::unique_ptr<slot[]>(c));
+        for (unsigned i = 0; i < chunk_size; i++) {
+          c[i].next = p.m_free;
+          p.m_free = &c[i];
+        }
+      }
+      slot * s = p.m_free;
+      p.m_free = s->next;
+      return new (&s->buf) T();
+    }
+
+  static void release(T * x)
+    {
+      x->~T();
+      dev_state_pool & p = get();
+      slot * s = reinterpret_cast<slot *>(x);
+      s->next = p.m_free;
+      p.m_free = s;
+    }
+
+private:
+  static const unsigned chunk_size = 64;
+
+  union slot {
+    slot * next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type buf;
+  };
+
+  std::vector< std::unique_ptr<slot[]> > m_chunks;
+  slot * m_free{};
+
+  static dev_state_pool & get()
+    {
+      static dev_state_pool pool;
+      return pool;
+    }
+};
+
+/// Protocol specific state data.  Allocated from dev_state_pool<T>
+/// on first non-const access, reads as zero if not allocated.
+/// Copies are deep.
+template <class T>
+class pooled_state
+{
+public:
+  pooled_state() = default;
+
+  pooled_state(const pooled_state & x)
+    { if (x.m_p) **this = *x; }
+
+  pooled_state(pooled_state && x) noexcept
+    : m_p(x.m_p) { x.m_p = nullptr; }
+
+  ~pooled_state()
+    { reset(); }
+
+  pooled_state & operator=(const pooled_state & x)
+    {
+      if (x.m_p)
+        **this = *x;
+      else
+        reset();
+      return *this;
+    }
+
+  pooled_state & operator=(pooled_state && x) noexcept
+    { std::swap(m_p, x.m_p); return *this; }
+
+  T & operator*()
+    {
+      if (!m_p)
+        m_p = dev_state_pool<T>::alloc();
+      return *m_p;
+    }
+
+  const T & operator*() const
+    { return (m_p ? *m_p : zero()); }
+
+  T * operator->()
+    { return &**this; }
+
+  const T * operator->() const
+    { return &**this; }
+
+  void reset()
+    {
+      if (m_p) {
+        dev_state_pool<T>::release(m_p);
+        m_p = nullptr;
+      }
+    }
+
+private:
+  T * m_p{};
+
+  static const T & zero()
+    {
+      static const T z{};
+      return z;
+    }
+};
+
 /// Persistent state data for a device.
 struct persistent_dev_state
 {
@@ -474,6 +649,10 @@ struct persistent_dev_state
   uint64_t selective_test_last_start{};   // Start LBA of last scheduled selective self-test
   uint64_t selective_test_last_end{};     // End LBA of last scheduled selective self-test
 
+  uint64_t media_verify_next_lba{};       // Next LBA for '-V' media verification
+  uint64_t media_verify_passes{};         // Number of completed verification passes
+  uint64_t media_verify_failed_blocks{};  // Total number of blocks failed verification
+
   mailinfo maillog[SMARTD_NMAIL];         // log info on when mail sent
 
   // ATA ONLY
@@ -484,41 +663,79 @@ struct persistent_dev_state
     unsigned char id{};
     unsigned char val{};
     unsigned char worst{}; // Byte needed for 'raw64' attribute only.
-    uint64_t raw{};
     unsigned char resvd{};
+    uint64_t raw{};
   };
-  ata_attribute ata_attributes[NUMBER_ATA_SMART_ATTRIBUTES];
-  
+  struct ata_attribute_table {
+    ata_attribute a[NUMBER_ATA_SMART_ATTRIBUTES];
+  };
+  pooled_state<ata_attribute_table> ata_attributes;
+
+  // Statistics of '-Y' attribute trend monitoring, O(1) update per sample.
+  // Rates are raw value increments per day.
+  struct attribute_trend {
+    unsigned char id{};
+    unsigned char flags{};                // TREND_* flags
+    uint32_t samples{};                   // Number of rate samples since (re)start
+    uint64_t raw{};                       // Raw value of last sample
+    time_t time{};                        // Time of last sample, 0 = none
+    double mean{}, var{};                 // EWMA of rate and of its variance
+    double cusum{};                       // Upper CUSUM of standardized rate
+    double min[2]{}, max[2]{};            // Min/Max rate of current and previous window
+    time_t window_start{};                // Start of current window
+  };
+  std::vector<attribute_trend> attr_trends;
+
+  attribute_trend & get_attr_trend(unsigned char id);
+
   // SCSI ONLY
 
   struct scsi_error_counter_t {
     struct scsiErrorCounter errCounter{};
     unsigned char found{};
   };
-  scsi_error_counter_t scsi_error_counters[3];
 
   struct scsi_nonmedium_error_t {
     struct scsiNonMediumError nme{};
     unsigned char found{};
   };
-  scsi_nonmedium_error_t scsi_nonmedium_error;
+
+  struct scsi_error_logs {
+    scsi_error_counter_t error_counters[3];
+    scsi_nonmedium_error_t nonmedium_error;
+  };
+  pooled_state<scsi_error_logs> scsi_logs;
 
   // NVMe only
   uint64_t nvme_err_log_entries{};
 
   // NVMe SMART/Health information: only the fields avail_spare,
   // percent_used and media_errors are persistent.
-  nvme_smart_log nvme_smartval{};
+  pooled_state<nvme_smart_log> nvme_smartval;
+};
+
+enum {
+  TREND_PREV_WINDOW = 0x01,               // min[1], max[1] are valid
+  TREND_RATE_ALARM  = 0x02,               // Average rate above limit was reported
 };
 
+// Find or add trend statistics for attribute ID.
+persistent_dev_state::attribute_trend & persistent_dev_state::get_attr_trend(unsigned char id)
+{
+  for (auto & t : attr_trends) {
+    if (t.id == id)
+      return t;
+  }
+  attr_trends.push_back(attribute_trend());
+  attr_trends.back().id = id;
+  return attr_trends.back();
+}
+
 /// Non-persistent state data for a device.
 struct temp_dev_state
 {
   bool must_write{};                      // true if persistent part should be written
 
-  bool skip{};                            // skip during next check cycle
-  time_t wakeuptime{};                    // next wakeup time, 0 if unknown or global
-
   bool not_cap_offline{};                 // true == not capable of offline testing
   bool not_cap_conveyance{};
   bool not_cap_short{};
@@ -532,15 +749,25 @@ struct temp_dev_state
 
   bool removed{};                         // true if open() failed for removable device
 
+  // Multipath ('-d multipath') only
+  std::vector<smart_device *> mpath_alt;  // Additional paths, owned by main_worker()
+  unsigned mpath_active{};                // Path used for last check, 0 = preferred path
+  unsigned mpath_next{};                  // First path to try in next round-robin cycle
+  uint32_t mpath_failed{};                // Bitmask of paths which failed last probe
+  bool media_verify_unsup{};              // true if '-V' media verification is not possible
+
   bool powermodefail{};                   // true if power mode check failed
   int powerskipcnt{};                     // Number of checks skipped due to idle or standby mode
   int lastpowermodeskipped{};             // the last power mode that was skipped
+  bool powerwake_armed{};                 // '-n ...,w': check if block I/O count changes
+  uint64_t powerwake_io_count{};          // block I/O count when check was skipped
 
   bool json_dirty{};                      // set when current state contains data fresh from this cycle, cleared after JSON write
+  uint64_t push_hash{};                   // hash of JSON state last queued for '--push', 0 if none
   bool ata_attr_refreshed{};              // state.smartval refreshed this cycle (ATA only)
   bool ata_errorlog_refreshed{};          // state.ataerrorcount refreshed this cycle (ATA only)
   bool selftest_log_refreshed{};          // state.selflogcount/selfloghour refreshed this cycle (any protocol)
-  bool scsi_logs_refreshed{};             // state.scsi_error_counters/nonmedium_error refreshed this cycle
+  bool scsi_logs_refreshed{};             // state.scsi_logs refreshed this cycle
   int attrlog_valid{};                    // nonzero if data is valid for protocol specific
                                           // attribute log: 1=ATA, 2=SCSI, 3=NVMe
 
@@ -557,8 +784,8 @@ struct temp_dev_state
                                           // know yet) 6 or 10
   // ATA ONLY
   uint64_t num_sectors{};                 // Number of sectors
-  ata_smart_values smartval{};            // SMART data
-  ata_smart_thresholds_pvt smartthres{};  // SMART thresholds
+  pooled_state<ata_smart_values> smartval;            // SMART data
+  pooled_state<ata_smart_thresholds_pvt> smartthres;  // SMART thresholds
   bool offline_started{};                 // true if offline data collection was started
 
   // ATA and NVMe
@@ -584,12 +811,28 @@ typedef std::vector<dev_config> dev_config_vector;
 /// Container for state info for each device.
 typedef std::vector<dev_state> dev_state_vector;
 
+/// Scheduling data for a device.
+/// Kept in a separate container to allow a quick scan of all devices.
+struct dev_sched_state
+{
+  time_t wakeuptime{};                    // next wakeup time, 0 if unknown or global
+  int checktime{};                        // check interval
+  bool skip{};                            // skip during next check cycle
+
+  // '--io-budget' only
+  int base_checktime{};                   // configured check interval
+  float cmds_per_check{};                 // average number of commands per check, 0 if unknown
+};
+
+/// Container for scheduling data for each device.
+typedef std::vector<dev_sched_state> dev_sched_vector;
+
 // Copy ATA attributes to persistent state.
 void dev_state::update_persistent_state()
 {
   for (int i = 0; i < NUMBER_ATA_SMART_ATTRIBUTES; i++) {
-    const ata_smart_attribute & ta = smartval.vendor_attributes[i];
-    ata_attribute & pa = ata_attributes[i];
+    const ata_smart_attribute & ta = smartval->vendor_attributes[i];
+    ata_attribute & pa = ata_attributes->a[i];
     pa.id = ta.id;
     if (ta.id == 0) {
       pa.val = pa.worst = 0; pa.raw = 0;
@@ -611,8 +854,8 @@ void dev_state::update_persistent_state()
 void dev_state::update_temp_state()
 {
   for (int i = 0; i < NUMBER_ATA_SMART_ATTRIBUTES; i++) {
-    const ata_attribute & pa = ata_attributes[i];
-    ata_smart_attribute & ta = smartval.vendor_attributes[i];
+    const ata_attribute & pa = ata_attributes->a[i];
+    ata_smart_attribute & ta = smartval->vendor_attributes[i];
     ta.id = pa.id;
     if (pa.id == 0) {
       ta.current = ta.worst = 0;
@@ -662,11 +905,15 @@ static bool parse_dev_state_line(const char * line, persistent_dev_state & state
      "|(nvme-available-spare)" // (25)
      "|(nvme-percentage-used)" // (26)
      "|(nvme-media-errors)" // (27)
+     "|(media-verify-next-lba)" // (28)
+     "|(media-verify-passes)" // (29)
+     "|(media-verify-failed-blocks)" // (30)
+     "|(attribute-trend\\.([0-9]+)\\.([a-z-]+))" // (31 (32) (33))
      ")" // 1)
-     " *= *([0-9]+)[ \n]*$" // (28)
+     " *= *([0-9]+)[ \n]*$" // (34)
   );
 
-  constexpr int nmatch = 1+28;
+  constexpr int nmatch = 1+34;
   regular_expression::match_range match[nmatch];
   if (!regex.execute(line, match))
     return false;
@@ -712,26 +959,66 @@ static bool parse_dev_state_line(const char * line, persistent_dev_state & state
     if (!(0 <= i && i < NUMBER_ATA_SMART_ATTRIBUTES))
       return false;
     if (match[m+=2].rm_so >= 0)
-      state.ata_attributes[i].id = (unsigned char)val;
+      state.ata_attributes->a[i].id = (unsigned char)val;
     else if (match[++m].rm_so >= 0)
-      state.ata_attributes[i].val = (unsigned char)val;
+      state.ata_attributes->a[i].val = (unsigned char)val;
     else if (match[++m].rm_so >= 0)
-      state.ata_attributes[i].worst = (unsigned char)val;
+      state.ata_attributes->a[i].worst = (unsigned char)val;
     else if (match[++m].rm_so >= 0)
-      state.ata_attributes[i].raw = val;
+      state.ata_attributes->a[i].raw = val;
     else if (match[++m].rm_so >= 0)
-      state.ata_attributes[i].resvd = (unsigned char)val;
+      state.ata_attributes->a[i].resvd = (unsigned char)val;
     else
       return false;
   }
   else if (match[m+=7].rm_so >= 0)
     state.nvme_err_log_entries = val;
   else if (match[++m].rm_so >= 0)
-    state.nvme_smartval.avail_spare = val;
+    state.nvme_smartval->avail_spare = val;
+  else if (match[++m].rm_so >= 0)
+    state.nvme_smartval->percent_used = val;
   else if (match[++m].rm_so >= 0)
-    state.nvme_smartval.percent_used = val;
+    state.nvme_smartval->media_errors = uint64_to_uile128(val);
   else if (match[++m].rm_so >= 0)
-    state.nvme_smartval.media_errors = uint64_to_uile128(val);
+    state.media_verify_next_lba = val;
+  else if (match[++m].rm_so >= 0)
+    state.media_verify_passes = val;
+  else if (match[++m].rm_so >= 0)
+    state.media_verify_failed_blocks = val;
+  else if (match[++m].rm_so >= 0) {
+    int id = atoi(line+match[m+1].rm_so);
+    if (!(0 < id && id <= 255))
+      return false;
+    std::string name(line+match[m+2].rm_so, match[m+2].rm_eo - match[m+2].rm_so);
+    auto & t = state.get_attr_trend((unsigned char)id);
+    double dval = val / 1000.0; // Rates are saved in 1/1000 units
+    if (name == "flags")
+      t.flags = (unsigned char)val;
+    else if (name == "samples")
+      t.samples = (uint32_t)val;
+    else if (name == "raw")
+      t.raw = val;
+    else if (name == "time")
+      t.time = (time_t)val;
+    else if (name == "rate-ewma")
+      t.mean = dval;
+    else if (name == "rate-stddev")
+      t.var = dval * dval;
+    else if (name == "cusum")
+      t.cusum = dval;
+    else if (name == "rate-min")
+      t.min[0] = dval;
+    else if (name == "rate-max")
+      t.max[0] = dval;
+    else if (name == "prev-rate-min")
+      t.min[1] = dval;
+    else if (name == "prev-rate-max")
+      t.max[1] = dval;
+    else if (name == "window-start")
+      t.window_start = (time_t)val;
+    else
+      return false;
+  }
   else
     return false;
   return true;
@@ -788,6 +1075,13 @@ static void write_dev_state_line(FILE * f, const char * name1, int id, const cha
     fprintf(f, "%s.%d.%s = %" PRIu64 "\n", name1, id, name2, val);
 }
 
+// Write non-negative rate in 1/1000 units.
+static void write_dev_state_rate(FILE * f, const char * name1, int id, const char * name2, double val)
+{
+  write_dev_state_line(f, name1, id, name2,
+    (uint64_t)(val <= 0 ? 0 : val < 1e15 ? val * 1000 + 0.5 : 1e18));
+}
+
 // Write a state file
 static bool write_dev_state(const char * path, const persistent_dev_state & state)
 {
@@ -810,6 +1104,9 @@ static bool write_dev_state(const char * path, const persistent_dev_state & stat
   write_dev_state_line(f, "scheduled-test-next-check", state.scheduled_test_next_check);
   write_dev_state_line(f, "selective-test-last-start", state.selective_test_last_start);
   write_dev_state_line(f, "selective-test-last-end", state.selective_test_last_end);
+  write_dev_state_line(f, "media-verify-next-lba", state.media_verify_next_lba);
+  write_dev_state_line(f, "media-verify-passes", state.media_verify_passes);
+  write_dev_state_line(f, "media-verify-failed-blocks", state.media_verify_failed_blocks);
 
   for (int i = 0; i < SMARTD_NMAIL; i++) {
     if (i == MAILTYPE_TEST) // Don't suppress test mails
@@ -826,7 +1123,7 @@ static bool write_dev_state(const char * path, const persistent_dev_state & stat
   write_dev_state_line(f, "ata-error-count", state.ataerrorcount);
 
   for (int i = 0; i < NUMBER_ATA_SMART_ATTRIBUTES; i++) {
-    const auto & pa = state.ata_attributes[i];
+    const auto & pa = state.ata_attributes->a[i];
     if (!pa.id)
       continue;
     write_dev_state_line(f, "ata-smart-attribute", i, "id", pa.id);
@@ -836,19 +1133,34 @@ static bool write_dev_state(const char * path, const persistent_dev_state & stat
     write_dev_state_line(f, "ata-smart-attribute", i, "resvd", pa.resvd);
   }
 
+  for (const auto & t : state.attr_trends) {
+    write_dev_state_line(f, "attribute-trend", t.id, "flags", t.flags);
+    write_dev_state_line(f, "attribute-trend", t.id, "samples", t.samples);
+    write_dev_state_line(f, "attribute-trend", t.id, "raw", t.raw);
+    write_dev_state_line(f, "attribute-trend", t.id, "time", (uint64_t)t.time);
+    write_dev_state_rate(f, "attribute-trend", t.id, "rate-ewma", t.mean);
+    write_dev_state_rate(f, "attribute-trend", t.id, "rate-stddev", sqrt(t.var));
+    write_dev_state_rate(f, "attribute-trend", t.id, "cusum", t.cusum);
+    write_dev_state_rate(f, "attribute-trend", t.id, "rate-min", t.min[0]);
+    write_dev_state_rate(f, "attribute-trend", t.id, "rate-max", t.max[0]);
+    write_dev_state_rate(f, "attribute-trend", t.id, "prev-rate-min", t.min[1]);
+    write_dev_state_rate(f, "attribute-trend", t.id, "prev-rate-max", t.max[1]);
+    write_dev_state_line(f, "attribute-trend", t.id, "window-start", (uint64_t)t.window_start);
+  }
+
   // NVMe only
   write_dev_state_line(f, "nvme-err-log-entries", state.nvme_err_log_entries);
-  write_dev_state_line(f, "nvme-available-spare", state.nvme_smartval.avail_spare);
-  write_dev_state_line(f, "nvme-percentage-used", state.nvme_smartval.percent_used);
+  write_dev_state_line(f, "nvme-available-spare", state.nvme_smartval->avail_spare);
+  write_dev_state_line(f, "nvme-percentage-used", state.nvme_smartval->percent_used);
   write_dev_state_line(f, "nvme-media-errors",
-    uile128_clamp_to_uint64(state.nvme_smartval.media_errors));
+    uile128_clamp_to_uint64(state.nvme_smartval->media_errors));
 
   return true;
 }
 
 static void write_ata_attrlog(FILE * f, const dev_state & state)
 {
-  for (const auto & pa : state.ata_attributes) {
+  for (const auto & pa : state.ata_attributes->a) {
     if (!pa.id)
       continue;
     fprintf(f, "\t%d;%d;%" PRIu64 ";", pa.id, pa.val, pa.raw);
@@ -860,8 +1172,8 @@ static void write_scsi_attrlog(FILE * f, const dev_state & state)
   const struct scsiErrorCounter * ecp;
   const char * pageNames[3] = {"read", "write", "verify"};
   for (int k = 0; k < 3; ++k) {
-    if ( !state.scsi_error_counters[k].found ) continue;
-    ecp = &state.scsi_error_counters[k].errCounter;
+    if ( !state.scsi_logs->error_counters[k].found ) continue;
+    ecp = &state.scsi_logs->error_counters[k].errCounter;
      fprintf(f, "\t%s-corr-by-ecc-fast;%" PRIu64 ";"
        "\t%s-corr-by-ecc-delayed;%" PRIu64 ";"
        "\t%s-corr-by-retry;%" PRIu64 ";"
@@ -877,8 +1189,8 @@ static void write_scsi_attrlog(FILE * f, const dev_state & state)
        pageNames[k], (ecp->counter[5] / 1000000000.0),
        pageNames[k], ecp->counter[6]);
   }
-  if(state.scsi_nonmedium_error.found && state.scsi_nonmedium_error.nme.gotPC0) {
-    fprintf(f, "\tnon-medium-errors;%" PRIu64 ";", state.scsi_nonmedium_error.nme.counterPC0);
+  if(state.scsi_logs->nonmedium_error.found && state.scsi_logs->nonmedium_error.nme.gotPC0) {
+    fprintf(f, "\tnon-medium-errors;%" PRIu64 ";", state.scsi_logs->nonmedium_error.nme.counterPC0);
   }
   // write SCSI current temperature if it is monitored
   if (state.temperature)
@@ -887,7 +1199,7 @@ static void write_scsi_attrlog(FILE * f, const dev_state & state)
 
 static void write_nvme_attrlog(FILE * f, const dev_state & state)
 {
-  const nvme_smart_log & s = state.nvme_smartval;
+  const nvme_smart_log & s = *state.nvme_smartval;
   // Names similar to smartctl JSON output with '-' instead of '_'
   fprintf(f,
     "\tcritical-warning;%d;"
@@ -923,22 +1235,14 @@ static void write_nvme_attrlog(FILE * f, const dev_state & state)
   );
 }
 
-// Write a JSON state file for one device, using the same json tree builder
+// Build the JSON state of one device, using the same json tree builder
 // and field names as smartctl -j so consumers can share a single parser.
 // Caller gates on state.json_dirty (set when this cycle produced fresh data);
 // cfg.json_dev_type (1=ATA, 2=SCSI, 3=NVMe) drives the per-protocol block.
-static bool write_dev_state_json(const char * path, const dev_config & cfg,
-                                 const dev_state & state)
+// 'local_time' is omitted if NOW is 0.
+static void build_dev_state_json(json & js, const dev_config & cfg,
+                                 const dev_state & state, time_t now)
 {
-  std::string tmppath = path; tmppath += '~';
-
-  stdio_file f(tmppath.c_str(), "w");
-  if (!f) {
-    lib_printf("Cannot create JSON state file \"%s\"\n", tmppath.c_str());
-    return false;
-  }
-
-  json js;
   js.enable();
 
   js["json_format_version"] += {1, 0};
@@ -949,10 +1253,11 @@ static bool write_dev_state_json(const char * path, const dev_config & cfg,
   if (!cfg.dev_idinfo.empty())
     js["device_info"] = cfg.dev_idinfo;
 
-  time_t now = time(nullptr);
-  char now_buf[DATEANDEPOCHLEN];
-  dateandtimezoneepoch(now_buf, now);
-  js["local_time"] += { {"time_t", now}, {"asctime", now_buf} };
+  if (now) {
+    char now_buf[DATEANDEPOCHLEN];
+    dateandtimezoneepoch(now_buf, now);
+    js["local_time"] += { {"time_t", now}, {"asctime", now_buf} };
+  }
 
   if (state.smart_health_status)
     js["smart_status"]["passed"] = (state.smart_health_status > 0);
@@ -985,15 +1290,15 @@ static bool write_dev_state_json(const char * path, const dev_config & cfg,
 
       int ji = 0;
       for (int i = 0; i < NUMBER_ATA_SMART_ATTRIBUTES; i++) {
-        const auto & attr = state.smartval.vendor_attributes[i];
+        const auto & attr = state.smartval->vendor_attributes[i];
         if (!attr.id)
           continue;
 
         unsigned char threshold = 0;
         ata_attr_state attrstate = ata_get_attr_state(attr, i,
-          state.smartthres.thres_entries, cfg.attribute_defs, &threshold);
+          state.smartthres->thres_entries, cfg.attribute_defs, &threshold);
 
-        json::ref jref = js["ata_smart_attributes"]["table"][ji++];
+        json::cursor jref(js["ata_smart_attributes"]["table"][ji++]);
         jref["id"] = attr.id;
         jref["name"] = ata_get_smart_attr_name(attr.id, cfg.attribute_defs, cfg.dev_rpm);
         if (attrstate > ATTRSTATE_NO_NORMVAL)
@@ -1008,7 +1313,7 @@ static bool write_dev_state_json(const char * path, const dev_config & cfg,
         }
 
         uint16_t flags = uile16_to_uint(attr.flags);
-        json::ref jreff = jref["flags"];
+        json::cursor jreff(jref["flags"]);
         jreff["value"] = flags;
         jreff["prefailure"]     = !!ATTRIBUTE_FLAGS_PREFAILURE(flags);
         jreff["updated_online"] = !!ATTRIBUTE_FLAGS_ONLINE(flags);
@@ -1019,7 +1324,26 @@ static bool write_dev_state_json(const char * path, const dev_config & cfg,
 
         uint64_t rawval = ata_get_attr_raw_value(attr, cfg.attribute_defs);
         jref["raw"]["value"] = rawval;
-        jref["raw"]["string"] = ata_format_attr_raw_value(attr, cfg.attribute_defs);
+        char rawstr[64];
+        jref["raw"]["string"] = ata_format_attr_raw_value(rawstr, attr, cfg.attribute_defs);
+      }
+
+      // '-Y' statistics, not available from smartctl
+      ji = 0;
+      for (const auto & t : state.attr_trends) {
+        if (!t.samples)
+          continue;
+        json::cursor jref(js["smartd_attribute_trends"][ji++]);
+        jref["id"] = t.id;
+        jref["samples"] = t.samples;
+        json::cursor jrefr(jref["rate_per_day"]);
+        jrefr["average"] = strprintf("%.3f", t.mean);
+        jrefr["stddev"] = strprintf("%.3f", sqrt(t.var));
+        bool prev = !!(t.flags & TREND_PREV_WINDOW);
+        jrefr["min"] = strprintf("%.3f", (prev ? std::min(t.min[0], t.min[1]) : t.min[0]));
+        jrefr["max"] = strprintf("%.3f", (prev ? std::max(t.max[0], t.max[1]) : t.max[0]));
+        jref["cusum"] = strprintf("%.3f", t.cusum);
+        jref["rate_limit_exceeded"] = !!(t.flags & TREND_RATE_ALARM);
       }
       break;
     }
@@ -1029,10 +1353,10 @@ static bool write_dev_state_json(const char * path, const dev_config & cfg,
         break; // skip scsi_error_counter_log when not refreshed this cycle (stale .state values)
       const char * page_names[3] = {"read", "write", "verify"};
       for (int k = 0; k < 3; k++) {
-        if (!state.scsi_error_counters[k].found)
+        if (!state.scsi_logs->error_counters[k].found)
           continue;
-        const auto & ec = state.scsi_error_counters[k].errCounter;
-        json::ref jref = js["scsi_error_counter_log"][page_names[k]];
+        const auto & ec = state.scsi_logs->error_counters[k].errCounter;
+        json::cursor jref(js["scsi_error_counter_log"][page_names[k]]);
         jref["errors_corrected_by_eccfast"] = ec.counter[0];
         jref["errors_corrected_by_eccdelayed"] = ec.counter[1];
         jref["errors_corrected_by_rereads_rewrites"] = ec.counter[2];
@@ -1041,14 +1365,14 @@ static bool write_dev_state_json(const char * path, const dev_config & cfg,
         jref["gigabytes_processed"] = strprintf("%.3f", ec.counter[5] / 1000000000.0);
         jref["total_uncorrected_errors"] = ec.counter[6];
       }
-      if (state.scsi_nonmedium_error.found && state.scsi_nonmedium_error.nme.gotPC0)
-        js["scsi_error_counter_log"]["non_medium_error"]["count"] = state.scsi_nonmedium_error.nme.counterPC0;
+      if (state.scsi_logs->nonmedium_error.found && state.scsi_logs->nonmedium_error.nme.gotPC0)
+        js["scsi_error_counter_log"]["non_medium_error"]["count"] = state.scsi_logs->nonmedium_error.nme.counterPC0;
       break;
     }
 
     case 3: {
-      const nvme_smart_log & s = state.nvme_smartval;
-      json::ref jref = js["nvme_smart_health_information_log"];
+      const nvme_smart_log & s = *state.nvme_smartval;
+      json::cursor jref(js["nvme_smart_health_information_log"]);
       jref["nsid"] = (cfg.json_nsid != nvme_broadcast_nsid ? (int64_t)cfg.json_nsid : -1);
       jref["critical_warning"] = s.critical_warning;
       int k = uile16_to_uint(s.temperature);
@@ -1077,6 +1401,22 @@ static bool write_dev_state_json(const char * path, const dev_config & cfg,
       break;
     }
   }
+}
+
+// Write a JSON state file for one device.
+static bool write_dev_state_json(const char * path, const dev_config & cfg,
+                                 const dev_state & state)
+{
+  std::string tmppath = path; tmppath += '~';
+
+  stdio_file f(tmppath.c_str(), "w");
+  if (!f) {
+    lib_printf("Cannot create JSON state file \"%s\"\n", tmppath.c_str());
+    return false;
+  }
+
+  json js;
+  build_dev_state_json(js, cfg, state, time(nullptr));
 
   json::output_options opts;
   opts.pretty = true;
@@ -1133,6 +1473,171 @@ static void write_all_dev_states_json(const dev_config_vector & configs,
   }
 }
 
+#ifdef HAVE_POSIX_API
+// Send JSON state of all devices checked this cycle as one batch of
+// NDJSON lines.  Devices whose state did not change since the last batch
+// are skipped.  Must be called before write_all_dev_states_json().
+// If SEND is false, the batch is only queued and sent by next retry.
+static void push_all_dev_states(const dev_config_vector & configs,
+                                dev_state_vector & states, bool send)
+{
+  time_t now = time(nullptr);
+  json::output_options opts; // compact, one line
+  std::string body;
+  unsigned cnt = 0;
+  for (unsigned i = 0; i < states.size(); i++) {
+    dev_state & state = states[i];
+    if (state.removed || !state.json_dirty)
+      continue;
+    const dev_config & cfg = configs.at(i);
+
+    // Compare state without 'local_time' (FNV-1a hash)
+    std::string line;
+    {
+      json js;
+      build_dev_state_json(js, cfg, state, 0);
+      js.output([&line](const char * str){ line += str; }, nullptr, opts);
+    }
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : line)
+      hash = (hash ^ c) * 0x100000001b3ULL;
+    if (!hash)
+      hash = 1;
+    if (hash == state.push_hash)
+      continue;
+    state.push_hash = hash;
+
+    json js;
+    build_dev_state_json(js, cfg, state, now);
+    js.output([&body](const char * str){ body += str; }, nullptr, opts);
+    if (body.empty() || body.back() != '\n')
+      body += '\n';
+    cnt++;
+  }
+
+  if (cnt) {
+    if (debugmode)
+      PrintOut(LOG_INFO, "Pushing state of %u device(s) to %s\n",
+               cnt, push_options.url.c_str());
+    pusher.push(std::move(body), now, send);
+  }
+  else if (send)
+    pusher.retry(now);
+}
+#endif // HAVE_POSIX_API
+
+// Create memory mapped state snapshot file with one entry per device.
+// Replaces the file of a previous configuration.
+static void create_shm_state(const dev_config_vector & configs, const dev_state_vector & states,
+                             const smart_device_list & devices)
+{
+  std::vector<shmstate_entry> entries(configs.size());
+  for (unsigned i = 0; i < entries.size(); i++) {
+    const dev_config & cfg = configs.at(i);
+    const dev_state & state = states.at(i);
+    const smart_device * dev = devices.at(i);
+    shmstate_entry & e = entries[i];
+    shmstate_init_entry(e);
+    e.protocol = (dev->is_ata() ? SHMSTATE_ATA : dev->is_scsi() ? SHMSTATE_SCSI : SHMSTATE_NVME);
+    e.temperature_min = state.tempmin; e.temperature_max = state.tempmax;
+    snprintf(e.name, sizeof(e.name), "%s", cfg.name.c_str());
+    snprintf(e.identity, sizeof(e.identity), "%s", cfg.dev_idinfo.c_str());
+  }
+
+  if (!shm_state.create(shm_state_path.c_str(), entries.size(), entries.data())) {
+    PrintOut(LOG_CRIT, "Cannot create state snapshot file \"%s\": %s\n",
+             shm_state_path.c_str(), strerror(errno));
+    return;
+  }
+  if (debugmode)
+    PrintOut(LOG_INFO, "State snapshot of %u devices written to %s\n",
+             shm_state.num_entries(), shm_state_path.c_str());
+}
+
+// Get power on hours from ATA attribute 9, same heuristics as smartctl.
+static uint64_t get_ata_power_on_hours(uint64_t rawval, ata_attr_raw_format format)
+{
+  switch (format) {
+    case RAWFMT_RAW48: case RAWFMT_RAW64:
+    case RAWFMT_RAW16_OPT_RAW16: case RAWFMT_RAW24_OPT_RAW8: break;
+    case RAWFMT_SEC2HOUR: rawval /= 60*60; break;
+    case RAWFMT_MIN2HOUR: rawval /= 60; break;
+    case RAWFMT_HALFMIN2HOUR: rawval /= 2*60; break;
+    case RAWFMT_DEFAULT: case RAWFMT_MSEC24_HOUR32:
+      rawval &= 0xffffffffULL; break;
+    default: return shmstate_na;
+  }
+  if (rawval > 0x00ffffffULL)
+    return shmstate_na; // assume bogus value
+  return rawval;
+}
+
+// Publish state of a device after a successful check.
+static void update_shm_state(unsigned i, const dev_config & cfg, const dev_state & state)
+{
+  shmstate_entry e = shm_state.get(i);
+  e.check_count++;
+  e.check_time = time(nullptr);
+  e.health = (state.smart_health_status > 0 ? 1 : state.smart_health_status < 0 ? -1 : 0);
+  e.temperature = state.temperature;
+  e.temperature_min = state.tempmin; e.temperature_max = state.tempmax;
+  if (state.selftest_log_refreshed)
+    e.selftest_errors = state.selflogcount;
+
+  switch (e.protocol) {
+    case SHMSTATE_ATA:
+      if (state.ata_errorlog_refreshed)
+        e.error_log_entries = state.ataerrorcount;
+      if (state.ata_attr_refreshed) {
+        for (const auto & attr : state.smartval->vendor_attributes) {
+          uint64_t * pval;
+          switch (attr.id) {
+            case   5: pval = &e.reallocated_sectors; break;
+            case 197: pval = &e.pending_sectors; break;
+            case 198: pval = &e.offline_uncorrectable; break;
+            case   9:
+              e.power_on_hours = get_ata_power_on_hours(
+                ata_get_attr_raw_value(attr, cfg.attribute_defs),
+                cfg.attribute_defs[9].raw_format);
+              continue;
+            default: continue;
+          }
+          *pval = ata_get_attr_raw_value(attr, cfg.attribute_defs);
+        }
+      }
+      break;
+
+    case SHMSTATE_SCSI:
+      if (state.scsi_logs_refreshed) {
+        const auto & logs = *state.scsi_logs;
+        uint64_t uncorrected = 0; bool found = false;
+        for (const auto & ec : logs.error_counters) {
+          if (!ec.found)
+            continue;
+          uncorrected += ec.errCounter.counter[6]; found = true;
+        }
+        if (found)
+          e.media_errors = uncorrected;
+        if (logs.nonmedium_error.found && logs.nonmedium_error.nme.gotPC0)
+          e.error_log_entries = logs.nonmedium_error.nme.counterPC0;
+      }
+      break;
+
+    case SHMSTATE_NVME: {
+      const nvme_smart_log & sl = *state.nvme_smartval;
+      e.critical_warning = sl.critical_warning;
+      e.percentage_used = sl.percent_used;
+      e.available_spare = sl.avail_spare;
+      e.power_on_hours = uile128_clamp_to_uint64(sl.power_on_hours);
+      e.media_errors = uile128_clamp_to_uint64(sl.media_errors);
+      e.error_log_entries = uile128_clamp_to_uint64(sl.num_err_log_entries);
+      break;
+    }
+  }
+
+  shm_state.update(i, e);
+}
+
 // Write to the attrlog file
 static bool write_dev_attrlog(const char * path, const dev_state & state)
 {
@@ -1319,6 +1824,87 @@ void env_buffer::set(const char * name, const char * value)
 
 #define EBUFLEN 1024
 
+#ifdef HAVE_POSIX_API
+
+// Format warning email like smartd_warning.sh does.
+static std::string format_warning_mail(const dev_config & cfg, const char * failtype,
+                                       const char * message, const mailinfo & mail,
+                                       int nextdays, std::string & subject)
+{
+  char hostname[256] = "";
+  if (gethostname(hostname, sizeof(hostname) - 1) || !*hostname)
+    strcpy(hostname, "[Unknown]");
+  // Split FQDN
+  const char * dnsdomain = "[Empty]";
+  if (char * dot = strchr(hostname, '.')) {
+    *dot = 0;
+    if (dot[1])
+      dnsdomain = dot + 1;
+  }
+
+  subject = strprintf("SMART error (%s) detected on host: %s", failtype, hostname);
+
+  std::string body = strprintf(
+    "This message was generated by the smartd daemon running on:\n"
+    "\n"
+    "   host name:  %s\n"
+    "   DNS domain: %s\n"
+    "\n"
+    "The following warning/error was logged by the smartd daemon:\n"
+    "\n"
+    "%s\n"
+    "\n"
+    "Device info:\n"
+    "%s\n"
+    "\n"
+    "For details see host's SYSLOG.\n",
+    hostname, dnsdomain, message, cfg.dev_idinfo.c_str());
+
+  if (strcmp(failtype, "EmailTest")) {
+    body += "\nYou can also use the smartctl utility for further investigation.\n";
+    if (mail.logged) {
+      char dates[DATEANDEPOCHLEN];
+      dateandtimezoneepoch(dates, mail.firstsent);
+      body += strprintf("The original message about this issue was sent at %s\n", dates);
+    }
+    if (nextdays < 0)
+      body += "No additional messages about this problem will be sent.\n";
+    else if (nextdays == 0)
+      body += "Another message will be sent upon next check if the problem persists.\n";
+    else if (nextdays == 1)
+      body += "Another message will be sent in 24 hours if the problem persists.\n";
+    else
+      body += strprintf("Another message will be sent in %d days if the problem persists.\n",
+                        nextdays);
+  }
+  return body;
+}
+
+// Send queued warning emails if due or if FORCE is set.
+static void flush_smtp_relay(bool force)
+{
+  if (!smtp_relay.is_open())
+    return;
+  time_t flushtime = smtp_relay.get_flush_time();
+  if (!flushtime)
+    return;
+  time_t now = time(nullptr);
+  if (force || flushtime <= now)
+    smtp_relay.flush(now);
+}
+
+// Try to send all queued warning emails before exit.
+static void close_smtp_relay()
+{
+  flush_smtp_relay(true);
+  unsigned cnt = smtp_relay.get_queue_size();
+  if (cnt)
+    PrintOut(LOG_CRIT, "SMTP relay %s: %u warning email(s) not sent\n",
+             smtp_relay.get_relay(), cnt);
+}
+
+#endif // HAVE_POSIX_API
+
 static void MailWarning(const dev_config & cfg, dev_state & state, int which, const char *fmt, ...)
   SMARTMON_FORMAT_PRINTF(4, 5);
 
@@ -1344,7 +1930,9 @@ static void MailWarning(const dev_config & cfg, dev_state & state, int which, co
     "FailedOpenDevice",           // 9
     "CurrentPendingSector",       // 10
     "OfflineUncorrectableSector", // 11
-    "Temperature"                 // 12
+    "Temperature",                // 12
+    "MediaVerify",                // 13
+    "AttributeTrend"              // 14
   };
   SMARTMON_STATIC_ASSERT(sizeof(whichfail) == SMARTD_NMAIL * sizeof(whichfail[0]));
   
@@ -1407,6 +1995,22 @@ static void MailWarning(const dev_config & cfg, dev_state & state, int which, co
   std::string address = cfg.emailaddress;
   std::replace(address.begin(), address.end(), ',', ' ');
 
+#ifdef HAVE_POSIX_API
+  // Queue email for the SMTP relay unless '-M exec' or plugins ('@NAME') are used
+  if (   smtp_relay.is_open() && cfg.emailcmdline.empty() && !address.empty()
+      && (' ' + address).find(" @") == std::string::npos) {
+    std::string subject;
+    std::string body = format_warning_mail(cfg, whichfail[which], message, *mail,
+                                           nextdays, subject);
+    PrintOut(LOG_INFO, "%s SMTP relay %s to %s (queued)\n",
+             (which ? "Sending warning via" : "Sending test via"),
+             smtp_relay.get_relay(), address.c_str());
+    smtp_relay.queue(address, subject, body, now);
+    mail->logged++;
+    return;
+  }
+#endif
+
   // Export information in environment variables that will be useful
   // for user scripts
   const char * executable = cfg.emailcmdline.c_str();
@@ -1473,6 +2077,7 @@ static void MailWarning(const dev_config & cfg, dev_state & state, int which, co
 
 #ifdef HAVE_POSIX_API
   if (warn_as_user) {
+    event_loop::unblocked_signals unblock;
     pfp = popen_as_ugid(command, "r", warn_uid, warn_gid);
   } else
 #endif
@@ -1480,6 +2085,10 @@ static void MailWarning(const dev_config & cfg, dev_state & state, int which, co
 #ifdef _WIN32
     pfp = popen_as_restr_user(command, "r", warn_as_restr_user);
 #else
+#ifdef HAVE_POSIX_API
+    // Child should not inherit signals blocked by the event loop
+    event_loop::unblocked_signals unblock;
+#endif
     pfp = popen(command, "r");
 #endif
   }
@@ -1624,9 +2233,12 @@ static smartd_hook the_smartd_hook;
 
 SMARTMON_DIAGNOSTIC_FORMAT_NONLITERAL_IGNORE
 
-// Printing function for watching ataprint commands, or losing them
+// Printing function for watching ataprint commands, or losing them.
+// May be called from the media verification threads.
 void smartd_hook::lib_vprintf(const char * fmt, va_list ap)
 {
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
   // In debugmode==1 mode we will print the library debug output
   if (debugmode && debugmode != 2) {
     FILE * f = stdout;
@@ -1816,11 +2428,11 @@ static void Directives()
   PrintOut(LOG_INFO,
            "Configuration file (%s) Directives (after device name):\n"
            "  -d TYPE Set the device type: auto, ignore, removable,\n"
-           "          %s\n"
+           "          multipath[,failover|,roundrobin], %s\n"
            "  -T TYPE Set the tolerance to one of: normal, permissive\n"
            "  -o VAL  Enable/disable automatic offline tests (on/off)\n"
            "  -S VAL  Enable/disable attribute autosave (on/off)\n"
-           "  -n MODE No check if: never, sleep[,N][,q], standby[,N][,q], idle[,N][,q]\n"
+           "  -n MODE No check if: never, sleep[,N][,q][,w], standby[,N][,q][,w], idle[,N][,q][,w]\n"
            "  -H      Monitor SMART Health Status, report if failed\n"
            "  -H MASK Monitor specific NVMe Critical Warning bits\n"
            "  -s REG  Do Self-Test at time(s) given by regular expression REG\n"
@@ -1842,6 +2454,9 @@ static void Directives()
            "  -C ID[+] Monitor [increases of] Current Pending Sectors in Attribute ID\n"
            "  -U ID[+] Monitor [increases of] Offline Uncorrectable Sectors in Attribute ID\n"
            "  -W D,I,C Monitor Temperature D)ifference, I)nformal limit, C)ritical limit\n"
+           "  -V R[,S[,C]] Verify medium with max R MB/s for S seconds per check,\n"
+           "          C blocks per command\n"
+           "  -Y ID[!][,OPT=VAL] Report anomalies in rate of Attribute ID Raw value\n"
            "  -v N,ST Modifies labeling of Attribute N (see man page)  \n"
            "  -P TYPE Drive-specific presets: use, ignore, show, showall\n"
            "  -a      Default: -H -f -t -l error -l selftest -l selfteststs -C 197 -U 198\n"
@@ -1879,10 +2494,21 @@ static const char *GetValidArgList(char opt)
     return "ioctl[,N], ataioctl[,N], scsiioctl[,N], nvmeioctl[,N]";
   case 'p':
   case 'w':
+#ifndef _WIN32
+  case 'S':
+#endif
     return "<FILE_NAME>";
   case 'i':
     return "<INTEGER_SECONDS>";
+  case 'b':
+    return "[<CMDS_PER_SEC>][,ctrl=<CMDS_PER_SEC>][,max=<DEVICES>]";
 #ifdef HAVE_POSIX_API
+  case 'P':
+    return "http://<HOST>[:<PORT>][/<PATH>][,gzip][,queue=<N>][,retry=<SEC>]"
+           "[,maxretry=<SEC>][,timeout=<SEC>][,spool=<DIR>]";
+  case 'm':
+    return "<HOST>[:<PORT>], unix:<PATH>, followed by [,from=<ADDR>][,batch=<SEC>][,digest]"
+           "[,queue=<N>][,timeout=<SEC>]";
   case 'u':
     return "<USER>[:<GROUP>], -";
 #elif defined(_WIN32)
@@ -1922,6 +2548,17 @@ static void Usage()
   PrintOut(LOG_INFO,"        [default is " SMARTMONTOOLS_JSONSTATE "MODEL-SERIAL.TYPE.json]\n");
 #endif
   PrintOut(LOG_INFO,"\n");
+#ifndef _WIN32
+  PrintOut(LOG_INFO,"  -S FILE, --shmstate=FILE\n");
+  PrintOut(LOG_INFO,"        Publish state of all devices in memory mapped FILE\n\n");
+#endif
+#ifdef HAVE_POSIX_API
+  PrintOut(LOG_INFO,"  -P URL[,OPTION...], --push=URL[,OPTION...]\n");
+  PrintOut(LOG_INFO,"        Send JSON state of changed devices to HTTP collector URL\n\n");
+  PrintOut(LOG_INFO,"  -m RELAY[,OPTION...], --smtp=RELAY[,OPTION...]\n");
+  PrintOut(LOG_INFO,"        Send warning emails via SMTP to mail relay HOST[:PORT] or\n"
+                    "        unix:PATH instead of running the warning script\n\n");
+#endif
   PrintOut(LOG_INFO,"  -B [+]FILE, --drivedb=[+]FILE\n");
   PrintOut(LOG_INFO,"        Read and replace [add] drive database from FILE\n");
   PrintOut(LOG_INFO,"        [default is +%s", get_drivedb_path_add());
@@ -1930,6 +2567,9 @@ static void Usage()
   PrintOut(LOG_INFO,"         and then    %s", get_drivedb_path_default());
 #endif
   PrintOut(LOG_INFO,"]\n\n");
+  PrintOut(LOG_INFO,"  -b N[,ctrl=M][,max=K], --io-budget=N[,ctrl=M][,max=K]\n");
+  PrintOut(LOG_INFO,"        Limit commands to N per second [M per controller], stretch\n"
+                    "        check intervals if needed [at most K devices busy at a time]\n\n");
   PrintOut(LOG_INFO,"  -c NAME|-, --configfile=NAME|-\n");
   PrintOut(LOG_INFO,"        Read configuration file NAME or stdin\n");
   PrintOut(LOG_INFO,"        [default is %s]\n\n", configfile);
@@ -2170,7 +2810,7 @@ static bool check_pending_id(const dev_config & cfg, const dev_state & state,
                              unsigned char id, const char * msg)
 {
   // Check attribute index
-  int i = ata_find_attr_index(id, state.smartval);
+  int i = ata_find_attr_index(id, *state.smartval);
   if (i < 0) {
     PrintOut(LOG_INFO, "Device: %s, can't monitor %s count - no Attribute %d\n",
              cfg.name.c_str(), msg, id);
@@ -2178,7 +2818,7 @@ static bool check_pending_id(const dev_config & cfg, const dev_state & state,
   }
 
   // Check value
-  uint64_t rawval = ata_get_attr_raw_value(state.smartval.vendor_attributes[i],
+  uint64_t rawval = ata_get_attr_raw_value(state.smartval->vendor_attributes[i],
     cfg.attribute_defs);
   if (rawval >= (state.num_sectors ? state.num_sectors : 0xffffffffULL)) {
     PrintOut(LOG_INFO, "Device: %s, ignoring %s count - bogus Attribute %d value %" PRIu64 " (0x%" PRIx64 ")\n",
@@ -2223,6 +2863,17 @@ static void format_set_result_msg(std::string & msg, const char * name, bool ok,
     msg += ":on";
 }
 
+// Return true if CFG and PREV_CFG have the same unique identity
+static bool is_same_dev_idinfo(const dev_config & cfg, const dev_config & prev_cfg)
+{
+  if (!(cfg.id_is_unique && prev_cfg.id_is_unique))
+    return false;
+  return (    cfg.dev_idinfo == prev_cfg.dev_idinfo
+          // Also check identity without NSID if device does not support multiple namespaces
+          || (!cfg.dev_idinfo_bc.empty()      && cfg.dev_idinfo_bc == prev_cfg.dev_idinfo)
+          || (!prev_cfg.dev_idinfo_bc.empty() && cfg.dev_idinfo == prev_cfg.dev_idinfo_bc));
+}
+
 // Return true and print message if CFG.dev_idinfo is already in PREV_CFGS
 static bool is_duplicate_dev_idinfo(const dev_config & cfg, const dev_config_vector & prev_cfgs)
 {
@@ -2230,13 +2881,11 @@ static bool is_duplicate_dev_idinfo(const dev_config & cfg, const dev_config_vec
     return false;
 
   for (const auto & prev_cfg : prev_cfgs) {
-    if (!prev_cfg.id_is_unique)
-      continue;
-    if (!(    cfg.dev_idinfo == prev_cfg.dev_idinfo
-          // Also check identity without NSID if device does not support multiple namespaces
-          || (!cfg.dev_idinfo_bc.empty()      && cfg.dev_idinfo_bc == prev_cfg.dev_idinfo)
-          || (!prev_cfg.dev_idinfo_bc.empty() && cfg.dev_idinfo == prev_cfg.dev_idinfo_bc)))
+    if (!is_same_dev_idinfo(cfg, prev_cfg))
       continue;
+    // Additional path, grouped by register_devices()
+    if (cfg.multipath && prev_cfg.multipath)
+      return false;
 
     PrintOut(LOG_INFO, "Device: %s, same identity as %s, ignored\n",
              cfg.dev_name.c_str(), prev_cfg.dev_name.c_str());
@@ -2422,22 +3071,24 @@ static int ATADeviceScan(dev_config & cfg, dev_state & state, ata_device * atade
       || cfg.offlinests      || cfg.selfteststs
       || cfg.usagefailed     || cfg.prefail  || cfg.usage
       || cfg.tempdiff        || cfg.tempinfo || cfg.tempcrit
-      || cfg.curr_pending_id || cfg.offl_pending_id         ) {
+      || cfg.curr_pending_id || cfg.offl_pending_id
+      || !cfg.attr_trends.empty()                           ) {
 
-    if (ataReadSmartValues(atadev, &state.smartval)) {
+    if (ataReadSmartValues(atadev, &*state.smartval)) {
       PrintOut(LOG_INFO, "Device: %s, Read SMART Values failed\n", name);
       cfg.usagefailed = cfg.prefail = cfg.usage = false;
       cfg.tempdiff = cfg.tempinfo = cfg.tempcrit = 0;
       cfg.curr_pending_id = cfg.offl_pending_id = 0;
+      cfg.attr_trends.clear();
     }
     else {
       smart_val_ok = true;
-      if (ataReadSmartThresholds(atadev, &state.smartthres)) {
+      if (ataReadSmartThresholds(atadev, &*state.smartthres)) {
         PrintOut(LOG_INFO, "Device: %s, Read SMART Thresholds failed%s\n",
                  name, (cfg.usagefailed ? ", ignoring -f Directive" : ""));
         cfg.usagefailed = false;
         // Let ata_get_attr_state() return ATTRSTATE_NO_THRESHOLD:
-        memset(&state.smartthres, 0, sizeof(state.smartthres));
+        memset(&*state.smartthres, 0, sizeof(*state.smartthres));
       }
     }
 
@@ -2454,7 +3105,7 @@ static int ATADeviceScan(dev_config & cfg, dev_state & state, ata_device * atade
       cfg.offl_pending_id = 0;
 
     if (   (cfg.tempdiff || cfg.tempinfo || cfg.tempcrit)
-        && !ata_return_temperature_value(&state.smartval, cfg.attribute_defs)) {
+        && !ata_return_temperature_value(&*state.smartval, cfg.attribute_defs)) {
       PrintOut(LOG_INFO, "Device: %s, can't monitor Temperature, ignoring -W %d,%d,%d\n",
                name, cfg.tempdiff, cfg.tempinfo, cfg.tempcrit);
       cfg.tempdiff = cfg.tempinfo = cfg.tempcrit = 0;
@@ -2467,17 +3118,27 @@ static int ATADeviceScan(dev_config & cfg, dev_state & state, ata_device * atade
         const char * excl = (cfg.monitor_attr_flags.is_set(id,
           (opt == 'r' ? MONITOR_AS_CRIT : MONITOR_RAW_AS_CRIT)) ? "!" : "");
 
-        int idx = ata_find_attr_index(id, state.smartval);
+        int idx = ata_find_attr_index(id, *state.smartval);
         if (idx < 0)
           PrintOut(LOG_INFO,"Device: %s, no Attribute %d, ignoring -%c %d%s\n", name, id, opt, id, excl);
         else {
-          bool prefail = !!ATTRIBUTE_FLAGS_PREFAILURE(uile16_to_uint(state.smartval.vendor_attributes[idx].flags));
+          bool prefail = !!ATTRIBUTE_FLAGS_PREFAILURE(uile16_to_uint(state.smartval->vendor_attributes[idx].flags));
           if (!((prefail && cfg.prefail) || (!prefail && cfg.usage)))
             PrintOut(LOG_INFO,"Device: %s, not monitoring %s Attributes, ignoring -%c %d%s\n", name,
                      (prefail ? "Prefailure" : "Usage"), opt, id, excl);
         }
       }
     }
+
+    // Remove '-Y' directives for missing attributes
+    auto & trends = cfg.attr_trends;
+    trends.erase(std::remove_if(trends.begin(), trends.end(),
+      [&](const attribute_trend_config & tc) {
+        if (ata_find_attr_index(tc.id, *state.smartval) >= 0)
+          return false;
+        PrintOut(LOG_INFO, "Device: %s, no Attribute %d, ignoring -Y %d\n", name, tc.id, tc.id);
+        return true;
+      }), trends.end());
   }
   
   // enable/disable automatic on-line testing
@@ -2488,7 +3149,7 @@ static int ATADeviceScan(dev_config & cfg, dev_state & state, ata_device * atade
       PrintOut(LOG_INFO,"Device: %s, could not %s SMART Automatic Offline Testing.\n",name, what);
     else {
       // if command appears unsupported, issue a warning...
-      if (!isSupportAutomaticTimer(&state.smartval))
+      if (!isSupportAutomaticTimer(&*state.smartval))
         PrintOut(LOG_INFO,"Device: %s, SMART Automatic Offline Testing unsupported...\n",name);
       // ... but then try anyway
       if ((cfg.autoofflinetest==1)?ataDisableAutoOffline(atadev):ataEnableAutoOffline(atadev))
@@ -2520,7 +3181,7 @@ static int ATADeviceScan(dev_config & cfg, dev_state & state, ata_device * atade
     int errcnt = 0; unsigned hour = 0;
     if (!(   cfg.permissive
           || ( smart_logdir_ok && smart_logdir.entry[0x06-1].numsectors)
-          || (!smart_logdir_ok && smart_val_ok && isSmartTestLogCapable(&state.smartval, &drive)))) {
+          || (!smart_logdir_ok && smart_val_ok && isSmartTestLogCapable(&*state.smartval, &drive)))) {
       PrintOut(LOG_INFO, "Device: %s, no SMART Self-test Log, ignoring -l selftest (override with -T permissive)\n", name);
       cfg.selftest = false;
     }
@@ -2540,7 +3201,7 @@ static int ATADeviceScan(dev_config & cfg, dev_state & state, ata_device * atade
     int errcnt1;
     if (!(   cfg.permissive
           || ( smart_logdir_ok && smart_logdir.entry[0x01-1].numsectors)
-          || (!smart_logdir_ok && smart_val_ok && isSmartErrorLogCapable(&state.smartval, &drive)))) {
+          || (!smart_logdir_ok && smart_val_ok && isSmartErrorLogCapable(&*state.smartval, &drive)))) {
       PrintOut(LOG_INFO, "Device: %s, no SMART Error Log, ignoring -l error (override with -T permissive)\n", name);
       cfg.errorlog = false;
     }
@@ -2577,7 +3238,7 @@ static int ATADeviceScan(dev_config & cfg, dev_state & state, ata_device * atade
 
   // capability check: self-test and offline data collection status
   if (cfg.offlinests || cfg.selfteststs) {
-    if (!(cfg.permissive || (smart_val_ok && state.smartval.offline_data_collection_capability))) {
+    if (!(cfg.permissive || (smart_val_ok && state.smartval->offline_data_collection_capability))) {
       if (cfg.offlinests)
         PrintOut(LOG_INFO, "Device: %s, no SMART Offline Data Collection capability, ignoring -l offlinests (override with -T permissive)\n", name);
       if (cfg.selfteststs)
@@ -2689,13 +3350,13 @@ static int ATADeviceScan(dev_config & cfg, dev_state & state, ata_device * atade
     }
     if (!attrlog_path_prefix.empty())
       cfg.attrlog_file = strprintf("%s%s-%s.ata.csv", attrlog_path_prefix.c_str(), model, serial);
-    if (!json_state_path_prefix.empty()) {
+    if (!json_state_path_prefix.empty())
       cfg.json_state_file = strprintf("%s%s-%s.ata.json", json_state_path_prefix.c_str(), model, serial);
-      // SAT/USB bridges are both ATA and SCSI, match smartctl's get_protocol_info()
-      cfg.json_protocol = (atadev->is_scsi() ? "ATA+SCSI" : "ATA");
-      cfg.json_dev_type = 1;
-    }
   }
+  // Protocol info for JSON state file and '--push'.
+  // SAT/USB bridges are both ATA and SCSI, match smartctl's get_protocol_info()
+  cfg.json_protocol = (atadev->is_scsi() ? "ATA+SCSI" : "ATA");
+  cfg.json_dev_type = 1;
 
   finish_device_scan(cfg, state);
 
@@ -2819,9 +3480,16 @@ static int SCSIDeviceScan(dev_config & cfg, dev_state & state, scsi_device * scs
     else
       PrintOut(LOG_CRIT, "Device: %s, failed Test Unit Ready [err=%d]\n", device, err);
     CloseDevice(scsidev, device);
-    return 2; 
+    return 2;
   }
-  
+
+  // Fetch the supported commands once, optional commands not supported
+  // by the device are then no longer sent in each check cycle.
+  if (scsidev->is_spc4_or_higher() && !scsidev->checked_cmd_support()) {
+    if (!scsidev->query_cmd_support() && debugmode)
+      PrintOut(LOG_INFO, "Device: %s, REPORT SUPPORTED OPERATION CODES failed\n", device);
+  }
+
   // Badly-conforming USB storage devices may fail this check.
   // The response to the following IE mode page fetch (current and
   // changeable values) is carefully examined. It has been found
@@ -2948,6 +3616,9 @@ static int SCSIDeviceScan(dev_config & cfg, dev_state & state, scsi_device * scs
   // Make sure that init_standby_check() ignores SCSI devices
   cfg.offlinests_ns = cfg.selfteststs_ns = false;
 
+  // Mode pages are not read again, free the cache
+  scsidev->clear_mode_page_cache();
+
   // close file descriptor
   CloseDevice(scsidev, device);
 
@@ -2958,20 +3629,17 @@ static int SCSIDeviceScan(dev_config & cfg, dev_state & state, scsi_device * scs
     if (!state_path_prefix.empty()) {
       cfg.state_file = strprintf("%s%s-%s-%s.scsi.state", state_path_prefix.c_str(), vendor, model, serial);
       // Read previous state
-      if (read_dev_state(cfg.state_file.c_str(), state)) {
+      if (read_dev_state(cfg.state_file.c_str(), state))
         PrintOut(LOG_INFO, "Device: %s, state read from %s\n", device, cfg.state_file.c_str());
-        // Copy ATA attribute values to temp state
-        state.update_temp_state();
-      }
     }
     if (!attrlog_path_prefix.empty())
       cfg.attrlog_file = strprintf("%s%s-%s-%s.scsi.csv", attrlog_path_prefix.c_str(), vendor, model, serial);
-    if (!json_state_path_prefix.empty()) {
+    if (!json_state_path_prefix.empty())
       cfg.json_state_file = strprintf("%s%s-%s-%s.scsi.json", json_state_path_prefix.c_str(), vendor, model, serial);
-      cfg.json_protocol = "SCSI";
-      cfg.json_dev_type = 2;
-    }
   }
+  // Protocol info for JSON state file and '--push'
+  cfg.json_protocol = "SCSI";
+  cfg.json_dev_type = 2;
 
   finish_device_scan(cfg, state);
 
@@ -3101,7 +3769,7 @@ static int NVMeDeviceScan(dev_config & cfg, dev_state & state, nvme_device * nvm
 
   // Read SMART/Health log
   // TODO: Support per namespace SMART/Health log
-  nvme_smart_log & smart_log = state.nvme_smartval;
+  nvme_smart_log & smart_log = *state.nvme_smartval;
   if (!nvme_read_smart_log(nvmedev, nvme_broadcast_nsid, smart_log)) {
     PrintOut(LOG_INFO, "Device: %s, failed to read NVMe SMART/Health Information\n", name);
     CloseDevice(nvmedev, name);
@@ -3187,19 +3855,29 @@ static int NVMeDeviceScan(dev_config & cfg, dev_state & state, nvme_device * nvm
     }
     if (!attrlog_path_prefix.empty())
       cfg.attrlog_file = strprintf("%s%s-%s%s.nvme.csv", attrlog_path_prefix.c_str(), model, serial, nsstr);
-    if (!json_state_path_prefix.empty()) {
+    if (!json_state_path_prefix.empty())
       cfg.json_state_file = strprintf("%s%s-%s%s.nvme.json", json_state_path_prefix.c_str(), model, serial, nsstr);
-      cfg.json_protocol = "NVMe";
-      cfg.json_dev_type = 3;
-      cfg.json_nsid = nsid;
-    }
   }
+  // Protocol info for JSON state file and '--push'
+  cfg.json_protocol = "NVMe";
+  cfg.json_dev_type = 3;
+  cfg.json_nsid = nsid;
 
   finish_device_scan(cfg, state);
 
   return 0;
 }
 
+// Remember block I/O count of a device skipped due to standby mode
+// if '-n ...,w' is specified.  See check_powerwake().
+static void arm_powerwake(const dev_config & cfg, dev_state & state, smart_device * device)
+{
+  state.powerwake_armed = (cfg.powerwake && device->get_block_io_count(state.powerwake_io_count));
+  if (cfg.powerwake && !state.powerwake_armed && debugmode)
+    PrintOut(LOG_INFO, "Device: %s, block I/O statistics not available, ignoring '-n ...,w'\n",
+             cfg.name.c_str());
+}
+
 // Open device for next check, return false on error
 static bool open_device(const dev_config & cfg, dev_state & state, smart_device * device,
                         const char * type)
@@ -3227,6 +3905,7 @@ static bool open_device(const dev_config & cfg, dev_state & state, smart_device
           state.lastpowermodeskipped = -1;
         }
         state.powerskipcnt++;
+        arm_powerwake(cfg, state, device);
         return false;
       }
     }
@@ -3683,7 +4362,7 @@ static void check_pending(const dev_config & cfg, dev_state & state,
 {
   // Find attribute index
   int i = ata_find_attr_index(id, smartval);
-  if (!(i >= 0 && ata_find_attr_index(id, state.smartval) == i))
+  if (!(i >= 0 && ata_find_attr_index(id, *state.smartval) == i))
     return;
 
   // No report if no sectors pending.
@@ -3694,7 +4373,7 @@ static void check_pending(const dev_config & cfg, dev_state & state,
   }
 
   // If attribute is not reset, report only sector count increases.
-  uint64_t prev_rawval = ata_get_attr_raw_value(state.smartval.vendor_attributes[i], cfg.attribute_defs);
+  uint64_t prev_rawval = ata_get_attr_raw_value(state.smartval->vendor_attributes[i], cfg.attribute_defs);
   if (!(!increase_only || prev_rawval < rawval))
     return;
 
@@ -3806,9 +4485,9 @@ static void check_attribute(const dev_config & cfg, dev_state & state,
   // If requested, check for usage attributes that have failed.
   if (   cfg.usagefailed && attrstate == ATTRSTATE_FAILED_NOW
       && !cfg.monitor_attr_flags.is_set(attr.id, MONITOR_IGN_FAILUSE)) {
-    std::string attrname = ata_get_smart_attr_name(attr.id, cfg.attribute_defs, cfg.dev_rpm);
-    PrintOut(LOG_CRIT, "Device: %s, Failed SMART usage Attribute: %d %s.\n", cfg.name.c_str(), attr.id, attrname.c_str());
-    MailWarning(cfg, state, 2, "Device: %s, Failed SMART usage Attribute: %d %s.", cfg.name.c_str(), attr.id, attrname.c_str());
+    const char * attrname = ata_get_smart_attr_name(attr.id, cfg.attribute_defs, cfg.dev_rpm);
+    PrintOut(LOG_CRIT, "Device: %s, Failed SMART usage Attribute: %d %s.\n", cfg.name.c_str(), attr.id, attrname);
+    MailWarning(cfg, state, 2, "Device: %s, Failed SMART usage Attribute: %d %s.", cfg.name.c_str(), attr.id, attrname);
     state.must_write = true;
   }
 
@@ -3849,54 +4528,206 @@ static void check_attribute(const dev_config & cfg, dev_state & state,
     return;
 
   // Format value strings
-  std::string currstr, prevstr;
+  char currstr[80], prevstr[80];
   if (attrstate == ATTRSTATE_NO_NORMVAL) {
     // Print raw values only
-    currstr = strprintf("%s (Raw)",
-      ata_format_attr_raw_value(attr, cfg.attribute_defs).c_str());
-    prevstr = strprintf("%s (Raw)",
-      ata_format_attr_raw_value(prev, cfg.attribute_defs).c_str());
+    char rawstr[64];
+    snprintf(currstr, sizeof(currstr), "%s (Raw)",
+      ata_format_attr_raw_value(rawstr, attr, cfg.attribute_defs));
+    snprintf(prevstr, sizeof(prevstr), "%s (Raw)",
+      ata_format_attr_raw_value(rawstr, prev, cfg.attribute_defs));
   }
   else if (cfg.monitor_attr_flags.is_set(attr.id, MONITOR_RAW_PRINT)) {
     // Print normalized and raw values
-    currstr = strprintf("%d [Raw %s]", attr.current,
-      ata_format_attr_raw_value(attr, cfg.attribute_defs).c_str());
-    prevstr = strprintf("%d [Raw %s]", prev.current,
-      ata_format_attr_raw_value(prev, cfg.attribute_defs).c_str());
+    char rawstr[64];
+    snprintf(currstr, sizeof(currstr), "%d [Raw %s]", attr.current,
+      ata_format_attr_raw_value(rawstr, attr, cfg.attribute_defs));
+    snprintf(prevstr, sizeof(prevstr), "%d [Raw %s]", prev.current,
+      ata_format_attr_raw_value(rawstr, prev, cfg.attribute_defs));
   }
   else {
     // Print normalized values only
-    currstr = strprintf("%d", attr.current);
-    prevstr = strprintf("%d", prev.current);
+    snprintf(currstr, sizeof(currstr), "%d", attr.current);
+    snprintf(prevstr, sizeof(prevstr), "%d", prev.current);
   }
 
   // Format message
-  std::string msg = strprintf("Device: %s, SMART %s Attribute: %d %s changed from %s to %s",
-                              cfg.name.c_str(), (prefail ? "Prefailure" : "Usage"), attr.id,
-                              ata_get_smart_attr_name(attr.id, cfg.attribute_defs, cfg.dev_rpm).c_str(),
-                              prevstr.c_str(), currstr.c_str());
+  char msg[512];
+  snprintf(msg, sizeof(msg), "Device: %s, SMART %s Attribute: %d %s changed from %s to %s",
+           cfg.name.c_str(), (prefail ? "Prefailure" : "Usage"), attr.id,
+           ata_get_smart_attr_name(attr.id, cfg.attribute_defs, cfg.dev_rpm),
+           prevstr, currstr);
 
   // Report this change as critical ?
   if (   (valchanged && cfg.monitor_attr_flags.is_set(attr.id, MONITOR_AS_CRIT))
       || (rawchanged && cfg.monitor_attr_flags.is_set(attr.id, MONITOR_RAW_AS_CRIT))) {
-    PrintOut(LOG_CRIT, "%s\n", msg.c_str());
-    MailWarning(cfg, state, 2, "%s", msg.c_str());
+    PrintOut(LOG_CRIT, "%s\n", msg);
+    MailWarning(cfg, state, 2, "%s", msg);
   }
   else {
-    PrintOut(LOG_INFO, "%s\n", msg.c_str());
+    PrintOut(LOG_INFO, "%s\n", msg);
   }
   state.must_write = true;
 }
 
 
-static int ATACheckDevice(const dev_config & cfg, dev_state & state, ata_device * atadev,
-                          bool firstpass, bool allow_selftests)
+// Minimum time between two samples of '-Y' trend monitoring.
+// Checks in shorter intervals are combined into one sample.
+const time_t trend_min_interval = 5 * 60;
+// Number of samples before anomalies are reported.
+const unsigned trend_min_samples = 10;
+
+// Add a raw value to the '-Y' statistics of one attribute.
+// Return false if no new rate sample is available yet.
+static bool update_attribute_trend(const attribute_trend_config & tc,
+                                   persistent_dev_state::attribute_trend & t,
+                                   uint64_t raw, time_t now,
+                                   double & rate, bool & cusum_exceeded)
 {
-  // Reset per-cycle JSON freshness flags; only set when corresponding data is
-  // refreshed below. JSON output gates each subsection on these to avoid
-  // republishing values restored from the persistent .state file as fresh.
-  state.json_dirty = false;
-  state.ata_attr_refreshed = false;
+  cusum_exceeded = false;
+  if (!t.time || raw < t.raw || now < t.time) {
+    // First value, counter reset or clock change: restart statistics
+    unsigned char id = t.id, flags = (t.flags & TREND_RATE_ALARM);
+    t = persistent_dev_state::attribute_trend();
+    t.id = id; t.flags = flags;
+    t.raw = raw; t.time = now;
+    return false;
+  }
+  if (now - t.time < trend_min_interval)
+    return false;
+
+  rate = (double)(raw - t.raw) * (24 * 60 * 60) / (now - t.time);
+  t.raw = raw; t.time = now;
+
+  if (!t.samples) {
+    t.mean = rate; t.var = t.cusum = 0;
+  }
+  else {
+    if (tc.cusum_h > 0 && t.samples >= trend_min_samples) {
+      // Standard deviation is limited to avoid alarms on almost constant rates
+      double sd = sqrt(t.var), sd_min = std::max(0.1 * t.mean, 1.0);
+      t.cusum = std::max(0.0, t.cusum + (rate - t.mean) / std::max(sd, sd_min) - tc.cusum_k);
+      if (t.cusum > tc.cusum_h) {
+        cusum_exceeded = true;
+        t.cusum = 0;
+      }
+    }
+    // Exponentially weighted mean and variance
+    double a = tc.alpha / 100.0, diff = rate - t.mean, incr = a * diff;
+    t.mean += incr;
+    t.var = (1 - a) * (t.var + diff * incr);
+  }
+  if (t.samples < ~(uint32_t)0)
+    t.samples++;
+
+  // Rolling min/max of current and previous window
+  time_t wsec = tc.window * (24 * 60 * 60);
+  if (!t.window_start || now - t.window_start >= wsec) {
+    if (t.window_start && now - t.window_start < 2 * wsec) {
+      t.min[1] = t.min[0]; t.max[1] = t.max[0];
+      t.flags |= TREND_PREV_WINDOW;
+    }
+    else
+      t.flags &= ~TREND_PREV_WINDOW;
+    t.window_start = now;
+    t.min[0] = t.max[0] = rate;
+  }
+  else {
+    t.min[0] = std::min(t.min[0], rate);
+    t.max[0] = std::max(t.max[0], rate);
+  }
+  return true;
+}
+
+// Check '-Y' attribute trends.
+static void check_attribute_trends(const dev_config & cfg, dev_state & state,
+                                   const ata_smart_values & curval)
+{
+  // Remove statistics of attributes no longer monitored
+  auto & trends = state.attr_trends;
+  trends.erase(std::remove_if(trends.begin(), trends.end(),
+    [&cfg](const persistent_dev_state::attribute_trend & t) {
+      for (const auto & tc : cfg.attr_trends) {
+        if (tc.id == t.id)
+          return false;
+      }
+      return true;
+    }), trends.end());
+
+  time_t now = time(nullptr);
+  for (const auto & tc : cfg.attr_trends) {
+    int idx = ata_find_attr_index(tc.id, curval);
+    if (idx < 0)
+      continue;
+    uint64_t raw = ata_get_attr_raw_value(curval.vendor_attributes[idx], cfg.attribute_defs);
+    auto & t = state.get_attr_trend(tc.id);
+    time_t prev_time = t.time; uint64_t prev_raw = t.raw;
+    double rate = 0; bool cusum_exceeded = false;
+    bool sampled = update_attribute_trend(tc, t, raw, now, rate, cusum_exceeded);
+    // Statistics were restarted or a sample was added, both set time and raw value
+    if (t.time != prev_time || t.raw != prev_raw)
+      state.must_write = true;
+    if (!sampled)
+      continue;
+
+    const char * name = cfg.name.c_str();
+    const char * attrname = ata_get_smart_attr_name(tc.id, cfg.attribute_defs, cfg.dev_rpm);
+    bool prev = !!(t.flags & TREND_PREV_WINDOW);
+    double rmin = (prev ? std::min(t.min[0], t.min[1]) : t.min[0]);
+    double rmax = (prev ? std::max(t.max[0], t.max[1]) : t.max[0]);
+    if (debugmode)
+      PrintOut(LOG_INFO, "Device: %s, Attribute %d trend: rate %.2f/day, average %.2f/day, "
+               "stddev %.2f, CUSUM %.2f, range %.2f-%.2f/day, %u samples\n", name, tc.id,
+               rate, t.mean, sqrt(t.var), t.cusum, rmin, rmax, t.samples);
+    if (t.samples < trend_min_samples)
+      continue;
+
+    char msg[256];
+    if (cusum_exceeded) {
+      snprintf(msg, sizeof(msg), "Device: %s, SMART Attribute: %d %s Raw value increases "
+               "faster than usual: %.1f/day (average %.1f/day, range %.1f-%.1f/day)",
+               name, tc.id, attrname, rate, t.mean, rmin, rmax);
+      PrintOut((tc.as_crit ? LOG_CRIT : LOG_INFO), "%s\n", msg);
+      if (tc.as_crit)
+        MailWarning(cfg, state, 14, "%s", msg);
+      state.must_write = true;
+    }
+
+    if (!tc.max_rate)
+      continue;
+    if (t.mean > tc.max_rate) {
+      if (t.flags & TREND_RATE_ALARM)
+        continue;
+      snprintf(msg, sizeof(msg), "Device: %s, SMART Attribute: %d %s Raw value average rate "
+               "%.1f/day exceeds limit of %g/day", name, tc.id, attrname, t.mean, tc.max_rate);
+      PrintOut((tc.as_crit ? LOG_CRIT : LOG_INFO), "%s\n", msg);
+      if (tc.as_crit)
+        MailWarning(cfg, state, 14, "%s", msg);
+      t.flags |= TREND_RATE_ALARM;
+      state.must_write = true;
+    }
+    else if (t.flags & TREND_RATE_ALARM) {
+      if (state.maillog[14].logged)
+        reset_warning_mail(cfg, state, 14, "SMART Attribute: %d %s Raw value average rate "
+                           "%.1f/day dropped below %g/day", tc.id, attrname, t.mean, tc.max_rate);
+      else
+        PrintOut(LOG_INFO, "Device: %s, SMART Attribute: %d %s Raw value average rate "
+                 "%.1f/day dropped below %g/day\n", name, tc.id, attrname, t.mean, tc.max_rate);
+      t.flags &= ~TREND_RATE_ALARM;
+      state.must_write = true;
+    }
+  }
+}
+
+
+static int ATACheckDevice(const dev_config & cfg, dev_state & state, ata_device * atadev,
+                          bool firstpass, bool allow_selftests)
+{
+  // Reset per-cycle JSON freshness flags; only set when corresponding data is
+  // refreshed below. JSON output gates each subsection on these to avoid
+  // republishing values restored from the persistent .state file as fresh.
+  state.json_dirty = false;
+  state.ata_attr_refreshed = false;
   state.ata_errorlog_refreshed = false;
   state.selftest_log_refreshed = false;
   state.scsi_logs_refreshed = false;
@@ -3992,6 +4823,7 @@ static int ATACheckDevice(const dev_config & cfg, dev_state & state, ata_device
           state.lastpowermodeskipped = powermode;
         }
         state.powerskipcnt++;
+        arm_powerwake(cfg, state, atadev);
         return 0;
       }
       else {
@@ -4029,7 +4861,8 @@ static int ATACheckDevice(const dev_config & cfg, dev_state & state, ata_device
   if (   cfg.usagefailed || cfg.prefail || cfg.usage
       || cfg.curr_pending_id || cfg.offl_pending_id
       || cfg.tempdiff || cfg.tempinfo || cfg.tempcrit
-      || cfg.selftest ||  cfg.offlinests || cfg.selfteststs) {
+      || cfg.selftest ||  cfg.offlinests || cfg.selfteststs
+      || !cfg.attr_trends.empty()) {
 
     // Read current attribute values.
     ata_smart_values curval;
@@ -4061,15 +4894,19 @@ static int ATACheckDevice(const dev_config & cfg, dev_state & state, ata_device
         for (int i = 0; i < NUMBER_ATA_SMART_ATTRIBUTES; i++) {
           check_attribute(cfg, state,
                           curval.vendor_attributes[i],
-                          state.smartval.vendor_attributes[i],
-                          i, state.smartthres.thres_entries);
+                          state.smartval->vendor_attributes[i],
+                          i, state.smartthres->thres_entries);
         }
       }
 
+      // update trend statistics
+      if (!cfg.attr_trends.empty())
+        check_attribute_trends(cfg, state, curval);
+
       // Log changes of offline data collection status
       if (cfg.offlinests) {
         if (   curval.offline_data_collection_status
-                != state.smartval.offline_data_collection_status
+                != state.smartval->offline_data_collection_status
             || state.offline_started // test was started in previous call
             || (firstpass && (debugmode || (curval.offline_data_collection_status & 0x7d))))
           log_offline_data_coll_status(name, curval.offline_data_collection_status);
@@ -4077,14 +4914,14 @@ static int ATACheckDevice(const dev_config & cfg, dev_state & state, ata_device
 
       // Log changes of self-test execution status
       if (cfg.selfteststs) {
-        if (   curval.self_test_exec_status != state.smartval.self_test_exec_status
+        if (   curval.self_test_exec_status != state.smartval->self_test_exec_status
             || state.selftest_started // test was started in previous call
             || (firstpass && (debugmode || (curval.self_test_exec_status & 0xf0))))
           log_self_test_exec_status(name, curval.self_test_exec_status);
       }
 
       // Save the new values for the next time around
-      state.smartval = curval;
+      *state.smartval = curval;
       state.update_persistent_state();
       state.attrlog_valid = 1; // ATA attributes valid
       state.ata_attr_refreshed = true;
@@ -4217,40 +5054,40 @@ static int SCSICheckDevice(const dev_config & cfg, dev_state & state, scsi_devic
   }
 
   if (!cfg.attrlog_file.empty()){
-    state.scsi_error_counters[0] = {};
-    state.scsi_error_counters[1] = {};
-    state.scsi_error_counters[2] = {};
-    state.scsi_nonmedium_error = {};
+    state.scsi_logs->error_counters[0] = {};
+    state.scsi_logs->error_counters[1] = {};
+    state.scsi_logs->error_counters[2] = {};
+    state.scsi_logs->nonmedium_error = {};
     bool found = false;
 
     // saving error counters to state
     uint8_t tBuf[252];
     if (state.ReadECounterPageSupported && (0 == scsiLogSense(scsidev,
       READ_ERROR_COUNTER_LPAGE, 0, tBuf, sizeof(tBuf), 0))) {
-      scsiDecodeErrCounterPage(tBuf, &state.scsi_error_counters[0].errCounter,
+      scsiDecodeErrCounterPage(tBuf, &state.scsi_logs->error_counters[0].errCounter,
                                scsiLogRespLen);
-      state.scsi_error_counters[0].found=1;
+      state.scsi_logs->error_counters[0].found=1;
       found = true;
     }
     if (state.WriteECounterPageSupported && (0 == scsiLogSense(scsidev,
       WRITE_ERROR_COUNTER_LPAGE, 0, tBuf, sizeof(tBuf), 0))) {
-      scsiDecodeErrCounterPage(tBuf, &state.scsi_error_counters[1].errCounter,
+      scsiDecodeErrCounterPage(tBuf, &state.scsi_logs->error_counters[1].errCounter,
                                scsiLogRespLen);
-      state.scsi_error_counters[1].found=1;
+      state.scsi_logs->error_counters[1].found=1;
       found = true;
     }
     if (state.VerifyECounterPageSupported && (0 == scsiLogSense(scsidev,
       VERIFY_ERROR_COUNTER_LPAGE, 0, tBuf, sizeof(tBuf), 0))) {
-      scsiDecodeErrCounterPage(tBuf, &state.scsi_error_counters[2].errCounter,
+      scsiDecodeErrCounterPage(tBuf, &state.scsi_logs->error_counters[2].errCounter,
                                scsiLogRespLen);
-      state.scsi_error_counters[2].found=1;
+      state.scsi_logs->error_counters[2].found=1;
       found = true;
     }
     if (state.NonMediumErrorPageSupported && (0 == scsiLogSense(scsidev,
       NON_MEDIUM_ERROR_LPAGE, 0, tBuf, sizeof(tBuf), 0))) {
-      scsiDecodeNonMediumErrPage(tBuf, &state.scsi_nonmedium_error.nme,
+      scsiDecodeNonMediumErrPage(tBuf, &state.scsi_logs->nonmedium_error.nme,
                                  scsiLogRespLen);
-      state.scsi_nonmedium_error.found=1;
+      state.scsi_logs->nonmedium_error.found=1;
       found = true;
     }
     // store temperature if not done by CheckTemperature() above
@@ -4443,10 +5280,19 @@ static int NVMeCheckDevice(const dev_config & cfg, dev_state & state, nvme_devic
 
   const char * name = cfg.name.c_str();
 
-  // Read SMART/Health log
+  // Read SMART/Health log and, if always needed, the self-test log.
+  // The commands are submitted concurrently if supported.
   // TODO: Support per namespace SMART/Health log
   nvme_smart_log smart_log;
-  if (!nvme_read_smart_log(nvmedev, nvme_broadcast_nsid, smart_log)) {
+  nvme_self_test_log self_test_log{};
+  nvme_log_page_req logs[2];
+  logs[0].nsid = nvme_broadcast_nsid; logs[0].lid = 0x02;
+  logs[0].data = &smart_log; logs[0].size = sizeof(smart_log);
+  logs[1].nsid = nvme_broadcast_nsid; logs[1].lid = 0x06;
+  logs[1].data = &self_test_log; logs[1].size = sizeof(self_test_log);
+  bool self_test_log_read = (cfg.selftest || cfg.selfteststs);
+  nvme_read_log_pages(nvmedev, logs, (self_test_log_read ? 2 : 1));
+  if (!logs[0].ok) {
       CloseDevice(nvmedev, name);
       PrintOut(LOG_INFO, "Device: %s, failed to read NVMe SMART/Health Information\n", name);
       MailWarning(cfg, state, 6, "Device: %s, failed to read NVMe SMART/Health Information", name);
@@ -4492,17 +5338,17 @@ static int NVMeCheckDevice(const dev_config & cfg, dev_state & state, nvme_devic
   // Names similar to smartctl plaintext output
   if (cfg.prefail) {
     log_nvme_smart_change(cfg, state, "Available Spare",
-      state.nvme_smartval.avail_spare, smart_log.avail_spare,
+      state.nvme_smartval->avail_spare, smart_log.avail_spare,
       (   smart_log.avail_spare < smart_log.spare_thresh
        && smart_log.spare_thresh <= 100 /* 101-255: "reserved" */));
   }
 
   if (cfg.usage || cfg.usagefailed) {
     log_nvme_smart_change(cfg, state, "Percentage Used",
-      state.nvme_smartval.percent_used, smart_log.percent_used,
+      state.nvme_smartval->percent_used, smart_log.percent_used,
       (cfg.usagefailed && smart_log.percent_used > 95), cfg.usage);
 
-    uint64_t old_me = uile128_clamp_to_uint64(state.nvme_smartval.media_errors);
+    uint64_t old_me = uile128_clamp_to_uint64(state.nvme_smartval->media_errors);
     uint64_t new_me = uile128_clamp_to_uint64(smart_log.media_errors);
     log_nvme_smart_change(cfg, state, "Media and Data Integrity Errors",
       old_me, new_me, (cfg.usagefailed && new_me > old_me), cfg.usage);
@@ -4524,14 +5370,15 @@ static int NVMeCheckDevice(const dev_config & cfg, dev_state & state, nvme_devic
   char testtype = (allow_selftests && !cfg.test_regex.empty()
                    ? next_scheduled_test(cfg, state) : 0);
 
-  // Read the self-test log if required
-  nvme_self_test_log self_test_log{};
-  if (testtype || cfg.selftest || cfg.selfteststs) {
-    if (!nvme_read_self_test_log(nvmedev, nvme_broadcast_nsid, self_test_log)) {
+  // Read the self-test log if required and not already read above
+  if (testtype || self_test_log_read) {
+    if (!self_test_log_read)
+      nvme_read_log_pages(nvmedev, logs + 1, 1);
+    if (!logs[1].ok) {
       PrintOut(LOG_CRIT, "Device: %s, Read Self-test Log failed: %s\n",
-               name, nvmedev->get_errmsg());
+               name, logs[1].errmsg.c_str());
       MailWarning(cfg, state, 8, "Device: %s, Read Self-test Log failed: %s\n",
-                  name, nvmedev->get_errmsg());
+                  name, logs[1].errmsg.c_str());
       testtype = 0;
     }
     else {
@@ -4568,7 +5415,7 @@ static int NVMeCheckDevice(const dev_config & cfg, dev_state & state, nvme_devic
   CloseDevice(nvmedev, name);
 
   // Preserve new SMART/Health info for state file and attribute log
-  state.nvme_smartval = smart_log;
+  *state.nvme_smartval = smart_log;
   state.attrlog_valid = 3; // NVMe attributes valid
   state.json_dirty = true;
   return 0;
@@ -4617,10 +5464,10 @@ static void do_disable_standby_check(const dev_config_vector & configs, const de
 
     if (   (   cfg.offlinests_ns
             && (state.offline_started ||
-                is_offl_coll_in_progress(state.smartval.offline_data_collection_status)))
+                is_offl_coll_in_progress(state.smartval->offline_data_collection_status)))
         || (   cfg.selfteststs_ns
             && (state.selftest_started ||
-                is_self_test_in_progress(state.smartval.self_test_exec_status)))         )
+                is_self_test_in_progress(state.smartval->self_test_exec_status)))         )
       running = true;
     // state.offline/selftest_started will be reset after next logging of test status
   }
@@ -4651,21 +5498,294 @@ static void do_disable_standby_check(const dev_config_vector & configs, const de
   }
 }
 
+// Result of one media verification slice, see VerifyDevicesOnce()
+struct media_verify_job
+{
+  unsigned index{};                       // Index into configs, states, devices
+  uint64_t start_lba{};                   // First LBA of this slice
+  unsigned max_seconds{};                 // Time limit of this slice
+  uint64_t num_blocks{};                  // Capacity, 0 if init failed
+  bool opened{};                          // Device open succeeded
+  bool ok{};                              // No device error
+  uint64_t num_cmds{};                    // Commands issued, for '--io-budget'
+  std::string errmsg;
+  media_verify_result result;
+};
+
+// Run one media verification slice on an open device.  Called in a
+// separate thread for each device, must not modify global state.
+// Library debug output is disabled, see VerifyDevicesOnce().
+static void run_media_verify_job(const dev_config & cfg, smart_device * device,
+                                 media_verify_job & job)
+{
+  uint64_t num_cmds = device->get_num_commands();
+  if (!device->open()) {
+    job.errmsg = device->get_errmsg();
+    return;
+  }
+  job.opened = true;
+
+  media_verifier verifier(device);
+  if (verifier.init()) {
+    job.num_blocks = verifier.get_num_blocks();
+    if (job.start_lba >= job.num_blocks)
+      job.start_lba = 0; // Capacity has changed
+    media_verify_options opts;
+    opts.chunk_blocks = cfg.verify_chunk;
+    opts.rate_mbps = cfg.verify_rate;
+    opts.max_seconds = job.max_seconds;
+    job.ok = verifier.run(job.start_lba, opts, job.result);
+  }
+  if (!job.ok)
+    job.errmsg = device->get_errmsg();
+  device->close();
+  job.num_cmds = device->get_num_commands() - num_cmds;
+}
+
+// Return path I of multipath device DEV, 0 = preferred path
+static smart_device * get_mpath(const dev_state & state, smart_device * dev, unsigned i)
+{
+  return (!i ? dev : state.mpath_alt.at(i - 1));
+}
+
+// Check a path of a multipath device, return false on error.
+// SCSI sense data (e.g. NOT READY) is ignored as it is reported
+// by the device regardless of the path.
+static bool probe_mpath(smart_device * dev)
+{
+  if (!dev->open())
+    return false;
+  bool ok = true;
+  if (scsi_device * scsidev = dev->to_scsi())
+    ok = (scsiTestUnitReady(scsidev) >= 0);
+  smart_device::error_info err = dev->get_err();
+  dev->close();
+  if (!ok)
+    dev->set_err(err);
+  return ok;
+}
+
+// Probe all paths of a multipath device and select the path for the
+// next check: The first working path in configuration order ('failover')
+// or the first working path following the previous one ('roundrobin').
+// Return preferred path if all paths fail, the check then reports the error.
+static smart_device * select_mpath(const dev_config & cfg, dev_state & state,
+                                   smart_device * dev)
+{
+  const char * name = cfg.name.c_str();
+  unsigned n = state.mpath_alt.size() + 1;
+  unsigned first = 0;
+  if (cfg.multipath == 2) {
+    first = state.mpath_next % n;
+    state.mpath_next = (first + 1) % n;
+  }
+
+  smart_device * selected = nullptr;
+  unsigned selected_i = 0;
+  for (unsigned j = 0; j < n; j++) {
+    unsigned i = (first + j) % n;
+    smart_device * path = get_mpath(state, dev, i);
+    uint32_t mask = 1U << i;
+    if (!probe_mpath(path)) {
+      if (!(state.mpath_failed & mask)) {
+        PrintOut(LOG_CRIT, "Device: %s, path %s failed: %s\n", name,
+                 path->get_info_name(), path->get_errmsg());
+        state.mpath_failed |= mask;
+      }
+      continue;
+    }
+    if (state.mpath_failed & mask) {
+      PrintOut(LOG_INFO, "Device: %s, path %s works again\n", name, path->get_info_name());
+      state.mpath_failed &= ~mask;
+    }
+    if (!selected) {
+      selected = path;
+      selected_i = i;
+    }
+  }
+
+  if (!selected)
+    selected_i = 0, selected = dev;
+  if (selected_i != state.mpath_active && (cfg.multipath != 2 || debugmode))
+    PrintOut(LOG_INFO, "Device: %s, using path %s\n", name, selected->get_info_name());
+  state.mpath_active = selected_i;
+  return selected;
+}
+
+static time_t calc_next_wakeuptime(time_t wakeuptime, time_t timenow, int ct)
+{
+  if (timenow < wakeuptime)
+    return wakeuptime;
+  return timenow + ct - (timenow - wakeuptime) % ct;
+}
+
+// Return the time of the next check of any device, 0 if unknown.
+// WAKEUPTIME is the time of the current check cycle if the same check
+// interval is used for all devices.
+static time_t get_next_wakeuptime(time_t wakeuptime, const dev_sched_vector & scheds,
+                                  time_t timenow)
+{
+  if (!checktime_min)
+    return (wakeuptime ? calc_next_wakeuptime(wakeuptime, timenow, checktime) : 0);
+  time_t next = 0;
+  for (const auto & sched : scheds) {
+    time_t t = (sched.skip ? sched.wakeuptime
+                : calc_next_wakeuptime((sched.wakeuptime ? sched.wakeuptime : timenow),
+                                       timenow, sched.checktime));
+    if (t && (!next || t < next))
+      next = t;
+  }
+  return next;
+}
+
+// Run media verification slices of all devices with '-V' directive
+// concurrently, then report the results.  The slices end before the next
+// device check is due, the main loop (signals, '--push', '--smtp') is
+// blocked meanwhile.
+static void VerifyDevicesOnce(const dev_config_vector & configs, dev_state_vector & states,
+                              const dev_sched_vector & scheds, smart_device_list & devices,
+                              time_t wakeuptime, std::vector<uint64_t> & num_cmds)
+{
+  time_t now = time(nullptr);
+  time_t next = get_next_wakeuptime(wakeuptime, scheds, now);
+  // At least one second to make progress if a check is already due
+  unsigned max_seconds = (!next ? 0 : next > now + 1 ? (unsigned)(next - now - 1) : 1);
+
+  std::vector<media_verify_job> jobs;
+  for (unsigned i = 0; i < configs.size(); i++) {
+    const dev_config & cfg = configs.at(i);
+    const dev_state & state = states.at(i);
+    // Do not wake up devices in standby or access removed devices
+    if (!cfg.verify_rate || state.media_verify_unsup || scheds.at(i).skip
+        || state.powerskipcnt || state.removed)
+      continue;
+    media_verify_job job;
+    job.index = i;
+    job.start_lba = state.media_verify_next_lba;
+    job.max_seconds = cfg.verify_slice;
+    if (max_seconds && job.max_seconds > max_seconds)
+      job.max_seconds = max_seconds;
+    jobs.push_back(job);
+  }
+  if (jobs.empty())
+    return;
+
+  // '--io-budget=...,max=N': run at most N slices at the same time,
+  // the available time is split between the rounds
+  unsigned num_jobs = jobs.size(), num_threads = num_jobs;
+  if (io_budget_max_busy && num_threads > io_budget_max_busy) {
+    num_threads = io_budget_max_busy;
+    unsigned rounds = (num_jobs + num_threads - 1) / num_threads;
+    for (auto & job : jobs)
+      job.max_seconds = std::max(job.max_seconds / rounds, 1U);
+  }
+
+  if (debugmode)
+    PrintOut(LOG_INFO, "Media verification of %u device(s) started, %u at a time, "
+             "up to %u seconds\n", num_jobs, num_threads, jobs.front().max_seconds);
+  // Debug output of the library functions would be interleaved
+  unsigned char save_ata_debugmode = ata_debugmode, save_scsi_debugmode = scsi_debugmode,
+                save_nvme_debugmode = nvme_debugmode;
+  ata_debugmode = scsi_debugmode = nvme_debugmode = 0;
+  std::vector<smart_device *> job_devs;
+  for (const auto & job : jobs)
+    job_devs.push_back(get_mpath(states.at(job.index), devices.at(job.index),
+                                 states.at(job.index).mpath_active));
+  std::atomic<unsigned> next_job{0};
+  auto run_jobs = [&configs, &jobs, &job_devs, &next_job, num_jobs]() {
+    for (unsigned j; (j = next_job++) < num_jobs; )
+      run_media_verify_job(configs.at(jobs[j].index), job_devs[j], jobs[j]);
+  };
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < num_threads; i++)
+    threads.emplace_back(run_jobs);
+  for (auto & t : threads)
+    t.join();
+  ata_debugmode = save_ata_debugmode; scsi_debugmode = save_scsi_debugmode;
+  nvme_debugmode = save_nvme_debugmode;
+
+  for (const auto & job : jobs) {
+    const dev_config & cfg = configs.at(job.index);
+    dev_state & state = states.at(job.index);
+    const char * name = cfg.name.c_str();
+    const media_verify_result & r = job.result;
+    num_cmds.at(job.index) += job.num_cmds;
+
+    if (!job.opened) {
+      PrintOut(LOG_INFO, "Device: %s, media verification skipped, open() failed: %s\n",
+               name, job.errmsg.c_str());
+      continue;
+    }
+    if (!job.num_blocks) {
+      PrintOut(LOG_INFO, "Device: %s, media verification not possible, ignoring -V: %s\n",
+               name, job.errmsg.c_str());
+      state.media_verify_unsup = true;
+      continue;
+    }
+
+    for (const auto & range : r.ranges) {
+      if (range.failed)
+        PrintOut(LOG_CRIT, "Device: %s, media verification failed at LBA %" PRIu64 "-%" PRIu64 "\n",
+                 name, range.lba, range.lba + range.num_blocks - 1);
+      else
+        PrintOut(LOG_INFO, "Device: %s, media verification slow (%u ms) at LBA %" PRIu64 "-%" PRIu64 "\n",
+                 name, range.msec, range.lba, range.lba + range.num_blocks - 1);
+    }
+    uint64_t failed_blocks = 0;
+    for (const auto & range : r.ranges) {
+      if (range.failed)
+        failed_blocks += range.num_blocks;
+    }
+    if (failed_blocks) {
+      state.media_verify_failed_blocks += failed_blocks;
+      MailWarning(cfg, state, 13, "Device: %s, %" PRIu64 " unreadable block(s) found by media verification",
+                  name, failed_blocks);
+    }
+    if (!job.ok)
+      PrintOut(LOG_INFO, "Device: %s, media verification stopped at LBA %" PRIu64 ": %s\n",
+               name, r.next_lba, job.errmsg.c_str());
+    else if (debugmode)
+      PrintOut(LOG_INFO, "Device: %s, media verification of LBA %" PRIu64 "-%" PRIu64
+               " (%.1f%%) took %.1f seconds\n", name, job.start_lba, r.next_lba - 1,
+               100.0 * r.next_lba / job.num_blocks, r.usec / 1000000.0);
+
+    if (r.complete) {
+      state.media_verify_passes++;
+      state.media_verify_next_lba = 0;
+      PrintOut(LOG_INFO, "Device: %s, media verification pass %" PRIu64 " completed, "
+               "%" PRIu64 " failed block(s) total\n", name, state.media_verify_passes,
+               state.media_verify_failed_blocks);
+    }
+    else
+      state.media_verify_next_lba = r.next_lba;
+    state.must_write = true;
+  }
+}
+
 // Checks the SMART status of all ATA and SCSI devices
 static void CheckDevicesOnce(const dev_config_vector & configs, dev_state_vector & states,
-                             smart_device_list & devices, bool firstpass, bool allow_selftests)
+                             dev_sched_vector & scheds, smart_device_list & devices,
+                             bool firstpass, bool allow_selftests, time_t wakeuptime)
 {
+  // Commands of each device for '--io-budget'
+  std::vector<uint64_t> num_cmds(configs.size());
+
   for (unsigned i = 0; i < configs.size(); i++) {
     const dev_config & cfg = configs.at(i);
-    dev_state & state = states.at(i);
-    if (state.skip) {
+    if (scheds.at(i).skip) {
       if (debugmode)
         PrintOut(LOG_INFO, "Device: %s, skipped (interval=%d)\n", cfg.name.c_str(),
-                 (cfg.checktime ? cfg.checktime : checktime));
+                 scheds.at(i).checktime);
       continue;
     }
 
+    dev_state & state = states.at(i);
+
     smart_device * dev = devices.at(i);
+    if (!state.mpath_alt.empty())
+      dev = select_mpath(cfg, state, dev);
+    uint64_t start_cmds = dev->get_num_commands();
+    state.powerwake_armed = false;
     if (dev->is_ata())
       ATACheckDevice(cfg, state, dev->to_ata(), firstpass, allow_selftests);
     else if (dev->is_scsi())
@@ -4673,26 +5793,129 @@ static void CheckDevicesOnce(const dev_config_vector & configs, dev_state_vector
     else if (dev->is_nvme())
       NVMeCheckDevice(cfg, state, dev->to_nvme(), firstpass, allow_selftests);
 
+    num_cmds[i] = dev->get_num_commands() - start_cmds;
+
+    // Publish fresh data of this device
+    if (shm_state.is_open() && state.json_dirty)
+      update_shm_state(i, cfg, state);
+
     // Prevent systemd unit startup timeout when checking many devices on startup
     notify_extend_timeout();
   }
 
+  // Media verification is not started in first pass, like self-tests
+  if (allow_selftests)
+    VerifyDevicesOnce(configs, states, scheds, devices, wakeuptime, num_cmds);
+
+  // Average number of commands per check including media verification
+  for (unsigned i = 0; i < configs.size(); i++) {
+    dev_sched_state & sched = scheds.at(i);
+    if (sched.skip)
+      continue;
+    if (!sched.cmds_per_check)
+      sched.cmds_per_check = num_cmds[i];
+    else
+      sched.cmds_per_check += (num_cmds[i] - sched.cmds_per_check) / 4;
+  }
+
   do_disable_standby_check(configs, states);
 }
 
+// Adjust check intervals to the '--io-budget' limits.
+// The commands per second required at the configured intervals are
+// determined from the average number of commands per check.  If a limit
+// is exceeded, the intervals of the affected devices are stretched by the
+// same factor.  Devices with the same device name (e.g. '-d megaraid,N')
+// share a controller.  An interval is only changed if it differs by more
+// than 10% to avoid frequent rescheduling.
+static void update_io_budget(const dev_config_vector & configs, dev_sched_vector & scheds)
+{
+  unsigned n = scheds.size();
+  time_t now = time(nullptr);
+
+  // Stretch factors of controllers
+  std::vector<double> factors(n, 1.0);
+  if (io_budget_ctrl_rate > 0) {
+    std::map<std::string, double> ctrl_rates;
+    for (unsigned i = 0; i < n; i++)
+      ctrl_rates[configs[i].dev_name] += scheds[i].cmds_per_check / scheds[i].base_checktime;
+    for (unsigned i = 0; i < n; i++) {
+      double rate = ctrl_rates[configs[i].dev_name];
+      if (rate > io_budget_ctrl_rate)
+        factors[i] = rate / io_budget_ctrl_rate;
+    }
+  }
+
+  // Global stretch factor
+  double rate = 0, rate_base = 0;
+  for (unsigned i = 0; i < n; i++) {
+    rate_base += scheds[i].cmds_per_check / scheds[i].base_checktime;
+    rate += scheds[i].cmds_per_check / (scheds[i].base_checktime * factors[i]);
+  }
+  double factor = 1;
+  if (io_budget_rate > 0 && rate > io_budget_rate)
+    factor = rate / io_budget_rate;
+
+  bool changed = false;
+  for (unsigned i = 0; i < n; i++) {
+    dev_sched_state & sched = scheds[i];
+    double ct = ceil(sched.base_checktime * factors[i] * factor);
+    int newct = (ct < INT_MAX ? (int)ct : INT_MAX);
+    if (!(   abs(newct - sched.checktime) > sched.checktime / 10
+          || (newct == sched.base_checktime && sched.checktime != newct)))
+      continue;
+    PrintOut(LOG_INFO, "Device: %s, %.1f commands per check, check interval %s from %d to %d seconds"
+                       " (configured: %d)\n", configs[i].name.c_str(), sched.cmds_per_check,
+             (newct > sched.checktime ? "stretched" : "reduced"), sched.checktime, newct,
+             sched.base_checktime);
+    sched.checktime = newct;
+    // Keep next check within the new interval
+    if (sched.wakeuptime > now + newct)
+      sched.wakeuptime = now + newct;
+    changed = true;
+  }
+
+  checktime_min = 0; rate = 0;
+  for (const auto & sched : scheds) {
+    if (!checktime_min || checktime_min > sched.checktime)
+      checktime_min = sched.checktime;
+    rate += sched.cmds_per_check / sched.checktime;
+  }
+
+  if (changed)
+    PrintOut(LOG_INFO, "I/O budget: %.3f commands/s at configured intervals, %.3f commands/s"
+                       " at effective intervals\n", rate_base, rate);
+}
+
+// Set signal handler and also receive signal through event loop if open
+static void install_signal(int sig, signal_handler_type handler)
+{
+  set_signal(sig, handler);
+#ifdef HAVE_POSIX_API
+  if (evloop.is_open() && !evloop.add_signal(sig, handler))
+    PrintOut(LOG_CRIT, "Event loop: cannot add signal %d: %s\n", sig, strerror(errno));
+#endif
+}
+
 // Install all signal handlers
 static void install_signal_handlers()
 {
+#ifdef HAVE_POSIX_API
+  // Use epoll based event loop if supported, sleep() otherwise
+  if (!evloop.open() && errno != ENOSYS)
+    PrintOut(LOG_CRIT, "Event loop not available, using sleep(): %s\n", strerror(errno));
+#endif
+
   // normal and abnormal exit
-  set_signal(SIGTERM, sighandler);
-  set_signal(SIGQUIT, sighandler);
+  install_signal(SIGTERM, sighandler);
+  install_signal(SIGQUIT, sighandler);
   
   // in debug mode, <CONTROL-C> ==> HUP
-  set_signal(SIGINT, (debugmode ? HUPhandler : sighandler));
+  install_signal(SIGINT, (debugmode ? HUPhandler : sighandler));
   
   // Catch HUP and USR1
-  set_signal(SIGHUP, HUPhandler);
-  set_signal(SIGUSR1, USR1handler);
+  install_signal(SIGHUP, HUPhandler);
+  install_signal(SIGUSR1, USR1handler);
 #ifdef _WIN32
   set_signal(SIGUSR2, USR2handler);
 #endif
@@ -4724,19 +5947,51 @@ static void ToggleDebugMode()
 }
 #endif
 
-static time_t calc_next_wakeuptime(time_t wakeuptime, time_t timenow, int ct)
+// Interval of block I/O polling for '-n ...,w'
+static constexpr int powerwake_poll_sec = 30;
+
+// Return true if any device waits for block I/O ('-n ...,w').
+static bool any_powerwake_armed(const dev_state_vector & states)
 {
-  if (timenow < wakeuptime)
-    return wakeuptime;
-  return timenow + ct - (timenow - wakeuptime) % ct;
+  for (const auto & state : states) {
+    if (state.powerwake_armed)
+      return true;
+  }
+  return false;
+}
+
+// Check block I/O count of devices skipped due to standby mode ('-n ...,w').
+// If the count changed, the disk was spun up by other I/O.  The device is
+// then scheduled for immediate check to avoid a later spin-up.
+// Return true if any device is due.
+static bool check_powerwake(const dev_config_vector & configs, dev_state_vector & states,
+                            dev_sched_vector & scheds, smart_device_list & devices,
+                            time_t timenow)
+{
+  bool due = false;
+  for (unsigned i = 0; i < states.size(); i++) {
+    dev_state & state = states[i];
+    if (!state.powerwake_armed)
+      continue;
+    uint64_t count = 0;
+    if (!devices.at(i)->get_block_io_count(count) || count == state.powerwake_io_count)
+      continue;
+    PrintOut(LOG_INFO, "Device: %s, block I/O detected, checking while disk is active\n",
+             configs.at(i).name.c_str());
+    state.powerwake_armed = false;
+    scheds.at(i).wakeuptime = timenow;
+    due = true;
+  }
+  return due;
 }
 
 static time_t dosleep(time_t wakeuptime, const dev_config_vector & configs,
-  dev_state_vector & states, bool & sigwakeup)
+                      dev_state_vector & states, dev_sched_vector & scheds,
+                      smart_device_list & devices, bool & sigwakeup)
 {
   // If past wake-up-time, compute next wake-up-time
   time_t timenow = time(nullptr);
-  unsigned n = configs.size();
+  unsigned n = scheds.size();
   int ct;
   if (!checktime_min) {
     // Same for all devices
@@ -4746,14 +6001,12 @@ static time_t dosleep(time_t wakeuptime, const dev_config_vector & configs,
   else {
     // Determine wakeuptime of next device(s)
     wakeuptime = 0;
-    for (unsigned i = 0; i < n; i++) {
-      const dev_config & cfg = configs.at(i);
-      dev_state & state = states.at(i);
-      if (!state.skip)
-        state.wakeuptime = calc_next_wakeuptime((state.wakeuptime ? state.wakeuptime : timenow),
-          timenow, (cfg.checktime ? cfg.checktime : checktime));
-      if (!wakeuptime || state.wakeuptime < wakeuptime)
-        wakeuptime = state.wakeuptime;
+    for (auto & sched : scheds) {
+      if (!sched.skip)
+        sched.wakeuptime = calc_next_wakeuptime((sched.wakeuptime ? sched.wakeuptime : timenow),
+          timenow, sched.checktime);
+      if (!wakeuptime || sched.wakeuptime < wakeuptime)
+        wakeuptime = sched.wakeuptime;
     }
     ct = checktime_min;
   }
@@ -4768,13 +6021,41 @@ static time_t dosleep(time_t wakeuptime, const dev_config_vector & configs,
     if (wakeuptime > timenow + ct) {
       PrintOut(LOG_INFO, "System clock time adjusted to the past. Resetting next wakeup time.\n");
       wakeuptime = timenow + ct;
-      for (auto & state : states)
-        state.wakeuptime = 0;
+      for (auto & sched : scheds)
+        sched.wakeuptime = 0;
       no_skip = true;
     }
     
     // Exit sleep when time interval has expired or a signal is received
-    sleep(wakeuptime+addtime-timenow);
+    time_t sleepuntil = wakeuptime+addtime;
+    // Poll block I/O of devices in standby mode ('-n ...,w')
+    if (timenow + powerwake_poll_sec < sleepuntil && any_powerwake_armed(states))
+      sleepuntil = timenow + powerwake_poll_sec;
+#ifdef HAVE_POSIX_API
+    // Resend queued '--push' batches if due, wake up for next retry
+    if (pusher.is_open()) {
+      time_t retrytime = pusher.get_retry_time();
+      if (retrytime && retrytime <= timenow) {
+        pusher.retry(timenow);
+        retrytime = pusher.get_retry_time();
+      }
+      if (timenow < retrytime && retrytime < sleepuntil)
+        sleepuntil = retrytime;
+    }
+
+    // Send queued '--smtp' warning emails if due, wake up for next try
+    if (smtp_relay.is_open()) {
+      flush_smtp_relay(false);
+      time_t flushtime = smtp_relay.get_flush_time();
+      if (timenow < flushtime && flushtime < sleepuntil)
+        sleepuntil = flushtime;
+    }
+
+    if (evloop.is_open())
+      evloop.wait_until(sleepuntil);
+    else
+#endif
+    sleep(sleepuntil-timenow);
 
 #ifdef _WIN32
     // toggle debug mode?
@@ -4786,6 +6067,10 @@ static time_t dosleep(time_t wakeuptime, const dev_config_vector & configs,
 
     timenow = time(nullptr);
 
+    // Check now if a disk in standby mode was spun up by other I/O
+    if (checktime_min && check_powerwake(configs, states, scheds, devices, timenow))
+      break;
+
     // Actual sleep time too long?
     if (!addtime && timenow > wakeuptime+60) {
       if (debugmode)
@@ -4810,8 +6095,8 @@ static time_t dosleep(time_t wakeuptime, const dev_config_vector & configs,
 
   // Check which devices must be skipped in this cycle
   if (checktime_min) {
-    for (auto & state : states)
-      state.skip = (!no_skip && timenow < state.wakeuptime);
+    for (auto & sched : scheds)
+      sched.skip = (!no_skip && timenow < sched.wakeuptime);
   }
   
   // return adjusted wakeuptime
@@ -4823,7 +6108,7 @@ static void printoutvaliddirectiveargs(int priority, char d)
 {
   switch (d) {
   case 'n':
-    PrintOut(priority, "never[,N][,q], sleep[,N][,q], standby[,N][,q], idle[,N][,q]");
+    PrintOut(priority, "never[,N][,q][,w], sleep[,N][,q][,w], standby[,N][,q][,w], idle[,N][,q][,w]");
     break;
   case 's':
     PrintOut(priority, "valid_regular_expression");
@@ -4860,6 +6145,12 @@ static void printoutvaliddirectiveargs(int priority, char d)
   case 'c':
     PrintOut(priority, "i=N, interval=N");
     break;
+  case 'V':
+    PrintOut(priority, "RATE[,SECONDS[,CHUNK]]");
+    break;
+  case 'Y':
+    PrintOut(priority, "ID[!][,rate=N][,alpha=PCT][,k=N][,h=N][,window=DAYS]");
+    break;
   }
 }
 
@@ -5030,6 +6321,10 @@ static int ParseToken(char * & token, dev_config & cfg, smart_devtype_list & sca
       cfg.ignore = true;
     } else if (!strcmp(arg, "removable")) {
       cfg.removable = true;
+    } else if (!strcmp(arg, "multipath") || !strcmp(arg, "multipath,failover")) {
+      cfg.multipath = 1;
+    } else if (!strcmp(arg, "multipath,roundrobin")) {
+      cfg.multipath = 2;
     } else if (!strcmp(arg, "auto")) {
       cfg.dev_type = "";
       scan_types.clear();
@@ -5157,6 +6452,7 @@ static int ParseToken(char * & token, dev_config & cfg, smart_devtype_list & sca
       char *next = strchr(const_cast<char*>(arg), ',');
 
       cfg.powerquiet = false;
+      cfg.powerwake = false;
       cfg.powerskipmax = 0;
 
       if (next)
@@ -5183,12 +6479,16 @@ static int ParseToken(char * & token, dev_config & cfg, smart_devtype_list & sca
           if (cfg.powerskipmax <= 0)
             badarg = 1;
         }
-        if (*next != '\0') {
-          if (!strcmp("q", next))
+        // Optional flags 'q' and 'w'
+        while (!badarg && *next != '\0') {
+          if (next[0] == 'q' && (!next[1] || next[1] == ','))
             cfg.powerquiet = true;
-          else {
+          else if (next[0] == 'w' && (!next[1] || next[1] == ','))
+            cfg.powerwake = true;
+          else
+            badarg = 1;
+          if (*++next == ',' && !*++next)
             badarg = 1;
-          }
         }
       }
     }
@@ -5326,6 +6626,75 @@ static int ParseToken(char * & token, dev_config & cfg, smart_devtype_list & sca
                      &cfg.tempdiff, &cfg.tempinfo, &cfg.tempcrit) < 0)
       return -1;
     break;
+  case 'V':
+    // media verification: MB/s[,seconds per check[,blocks per command]]
+    if (!(arg = strtok(nullptr, delim))) {
+      missingarg = true;
+    }
+    else {
+      unsigned rate = 0, slice = 60, chunk = 0;
+      int n1 = -1, n2 = -1, n3 = -1, len = strlen(arg);
+      if (   sscanf(arg, "%u%n,%u%n,%u%n", &rate, &n1, &slice, &n2, &chunk, &n3) >= 1
+          && (n1 == len || n2 == len || n3 == len)
+          && 1 <= rate && rate <= 100000 && 1 <= slice && slice <= 86400
+          && chunk <= 0x10000) {
+        cfg.verify_rate = rate;
+        cfg.verify_slice = slice;
+        cfg.verify_chunk = chunk;
+      }
+      else
+        badarg = true;
+    }
+    break;
+  case 'Y':
+    // track rate of raw value: ID[!][,rate=N][,alpha=PCT][,k=N][,h=N][,window=DAYS]
+    if (!(arg = strtok(nullptr, delim))) {
+      missingarg = true;
+    }
+    else {
+      attribute_trend_config tc;
+      unsigned id = 0; int n = -1;
+      if (!(sscanf(arg, "%u%n", &id, &n) == 1 && n > 0 && 1 <= id && id <= 255))
+        badarg = true;
+      else {
+        const char * p = arg + n;
+        if (*p == '!') {
+          tc.as_crit = true;
+          p++;
+        }
+        while (*p) {
+          char optname[6+1] = ""; double v = 0; n = -1;
+          if (!(sscanf(p, ",%6[a-z]=%lf%n", optname, &v, &n) == 2 && n > 0 && v >= 0)) {
+            badarg = true;
+            break;
+          }
+          if (!strcmp(optname, "rate"))
+            tc.max_rate = v;
+          else if (!strcmp(optname, "alpha") && 1 <= v && v <= 100 && v == (unsigned)v)
+            tc.alpha = (unsigned)v;
+          else if (!strcmp(optname, "k"))
+            tc.cusum_k = v;
+          else if (!strcmp(optname, "h"))
+            tc.cusum_h = v;
+          else if (!strcmp(optname, "window") && 1 <= v && v <= 365 && v == (unsigned)v)
+            tc.window = (unsigned)v;
+          else {
+            badarg = true;
+            break;
+          }
+          p += n;
+        }
+        if (!badarg) {
+          tc.id = (unsigned char)id;
+          // Last directive for the same ID wins
+          auto & trends = cfg.attr_trends;
+          trends.erase(std::remove_if(trends.begin(), trends.end(),
+            [id](const attribute_trend_config & x) { return x.id == id; }), trends.end());
+          trends.push_back(tc);
+        }
+      }
+    }
+    break;
   case 'v':
     // non-default vendor-specific attribute meaning
     if (!(arg = strtok(nullptr, delim))) {
@@ -5760,10 +7129,16 @@ static int parse_options(int argc, char **argv)
 #endif
 
   // Please update GetValidArgList() if you edit shortopts
-  static const char shortopts[] = "c:l:q:dDni:j:p:r:s:A:B:w:Vh?"
+  static const char shortopts[] = "c:l:q:dDni:b:j:p:r:s:A:B:w:Vh?"
 #if defined(HAVE_POSIX_API) || defined(_WIN32)
                                                           "u:"
 #endif
+#ifndef _WIN32
+                                                          "S:"
+#endif
+#ifdef HAVE_POSIX_API
+                                                          "P:m:"
+#endif
 #ifdef HAVE_LIBCAP_NG
                                                           "C"
 #endif
@@ -5772,11 +7147,19 @@ static int parse_options(int argc, char **argv)
   struct option longopts[] = {
     { "configfile",     required_argument, 0, 'c' },
     { "jsonstate",      required_argument, 0, 'j' },
+#ifndef _WIN32
+    { "shmstate",       required_argument, 0, 'S' },
+#endif
+#ifdef HAVE_POSIX_API
+    { "push",           required_argument, 0, 'P' },
+    { "smtp",           required_argument, 0, 'm' },
+#endif
     { "logfacility",    required_argument, 0, 'l' },
     { "quit",           required_argument, 0, 'q' },
     { "debug",          no_argument,       0, 'd' },
     { "showdirectives", no_argument,       0, 'D' },
     { "interval",       required_argument, 0, 'i' },
+    { "io-budget",      required_argument, 0, 'b' },
 #ifndef _WIN32
     { "no-fork",        no_argument,       0, 'n' },
 #else
@@ -5902,6 +7285,42 @@ static int parse_options(int argc, char **argv)
       }
       checktime = (int)lchecktime;
       break;
+    case 'b':
+      // Limits of commands per second and busy devices: [N][,ctrl=M][,max=K]
+      {
+        double rate = 0, ctrl_rate = 0; unsigned max_busy = 0;
+        std::string arg = (isalpha((unsigned char)*optarg) ? "," : "");
+        arg += optarg;
+        const char * p = arg.c_str(); int n = -1;
+        if (*p != ',') {
+          if (sscanf(p, "%lf%n", &rate, &n) == 1 && n > 0)
+            p += n;
+          else
+            badarg = true;
+        }
+        while (*p && !badarg) {
+          char name[8+1] = ""; double v = 0; n = -1;
+          if (!(sscanf(p, ",%8[a-z]=%lf%n", name, &v, &n) == 2 && n > 0))
+            badarg = true;
+          else if (!strcmp(name, "ctrl"))
+            ctrl_rate = v;
+          else if (!strcmp(name, "max") && 1 <= v && v <= 10000 && v == (unsigned)v)
+            max_busy = (unsigned)v;
+          else
+            badarg = true;
+          p += n;
+        }
+        if (!(   !badarg
+              && 0 <= rate && rate <= 1000000 && 0 <= ctrl_rate && ctrl_rate <= 1000000
+              && (rate > 0 || ctrl_rate > 0 || max_busy > 0)                         ))
+          badarg = true;
+        else {
+          io_budget_rate = rate;
+          io_budget_ctrl_rate = ctrl_rate;
+          io_budget_max_busy = max_busy;
+        }
+      }
+      break;
     case 'r':
       // report IOCTL transactions
       {
@@ -5946,6 +7365,24 @@ static int parse_options(int argc, char **argv)
       // path prefix of JSON state file
       json_state_path_prefix = (strcmp(optarg, "-") ? optarg : "");
       break;
+#ifndef _WIN32
+    case 'S':
+      // path of memory mapped state snapshot file
+      shm_state_path = optarg;
+      break;
+#endif
+#ifdef HAVE_POSIX_API
+    case 'P':
+      // URL and options of HTTP collector
+      push_options = http_push_options();
+      badarg_msg = parse_http_push_arg(optarg, push_options);
+      break;
+    case 'm':
+      // Mail relay and options
+      smtp_relay_options = smtp_options();
+      badarg_msg = parse_smtp_arg(optarg, smtp_relay_options);
+      break;
+#endif
     case 'B':
       {
         const char * path = optarg;
@@ -6082,7 +7519,12 @@ static int parse_options(int argc, char **argv)
     if (!(   check_abs_path('p', pid_file)
           && check_abs_path('s', state_path_prefix)
           && check_abs_path('A', attrlog_path_prefix)
-          && check_abs_path('j', json_state_path_prefix)))
+          && check_abs_path('j', json_state_path_prefix)
+          && check_abs_path('S', shm_state_path)
+#ifdef HAVE_POSIX_API
+          && check_abs_path('P', push_options.spool_dir)
+#endif
+                                                          ))
       return EXIT_BADCMD;
   }
 #endif
@@ -6113,6 +7555,26 @@ static int parse_options(int argc, char **argv)
   // print header, don't write Copyright line to syslog
   PrintOut(LOG_INFO, "%s\n", format_version_info("smartd", (debugmode ? 2 : 1)).c_str());
 
+#ifdef HAVE_POSIX_API
+  // Parse URL and load spooled batches of '--push'
+  if (!push_options.url.empty()) {
+    std::string errmsg;
+    if (!pusher.open(push_options,
+                     [](int priority, const std::string & msg)
+                       { PrintOut(priority, "%s\n", msg.c_str()); },
+                     errmsg)) {
+      PrintOut(LOG_CRIT, "Option '--push=%s': %s\n", push_options.url.c_str(), errmsg.c_str());
+      return EXIT_BADCMD;
+    }
+  }
+
+  // Send warning emails via SMTP relay
+  if (!smtp_relay_options.relay.empty())
+    smtp_relay.open(smtp_relay_options,
+                    [](int priority, const std::string & msg)
+                      { PrintOut(priority, "%s\n", msg.c_str()); });
+#endif
+
   // No error, continue in main_worker()
   return -1;
 }
@@ -6291,20 +7753,58 @@ static bool register_device(dev_config & cfg, dev_state & state, smart_device_au
   return true;
 }
 
+// Max number of paths of a multipath device
+const unsigned mpath_max_paths = 32;
+
+// Add DEV as an additional path to a previous device with same identity
+// if both use '-d multipath'.  Return false if there is no such device.
+static bool add_multipath(const dev_config & cfg, smart_device_auto_ptr & dev,
+                          const dev_config_vector & configs, dev_state_vector & states,
+                          smart_device_list & mpath_devices)
+{
+  if (!cfg.multipath)
+    return false;
+  for (unsigned i = 0; i < configs.size(); i++) {
+    const dev_config & prev_cfg = configs[i];
+    if (!(prev_cfg.multipath && is_same_dev_idinfo(cfg, prev_cfg)))
+      continue;
+    dev_state & state = states[i];
+    if (state.mpath_alt.size() + 1 >= mpath_max_paths) {
+      PrintOut(LOG_INFO, "Device: %s, same identity as %s, more than %u paths, ignored\n",
+               cfg.name.c_str(), prev_cfg.name.c_str(), mpath_max_paths);
+      return true;
+    }
+    state.mpath_alt.push_back(dev.get());
+    mpath_devices.push_back(dev);
+    PrintOut(LOG_INFO, "Device: %s, same identity as %s, added as path %u (%s)\n",
+             cfg.name.c_str(), prev_cfg.name.c_str(), (unsigned)state.mpath_alt.size(),
+             (prev_cfg.multipath == 2 ? "roundrobin" : "failover"));
+    return true;
+  }
+  return false;
+}
+
 // This function tries devices from conf_entries.  Each one that can be
 // registered is moved onto the [ata|scsi]devices lists and removed
 // from the conf_entries list.
 static bool register_devices(const dev_config_vector & conf_entries, smart_device_list & scanned_devs,
-                             dev_config_vector & configs, dev_state_vector & states, smart_device_list & devices)
+                             dev_config_vector & configs, dev_state_vector & states,
+                             dev_sched_vector & scheds, smart_device_list & devices,
+                             smart_device_list & mpath_devices)
 {
   // start by clearing lists/memory of ALL existing devices
   configs.clear();
-  devices.clear();
   states.clear();
+  devices.clear();
+  mpath_devices.clear();
+  scheds.clear();
 
   // Map of already seen non-DEVICESCAN devices (unique_name -> cfg.name)
   typedef std::map<std::string, std::string> prev_unique_names_map;
   prev_unique_names_map prev_unique_names;
+  // Map of identities of registered devices provided by the OS
+  // without pass-through commands (os_dev_identity -> cfg.name)
+  prev_unique_names_map prev_os_ids;
 
   // Register entries
   for (unsigned i = 0; i < conf_entries.size(); i++) {
@@ -6346,6 +7846,24 @@ static bool register_devices(const dev_config_vector & conf_entries, smart_devic
       }
     }
 
+    // Get device identity from OS (e.g. Linux sysfs) if available
+    std::string os_id;
+    os_dev_identity osid;
+    if (smi()->get_os_dev_identity(cfg.dev_name.c_str(), cfg.dev_type.c_str(), osid))
+      os_id = osid.get_unique_id();
+    if (debugmode && !os_id.empty())
+      PrintOut(LOG_INFO, "Device: %s, OS identity: %s\n", cfg.name.c_str(), os_id.c_str());
+
+    // Skip other paths of a registered device without opening it
+    if (scanning && !cfg.multipath && !os_id.empty()) {
+      prev_unique_names_map::iterator oi = prev_os_ids.find(os_id);
+      if (oi != prev_os_ids.end()) {
+        PrintOut(LOG_INFO, "Device: %s, same identity as %s (%s), ignored\n",
+                 dev->get_info_name(), oi->second.c_str(), os_id.c_str());
+        continue;
+      }
+    }
+
     // Prevent systemd unit startup timeout when registering many devices
     notify_extend_timeout();
 
@@ -6368,27 +7886,63 @@ static bool register_devices(const dev_config_vector & conf_entries, smart_devic
       continue;
     }
 
-    // move onto the list of devices
-    configs.push_back(cfg);
-    states.push_back(state);
-    devices.push_back(dev);
     if (!scanning)
       // Store for duplicate detection
       prev_unique_names[unique_name] = cfg.name;
+
+    if (!os_id.empty())
+      prev_os_ids.emplace(os_id, cfg.name);
+
+    // Group paths of multipath device
+    if (add_multipath(cfg, dev, configs, states, mpath_devices))
+      continue;
+
+    // move onto the list of devices
+    configs.push_back(cfg);
+    states.push_back(std::move(state));
+    devices.push_back(dev);
   }
 
   // Set minimum check time and factors for staggered tests
   checktime_min = 0;
   unsigned factor = 0;
-  for (auto & cfg : configs) {
+  scheds.resize(configs.size());
+  for (unsigned i = 0; i < configs.size(); i++) {
+    dev_config & cfg = configs[i];
     if (cfg.checktime && (!checktime_min || checktime_min > cfg.checktime))
       checktime_min = cfg.checktime;
     if (!cfg.test_regex.empty())
       cfg.test_offset_factor = factor++;
+    scheds[i].checktime = scheds[i].base_checktime = (cfg.checktime ? cfg.checktime : checktime);
   }
   if (checktime_min && checktime_min > checktime)
     checktime_min = checktime;
 
+  // Use individual check times if '-n ...,w' is specified
+  // to allow early checks of single devices
+  if (!checktime_min) {
+    for (const auto & cfg : configs) {
+      if (cfg.powerwake) {
+        checktime_min = checktime;
+        break;
+      }
+    }
+  }
+
+  if ((io_budget_rate > 0 || io_budget_ctrl_rate > 0) && !scheds.empty()) {
+    // Use individual check times and spread checks after first check
+    // evenly over the interval
+    time_t now = time(nullptr);
+    unsigned n = scheds.size();
+    checktime_min = 0;
+    for (unsigned i = 0; i < n; i++) {
+      dev_sched_state & sched = scheds[i];
+      sched.wakeuptime = now + (time_t)sched.checktime * (i + 1) / n;
+      if (!checktime_min || checktime_min > sched.checktime)
+        checktime_min = sched.checktime;
+    }
+  }
+
   init_disable_standby_check(configs);
   return true;
 }
@@ -6417,8 +7971,12 @@ static int main_worker(int argc, char **argv)
   dev_config_vector configs;
   // Device states
   dev_state_vector states;
+  // Device scheduling data
+  dev_sched_vector scheds;
   // Devices to monitor
   smart_device_list devices;
+  // Additional paths of multipath devices, see dev_state::mpath_alt
+  smart_device_list mpath_devices;
 
   // Drop capabilities if supported and enabled
   capabilities_drop_now();
@@ -6453,11 +8011,13 @@ static int main_worker(int argc, char **argv)
 
         if (entries>=0) {
           // checks devices, then moves onto ata/scsi list or deallocates.
-          if (!register_devices(conf_entries, scanned_devs, configs, states, devices)) {
+          if (!register_devices(conf_entries, scanned_devs, configs, states, scheds, devices,
+                                mpath_devices)) {
             status = EXIT_BADDEV;
             break;
           }
-          if (!(configs.size() == devices.size() && configs.size() == states.size()))
+          if (!(   configs.size() == devices.size() && configs.size() == states.size()
+                && configs.size() == scheds.size()))
             throw std::logic_error("Invalid result from RegisterDevices");
         }
         else if (   quit == QUIT_NEVER
@@ -6500,6 +8060,10 @@ static int main_worker(int argc, char **argv)
         return 0;
       }
 
+      // Create state snapshot file for new configuration
+      if (!shm_state_path.empty())
+        create_shm_state(configs, states, devices);
+
       // reset signal
       caughtsigHUP=0;
 
@@ -6510,13 +8074,34 @@ static int main_worker(int argc, char **argv)
     // check all devices once,
     // self tests are not started in first pass unless '-q onecheck' is specified
     notify_check((int)devices.size());
-    CheckDevicesOnce(configs, states, devices, firstpass, (!firstpass || quit == QUIT_ONECHECK));
+    CheckDevicesOnce(configs, states, scheds, devices, firstpass, (!firstpass || quit == QUIT_ONECHECK),
+                     wakeuptime);
+
+    // Adjust check intervals to I/O budget
+    if ((io_budget_rate > 0 || io_budget_ctrl_rate > 0) && !scheds.empty())
+      update_io_budget(configs, scheds);
 
      // Write state files
     if (!state_path_prefix.empty())
       write_all_dev_states(configs, states, write_states_always);
     write_states_always = false;
 
+#ifdef HAVE_POSIX_API
+    // No name lookup or network I/O before daemon_init(): fork() may
+    // occur while a resolver thread holds NSS locks.  Queued data is sent
+    // by dosleep() after the fork.
+    bool send_now = !(firstpass && !debugmode && quit != QUIT_ONECHECK);
+
+    // Send JSON state to collector (before JSON state files and attrlogs
+    // which clear the dirty flag)
+    if (pusher.is_open())
+      push_all_dev_states(configs, states, send_now);
+
+    // Send warning emails queued during this check
+    if (send_now)
+      flush_smtp_relay(false);
+#endif
+
     // Write JSON state files (before attrlogs which clear the dirty flag)
     if (!json_state_path_prefix.empty())
       write_all_dev_states_json(configs, states);
@@ -6527,6 +8112,10 @@ static int main_worker(int argc, char **argv)
 
     // user has asked us to exit after first check
     if (quit == QUIT_ONECHECK) {
+      shm_state.close();
+#ifdef HAVE_POSIX_API
+      close_smtp_relay();
+#endif
       PrintOut(LOG_INFO,"Started with '-q onecheck' option. All devices successfully checked once.\n"
                "smartd is exiting (exit status 0)\n");
       // assert(firstpass);
@@ -6544,6 +8133,9 @@ static int main_worker(int argc, char **argv)
         // Write PID file if configured
         if (!write_pid_file())
           return EXIT_PID;
+
+        // State snapshot was created by the foreground process
+        shm_state.set_pid();
       }
 
       // Set exit and signal handlers
@@ -6556,7 +8148,7 @@ static int main_worker(int argc, char **argv)
     }
 
     // sleep until next check time, or a signal arrives
-    wakeuptime = dosleep(wakeuptime, configs, states, write_states_always);
+    wakeuptime = dosleep(wakeuptime, configs, states, scheds, devices, write_states_always);
 
   } while (!caughtsigEXIT);
 
@@ -6591,6 +8183,14 @@ static int main_worker(int argc, char **argv)
                  pid_file.c_str(), strerror(errno));
   }
 
+  // Tell readers of the state snapshot that no further updates follow
+  shm_state.close();
+
+#ifdef HAVE_POSIX_API
+  // Try to send warning emails still queued
+  close_smtp_relay();
+#endif
+
   PrintOut((status ? LOG_CRIT : LOG_INFO), "smartd is exiting (exit status %d)\n", status);
   return status;
 }
@@ -0,0 +1,463 @@
+/*
+ * smtp_client.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "smtp_client.h"
+
+#include "http_push.h" // socket_address, send_all()
+
+#include <smartmon/utility.h>
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+using namespace smartmon;
+
+// Retry delays after temporary failures
+const unsigned retry_sec = 60, max_retry_sec = 3600;
+
+// Limits of a digest message, a new message is started if reached
+const unsigned max_digest_count = 100, max_digest_size = 0x40000;
+
+const char * parse_smtp_arg(const char * arg, smtp_options & options)
+{
+  const char * comma = strchr(arg, ',');
+  options.relay.assign(arg, (comma ? comma - arg : strlen(arg)));
+  const char * p = options.relay.c_str();
+  if (!strncmp(p, "unix:", 5)) {
+    options.host = p + 5;
+    options.port.clear();
+    if (options.host.empty() || options.host[0] != '/')
+      return "Unix domain socket requires an absolute path";
+  }
+  else {
+    // HOST[:PORT], HOST may be [IPv6]
+    size_t hl;
+    if (*p == '[') {
+      const char * e = strchr(p, ']');
+      if (!e)
+        return "Missing ']' in relay";
+      options.host.assign(p + 1, e - p - 1);
+      hl = e - p + 1;
+    }
+    else {
+      hl = strcspn(p, ":");
+      options.host.assign(p, hl);
+    }
+    if (options.host.empty())
+      return "Missing relay host name";
+    p += hl;
+    options.port = "25";
+    if (*p == ':') {
+      size_t pl = strspn(++p, "0123456789");
+      if (!pl || p[pl])
+        return "Invalid relay port";
+      options.port = p;
+    }
+    else if (*p)
+      return "Syntax error in relay";
+  }
+
+  for (arg = comma; arg && *arg; ) {
+    if (!strncmp(arg, ",from=", 6)) {
+      size_t fl = strcspn(arg + 6, ",");
+      options.from.assign(arg + 6, fl);
+      if (!(options.from.find('@') != std::string::npos
+            && options.from.find_first_of(" <>\t\r\n") == std::string::npos))
+        return "Invalid sender address";
+      arg += 6 + fl;
+      continue;
+    }
+    if (!strcmp(arg, ",digest") || !strncmp(arg, ",digest,", 8)) {
+      options.digest = true;
+      arg += 7;
+      continue;
+    }
+    char name[8+1] = ""; unsigned v = 0; int n = -1;
+    if (!(sscanf(arg, ",%8[a-z]=%u%n", name, &v, &n) == 2 && n > 0))
+      return "Syntax error in options";
+    if (!strcmp(name, "batch") && v <= 3600)
+      options.batch_sec = v;
+    else if (!strcmp(name, "queue") && 1 <= v && v <= 10000)
+      options.max_queue = v;
+    else if (!strcmp(name, "timeout") && 1 <= v && v <= 300)
+      options.timeout_sec = v;
+    else
+      return "Unknown option or value out of range";
+    arg += n;
+  }
+  return nullptr;
+}
+
+void smtp_client::open(const smtp_options & options, log_func logfn)
+{
+  m_options = options;
+  m_log = logfn;
+
+  char hostname[256] = "";
+  if (gethostname(hostname, sizeof(hostname) - 1) || !*hostname)
+    strcpy(hostname, "localhost");
+  m_hostname = hostname;
+  if (m_options.from.empty())
+    m_options.from = "root@" + m_hostname;
+
+  // Relay is resolved by first flush(), not here (see http_pusher::open())
+  m_addr.set(m_options.host.c_str(),
+             (!m_options.port.empty() ? m_options.port.c_str() : nullptr));
+}
+
+void smtp_client::log(int priority, const char * fmt, ...)
+{
+  if (!m_log)
+    return;
+  va_list ap;
+  va_start(ap, fmt);
+  std::string msg = vstrprintf(fmt, ap);
+  va_end(ap);
+  m_log(priority, msg);
+}
+
+void smtp_client::queue(const std::string & recipients, const std::string & subject,
+                        const std::string & body, time_t now)
+{
+  message msg;
+  for (size_t i = 0; ; ) {
+    i = recipients.find_first_not_of(" ,", i);
+    if (i == std::string::npos)
+      break;
+    size_t j = recipients.find_first_of(" ,", i);
+    std::string rcpt = recipients.substr(i, j - i);
+    // Angle brackets and control characters would break the SMTP command
+    if (rcpt.find_first_of("<>\t\r\n") == std::string::npos)
+      msg.rcpts.push_back(rcpt);
+    else
+      log(LOG_INFO, "Invalid mail address \"%s\" ignored", rcpt.c_str());
+    if (j == std::string::npos)
+      break;
+    i = j;
+  }
+  if (msg.rcpts.empty())
+    return;
+
+  // Append to the newest queued message to the same recipients
+  // unless it is already too large
+  message * prev = nullptr;
+  if (m_options.digest) {
+    for (auto it = m_queue.rbegin(); it != m_queue.rend(); ++it) {
+      if (it->rcpts == msg.rcpts) {
+        if (   it->count < max_digest_count
+            && it->body.size() + body.size() <= max_digest_size)
+          prev = &*it;
+        break;
+      }
+    }
+  }
+  if (prev) {
+    prev->body += "\n----------------------------------------------------------------------\n\n";
+    prev->body += body;
+    prev->date = now;
+    prev->count++;
+  }
+  else {
+    msg.subject = subject;
+    msg.body = body;
+    msg.date = now;
+
+    m_queue.push_back(std::move(msg));
+    while (m_queue.size() > m_options.max_queue) {
+      m_queue.pop_front();
+      log(LOG_CRIT, "SMTP queue full, oldest message dropped");
+    }
+  }
+  // Keep time of a pending retry
+  if (!m_next_try)
+    m_next_try = now + m_options.batch_sec;
+}
+
+// Read a possibly multiline reply, return the code of the last line
+// and the text of all lines.
+bool smtp_client::read_reply(int & code, std::string & reply, std::string & errmsg)
+{
+  reply.clear(); code = 0;
+  for (;;) {
+    size_t nl;
+    while ((nl = m_rbuf.find('\n')) == std::string::npos) {
+      if (m_rbuf.size() > 0x10000) {
+        errmsg = "SMTP reply line too long";
+        return false;
+      }
+      char buf[1024];
+      ssize_t n = recv(m_fd, buf, sizeof(buf), 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        errmsg = (n < 0 ? strprintf("recv(): %s", strerror(errno))
+                        : std::string("Connection closed by relay"));
+        return false;
+      }
+      m_rbuf.append(buf, n);
+    }
+    std::string line = m_rbuf.substr(0, nl);
+    m_rbuf.erase(0, nl + 1);
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+
+    int c = -1, n = -1;
+    if (!(sscanf(line.c_str(), "%3d%n", &c, &n) == 1 && n == 3 && 200 <= c && c <= 599
+          && (!line[3] || line[3] == ' ' || line[3] == '-'))) {
+      errmsg = strprintf("Invalid SMTP reply \"%.60s\"", line.c_str());
+      return false;
+    }
+    if (!reply.empty())
+      reply += ' ';
+    reply += line.c_str() + (line[3] ? 4 : 3);
+    if (line[3] != '-') {
+      code = c;
+      return true;
+    }
+  }
+}
+
+// Send command and read reply.  Return false on I/O errors only.
+bool smtp_client::command(const char * cmd, int & code, std::string & reply,
+                          std::string & errmsg)
+{
+  std::string line = cmd; line += "\r\n";
+  if (!send_all(m_fd, line.data(), line.size())) {
+    errmsg = strprintf("send(): %s", strerror(errno));
+    return false;
+  }
+  return read_reply(code, reply, errmsg);
+}
+
+static const char * const day_names[] = {
+  "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+};
+
+static const char * const month_names[] = {
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+// Format header and body, convert line endings to CRLF and apply
+// dot-stuffing (RFC 5321 4.5.2).
+std::string smtp_client::format_message(const message & msg)
+{
+  // RFC 5322 date, day and month names must not depend on locale
+  struct tm tmbuf, * tm = time_to_tm_local(&tmbuf, msg.date);
+  char zone[16] = "";
+  strftime(zone, sizeof(zone), "%z", tm);
+
+  std::string subject = msg.subject;
+  if (msg.count > 1)
+    subject += strprintf(" (+%u more)", msg.count - 1);
+
+  std::string to;
+  for (const auto & rcpt : msg.rcpts) {
+    if (!to.empty())
+      to += ", ";
+    to += rcpt;
+  }
+
+  std::string data = strprintf(
+    "From: %s\r\n"
+    "To: %s\r\n"
+    "Subject: %s\r\n"
+    "Date: %s, %d %s %d %02d:%02d:%02d %s\r\n"
+    "Message-ID: <smartd.%lld.%u.%u@%s>\r\n"
+    "MIME-Version: 1.0\r\n"
+    "Content-Type: text/plain; charset=utf-8\r\n"
+    "Content-Transfer-Encoding: 8bit\r\n"
+    "X-Mailer: smartd " PACKAGE_VERSION "\r\n"
+    "\r\n",
+    m_options.from.c_str(), to.c_str(), subject.c_str(),
+    day_names[tm->tm_wday], tm->tm_mday, month_names[tm->tm_mon], 1900 + tm->tm_year,
+    tm->tm_hour, tm->tm_min, tm->tm_sec, zone,
+    (long long)msg.date, (unsigned)getpid(), m_msg_seq++, m_hostname.c_str());
+
+  for (size_t i = 0; i < msg.body.size(); ) {
+    size_t nl = msg.body.find('\n', i);
+    size_t end = (nl != std::string::npos ? nl : msg.body.size());
+    if (msg.body[i] == '.')
+      data += '.';
+    data.append(msg.body, i, end - i);
+    if (!data.empty() && data.back() == '\r')
+      data.pop_back();
+    data += "\r\n";
+    i = end + 1;
+  }
+  data += ".\r\n";
+  return data;
+}
+
+// Send one message.  Return false on I/O errors only, CODE is 250
+// if the message was accepted.  Recipients rejected with a 5xx reply
+// are removed from MSG.  If the message was accepted, only recipients
+// rejected with a 4xx reply are kept for a retry.
+bool smtp_client::send_message(message & msg, int & code, std::string & reply,
+                               std::string & errmsg)
+{
+  std::string cmd = "MAIL FROM:<" + m_options.from + '>';
+  if (!command(cmd.c_str(), code, reply, errmsg))
+    return false;
+  if (code != 250)
+    return true;
+
+  std::vector<std::string> accepted, temp_rejected;
+  int rcode = 0, tcode = 0; std::string rreply, treply;
+  for (const auto & rcpt : msg.rcpts) {
+    cmd = "RCPT TO:<" + rcpt + '>';
+    if (!command(cmd.c_str(), code, reply, errmsg))
+      return false;
+    if (code == 250 || code == 251)
+      accepted.push_back(rcpt);
+    else if (code < 500) {
+      log(LOG_INFO, "SMTP relay %s: Recipient %s temporarily rejected: %d %s",
+          m_options.relay.c_str(), rcpt.c_str(), code, reply.c_str());
+      temp_rejected.push_back(rcpt);
+      tcode = code; treply = reply;
+    }
+    else {
+      log(LOG_CRIT, "SMTP relay %s: Recipient %s rejected: %d %s, recipient dropped",
+          m_options.relay.c_str(), rcpt.c_str(), code, reply.c_str());
+      rcode = code; rreply = reply;
+    }
+  }
+  if (accepted.empty()) {
+    if (!temp_rejected.empty()) {
+      msg.rcpts = temp_rejected;
+      code = tcode; reply = treply;
+    }
+    else {
+      code = rcode; reply = rreply;
+    }
+    return true;
+  }
+  // Keep accepted recipients if DATA fails
+  msg.rcpts = accepted;
+  msg.rcpts.insert(msg.rcpts.end(), temp_rejected.begin(), temp_rejected.end());
+
+  if (!command("DATA", code, reply, errmsg))
+    return false;
+  if (code != 354)
+    return true;
+
+  std::string data = format_message(msg);
+  if (!send_all(m_fd, data.data(), data.size())) {
+    errmsg = strprintf("send(): %s", strerror(errno));
+    return false;
+  }
+  if (!read_reply(code, reply, errmsg))
+    return false;
+  if (code == 250) {
+    msg.rcpts = temp_rejected;
+    if (!temp_rejected.empty()) {
+      // Retry these recipients later
+      reply = strprintf("Recipient(s) temporarily rejected: %d %s", tcode, treply.c_str());
+    }
+  }
+  return true;
+}
+
+// Send all queued messages in one session, stop at first temporary failure.
+void smtp_client::flush(time_t now)
+{
+  if (m_queue.empty())
+    return;
+
+  std::string errmsg, reply; int code = 0;
+  m_rbuf.clear();
+  m_fd = m_addr.connect(m_options.timeout_sec, errmsg);
+  bool io_ok = (m_fd >= 0), temp_fail = false;
+  if (io_ok) {
+    std::string cmd = "EHLO " + m_hostname;
+    io_ok = (   read_reply(code, reply, errmsg) && code == 220
+             && command(cmd.c_str(), code, reply, errmsg));
+    if (io_ok && code != 250) {
+      // Relay does not support ESMTP
+      cmd = "HELO " + m_hostname;
+      io_ok = command(cmd.c_str(), code, reply, errmsg);
+    }
+    if (io_ok && code != 250) {
+      errmsg = strprintf("%d %s", code, reply.c_str());
+      temp_fail = true;
+    }
+    else if (!io_ok && errmsg.empty())
+      errmsg = strprintf("%d %s", code, reply.c_str()); // Unexpected greeting
+  }
+
+  unsigned sent = 0;
+  while (io_ok && !temp_fail && !m_queue.empty()) {
+    message & msg = m_queue.front();
+    if (!send_message(msg, code, reply, errmsg)) {
+      io_ok = false;
+      break;
+    }
+    if (code == 250) {
+      sent++;
+      if (msg.rcpts.empty()) {
+        m_queue.pop_front();
+        continue;
+      }
+      // Keep message for the recipients rejected with 4xx
+      errmsg = reply;
+      temp_fail = true;
+      break;
+    }
+    // Abort the mail transaction, keep the session
+    int rcode; std::string rreply;
+    io_ok = command("RSET", rcode, rreply, errmsg);
+    if (code >= 500) {
+      // Retry would fail again
+      log(LOG_CRIT, "SMTP relay %s rejected message \"%s\": %d %s, message dropped",
+          m_options.relay.c_str(), msg.subject.c_str(), code, reply.c_str());
+      m_queue.pop_front();
+      continue;
+    }
+    errmsg = strprintf("%d %s", code, reply.c_str());
+    temp_fail = true;
+  }
+
+  if (m_fd >= 0) {
+    if (io_ok) {
+      std::string qerrmsg;
+      command("QUIT", code, reply, qerrmsg);
+    }
+    close(m_fd);
+    m_fd = -1;
+  }
+
+  if (sent)
+    log(LOG_INFO, "SMTP relay %s: %u message(s) sent", m_options.relay.c_str(), sent);
+
+  if (m_queue.empty()) {
+    if (m_failures)
+      log(LOG_INFO, "SMTP relay %s worked again after %u failure(s)",
+          m_options.relay.c_str(), m_failures);
+    m_failures = 0; m_delay = 0; m_next_try = 0;
+    return;
+  }
+
+  // Exponential backoff
+  m_delay = (!m_delay ? retry_sec : std::min(2 * m_delay, max_retry_sec));
+  m_next_try = now + m_delay;
+  if (!m_failures++)
+    log(LOG_CRIT, "SMTP relay %s failed: %s", m_options.relay.c_str(), errmsg.c_str());
+  log(LOG_INFO, "SMTP relay %s: %u message(s) queued, next try in %u seconds",
+      m_options.relay.c_str(), (unsigned)m_queue.size(), m_delay);
+}
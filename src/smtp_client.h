@@ -0,0 +1,109 @@
+/*
+ * smtp_client.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef SMTP_CLIENT_H
+#define SMTP_CLIENT_H
+
+#include <smartmon/smartmon_defs.h>
+
+#include "http_push.h" // socket_address
+
+#include <time.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Options of smartd '--smtp'
+struct smtp_options
+{
+  std::string relay;                      // Argument as specified: HOST[:PORT] or unix:PATH
+  std::string host;                       // Host name or path of Unix domain socket
+  std::string port;                       // Port, empty for Unix domain socket
+  std::string from;                       // Envelope and header sender, default "root@HOSTNAME"
+  unsigned batch_sec = 0;                 // Collect messages for this time before sending
+  unsigned max_queue = 100;               // Number of queued messages, oldest are dropped
+  unsigned timeout_sec = 10;              // Timeout of connect, send and receive
+  bool digest = false;                    // Combine messages to the same recipients
+};
+
+// Parse argument of '--smtp=HOST[:PORT]|unix:PATH[,OPTION=VALUE,...]'.
+// Return nullptr on success, error message otherwise.
+const char * parse_smtp_arg(const char * arg, smtp_options & options);
+
+// Sends warning messages to a local mail relay via SMTP.  Messages are
+// queued and all queued messages are sent in a single SMTP session.
+// Messages which could not be sent due to a temporary error are retried
+// with exponential backoff.  STARTTLS and AUTH are not supported.
+class smtp_client
+{
+public:
+  // Log callback, PRIORITY is LOG_INFO or LOG_CRIT.
+  typedef std::function<void (int priority, const std::string & msg)> log_func;
+
+  /// Set options and log callback.
+  void open(const smtp_options & options, log_func logfn);
+
+  /// Return true if open() was called.
+  bool is_open() const
+    { return !m_options.relay.empty(); }
+
+  /// Relay as specified, for log messages.
+  const char * get_relay() const
+    { return m_options.relay.c_str(); }
+
+  /// Queue a message to the space or comma separated RECIPIENTS.
+  void queue(const std::string & recipients, const std::string & subject,
+             const std::string & body, time_t now);
+
+  /// Send all queued messages.
+  void flush(time_t now);
+
+  /// Time when queued messages should be sent, 0 if nothing is queued.
+  time_t get_flush_time() const
+    { return (!m_queue.empty() ? m_next_try : 0); }
+
+  /// Number of messages not yet sent.
+  unsigned get_queue_size() const
+    { return m_queue.size(); }
+
+private:
+  smtp_options m_options;
+  log_func m_log;
+  std::string m_hostname;
+  socket_address m_addr;
+
+  struct message {
+    std::vector<std::string> rcpts;
+    std::string subject, body;            // Subject of first message, all bodies
+    time_t date = 0;                      // Date of last message
+    unsigned count = 1;                   // Number of combined messages
+  };
+  std::deque<message> m_queue;
+  unsigned m_msg_seq = 0;
+
+  time_t m_next_try = 0;                  // Time of next flush, 0 = none
+  unsigned m_delay = 0;                   // Current retry delay
+  unsigned m_failures = 0;                // Number of failed sessions in a row
+
+  // Session state
+  int m_fd = -1;
+  std::string m_rbuf;
+
+  bool command(const char * cmd, int & code, std::string & reply, std::string & errmsg);
+  bool read_reply(int & code, std::string & reply, std::string & errmsg);
+  bool send_message(message & msg, int & code, std::string & reply, std::string & errmsg);
+  std::string format_message(const message & msg);
+  void log(int priority, const char * fmt, ...)
+    SMARTMON_FORMAT_PRINTF(3, 4);
+};
+
+#endif // SMTP_CLIENT_H
@@ -0,0 +1,275 @@
+/*
+ * verifyprint.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define __STDC_FORMAT_MACROS 1 // enable PRI* for C++
+
+#include "verifyprint.h"
+
+#include <smartmon/utility.h>
+#include "smartctl.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+using namespace smartmon;
+
+// Interval of progress output and state file updates
+const unsigned progress_interval_sec = 10;
+
+bool parse_verify_arg(const char * arg, verify_print_options & options)
+{
+  uint64_t start = 0, val = 0; char sep = 0; int n = -1;
+  if (!strncmp(arg, "all", 3)) {
+    options.start_lba = 0;
+    options.verify.end_lba = ~(uint64_t)0;
+    arg += 3;
+  }
+  else if (sscanf(arg, "%" SCNu64 "%c%" SCNu64 "%n", &start, &sep, &val, &n) == 3 && n > 0) {
+    if (sep == '-') {
+      if (val < start)
+        return false;
+      options.verify.end_lba = val;
+    }
+    else if (sep == '+') {
+      if (!val || start + val < start)
+        return false;
+      options.verify.end_lba = start + val - 1;
+    }
+    else
+      return false;
+    options.start_lba = start;
+    arg += n;
+  }
+  else
+    return false;
+
+  while (*arg) {
+    if (!strncmp(arg, ",state=", 7)) {
+      // FILE may contain commas, must be last
+      options.state_file = arg + 7;
+      if (options.state_file.empty())
+        return false;
+      break;
+    }
+    char name[8+1] = ""; unsigned v = 0; n = -1;
+    if (!(sscanf(arg, ",%8[a-z]=%u%n", name, &v, &n) == 2 && n > 0))
+      return false;
+    if (!strcmp(name, "chunk") && 1 <= v && v <= 0x10000)
+      options.verify.chunk_blocks = v;
+    else if (!strcmp(name, "rate") && v <= 100000)
+      options.verify.rate_mbps = v;
+    else if (!strcmp(name, "slow") && v <= 3600000)
+      options.verify.slow_msec = v;
+    else if (!strcmp(name, "time"))
+      options.verify.max_seconds = v;
+    else
+      return false;
+    arg += n;
+  }
+  options.enabled = true;
+  return true;
+}
+
+// Progress saved in state file
+struct verify_state
+{
+  uint64_t start_lba = 0, end_lba = 0, next_lba = 0;
+  uint64_t failed_blocks = 0;
+};
+
+static bool read_state_file(const char * path, verify_state & state)
+{
+  stdio_file f(path, "r");
+  if (!f)
+    return false;
+  char line[256];
+  unsigned found = 0;
+  while (fgets(line, sizeof(line), f)) {
+    uint64_t val;
+    if (sscanf(line, "start_lba=%" SCNu64, &val) == 1)
+      state.start_lba = val, found |= 1;
+    else if (sscanf(line, "end_lba=%" SCNu64, &val) == 1)
+      state.end_lba = val, found |= 2;
+    else if (sscanf(line, "next_lba=%" SCNu64, &val) == 1)
+      state.next_lba = val, found |= 4;
+    else if (sscanf(line, "failed_blocks=%" SCNu64, &val) == 1)
+      state.failed_blocks = val;
+  }
+  return (found == 7);
+}
+
+static bool write_state_file(const char * path, const char * devname,
+                             const verify_state & state)
+{
+  stdio_file f(path, "w");
+  if (!f)
+    return false;
+  char datebuf[DATEANDEPOCHLEN];
+  dateandtimezoneepoch(datebuf, time(nullptr));
+  fprintf(f, "# smartctl --verify state, %s\n"
+             "device=%s\n"
+             "start_lba=%" PRIu64 "\n"
+             "end_lba=%" PRIu64 "\n"
+             "next_lba=%" PRIu64 "\n"
+             "failed_blocks=%" PRIu64 "\n",
+          datebuf, devname, state.start_lba, state.end_lba, state.next_lba,
+          state.failed_blocks);
+  return f.close();
+}
+
+static uint64_t count_failed_blocks(const media_verify_result & result)
+{
+  uint64_t cnt = 0;
+  for (const auto & r : result.ranges) {
+    if (r.failed)
+      cnt += r.num_blocks;
+  }
+  return cnt;
+}
+
+int verifyPrintMain(smart_device * device, const verify_print_options & options)
+{
+  if (!(device->is_ata() || device->is_scsi() || device->is_nvme())) {
+    jerr("%s: --verify is not supported for this device\n", device->get_info_name());
+    return FAILCMD;
+  }
+
+  media_verifier verifier(device);
+  if (!verifier.init()) {
+    jerr("%s: Unable to start media verification: %s\n", device->get_info_name(),
+         device->get_errmsg());
+    return FAILID;
+  }
+
+  uint64_t num_blocks = verifier.get_num_blocks();
+  unsigned block_size = verifier.get_block_size();
+  if (options.start_lba >= num_blocks) {
+    jerr("%s: Start LBA %" PRIu64 " exceeds last LBA %" PRIu64 "\n",
+         device->get_info_name(), options.start_lba, num_blocks - 1);
+    return FAILCMD;
+  }
+  media_verify_options vopts = options.verify;
+  if (vopts.end_lba >= num_blocks)
+    vopts.end_lba = num_blocks - 1;
+
+  // Resume if state file matches range
+  verify_state state;
+  state.start_lba = state.next_lba = options.start_lba;
+  state.end_lba = vopts.end_lba;
+  const char * state_file = (!options.state_file.empty() ? options.state_file.c_str() : nullptr);
+  bool resumed = false;
+  if (state_file) {
+    verify_state saved;
+    if (   read_state_file(state_file, saved)
+        && saved.start_lba == state.start_lba && saved.end_lba == state.end_lba
+        && state.start_lba < saved.next_lba && saved.next_lba <= state.end_lba) {
+      state = saved;
+      resumed = true;
+    }
+  }
+
+  bool as_json = jglb.is_enabled();
+  if (!as_json) {
+    pout("Verifying %s: LBA %" PRIu64 "-%" PRIu64 " (%u bytes/block)",
+         device->get_info_name(), state.start_lba, state.end_lba, block_size);
+    if (vopts.rate_mbps)
+      pout(", max %u MB/s", vopts.rate_mbps);
+    pout("\n");
+    if (resumed)
+      pout("Resuming at LBA %" PRIu64 " from %s\n", state.next_lba, state_file);
+    pout("\n");
+  }
+
+  time_t last_progress = time(nullptr);
+  auto progress = [&](const media_verify_result & r) -> bool {
+    time_t now = time(nullptr);
+    if (now - last_progress < (time_t)progress_interval_sec)
+      return true;
+    last_progress = now;
+    if (state_file) {
+      verify_state s = state;
+      s.next_lba = r.next_lba;
+      s.failed_blocks += count_failed_blocks(r);
+      if (!write_state_file(state_file, device->get_dev_name(), s))
+        jerr("%s: %s\n", state_file, strerror(errno));
+    }
+    if (!as_json) {
+      uint64_t total = state.end_lba - state.start_lba + 1;
+      uint64_t done = r.next_lba - state.start_lba;
+      double mbps = (r.usec ? (double)r.blocks_verified * block_size / r.usec : 0);
+      pout("%5.1f%% done, LBA %" PRIu64 ", %.1f MB/s, %u failed, %u slow\n",
+           100.0 * done / total, r.next_lba, mbps, r.failed_chunks, r.slow_chunks);
+    }
+    return true;
+  };
+
+  media_verify_result result;
+  bool ok = verifier.run(state.next_lba, vopts, result, progress);
+
+  verify_state s = state;
+  s.next_lba = (result.complete ? state.start_lba : result.next_lba);
+  s.failed_blocks += count_failed_blocks(result);
+  if (state_file && !write_state_file(state_file, device->get_dev_name(), s))
+    jerr("%s: %s\n", state_file, strerror(errno));
+
+  double secs = result.usec / 1000000.0;
+  uint64_t bytes = result.blocks_verified * block_size;
+  if (!as_json) {
+    char blocks_str[64], bytes_str[64];
+    pout("\nVerified %s blocks (%s bytes) in %.1f seconds (%.1f MB/s), %s\n",
+         format_with_thousands_sep(blocks_str, sizeof(blocks_str), result.blocks_verified),
+         format_with_thousands_sep(bytes_str, sizeof(bytes_str), bytes), secs,
+         (result.usec ? (double)bytes / result.usec : 0.0),
+         (result.complete ? "completed" :
+          strprintf("stopped at LBA %" PRIu64, result.next_lba).c_str()));
+    if (!ok)
+      pout("Verification aborted: %s\n", device->get_errmsg());
+    pout("%u failed, %u slow chunks\n", result.failed_chunks, result.slow_chunks);
+    if (!result.ranges.empty()) {
+      pout("\n%-20s %10s %8s  %s\n", "LBA_first", "Blocks", "Max_ms", "Status");
+      for (const auto & r : result.ranges)
+        pout("%-20" PRIu64 " %10" PRIu64 " %8u  %s\n", r.lba, r.num_blocks, r.msec,
+             (r.failed ? "FAILED" : "slow"));
+    }
+  }
+
+  json::cursor jref(jglb["media_verify"]);
+  jref["start_lba"] = state.start_lba;
+  jref["end_lba"] = state.end_lba;
+  jref["resumed_lba"] = state.next_lba;
+  jref["next_lba"] = result.next_lba;
+  jref["block_size"] = block_size;
+  jref["blocks_verified"] = result.blocks_verified;
+  jref["elapsed_msec"] = result.usec / 1000;
+  jref["completed"] = result.complete;
+  if (!ok)
+    jref["error"] = device->get_errmsg();
+  jref["failed_chunks"] = result.failed_chunks;
+  jref["slow_chunks"] = result.slow_chunks;
+  for (unsigned i = 0; i < result.ranges.size(); i++) {
+    const media_verify_range & r = result.ranges[i];
+    json::ref jr = jref["ranges"][(int)i];
+    jr["lba"] = r.lba;
+    jr["num_blocks"] = r.num_blocks;
+    jr["max_msec"] = r.msec;
+    jr["failed"] = r.failed;
+  }
+
+  int retval = 0;
+  if (!ok)
+    retval |= FAILSMART;
+  if (result.failed_chunks)
+    retval |= FAILERR;
+  return retval;
+}
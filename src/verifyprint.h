@@ -0,0 +1,36 @@
+/*
+ * verifyprint.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef VERIFYPRINT_H
+#define VERIFYPRINT_H
+
+#include <smartmon/dev_interface.h>
+#include <smartmon/mediaverify.h>
+
+#include <string>
+
+// options for verifyPrintMain
+struct verify_print_options
+{
+  bool enabled = false; // --verify was specified
+  uint64_t start_lba = 0;
+  smartmon::media_verify_options verify; // end_lba, chunk, rate, ...
+  std::string state_file; // Progress is saved here and resumed from
+};
+
+// Parse argument of '--verify=RANGE[,OPTION=VALUE,...]'.
+// Return false on error.
+bool parse_verify_arg(const char * arg, verify_print_options & options);
+
+// Verify the medium of an open ATA, SCSI or NVMe device and print
+// failed or slow ranges.
+int verifyPrintMain(smartmon::smart_device * device, const verify_print_options & options);
+
+#endif // VERIFYPRINT_H
@@ -0,0 +1,505 @@
+/*
+ * watchprint.cpp
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define __STDC_FORMAT_MACROS 1 // enable PRI* for C++
+
+#include "watchprint.h"
+
+#include <smartmon/atacmds.h>
+#include <smartmon/knowndrives.h>
+#include <smartmon/nvmecmds.h>
+#include <smartmon/scsicmds.h>
+#include <smartmon/utility.h>
+#include "smartctl.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace smartmon;
+
+namespace {
+
+// One value of a sample
+struct watch_value
+{
+  int id; // ATA attribute ID, -1 otherwise
+  std::string name; // Name for text output
+  std::string key; // Key for JSON output
+  uint64_t value;
+};
+
+struct watch_sample
+{
+  std::vector<watch_value> values;
+  int temperature = -1; // Celsius, -1 if unknown
+  std::string errmsg; // Set if device access failed
+};
+
+// Reads changing data from an open device.  Identity and capabilities
+// are only read once by init().
+class watch_sampler
+{
+public:
+  virtual ~watch_sampler() = default;
+
+  /// Read static information.  Return false and set errmsg on error.
+  virtual bool init(std::string & info, std::string & errmsg) = 0;
+
+  /// Read current values.
+  virtual void read(watch_sample & sample) = 0;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// ATA: SMART attributes
+
+class ata_watch_sampler : public watch_sampler
+{
+public:
+  ata_watch_sampler(ata_device * device, const watch_print_options & options)
+    : m_device(device), m_options(options),
+      m_attribute_defs(options.attribute_defs) { }
+
+  virtual bool init(std::string & info, std::string & errmsg) override;
+  virtual void read(watch_sample & sample) override;
+
+private:
+  ata_device * m_device;
+  const watch_print_options & m_options;
+  ata_vendor_attr_defs m_attribute_defs;
+  int m_rpm = 0;
+};
+
+bool ata_watch_sampler::init(std::string & info, std::string & errmsg)
+{
+  ata_identify_device drive;
+  if (ata_read_identity(m_device, &drive, m_options.fix_swapped_id) < 0) {
+    errmsg = strprintf("Read Device Identity failed: %s", m_device->get_errmsg());
+    return false;
+  }
+  if (ataIsSmartEnabled(&drive) <= 0) {
+    errmsg = "SMART support is not available or disabled";
+    return false;
+  }
+
+  if (!m_options.ignore_presets) {
+    firmwarebug_defs firmwarebugs;
+    std::string dbversion;
+    lookup_drive_apply_presets(&drive, m_attribute_defs, firmwarebugs, dbversion);
+  }
+  m_rpm = ata_get_rotation_rate(&drive);
+
+  char model[40+1], serial[20+1], firmware[8+1];
+  ata_format_id_string(model, drive.model, sizeof(model)-1);
+  ata_format_id_string(serial, drive.serial_no, sizeof(serial)-1);
+  ata_format_id_string(firmware, drive.fw_rev, sizeof(firmware)-1);
+  info = strprintf("%s, S/N:%s, FW:%s", model,
+                   (dont_print_serial_number ? "[No Information Found]" : serial),
+                   firmware);
+  return true;
+}
+
+// Return true if the attribute is used for the temperature
+static bool is_temperature_attr(unsigned char id, const ata_vendor_attr_defs & defs)
+{
+  ata_attr_raw_format format = defs[id].raw_format;
+  return (   ((id == 194 || id == 190) && format == RAWFMT_DEFAULT)
+          || format == RAWFMT_TEMPMINMAX || format == RAWFMT_TEMP10X);
+}
+
+void ata_watch_sampler::read(watch_sample & sample)
+{
+  ata_smart_values smartval;
+  if (ataReadSmartValues(m_device, &smartval)) {
+    sample.errmsg = strprintf("Read SMART Data failed: %s", m_device->get_errmsg());
+    return;
+  }
+
+  unsigned char temp = ata_return_temperature_value(&smartval, m_attribute_defs);
+  if (temp)
+    sample.temperature = temp;
+
+  for (const ata_smart_attribute & attr : smartval.vendor_attributes) {
+    if (!attr.id || is_temperature_attr(attr.id, m_attribute_defs))
+      continue;
+    watch_value v;
+    v.id = attr.id;
+    v.name = ata_get_smart_attr_name(attr.id, m_attribute_defs, m_rpm);
+    v.key = v.name;
+    v.value = ata_get_attr_raw_value(attr, m_attribute_defs);
+    sample.values.push_back(v);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// SCSI: Error counter and non-medium error log pages
+
+class scsi_watch_sampler : public watch_sampler
+{
+public:
+  explicit scsi_watch_sampler(scsi_device * device)
+    : m_device(device) { }
+
+  virtual bool init(std::string & info, std::string & errmsg) override;
+  virtual void read(watch_sample & sample) override;
+
+private:
+  scsi_device * m_device;
+  // Pages are not read again if not supported (ILLEGAL REQUEST),
+  // other errors are retried with the next sample
+  bool m_no_temp = false;
+  bool m_no_page[4] = { false, false, false, false };
+};
+
+bool scsi_watch_sampler::init(std::string & info, std::string & errmsg)
+{
+  uint8_t inq[96] = {};
+  int err = scsiStdInquiry(m_device, inq, sizeof(inq));
+  if (err) {
+    errmsg = strprintf("Standard Inquiry failed [%s]", scsiErrString(err));
+    return false;
+  }
+  char vendor[8+1], product[16+1], revision[4+1];
+  format_char_array(vendor, (const char *)inq + 8, 8);
+  format_char_array(product, (const char *)inq + 16, 16);
+  format_char_array(revision, (const char *)inq + 32, 4);
+  info = strprintf("%s %s, Rev:%s", vendor, product, revision);
+  return true;
+}
+
+// Return true if scsiLogSense() error ERR indicates an unsupported page.
+static bool is_scsi_illegal_request(int err)
+{
+  return (   err == SIMPLE_ERR_BAD_OPCODE || err == SIMPLE_ERR_BAD_FIELD
+          || err == SIMPLE_ERR_BAD_PARAM);
+}
+
+void scsi_watch_sampler::read(watch_sample & sample)
+{
+  // Keep the first transient error, values of this sample are incomplete
+  auto set_error = [&sample](const char * what, int err) {
+    if (sample.errmsg.empty())
+      sample.errmsg = strprintf("Read %s log page failed [%s]", what, scsiErrString(err));
+  };
+
+  if (!m_no_temp) {
+    uint8_t temp = 0, trip = 0;
+    int err = scsiGetTemp(m_device, &temp, &trip);
+    if (is_scsi_illegal_request(err))
+      m_no_temp = true;
+    else if (err)
+      set_error("Temperature", err);
+    else if (0 < temp && temp < 255)
+      sample.temperature = temp;
+  }
+
+  static const struct {
+    int page; const char * name, * key;
+  } ec_pages[3] = {
+    { READ_ERROR_COUNTER_LPAGE,   "Read",   "read" },
+    { WRITE_ERROR_COUNTER_LPAGE,  "Write",  "write" },
+    { VERIFY_ERROR_COUNTER_LPAGE, "Verify", "verify" }
+  };
+
+  uint8_t buf[252];
+  int cnt = 0;
+  for (int k = 0; k < 3; k++) {
+    if (m_no_page[k])
+      continue;
+    int err = scsiLogSense(m_device, ec_pages[k].page, 0, buf, sizeof(buf), 0);
+    if (err) {
+      if (is_scsi_illegal_request(err))
+        m_no_page[k] = true;
+      else
+        set_error("Error Counter", err);
+      continue;
+    }
+    scsiErrorCounter ecp;
+    scsiDecodeErrCounterPage(buf, &ecp, sizeof(buf));
+    const char * name = ec_pages[k].name, * key = ec_pages[k].key;
+    sample.values.push_back({-1, strprintf("%s_Errors_Corrected", name),
+                             strprintf("%s_total_errors_corrected", key), ecp.counter[3]});
+    sample.values.push_back({-1, strprintf("%s_Bytes_Processed", name),
+                             strprintf("%s_bytes_processed", key), ecp.counter[5]});
+    sample.values.push_back({-1, strprintf("%s_Errors_Uncorrected", name),
+                             strprintf("%s_total_uncorrected_errors", key), ecp.counter[6]});
+    cnt++;
+  }
+
+  if (!m_no_page[3]) {
+    int err = scsiLogSense(m_device, NON_MEDIUM_ERROR_LPAGE, 0, buf, sizeof(buf), 0);
+    if (is_scsi_illegal_request(err))
+      m_no_page[3] = true;
+    else if (err)
+      set_error("Non-Medium Error", err);
+    else {
+      scsiNonMediumError nme;
+      scsiDecodeNonMediumErrPage(buf, &nme, sizeof(buf));
+      if (nme.gotPC0)
+        sample.values.push_back({-1, "Non-medium_Errors", "non_medium_error_count",
+                                 nme.counterPC0});
+      cnt++;
+    }
+  }
+
+  if (!cnt && m_no_temp && sample.errmsg.empty())
+    sample.errmsg = "No error counter or temperature log pages available";
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// NVMe: SMART/Health Information log
+
+class nvme_watch_sampler : public watch_sampler
+{
+public:
+  explicit nvme_watch_sampler(nvme_device * device)
+    : m_device(device) { }
+
+  virtual bool init(std::string & info, std::string & errmsg) override;
+  virtual void read(watch_sample & sample) override;
+
+private:
+  nvme_device * m_device;
+  uint32_t m_nsid = nvme_broadcast_nsid;
+};
+
+bool nvme_watch_sampler::init(std::string & info, std::string & errmsg)
+{
+  nvme_id_ctrl id_ctrl;
+  if (!nvme_read_id_ctrl(m_device, id_ctrl)) {
+    errmsg = strprintf("Read NVMe Identify Controller failed: %s", m_device->get_errmsg());
+    return false;
+  }
+  // Use individual NSID if SMART/Health Information per namespace is supported
+  m_nsid = ((id_ctrl.lpa & 0x01) ? m_device->get_nsid() : nvme_broadcast_nsid);
+
+  char model[40+1], serial[20+1], firmware[8+1];
+  format_char_array(model, id_ctrl.mn);
+  format_char_array(serial, id_ctrl.sn);
+  format_char_array(firmware, id_ctrl.fr);
+  info = strprintf("%s, S/N:%s, FW:%s", model,
+                   (dont_print_serial_number ? "[No Information Found]" : serial),
+                   firmware);
+  return true;
+}
+
+void nvme_watch_sampler::read(watch_sample & sample)
+{
+  nvme_smart_log smart_log;
+  if (!nvme_read_smart_log(m_device, m_nsid, smart_log)) {
+    sample.errmsg = strprintf("Read NVMe SMART/Health Information failed: %s",
+                              m_device->get_errmsg());
+    return;
+  }
+
+  int k = uile16_to_uint(smart_log.temperature);
+  if (k)
+    sample.temperature = k - 273;
+
+  const struct {
+    const char * name, * key; uint64_t value;
+  } values[] = {
+    { "Critical_Warning",       "critical_warning",      smart_log.critical_warning },
+    { "Available_Spare",        "available_spare",       smart_log.avail_spare },
+    { "Percentage_Used",        "percentage_used",       smart_log.percent_used },
+    { "Data_Units_Read",        "data_units_read",       uile128_clamp_to_uint64(smart_log.data_units_read) },
+    { "Data_Units_Written",     "data_units_written",    uile128_clamp_to_uint64(smart_log.data_units_written) },
+    { "Host_Read_Commands",     "host_reads",            uile128_clamp_to_uint64(smart_log.host_reads) },
+    { "Host_Write_Commands",    "host_writes",           uile128_clamp_to_uint64(smart_log.host_writes) },
+    { "Controller_Busy_Time",   "controller_busy_time",  uile128_clamp_to_uint64(smart_log.ctrl_busy_time) },
+    { "Power_Cycles",           "power_cycles",          uile128_clamp_to_uint64(smart_log.power_cycles) },
+    { "Power_On_Hours",         "power_on_hours",        uile128_clamp_to_uint64(smart_log.power_on_hours) },
+    { "Unsafe_Shutdowns",       "unsafe_shutdowns",      uile128_clamp_to_uint64(smart_log.unsafe_shutdowns) },
+    { "Media_Errors",           "media_errors",          uile128_clamp_to_uint64(smart_log.media_errors) },
+    { "Error_Log_Entries",      "num_err_log_entries",   uile128_clamp_to_uint64(smart_log.num_err_log_entries) },
+    { "Warning_Temp_Time",      "warning_temp_time",     smart_log.warning_temp_time },
+    { "Critical_Temp_Time",     "critical_comp_time",    smart_log.critical_comp_time }
+  };
+  for (const auto & v : values)
+    sample.values.push_back({-1, v.name, v.key, v.value});
+}
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////
+// Output
+
+// Find value of previous sample, nullptr if none
+static const watch_value * find_value(const watch_sample & prev,
+  const watch_value & v, unsigned index)
+{
+  // Order is usually unchanged
+  if (index < prev.values.size()) {
+    const watch_value & p = prev.values[index];
+    if (p.id == v.id && p.key == v.key)
+      return &p;
+  }
+  for (const watch_value & p : prev.values) {
+    if (p.id == v.id && p.key == v.key)
+      return &p;
+  }
+  return nullptr;
+}
+
+static void print_sample_text(unsigned num, time_t now, double elapsed,
+  const watch_sample & sample, const watch_sample * prev)
+{
+  char timestr[32];
+  struct tm tmbuf;
+  strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", time_to_tm_local(&tmbuf, now));
+  pout("%s  #%u", timestr, num);
+  if (sample.temperature >= 0) {
+    pout("  Temperature: %d Celsius", sample.temperature);
+    if (prev && prev->temperature >= 0 && prev->temperature != sample.temperature)
+      pout(" (%+d)", sample.temperature - prev->temperature);
+  }
+  if (prev)
+    pout("  Interval: %.1fs", elapsed);
+  pout("\n");
+
+  if (!sample.errmsg.empty()) {
+    jerr("%s\n", sample.errmsg.c_str());
+    return;
+  }
+
+  bool header = false;
+  for (unsigned i = 0; i < sample.values.size(); i++) {
+    const watch_value & v = sample.values[i];
+    const watch_value * p = (prev ? find_value(*prev, v, i) : nullptr);
+    if (prev && p && p->value == v.value)
+      continue;
+    if (!header) {
+      pout("%-4s %-28s %20s%s\n", (v.id >= 0 ? "ID#" : ""), "NAME", "VALUE",
+           (prev ? "          DELTA    RATE/s" : ""));
+      header = true;
+    }
+    char valstr[32];
+    format_with_thousands_sep(valstr, sizeof(valstr), v.value);
+    char idstr[16] = "";
+    if (v.id >= 0)
+      snprintf(idstr, sizeof(idstr), "%3d", v.id);
+    if (!(prev && p)) {
+      pout("%-4s %-28s %20s%s\n", idstr, v.name.c_str(), valstr,
+           (prev ? "            new" : ""));
+      continue;
+    }
+    int64_t delta = (int64_t)(v.value - p->value);
+    pout("%-4s %-28s %20s %+14" PRId64 " %9.1f\n", idstr, v.name.c_str(), valstr,
+         delta, (elapsed > 0 ? delta / elapsed : 0.0));
+  }
+  if (prev && !header)
+    pout("No changes\n");
+  pout("\n");
+}
+
+static void print_sample_json(const smart_device * device, unsigned num,
+  time_t now, double elapsed, const watch_sample & sample, const watch_sample * prev)
+{
+  json js;
+  js.enable();
+  js["device"]["name"] = device->get_info_name();
+  js["sample"] = num;
+  js["time_t"] = (long long)now;
+  if (prev)
+    js["interval_msec"] = (long long)(elapsed * 1000 + 0.5);
+  if (sample.temperature >= 0)
+    js["temperature"]["current"] = sample.temperature;
+  if (!sample.errmsg.empty())
+    js["error"] = sample.errmsg;
+
+  unsigned n = 0;
+  for (unsigned i = 0; i < sample.values.size(); i++) {
+    const watch_value & v = sample.values[i];
+    const watch_value * p = (prev ? find_value(*prev, v, i) : nullptr);
+    json::ref jref = js["values"][n++];
+    if (v.id >= 0)
+      jref["id"] = v.id;
+    jref["name"] = v.key;
+    jref["value"] = v.value;
+    if (p) {
+      int64_t delta = (int64_t)(v.value - p->value);
+      jref["delta"] = delta;
+      jref["rate"] = strprintf("%.3f", (elapsed > 0 ? delta / elapsed : 0.0));
+    }
+  }
+
+  json::output_options opts; // compact, one line per sample
+  js.output([](const char * str){ fputs(str, stdout); }, nullptr, opts);
+  fputs("\n", stdout);
+  fflush(stdout);
+}
+
+int watchPrintMain(smart_device * device, const watch_print_options & options)
+{
+  std::unique_ptr<watch_sampler> sampler;
+  if (device->is_ata())
+    sampler.reset(new ata_watch_sampler(device->to_ata(), options));
+  else if (device->is_scsi())
+    sampler.reset(new scsi_watch_sampler(device->to_scsi()));
+  else if (device->is_nvme())
+    sampler.reset(new nvme_watch_sampler(device->to_nvme()));
+  else {
+    jerr("%s: --watch is not supported for this device\n", device->get_info_name());
+    return FAILCMD;
+  }
+
+  std::string info, errmsg;
+  if (!sampler->init(info, errmsg)) {
+    jerr("%s\n", errmsg.c_str());
+    return FAILID;
+  }
+
+  bool as_json = jglb.is_enabled();
+  if (!as_json)
+    pout("Watching %s: %s, every %u second%s%s\n\n", device->get_info_name(),
+         info.c_str(), options.interval, (options.interval == 1 ? "" : "s"),
+         (!options.count ? " (Ctrl-C to stop)" : ""));
+
+  watch_sample prev;
+  long long prev_usec = 0;
+  long long start_usec = get_timer_usec();
+  int retval = 0;
+  for (unsigned num = 1; ; num++) {
+    watch_sample sample;
+    long long now_usec = get_timer_usec();
+    sampler->read(sample);
+    time_t now = time(nullptr);
+
+    bool have_prev = (num > 1 && prev.errmsg.empty());
+    double elapsed = (have_prev ? (now_usec - prev_usec) / 1000000.0 : 0);
+    if (as_json)
+      print_sample_json(device, num, now, elapsed, sample, (have_prev ? &prev : nullptr));
+    else
+      print_sample_text(num, now, elapsed, sample, (have_prev ? &prev : nullptr));
+
+    if (!sample.errmsg.empty())
+      retval |= FAILSMART;
+    prev = std::move(sample);
+    prev_usec = now_usec;
+
+    if (options.count && num >= options.count)
+      break;
+
+    // Keep the schedule independent of the duration of the commands
+    long long next_usec = start_usec + (long long)num * options.interval * 1000000;
+    long long wait_usec = next_usec - get_timer_usec();
+    if (wait_usec > 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(wait_usec));
+  }
+  return retval;
+}
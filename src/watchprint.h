@@ -0,0 +1,32 @@
+/*
+ * watchprint.h
+ *
+ * Home page of code is: https://www.smartmontools.org
+ *
+ * Copyright (C) 2026 Christian Franke
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef WATCHPRINT_H
+#define WATCHPRINT_H
+
+#include <smartmon/atacmds.h>
+#include <smartmon/dev_interface.h>
+
+// options for watchPrintMain
+struct watch_print_options
+{
+  unsigned interval = 0; // seconds, 0 = no --watch
+  unsigned count = 0; // number of samples, 0 = unlimited
+  bool fix_swapped_id = false;
+  bool ignore_presets = false;
+  smartmon::ata_vendor_attr_defs attribute_defs;
+};
+
+// Sample changing counters of an open device every INTERVAL seconds
+// and print the differences.  With JSON enabled, print one compact
+// JSON object per sample.
+int watchPrintMain(smartmon::smart_device * device, const watch_print_options & options);
+
+#endif // WATCHPRINT_H